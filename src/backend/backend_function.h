@@ -9,6 +9,8 @@
 
 #include "interfaces/printable.h"
 #include "interfaces/uncopyable.h"
+#include "memory_report.h"
+#include "profile.h"
 
 namespace simit {
 class Set;
@@ -61,6 +63,17 @@ public:
   /// Print the function as machine assembly code to the stream.
   virtual void printMachine(std::ostream &os) const = 0;
 
+  /// Returns the memory held by the function. Backends that do not account
+  /// for memory return an empty report.
+  virtual MemoryReport getMemoryReport() const {return MemoryReport();}
+
+  /// The stages of compiling the function. Backends add their own stages,
+  /// and the compiler may add the frontend and lowering stages before them.
+  const CompileProfile& getCompileProfile() const {return compileProfile;}
+  void setCompileProfile(const CompileProfile& profile) {
+    compileProfile = profile;
+  }
+
   bool hasArg(std::string arg) const;
   const std::vector<std::string>& getArgs() const;
   const ir::Type& getArgType(std::string arg) const;
@@ -74,6 +87,9 @@ public:
 
   const ir::Environment& getEnvironment() const;
 
+protected:
+  CompileProfile compileProfile;
+
 private:
   ir::Environment* environment;
 
@@ -443,6 +443,8 @@ llvm::Value *GPUFunction::pushArg(std::string name, ir::Type& argType, Actual* a
       setData.push_back(llvmPtr(LLVM_INT_PTR, reinterpret_cast<void*>(
           *(pushedData.nbrIndex->devBuffer))));
     }
+    // Partition table (not used on the GPU)
+    setData.push_back(llvmPtr(LLVM_INT_PTR, nullptr));
     // Fields
     ir::Type ety = setType->elementType;
     iassert(ety.isElement()) << "Set element type must be ElementType.";
@@ -701,6 +703,7 @@ GPUFunction::init() {
       std::vector<DeviceDataHandle*> handleVec;
       
       size_t expectedSize = sizeof(int) // setSize
+          + sizeof(void*) // partition table
           + pushedData.fields.size() * sizeof(void*); // fields
       if (setType->getCardinality() > 0) {
         expectedSize += 3*sizeof(void*); // endpoints and indices arrays
@@ -724,6 +727,9 @@ GPUFunction::init() {
         handleVec.push_back(pushedData.startIndex);
         handleVec.push_back(pushedData.nbrIndex);
       }
+      // Partition table (not used on the GPU)
+      *(void**)globalPtrHost = nullptr;
+      globalPtrHost = ((void**)globalPtrHost)+1;
       // NOTE: This code assumes the width of void* is the same as
       // and float*/int* on the GPU.
       for (DeviceDataHandle *fieldHandle : pushedData.fields) {
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <iostream>
+#include <set>
 #include <stack>
 #include <algorithm>
 
@@ -22,10 +23,32 @@
 #endif
 
 #include "llvm/ADT/SmallVector.h"
+#if !(LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5)
+#include "llvm/IR/MDBuilder.h"
+#endif
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Host.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#if !(LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6)
+#include "llvm/Analysis/TargetTransformInfo.h"
+#endif
+
+#if LLVM_MAJOR_VERSION <= 3
+#include "llvm/Bitcode/ReaderWriter.h"
+#else
+#include "llvm/Bitcode/BitcodeReader.h"
+#endif
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
+#include "llvm/Linker.h"
+#else
+#include "llvm/Linker/Linker.h"
+#endif
+#include "llvm/Support/MemoryBuffer.h"
 
 #include "llvm/Analysis/Passes.h"
+#include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #if LLVM_MAJOR_VERSION <=3 && LLVM_MINOR_VERSION <= 6
@@ -43,17 +66,21 @@
 #include "types.h"
 #include "func.h"
 #include "ir.h"
+#include "init.h"
 #include "intrinsics.h"
 #include "ir_printer.h"
 #include "ir_queries.h"
 #include "ir_transforms.h"
 #include "ir_rewriter.h" // TODO: Remove this header
 #include "environment.h"
+#include "memory_tracker.h"
 #include "tensor_index.h"
+#include "timers.h"
 #include "llvm_function.h"
 #include "macros.h"
 #include "path_expressions.h"
 #include "util/collections.h"
+#include "util/util.h"
 
 using namespace std;
 using namespace simit::ir;
@@ -68,6 +95,46 @@ const std::string LEN_SUFFIX(".len");
 // class LLVMBackend
 bool LLVMBackend::llvmInitialized = false;
 
+/// The CPU to generate code for.
+static string getTargetCPU() {
+  return (kTargetCPU == "native") ? llvm::sys::getHostCPUName().str()
+                                  : kTargetCPU;
+}
+
+/// The target features of the CPU to generate code for, followed by the
+/// features of the settings, that take precedence.
+static vector<string> getTargetFeatures() {
+  vector<string> features;
+  if (kTargetCPU == "native") {
+    llvm::StringMap<bool> hostFeatures;
+    if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+      for (auto &feature : hostFeatures) {
+        features.push_back((feature.second ? "+" : "-") +
+                           feature.first().str());
+      }
+    }
+  }
+  for (auto &feature : util::split(kTargetFeatures, ",")) {
+    if (util::trim(feature) != "") {
+      features.push_back(util::trim(feature));
+    }
+  }
+  return features;
+}
+
+static llvm::CodeGenOpt::Level getCodeGenOptLevel() {
+  switch (kOptLevel) {
+    case 0:
+      return llvm::CodeGenOpt::None;
+    case 1:
+      return llvm::CodeGenOpt::Less;
+    case 2:
+      return llvm::CodeGenOpt::Default;
+    default:
+      return llvm::CodeGenOpt::Aggressive;
+  }
+}
+
 shared_ptr<llvm::EngineBuilder> createEngineBuilder(llvm::Module *module) {
 #if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
   shared_ptr<llvm::EngineBuilder> engineBuilder(new llvm::EngineBuilder(module));
@@ -75,10 +142,121 @@ shared_ptr<llvm::EngineBuilder> createEngineBuilder(llvm::Module *module) {
   shared_ptr<llvm::EngineBuilder> engineBuilder(new llvm::EngineBuilder(
       unique_ptr<llvm::Module>(module)));
 #endif
+
+  llvm::TargetOptions options;
+  if (kFastMath) {
+    options.UnsafeFPMath = true;
+    options.NoInfsFPMath = true;
+    options.NoNaNsFPMath = true;
+    options.AllowFPOpFusion = llvm::FPOpFusion::Fast;
+  }
+  engineBuilder->setMCPU(getTargetCPU());
+  engineBuilder->setMAttrs(getTargetFeatures());
+  engineBuilder->setOptLevel(getCodeGenOptLevel());
+  engineBuilder->setTargetOptions(options);
   return engineBuilder;
 }
 
-LLVMBackend::LLVMBackend() : builder(new SimitIRBuilder(LLVM_CTX)) {
+extern "C" unsigned char simit_runtime_intrinsics[];
+extern "C" int simit_runtime_intrinsics_length;
+
+/// Link the definitions of the runtime intrinsics that the module calls into
+/// the module, from the bitcode of `runtime_intrinsics.cpp' embedded in the
+/// library, so that the optimizer can inline them. If the library was built
+/// without the bitcode the module calls the intrinsics of the library.
+static void linkRuntimeIntrinsics(llvm::Module *module) {
+  if (simit_runtime_intrinsics_length == 0) {
+    return;
+  }
+  llvm::StringRef bitcode(
+      reinterpret_cast<const char*>(simit_runtime_intrinsics),
+      simit_runtime_intrinsics_length);
+
+  set<string> declared;
+  for (llvm::Function &function : *module) {
+    if (function.isDeclaration()) {
+      declared.insert(function.getName().str());
+    }
+  }
+
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
+  unique_ptr<llvm::MemoryBuffer> buffer(
+      llvm::MemoryBuffer::getMemBuffer(bitcode, "runtime_intrinsics", false));
+  string error;
+  unique_ptr<llvm::Module> runtime(
+      llvm::ParseBitcodeFile(buffer.get(), LLVM_CTX, &error));
+  iassert(runtime != nullptr) << "could not read the runtime intrinsics: "
+                              << error;
+#elif LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  unique_ptr<llvm::MemoryBuffer> buffer(
+      llvm::MemoryBuffer::getMemBuffer(bitcode, "runtime_intrinsics", false));
+  llvm::ErrorOr<llvm::Module*> parsed =
+      llvm::parseBitcodeFile(buffer.get(), LLVM_CTX);
+  iassert(parsed) << "could not read the runtime intrinsics";
+  unique_ptr<llvm::Module> runtime(parsed.get());
+#elif LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+  llvm::ErrorOr<llvm::Module*> parsed = llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(bitcode, "runtime_intrinsics"), LLVM_CTX);
+  iassert(parsed) << "could not read the runtime intrinsics";
+  unique_ptr<llvm::Module> runtime(parsed.get());
+#elif LLVM_MAJOR_VERSION <= 3
+  llvm::ErrorOr<unique_ptr<llvm::Module>> parsed = llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(bitcode, "runtime_intrinsics"), LLVM_CTX);
+  iassert(parsed) << "could not read the runtime intrinsics";
+  unique_ptr<llvm::Module> runtime = std::move(parsed.get());
+#else
+  llvm::Expected<unique_ptr<llvm::Module>> parsed = llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(bitcode, "runtime_intrinsics"), LLVM_CTX);
+  iassert(bool(parsed)) << "could not read the runtime intrinsics: "
+                        << llvm::toString(parsed.takeError());
+  unique_ptr<llvm::Module> runtime = std::move(parsed.get());
+#endif
+
+  // Only link the intrinsics that the module calls, and that it does not
+  // define itself
+  set<string> linked;
+  for (llvm::Function &function : *runtime) {
+    if (function.isDeclaration()) {
+      continue;
+    }
+    if (util::contains(declared, function.getName().str())) {
+      linked.insert(function.getName().str());
+    }
+    else {
+      function.deleteBody();
+    }
+  }
+  if (linked.size() == 0) {
+    return;
+  }
+
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  bool failed = llvm::Linker::LinkModules(module, runtime.get(),
+                                          llvm::Linker::DestroySource, &error);
+#elif LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 7
+  bool failed = llvm::Linker::LinkModules(module, runtime.get());
+#else
+  bool failed = llvm::Linker::linkModules(*module, std::move(runtime));
+#endif
+  iassert(!failed) << "could not link the runtime intrinsics";
+
+  // The linked intrinsics are private to the module, so that they are removed
+  // once they have been inlined into all their callers
+  for (const string &name : linked) {
+    llvm::Function *function = module->getFunction(name);
+    function->setLinkage(llvm::GlobalValue::InternalLinkage);
+    function->addFnAttr(llvm::Attribute::AlwaysInline);
+#if !(LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6)
+    // Generate the intrinsics for the CPU of the module, rather than for the
+    // CPU the bitcode was compiled for
+    function->removeFnAttr("target-cpu");
+    function->removeFnAttr("target-features");
+#endif
+  }
+}
+
+LLVMBackend::LLVMBackend()
+    : allocator(-1), builder(new SimitIRBuilder(LLVM_CTX)) {
   if (!llvmInitialized) {
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
@@ -125,6 +303,8 @@ Func LLVMBackend::makeSystemTensorsGlobal(Func func) {
 }
 
 Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
+  CompileProfile profile;
+  CompileTimer timer(&profile);
   this->module = new llvm::Module("simit", LLVM_CTX);
 
   iassert(func.getBody().defined()) << "cannot compile an undefined function";
@@ -134,12 +314,25 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
   this->symtable.clear();
   this->buffers.clear();
   this->globals.clear();
+  this->arrays.clear();
   this->storage = storage;
+  this->allocator = internal::MemoryTracker::getInstance().addAllocator();
 
   // This backend stores dense tensors and sparse tensors with path expressions
   // as globals.
   func = makeSystemTensorsGlobal(func);
 
+  // Floating point operations carry the fast-math flags of the settings
+  llvm::FastMathFlags fastMathFlags;
+  if (kFastMath) {
+#if LLVM_MAJOR_VERSION <= 5
+    fastMathFlags.setUnsafeAlgebra();
+#else
+    fastMathFlags.setFast();
+#endif
+  }
+  builder->SetFastMathFlags(fastMathFlags);
+
   this->environment = &func.getEnvironment();
   emitGlobals(*this->environment);
 
@@ -173,6 +366,8 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
     // we move all the var decls to the front of the function body
     Stmt body = moveVarDeclsToFront(f.getBody());
 
+    emitFieldAliasScopes(body);
+    emitTimers(body);
     compile(body);
     builder->CreateRetVoid();
 
@@ -180,15 +375,15 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
   }
   iassert(llvmFunc);
 
-  // Declare malloc and free if necessary
+  // Declare the tracked malloc and free if necessary
   llvm::FunctionType *m =
-      llvm::FunctionType::get(LLVM_INT8_PTR, {LLVM_INT}, false);
+      llvm::FunctionType::get(LLVM_INT8_PTR, {LLVM_INT, LLVM_INT}, false);
   llvm::Function *malloc =
-      llvm::cast<llvm::Function>(module->getOrInsertFunction("malloc", m));
+      llvm::cast<llvm::Function>(module->getOrInsertFunction("simitMalloc",m));
   llvm::FunctionType *f =
       llvm::FunctionType::get(LLVM_VOID, {LLVM_INT8_PTR}, false);
   llvm::Function *free =
-      llvm::cast<llvm::Function>(module->getOrInsertFunction("free", f));
+      llvm::cast<llvm::Function>(module->getOrInsertFunction("simitFree", f));
 
   // Create initialization function
   emitEmptyFunction(func.getName()+"_init", func.getArguments(),
@@ -205,7 +400,7 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
     llvm::Value *len= emitComputeLen(ttype,this->storage.getStorage(bufferVar));
     unsigned compSize = ttype->getComponentType().bytes();
     llvm::Value *size = builder->CreateMul(len, llvmInt(compSize));
-    llvm::Value *mem = builder->CreateCall(malloc, size);
+    llvm::Value *mem = builder->CreateCall(malloc, {llvmInt(allocator), size});
 
     mem = builder->CreateCast(llvm::Instruction::CastOps::BitCast, mem, ltype);
     builder->CreateStore(mem, bufferVal);
@@ -229,51 +424,83 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
   builder->CreateRetVoid();
   symtable.clear();
 
+  linkRuntimeIntrinsics(module);
+
   iassert(!llvm::verifyModule(*module))
       << "LLVM module does not pass verification";
+  timer.endStage("Emit LLVM IR");
 
   auto engineBuilder = createEngineBuilder(module);
 
+  // Vectorized loops use vectors of the preferred width
+  if (kVectorWidth > 0) {
+    for (llvm::Function &function : *module) {
+      function.addFnAttr("prefer-vector-width", to_string(kVectorWidth));
+    }
+  }
+
 #ifndef SIMIT_DEBUG
-  // Run LLVM optimization passes on the function
-  // We use the built-in PassManagerBuilder to build
-  // the set of passes that are similar to clang's -O3
+  if (kOptLevel > 0) {
+    // Run LLVM optimization passes on the function
+    // We use the built-in PassManagerBuilder to build
+    // the set of passes that are similar to clang's -O<optLevel>
 #if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
-  llvm::FunctionPassManager fpm(module);
-  llvm::PassManager mpm;
+    llvm::FunctionPassManager fpm(module);
+    llvm::PassManager mpm;
 #else
-  llvm::legacy::FunctionPassManager fpm(module);
-  llvm::legacy::PassManager mpm;
+    llvm::legacy::FunctionPassManager fpm(module);
+    llvm::legacy::PassManager mpm;
 #endif
-  llvm::PassManagerBuilder pmBuilder;
-  
-  pmBuilder.OptLevel = 3;
+    llvm::PassManagerBuilder pmBuilder;
+
+    pmBuilder.OptLevel = kOptLevel;
+    pmBuilder.Inliner = llvm::createFunctionInliningPass(kOptLevel, 0);
 
-  pmBuilder.BBVectorize = 1;
-  pmBuilder.LoopVectorize = 1;
-//  pmBuilder.LoadCombine = 1;
-  pmBuilder.SLPVectorize = 1;
+    pmBuilder.BBVectorize = (kOptLevel >= 3);
+    pmBuilder.LoopVectorize = (kOptLevel >= 2);
+//    pmBuilder.LoadCombine = 1;
+    pmBuilder.SLPVectorize = (kOptLevel >= 2);
 
-  llvm::DataLayout dataLayout(module);
+    llvm::DataLayout dataLayout(module);
 #if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
-  fpm.add(new llvm::DataLayout(dataLayout));
+    fpm.add(new llvm::DataLayout(dataLayout));
 #elif LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
-  fpm.add(new llvm::DataLayoutPass(dataLayout));
+    fpm.add(new llvm::DataLayoutPass(dataLayout));
 #else
-  module->setDataLayout(dataLayout);
+    module->setDataLayout(dataLayout);
 #endif
 
-  pmBuilder.populateFunctionPassManager(fpm);
-  pmBuilder.populateModulePassManager(mpm);
+    // The vectorizers use the cost model of the target CPU
+    unique_ptr<llvm::TargetMachine> targetMachine(
+        engineBuilder->selectTarget());
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+    targetMachine->addAnalysisPasses(fpm);
+    targetMachine->addAnalysisPasses(mpm);
+#else
+    fpm.add(llvm::createTargetTransformInfoWrapperPass(
+        targetMachine->getTargetIRAnalysis()));
+    mpm.add(llvm::createTargetTransformInfoWrapperPass(
+        targetMachine->getTargetIRAnalysis()));
+#endif
 
-  fpm.doInitialization();
-  fpm.run(*llvmFunc);
-  fpm.doFinalization();
-  
-  mpm.run(*module);
+    pmBuilder.populateFunctionPassManager(fpm);
+    pmBuilder.populateModulePassManager(mpm);
+
+    fpm.doInitialization();
+    fpm.run(*llvmFunc);
+    fpm.doFinalization();
+
+    mpm.run(*module);
+    timer.endStage("Optimize LLVM IR");
+  }
 #endif
 
-  return new LLVMFunction(func, storage, llvmFunc, module, engineBuilder);
+  // The execution engines of the function generate its machine code
+  Function* function = new LLVMFunction(func, storage, llvmFunc, module,
+                                        engineBuilder, allocator);
+  timer.endStage("Generate Machine Code");
+  function->setCompileProfile(profile);
+  return function;
 }
 
 void LLVMBackend::compile(const ir::Literal& literal) {
@@ -334,8 +561,9 @@ void LLVMBackend::compile(const ir::VarExpr& varExpr) {
   string ptrName = string(val->getName());
   string valName = string(val->getName()) + VAL_SUFFIX;
 
-  // Globals are stored as pointer-pointers so we must load them
-  if (util::contains(globals, varExpr.var)) {
+  // Globals and arrays are stored as pointer-pointers so we must load them
+  if (util::contains(globals, varExpr.var) ||
+      util::contains(arrays, varExpr.var)) {
     val = builder->CreateLoad(val, ptrName);
     // Cast non-generic address spaces into generic
     if (val->getType()->isPointerTy() &&
@@ -367,7 +595,9 @@ void LLVMBackend::compile(const ir::Load& load) {
   llvm::Value *bufferLoc = builder->CreateInBoundsGEP(buffer, index, locName);
 
   string valName = string(buffer->getName()) + VAL_SUFFIX;
-  val = builder->CreateLoad(bufferLoc, valName);
+  llvm::LoadInst *loadInst = builder->CreateLoad(bufferLoc, valName);
+  addFieldAliasMetadata(loadInst, load.buffer);
+  val = loadInst;
 }
 
 void LLVMBackend::compile(const ir::FieldRead& fieldRead) {
@@ -397,6 +627,10 @@ void LLVMBackend::compile(const ir::IndexRead& indexRead) {
       iassert(indexRead.edgeSet.type().isLatticeLinkSet());
       val = layout->getSize(indexRead.index);
       break;
+    case ir::IndexRead::LatticeMortonCodes:
+      iassert(indexRead.edgeSet.type().isLatticeLinkSet());
+      val = layout->getMortonCodes(indexRead.index);
+      break;
     default:
       unreachable;
   }
@@ -695,6 +929,14 @@ void LLVMBackend::compile(const ir::VarDecl& varDecl) {
   } else if (type.isOpaque()) {
     llvmVar = builder->CreateAlloca(llvmType(type), nullptr, var.getName());
   }
+  else if (type.isArray()) {
+    // Arrays are allocated at runtime and we keep the pointer on the stack
+    llvm::PointerType *arrayType = llvmType(*type.toArray());
+    llvmVar = builder->CreateAlloca(arrayType, nullptr,
+                                    var.getName()+PTR_SUFFIX);
+    builder->CreateStore(llvm::ConstantPointerNull::get(arrayType), llvmVar);
+    arrays.insert(var);
+  }
   else {
     terror << type << " declarations not supported yet";
   }
@@ -734,12 +976,6 @@ LLVMBackend::emitArgument(ir::Expr argument, bool excludeStaticTypes) {
       auto tensorStorage = storage.getStorage(to<VarExpr>(argument)->var);
       auto tensorIndex = tensorStorage.getTensorIndex();
 
-      llvm::Value *rowptr = compile(tensorIndex.getRowptrArray());
-      llvm::Value *colidx = compile(tensorIndex.getColidxArray());
-
-      auto n = emitComputeLen(dimensions[0]);
-      auto m = emitComputeLen(dimensions[1]);
-
       // get block sizes.
       llvm::Value* nn;
       llvm::Value* mm;
@@ -754,17 +990,54 @@ LLVMBackend::emitArgument(ir::Expr argument, bool excludeStaticTypes) {
         mm = emitComputeLen(blockDimensions[1]);
       }
 
-      // Argument list:
-      // - Top-level type:    n, m
-      // - Top-level indices: rowPtr, colIdx,
-      // - Block type:        nn, mm
-      // - Values:  vals
-      argumentValues.push_back(n);
-      argumentValues.push_back(m);
-      argumentValues.push_back(rowptr);
-      argumentValues.push_back(colidx);
-      argumentValues.push_back(nn);
-      argumentValues.push_back(mm);
+      // Stencil-stored matrices have no index: they are described by their
+      // lattice and by the lattice offset of each value in a row.
+      if (tensorStorage.getKind() == TensorStorage::Stencil) {
+        const StencilLayout& stencil = tensorIndex.getStencilLayout();
+        Expr lattice = VarExpr::make(stencil.getLatticeSet());
+        int ndims = lattice.type().toLatticeLinkSet()->dimensions;
+
+        vector<int> offsets;
+        for (auto& offset : stencil.getLayoutReversed()) {
+          offsets.insert(offsets.end(), offset.second.begin(),
+                         offset.second.end());
+        }
+
+        // The first field of a lattice link set is its array of dimensions
+        llvm::Value *dims = builder->CreateExtractValue(
+            compile(lattice), {0}, util::toString(lattice)+".sizes()");
+
+        // Argument list:
+        // - Lattice:    ndims, dims
+        // - Stencil:    numOffsets, offsets
+        // - Block type: nn, mm
+        // - Values:  vals
+        argumentValues.push_back(llvmInt(ndims));
+        argumentValues.push_back(dims);
+        argumentValues.push_back(llvmInt(stencil.getLayout().size()));
+        argumentValues.push_back(emitGlobalIntArray(offsets));
+        argumentValues.push_back(nn);
+        argumentValues.push_back(mm);
+      }
+      else {
+        llvm::Value *rowptr = compile(tensorIndex.getRowptrArray());
+        llvm::Value *colidx = compile(tensorIndex.getColidxArray());
+
+        auto n = emitComputeLen(dimensions[0]);
+        auto m = emitComputeLen(dimensions[1]);
+
+        // Argument list:
+        // - Top-level type:    n, m
+        // - Top-level indices: rowPtr, colIdx,
+        // - Block type:        nn, mm
+        // - Values:  vals
+        argumentValues.push_back(n);
+        argumentValues.push_back(m);
+        argumentValues.push_back(rowptr);
+        argumentValues.push_back(colidx);
+        argumentValues.push_back(nn);
+        argumentValues.push_back(mm);
+      }
     }
     // Dense vectors and matrices
     else if (type->order() == 1 || type->order() == 2) {
@@ -917,6 +1190,18 @@ void LLVMBackend::emitExternCall(const ir::CallStmt& callStmt) {
   // Function name
   std::string name = callStmt.callee.getName();
   name = name.substr(0, name.find("@"));
+
+  // The multigrid solver takes its lattice from a stencil-stored matrix
+  if (name == ir::intrinsics::mgsolve().getName()) {
+    const Expr& A = callStmt.actuals[0];
+    uassert(isa<VarExpr>(A) &&
+            storage.getStorage(to<VarExpr>(A)->var).getKind() ==
+            TensorStorage::Stencil)
+        << "mgsolve requires a matrix assembled by a map through a lattice "
+        << "with indexless stencils";
+    uassert(!kMortonLattices)
+        << "mgsolve requires lexicographically ordered lattices";
+  }
   std::string floatType = ir::ScalarType::singleFloat() ? "s" : "d";
   name = floatType + name;
 
@@ -932,7 +1217,116 @@ void LLVMBackend::emitExternCall(const ir::CallStmt& callStmt) {
   }
 }
 
+void LLVMBackend::emitTimers(const ir::Stmt& body) {
+  class GetTimedSites : public ir::IRVisitor {
+  public:
+    std::set<int> sites;
+  private:
+    using IRVisitor::visit;
+    void visit(const ir::CallStmt *op) {
+      if (op->callee == ir::intrinsics::timerStart()) {
+        sites.insert(ir::to<ir::Literal>(op->actuals[0])->getIntVal(0));
+      }
+    }
+  };
+  GetTimedSites getTimedSites;
+  body.accept(&getTimedSites);
+
+  timerStarts.clear();
+  timerCounters = nullptr;
+  if (getTimedSites.sites.size() == 0) {
+    return;
+  }
+  int site = *getTimedSites.sites.begin();
+  int profile = TimerStorage::getInstance().getSites()[site].profile;
+  timerCounters = emitCall("simitTimerCounters", {llvmInt(profile)},
+                           LLVM_INT64_PTR);
+  for (int site : getTimedSites.sites) {
+    timerStarts[site] = builder->CreateAlloca(LLVM_INT64, nullptr,
+                                              "timer" + to_string(site));
+  }
+}
+
+void LLVMBackend::emitTimer(const ir::CallStmt& callStmt) {
+  iassert(timerCounters != nullptr);
+  int site = ir::to<ir::Literal>(callStmt.actuals[0])->getIntVal(0);
+  bool countsEvents = TimerStorage::getInstance().getSites()[site].countsEvents;
+  llvm::Function *readCycleCounter =
+      llvm::Intrinsic::getDeclaration(module, llvm::Intrinsic::readcyclecounter);
+
+  // Hardware events are read outside of the cycles of the site
+  if (callStmt.callee == ir::intrinsics::timerStart()) {
+    if (countsEvents) {
+      emitCall("simitTimerStartEvents", {llvmInt(site)}, LLVM_VOID);
+    }
+    builder->CreateStore(builder->CreateCall(readCycleCounter),
+                         timerStarts.at(site));
+    return;
+  }
+  llvm::Value *cycles = builder->CreateCall(readCycleCounter);
+
+  // Add the elapsed cycles and a run to the counters of the site, and update
+  // its shortest and longest run
+  llvm::Value *elapsed =
+      builder->CreateSub(cycles, builder->CreateLoad(timerStarts.at(site)));
+  auto counter = [&](int i) {
+    return builder->CreateInBoundsGEP(timerCounters,
+        llvmInt(TimerStorage::kCountersPerSite*site + i));
+  };
+  llvm::Value *total = counter(0);
+  builder->CreateStore(builder->CreateAdd(builder->CreateLoad(total), elapsed),
+                       total);
+  llvm::Value *runs = counter(1);
+  builder->CreateStore(builder->CreateAdd(builder->CreateLoad(runs),
+                                          llvmInt(1, 64)), runs);
+  llvm::Value *min = counter(2);
+  llvm::Value *minVal = builder->CreateLoad(min);
+  builder->CreateStore(builder->CreateSelect(
+      builder->CreateICmpSLT(elapsed, minVal), elapsed, minVal), min);
+  llvm::Value *max = counter(3);
+  llvm::Value *maxVal = builder->CreateLoad(max);
+  builder->CreateStore(builder->CreateSelect(
+      builder->CreateICmpSGT(elapsed, maxVal), elapsed, maxVal), max);
+
+  // Add the operations of the run, that the lowering computed
+  for (int i = 1; i <= 2; ++i) {
+    const Expr& operations = callStmt.actuals[i];
+    if (isa<Literal>(operations) && to<Literal>(operations)->getIntVal(0) == 0) {
+      continue;
+    }
+    llvm::Value *total = counter(3 + i);
+    llvm::Value *run = builder->CreateSExt(compile(operations), LLVM_INT64);
+    builder->CreateStore(builder->CreateAdd(builder->CreateLoad(total), run),
+                         total);
+  }
+
+  if (countsEvents) {
+    emitCall("simitTimerStopEvents", {llvmInt(site)}, LLVM_VOID);
+  }
+}
+
 void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
+  if (callStmt.callee == ir::intrinsics::timerStart() ||
+      callStmt.callee == ir::intrinsics::timerStop()) {
+    emitTimer(callStmt);
+    return;
+  }
+
+  // Prefetches take a buffer and an index, and compute the address to fetch
+  if (callStmt.callee == ir::intrinsics::prefetch()) {
+    iassert(callStmt.actuals.size() == 2);
+    llvm::Value *buffer = compile(callStmt.actuals[0]);
+    llvm::Value *index = compile(callStmt.actuals[1]);
+    llvm::Value *address = builder->CreateBitCast(
+        builder->CreateInBoundsGEP(buffer, index), LLVM_INT8_PTR);
+    llvm::Function *prefetch =
+        llvm::Intrinsic::getDeclaration(module, llvm::Intrinsic::prefetch);
+    // Read, with high temporal locality, into the data cache
+    builder->CreateCall(prefetch, {address, llvmInt(0), llvmInt(3),
+                                   llvmInt(1)});
+    return;
+  }
+
   auto args = emitArguments(callStmt.actuals, true);
 
   llvm::Function *fun = nullptr;
@@ -949,13 +1343,27 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
        {ir::intrinsics::exp(), llvm::Intrinsic::exp},
        {ir::intrinsics::pow(), llvm::Intrinsic::pow}};
 
+  // Intrinsics that the in-tree math library implements (runtime_math.h)
+  std::set<Func> mathLibraryIntrinsics =
+      {ir::intrinsics::sin(), ir::intrinsics::cos(), ir::intrinsics::exp(),
+       ir::intrinsics::log(), ir::intrinsics::pow(), ir::intrinsics::atan2()};
+
   std::string floatTypeName = ir::ScalarType::singleFloat() ? "_f32" : "_f64";
 
   llvm::Value *call = nullptr;
 
-  // is it an LLVM intrinsic?
+  // is it an intrinsic from the math library? The library functions are
+  // linked into the module, so they are inlined and vectorized with the loops
+  // that call them.
   auto foundIntrinsic = llvmIntrinsicByName.find(callStmt.callee);
-  if (foundIntrinsic != llvmIntrinsicByName.end()) {
+  if (kMathAccuracy != "libm" &&
+      util::contains(mathLibraryIntrinsics, callStmt.callee)) {
+    std::string fname = callStmt.callee.getName() + "_" + kMathAccuracy +
+                        floatTypeName;
+    call = emitCall(fname, args, llvmFloatType());
+  }
+  // is it an LLVM intrinsic?
+  else if (foundIntrinsic != llvmIntrinsicByName.end()) {
     iassert(callStmt.results.size() == 1);
     auto ctype = callStmt.results[0].getType().toTensor()->getComponentType();
     llvm::Type *overloadType = llvmType(ctype);
@@ -983,10 +1391,15 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
   else if (callStmt.callee == ir::intrinsics::free()) {
     auto arg = args[args.size()-1];
     arg = builder->CreateCast(llvm::Instruction::CastOps::BitCast, arg, LLVM_INT8_PTR);
-    call = emitCall("free", {arg}, LLVM_VOID);
+    call = (allocator != -1) ? emitCall("simitFree", {arg}, LLVM_VOID)
+                             : emitCall("free", {arg}, LLVM_VOID);
   }
   else if (callStmt.callee == ir::intrinsics::malloc()) {
-    call = emitCall("malloc", args, LLVM_INT8_PTR);
+    // Buffers are allocated from the function's allocator, so that memory
+    // reports include them
+    call = (allocator != -1)
+        ? emitCall("simitMalloc", {llvmInt(allocator), args[0]}, LLVM_INT8_PTR)
+        : emitCall("malloc", args, LLVM_INT8_PTR);
   }
   else if (callStmt.callee == ir::intrinsics::strcmp()) {
     call = emitCall("strcmp", args, LLVM_INT);
@@ -1053,6 +1466,11 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
     iassert(callStmt.results.size() == 1);
     Var var = callStmt.results[0];
     llvm::Value *llvmVar = symtable.get(var);
+    // Intrinsics that allocate memory return untyped pointers
+    llvm::Type *varType = llvmVar->getType()->getPointerElementType();
+    if (call->getType() != varType && call->getType()->isPointerTy()) {
+      call = builder->CreateBitCast(call, varType);
+    }
     builder->CreateStore(call, llvmVar);
   }
 }
@@ -1090,7 +1508,8 @@ void LLVMBackend::compile(const ir::Store& store) {
 
   string locName = string(buffer->getName()) + PTR_SUFFIX;
   llvm::Value *bufferLoc = builder->CreateInBoundsGEP(buffer, index, locName);
-  builder->CreateStore(value, bufferLoc);
+  llvm::StoreInst *storeInst = builder->CreateStore(value, bufferLoc);
+  addFieldAliasMetadata(storeInst, store.buffer);
 }
 
 void LLVMBackend::compile(const ir::FieldWrite& fieldWrite) {
@@ -1230,9 +1649,14 @@ void LLVMBackend::compile(const ir::ForRange& forLoop) {
 
   llvm::Value *exitCond = builder->CreateICmpSLT(i_nxt, rangeEnd,
                                                  iName+"_cmp");
-  builder->CreateCondBr(exitCond, loopBodyStart, loopEnd);
+  llvm::BranchInst *backEdge =
+      builder->CreateCondBr(exitCond, loopBodyStart, loopEnd);
+  if (forLoop.vectorize) {
+    // Vectors of the preferred width hold this many floats
+    int width = kVectorWidth / (8 * ScalarType::floatBytes);
+    addLoopVectorizeHint(backEdge, width);
+  }
   builder->SetInsertPoint(loopEnd);
-
 }
 
 void LLVMBackend::compile(const ir::For& forLoop) {
@@ -1406,6 +1830,52 @@ llvm::Value *LLVMBackend::emitFieldRead(const Expr &elemOrSet,
                                      setOrElemValue->getName()+"."+fieldName);
 }
 
+void LLVMBackend::emitFieldAliasScopes(const Stmt& body) {
+  fieldScopes.clear();
+
+  // Scoped noalias metadata is not available before LLVM 3.6
+#if !(LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5)
+  std::set<std::string> fieldNames;
+  match(body, function<void(const FieldRead*)>([&](const FieldRead* op) {
+    fieldNames.insert(op->fieldName);
+  }));
+  if (fieldNames.size() < 2) {
+    return;
+  }
+
+  llvm::MDBuilder mdBuilder(LLVM_CTX);
+  llvm::MDNode *domain =
+      mdBuilder.createAnonymousAliasScopeDomain("simit.fields");
+  std::map<std::string, llvm::MDNode*> scopes;
+  for (const std::string& fieldName : fieldNames) {
+    scopes[fieldName] = mdBuilder.createAnonymousAliasScope(domain, fieldName);
+  }
+  for (auto& scope : scopes) {
+    vector<llvm::Metadata*> others;
+    for (auto& other : scopes) {
+      if (other.first != scope.first) {
+        others.push_back(other.second);
+      }
+    }
+    fieldScopes[scope.first] = {llvm::MDNode::get(LLVM_CTX, {scope.second}),
+                                llvm::MDNode::get(LLVM_CTX, others)};
+  }
+#endif
+}
+
+void LLVMBackend::addFieldAliasMetadata(llvm::Instruction *access,
+                                        const Expr& buffer) {
+  if (!isa<FieldRead>(buffer)) {
+    return;
+  }
+  auto scope = fieldScopes.find(to<FieldRead>(buffer)->fieldName);
+  if (scope == fieldScopes.end()) {
+    return;
+  }
+  access->setMetadata("alias.scope", scope->second.first);
+  access->setMetadata("noalias", scope->second.second);
+}
+
 llvm::Value *LLVMBackend::emitComputeLen(const TensorType *tensorType,
                                          const TensorStorage &tensorStorage) {
   if (tensorType->order() == 0) {
@@ -1556,6 +2026,30 @@ llvm::Constant *LLVMBackend::emitGlobalString(const std::string& str) {
 #endif
 }
 
+llvm::Constant *LLVMBackend::emitGlobalIntArray(const vector<int>& values) {
+  vector<llvm::Constant*> elements;
+  for (int value : values) {
+    elements.push_back(llvmInt(value));
+  }
+  auto arrayType = llvm::ArrayType::get(LLVM_INT, values.size());
+  auto arrayValue = llvm::ConstantArray::get(arrayType, elements);
+
+  llvm::GlobalVariable *arrayGlobal =
+      new llvm::GlobalVariable(*module, arrayType, true,
+                               llvm::GlobalValue::PrivateLinkage, arrayValue,
+                               "_ints");
+  llvm::Constant *zero = llvm::Constant::getNullValue(LLVM_INT);
+
+  std::vector<llvm::Constant*> idx;
+  idx.push_back(zero);
+  idx.push_back(zero);
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+  return llvm::ConstantExpr::getGetElementPtr(arrayGlobal, idx);
+#else
+  return llvm::ConstantExpr::getGetElementPtr(nullptr, arrayGlobal, idx);
+#endif
+}
+
 llvm::Function *LLVMBackend::emitEmptyFunction(const string &name,
                                                const vector<ir::Var> &arguments,
                                                const vector<ir::Var> &results,
@@ -27,6 +27,7 @@ class Type;
 class Value;
 class Instruction;
 class Function;
+class MDNode;
 class DataLayout;
 }
 
@@ -62,6 +63,23 @@ protected:
   std::map<ir::Var, llvm::Value*> buffers;
 
   std::set<ir::Var> globals;
+
+  // Arrays declared in the function, whose pointers are kept on the stack
+  std::set<ir::Var> arrays;
+
+  // The alias scope of each field accessed by the function being compiled,
+  // and the list of the other fields' scopes, which it does not alias
+  std::map<std::string, std::pair<llvm::MDNode*,llvm::MDNode*>> fieldScopes;
+
+  // The timer counters of the running thread, and the cycle counter at the
+  // start of each timed site of the function being compiled
+  llvm::Value *timerCounters;
+  std::map<int, llvm::Value*> timerStarts;
+
+  // The memory tracker allocator of the function being compiled, that the
+  // malloc and free intrinsics allocate from, or -1 to call malloc and free
+  int allocator;
+
   ir::Storage storage;
   const ir::Environment* environment;
 
@@ -132,6 +150,9 @@ protected:
   /// Build a global string and return a constant pointer to it
   llvm::Constant *emitGlobalString(const std::string& str);
 
+  /// Build a constant global int array and return a constant pointer to it
+  llvm::Constant *emitGlobalIntArray(const std::vector<int>& values);
+
   /// Gets a reference to a named built-in
   llvm::Function* getBuiltIn(std::string name,
                              llvm::Type *retTy,
@@ -148,6 +169,17 @@ protected:
 
   void emitAssign(ir::Var var, const ir::Expr& value);
 
+  /// Create an alias scope for every field accessed in `body`. Fields are
+  /// allocated separately, so loads and stores of differently named fields
+  /// never alias, which lets LLVM vectorize loops that read some fields and
+  /// write others without runtime overlap checks.
+  void emitFieldAliasScopes(const ir::Stmt& body);
+
+  /// Attach the alias scope metadata of the field `buffer` to a load or store
+  /// of one of its elements. Does nothing if `buffer` is not a field.
+  void addFieldAliasMetadata(llvm::Instruction *access,
+                             const ir::Expr& buffer);
+
   /// Produce LLVM globals for everything in `env` and store in `globals`
   /// and in `symtable` appropriately.
   virtual void emitGlobals(const ir::Environment& env);
@@ -196,6 +228,13 @@ protected:
   /// Emit a call to an intrinsic
   void emitIntrinsicCall(const ir::CallStmt& callStmt);
 
+  /// Emit the loads of the timer counters and the timer start variables of
+  /// the timed sites of a function body, at the start of the function
+  void emitTimers(const ir::Stmt& body);
+
+  /// Emit a timerStart or timerStop intrinsic
+  void emitTimer(const ir::CallStmt& callStmt);
+
   // TODO: Remove this function, once the old init system has been removed
   ir::Func makeSystemTensorsGlobal(ir::Func func);
 
@@ -226,4 +226,47 @@ llvm::GlobalVariable* createGlobal(llvm::Module *module, const Var& var,
   return globalPtr;
 }
 
+void addLoopVectorizeHint(llvm::BranchInst *backEdge, int width) {
+  // The loop id is a distinct node whose first operand refers to itself
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
+  const char *enableHint = "llvm.vectorizer.enable";
+#else
+  const char *enableHint = "llvm.loop.vectorize.enable";
+#endif
+  llvm::Value *hint[] = {llvm::MDString::get(LLVM_CTX, enableHint),
+                         llvmBool(true)};
+  llvm::MDNode *temp = llvm::MDNode::getTemporary(LLVM_CTX,
+                                                  llvm::ArrayRef<llvm::Value*>());
+  std::vector<llvm::Value*> loopOps = {temp, llvm::MDNode::get(LLVM_CTX, hint)};
+  if (width > 0) {
+    llvm::Value *widthHint[] = {
+      llvm::MDString::get(LLVM_CTX, "llvm.loop.vectorize.width"),
+      llvmInt(width)
+    };
+    loopOps.push_back(llvm::MDNode::get(LLVM_CTX, widthHint));
+  }
+  llvm::MDNode *loopID = llvm::MDNode::get(LLVM_CTX, loopOps);
+  loopID->replaceOperandWith(0, loopID);
+  llvm::MDNode::deleteTemporary(temp);
+#else
+  llvm::Metadata *hint[] = {
+    llvm::MDString::get(LLVM_CTX, "llvm.loop.vectorize.enable"),
+    llvm::ConstantAsMetadata::get(llvmBool(true))
+  };
+  std::vector<llvm::Metadata*> loopOps = {nullptr,
+                                          llvm::MDNode::get(LLVM_CTX, hint)};
+  if (width > 0) {
+    llvm::Metadata *widthHint[] = {
+      llvm::MDString::get(LLVM_CTX, "llvm.loop.vectorize.width"),
+      llvm::ConstantAsMetadata::get(llvmInt(width))
+    };
+    loopOps.push_back(llvm::MDNode::get(LLVM_CTX, widthHint));
+  }
+  llvm::MDNode *loopID = llvm::MDNode::getDistinct(LLVM_CTX, loopOps);
+  loopID->replaceOperandWith(0, loopID);
+#endif
+  backEdge->setMetadata("llvm.loop", loopID);
+}
+
 }}
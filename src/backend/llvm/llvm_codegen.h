@@ -72,5 +72,10 @@ llvm::GlobalVariable* createGlobal(llvm::Module *module, const ir::Var& var,
                                    llvm::GlobalValue::LinkageTypes linkage,
                                    unsigned addrspace);
 
+/// Attach loop metadata to the back edge branch of a loop that tells the loop
+/// vectorizer to vectorize it, regardless of its cost model's doubts about
+/// the benefit, with `width' elements per vector if it is not 0.
+void addLoopVectorizeHint(llvm::BranchInst *backEdge, int width=0);
+
 }}
 #endif
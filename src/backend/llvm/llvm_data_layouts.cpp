@@ -25,9 +25,14 @@ llvm::Value* UnstructuredSetLayout::getTotalSize() {
       value, {0}, util::toString(set)+".size()");
 }
 
+llvm::Value* UnstructuredSetLayout::getPartitionTable() {
+  return builder->CreateExtractValue(
+      value, {1}, util::toString(set)+".partitions()");
+}
+
 int UnstructuredSetLayout::getFieldsOffset() {
-  // Always only the set size to skip
-  return 1;
+  // Must skip size and partitions
+  return 2;
 }
 
 llvm::Value* UnstructuredSetLayout::makeSet(Set *actual, ir::Type type) {
@@ -40,6 +45,8 @@ llvm::Value* UnstructuredSetLayout::makeSet(Set *actual, ir::Type type) {
 
   // Set size
   setData.push_back(llvmInt(actual->getSize()));
+  // Partition table
+  setData.push_back(llvmPtr(LLVM_INT_PTR, actual->getPartitionTable()));
   // Fields
   for (auto &field : setType->elementType.toElement()->fields) {
     assert(field.type.isTensor());
@@ -59,6 +66,9 @@ void UnstructuredSetLayout::writeSet(
   // Set size
   ((int*)externPtr)[0] = actual->getSize();
   void **externPtrCast = (void**)(((int*)externPtr)+1);
+  // Partition table
+  *externPtrCast = (void*)actual->getPartitionTable();
+  externPtrCast++;
   // Fields
   for (auto &field : setType->elementType.toElement()->fields) {
     assert(field.type.isTensor());
@@ -82,9 +92,14 @@ llvm::Value* UnstructuredEdgeSetLayout::getNbrsArray() {
       value, {3}, util::toString(set)+".nbrs()");
 }
 
+llvm::Value* UnstructuredEdgeSetLayout::getPartitionTable() {
+  return builder->CreateExtractValue(
+      value, {4}, util::toString(set)+".partitions()");
+}
+
 int UnstructuredEdgeSetLayout::getFieldsOffset() {
-  // Must skip size, eps, nbrs_start, and nbrs
-  return 4;
+  // Must skip size, eps, nbrs_start, nbrs, and partitions
+  return 5;
 }
 
 llvm::Value* UnstructuredEdgeSetLayout::makeSet(Set *actual, ir::Type type) {
@@ -102,6 +117,8 @@ llvm::Value* UnstructuredEdgeSetLayout::makeSet(Set *actual, ir::Type type) {
   const internal::NeighborIndex *nbrs = actual->getNeighborIndex();
   setData.push_back(llvmPtr(LLVM_INT_PTR, nbrs->getStartIndex()));
   setData.push_back(llvmPtr(LLVM_INT_PTR, nbrs->getNeighborIndex()));
+  // Partition table
+  setData.push_back(llvmPtr(LLVM_INT_PTR, actual->getPartitionTable()));
   // Fields
   for (auto &field : setType->elementType.toElement()->fields) {
     assert(field.type.isTensor());
@@ -126,9 +143,11 @@ void UnstructuredEdgeSetLayout::writeSet(
   const internal::NeighborIndex *nbrs = actual->getNeighborIndex();
   ((const int**)externPtrCast)[1] = nbrs->getStartIndex();
   ((const int**)externPtrCast)[2] = nbrs->getNeighborIndex();
+  // Partition table
+  ((const int**)externPtrCast)[3] = actual->getPartitionTable();
 
   // Fields
-  void **externPtrFieldCast = (void**)(externPtrCast+3);
+  void **externPtrFieldCast = (void**)(externPtrCast+4);
   for (auto &field : setType->elementType.toElement()->fields) {
     assert(field.type.isTensor());
     *externPtrFieldCast = actual->getFieldData(field.name);
@@ -156,6 +175,19 @@ llvm::Value* LatticeEdgeSetLayout::getTotalSize() {
   return total;
 }
 
+llvm::Value* LatticeEdgeSetLayout::getMortonCodes(unsigned i) {
+  unsigned dims = set.type().toLatticeLinkSet()->dimensions;
+  iassert(i < dims);
+  // The tables follow the sizes, in dimension order
+  llvm::Value *offset = llvmInt(dims);
+  for (unsigned d = 0; d < i; ++d) {
+    offset = builder->CreateAdd(offset, getSize(d));
+  }
+  auto sizes = builder->CreateExtractValue(value, {0}, util::toString(set)+".sizes()");
+  return builder->CreateInBoundsGEP(sizes, offset, util::toString(set) +
+                                    ".mortoncodes(" + std::to_string(i) + ")");
+}
+
 llvm::Value* LatticeEdgeSetLayout::getEpsArray() {
   iassert(!kIndexlessStencils)
       << "Endpoints array undefined when in indexless mode";
@@ -196,7 +228,7 @@ llvm::Value* LatticeEdgeSetLayout::makeSet(Set *actual, ir::Type type) {
       << "Lattice link set with wrong number of dimensions: "
       << dimensions.size() << " passed, but " << ndims
       << " required";
-  setData.push_back(llvmPtr(LLVM_INT_PTR, dimensions.data()));
+  setData.push_back(llvmPtr(LLVM_INT_PTR, actual->getLatticeIndexData()));
     
   // CSR data: only set if kIndexlessStencils is false, otherwise
   // we set these to NULL.
@@ -231,8 +263,7 @@ void LatticeEdgeSetLayout::writeSet(Set *actual, ir::Type type, void *externPtr)
   int** externPtrCast = (int**)externPtr;
 
   // Set sizes
-  const vector<int> &dimensions = actual->getDimensions();
-  ((const int**)externPtrCast)[0] = dimensions.data();
+  ((const int**)externPtrCast)[0] = actual->getLatticeIndexData();
     
   // CSR data: only set if kIndexlessStencils is false, otherwise
   // we set these to NULL.
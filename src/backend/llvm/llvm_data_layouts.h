@@ -32,12 +32,18 @@ public:
   virtual llvm::Value* getNbrsStartArray() = 0;
   /// Get the neighbors array
   virtual llvm::Value* getNbrsArray() = 0;
+  /// Get the partition table (see Set::getPartitionTable), which is null if
+  /// the set is not partitioned
+  virtual llvm::Value* getPartitionTable() = 0;
+  /// Get the Morton codes of the coordinates of the ith lattice dimension
+  /// (see Set::getLatticeIndexData)
+  virtual llvm::Value* getMortonCodes(unsigned i) = 0;
   /// Get the offset to the fields pointers
   virtual int getFieldsOffset() = 0;
 };
 
 /// Unstructured set layout (cardinality 0):
-/// <size> <f1> <f2> ...
+/// <size> <partitions_ptr> <f1> <f2> ...
 class UnstructuredSetLayout : public SetLayout {
 public:
   virtual llvm::Value* getSize(unsigned i);
@@ -46,6 +52,10 @@ public:
   inline virtual llvm::Value* getEpsArray() {unreachable; return nullptr;}
   inline virtual llvm::Value* getNbrsStartArray() {unreachable; return nullptr;}
   inline virtual llvm::Value* getNbrsArray() {unreachable; return nullptr;}
+  virtual llvm::Value* getPartitionTable();
+  inline virtual llvm::Value* getMortonCodes(unsigned) {
+    unreachable; return nullptr;
+  }
 
   virtual int getFieldsOffset();
 
@@ -64,12 +74,13 @@ private:
 
 
 /// Unstructured edge set layout:
-/// <size> <eps_ptr> <nbrs_start_ptr> <nbrs_ptr> <f1> <f2> ...
+/// <size> <eps_ptr> <nbrs_start_ptr> <nbrs_ptr> <partitions_ptr> <f1> <f2> ...
 class UnstructuredEdgeSetLayout : public UnstructuredSetLayout {
 public:
   virtual llvm::Value* getEpsArray();
   virtual llvm::Value* getNbrsStartArray();
   virtual llvm::Value* getNbrsArray();
+  virtual llvm::Value* getPartitionTable();
 
   virtual int getFieldsOffset();
 
@@ -90,6 +101,8 @@ private:
 
 /// Lattice edge set layout:
 /// <sizes_ptr> <eps_ptr> <nbrs_start_ptr> <nbrs_ptr> <f1> <f2> ...
+/// where the sizes of Morton ordered lattices are followed by their Morton
+/// code tables.
 class LatticeEdgeSetLayout : public SetLayout {
 public:
   virtual llvm::Value* getSize(unsigned i);
@@ -97,6 +110,10 @@ public:
   virtual llvm::Value* getEpsArray();
   virtual llvm::Value* getNbrsStartArray();
   virtual llvm::Value* getNbrsArray();
+  inline virtual llvm::Value* getPartitionTable() {
+    unreachable; return nullptr;
+  }
+  virtual llvm::Value* getMortonCodes(unsigned i);
   virtual int getFieldsOffset();
 
   static llvm::Value* makeSet(Set *actual, ir::Type type);
@@ -19,10 +19,14 @@
 #include "llvm_types.h"
 #include "llvm_codegen.h"
 #include "llvm_data_layouts.h"
+#include "llvm_jit_listener.h"
+#include "llvm_memory_manager.h"
 
 #include "backend/actual.h"
 #include "graph.h"
 #include "graph_indices.h"
+#include "init.h"
+#include "memory_tracker.h"
 #include "tensor_index.h"
 #include "path_indices.h"
 #include "util/collections.h"
@@ -39,25 +43,28 @@ typedef void (*FuncPtrType)();
 
 LLVMFunction::LLVMFunction(ir::Func func, const ir::Storage &storage,
                            llvm::Function* llvmFunc, llvm::Module* module,
-                           std::shared_ptr<llvm::EngineBuilder> engineBuilder)
+                           std::shared_ptr<llvm::EngineBuilder> engineBuilder,
+                           int allocator)
     : Function(func), initialized(false), llvmFunc(llvmFunc), module(module),
       harnessModule(new llvm::Module("simit_harness", LLVM_CTX)),
       storage(storage),
       engineBuilder(engineBuilder),
-#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
-      executionEngine(engineBuilder->setUseMCJIT(true).create()), // MCJIT EE
-#else
-      executionEngine(engineBuilder->create()),
-#endif
+      executionEngine(createExecutionEngine(engineBuilder.get(),
+                                            &jitSectionBytes)),
 #if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
       harnessEngineBuilder(new llvm::EngineBuilder(harnessModule)),
-      harnessExecEngine(harnessEngineBuilder->setUseMCJIT(true).create()), // MCJIT EE
 #else
       harnessEngineBuilder(new llvm::EngineBuilder(
           unique_ptr<llvm::Module>(harnessModule))),
-      harnessExecEngine(harnessEngineBuilder->create()),
 #endif
-      deinit(nullptr) {
+      harnessExecEngine(createExecutionEngine(harnessEngineBuilder.get(),
+                                              &jitSectionBytes)),
+      allocator(allocator), bufferBytes(0), deinit(nullptr) {
+
+  if (kJITSymbols) {
+    registerJITEventListeners(executionEngine.get());
+    registerJITEventListeners(harnessExecEngine.get());
+  }
 
   // Finalize existing module so we can get global pointer hooks
   // from the LLVM memory manager.
@@ -168,6 +175,10 @@ void LLVMFunction::bind(const std::string& name, simit::Set* set) {
           << "Lattice link set with wrong number of dimensions: "
           << dimensions.size() << " passed, but " << ndims
           << " required";
+      uassert(set->getLatticeOrder() ==
+              (kMortonLattices ? Set::Morton : Set::Lexicographic))
+          << "Lattice link sets bound to " << name << " must be "
+          << (kMortonLattices ? "Morton" : "lexicographically") << " ordered";
     }
     else {
       not_supported_yet;
@@ -279,6 +290,8 @@ Function::FuncType LLVMFunction::init() {
         size_t componentSize = tensorType->getComponentType().bytes();
         *temporaryPtrs.at(tmp.getName()) =
             calloc(size(vecDimension) *blockSize, componentSize);
+        temporaryBytes[tmp.getName()] =
+            size(vecDimension) * blockSize * componentSize;
       }
       else if (order == 2) {
         Type blockType = tensorType->getBlockType();
@@ -293,6 +306,7 @@ Function::FuncType LLVMFunction::init() {
           size_t matSize = pathIndices.at(pexpr).numNeighbors() *
               blockSize * componentSize;
           *temporaryPtrs.at(tmp.getName()) = malloc(matSize);
+          temporaryBytes[tmp.getName()] = matSize;
         }
         else if (ti.getKind() == TensorIndex::Sten) {
           auto iss = tensorType->getOuterDimensions();
@@ -304,6 +318,7 @@ Function::FuncType LLVMFunction::init() {
           size_t matSize = stencil.getLayout().size() *
               latticeSize * blockSize * componentSize;
           *temporaryPtrs.at(tmp.getName()) = malloc(matSize);
+          temporaryBytes[tmp.getName()] = matSize;
         }
         else {
           not_supported_yet;
@@ -320,6 +335,8 @@ Function::FuncType LLVMFunction::init() {
   // llvm function with pointers to the arguments.
   Function::FuncType func;
   initialized = true;
+  size_t allocated = (allocator != -1)
+      ? internal::MemoryTracker::getInstance().getAllocated(allocator) : 0;
   vector<string> formals = getArgs();
   iassert(formals.size() == llvmFunc->getArgumentList().size());
   if (llvmFunc->getArgumentList().size() == 0) {
@@ -391,12 +408,14 @@ Function::FuncType LLVMFunction::init() {
         (void*) executionEngine->getFunctionAddress(funcName));
 
     // Create Init/deinit function harnesses
+    CompileTimer timer(&compileProfile);
     createHarness(initFuncName, args);
     createHarness(deinitFuncName, args);
     createHarness(funcName, args);
 
     // Finalize harness module
     harnessExecEngine->finalizeObject();
+    timer.endStage("Finalize Harness");
 
     // Fetch hard addresses from ExecutionEngine
     auto init = getHarnessFunctionAddress(initFuncName);
@@ -410,6 +429,11 @@ Function::FuncType LLVMFunction::init() {
     iassert(!llvm::verifyModule(*harnessModule))
         << "LLVM harness module does not pass verification";
   }
+  if (allocator != -1) {
+    bufferBytes =
+        internal::MemoryTracker::getInstance().getAllocated(allocator) -
+        allocated;
+  }
   return func;
 }
 
@@ -429,6 +453,49 @@ void LLVMFunction::printMachine(std::ostream &os) const {
   target->Options.PrintMachineCode = false;
 }
 
+MemoryReport LLVMFunction::getMemoryReport() const {
+  vector<MemoryRecord> records;
+  for (auto actuals : {&arguments, &globals}) {
+    for (auto& actual : *actuals) {
+      if (!isa<SetActual>(actual.second.get())) {
+        continue;
+      }
+      const Set* set = to<SetActual>(actual.second.get())->getSet();
+      const string& name = actual.first;
+      records.push_back({SetMemory, name + " fields", set->getFieldBytes()});
+      records.push_back({SetMemory, name + " endpoints",
+                         set->getEndpointBytes()});
+      records.push_back({IndexMemory, name + " neighbor index",
+                         set->getNeighborIndexBytes()});
+    }
+  }
+  for (auto& pathIndex : pathIndices) {
+    if (isa<pe::SegmentedPathIndex>(pathIndex.second)) {
+      records.push_back({IndexMemory, util::toString(pathIndex.first),
+          to<pe::SegmentedPathIndex>(pathIndex.second)->getBytes()});
+    }
+  }
+  for (auto& temporary : temporaryBytes) {
+    records.push_back({TemporaryMemory, temporary.first, temporary.second});
+  }
+
+  internal::MemoryTracker& tracker = internal::MemoryTracker::getInstance();
+  size_t peak = 0;
+  if (allocator != -1) {
+    records.push_back({BufferMemory, "init buffers", bufferBytes});
+    peak = tracker.getPeak(allocator);
+  }
+  // Factorizations are cached by the runtime and are not attributed to the
+  // functions that compute them
+  for (size_t factorization : tracker.getFactorizations()) {
+    records.push_back({SolverMemory, "cholesky factorization", factorization});
+  }
+
+  records.push_back({CodeMemory, "code sections", jitSectionBytes.code});
+  records.push_back({CodeMemory, "data sections", jitSectionBytes.data});
+  return MemoryReport(records, peak);
+}
+
 void LLVMFunction::initIndices(pe::PathIndexBuilder& piBuilder,
                                const Environment& environment) {
   // Initialize indices
@@ -10,6 +10,7 @@
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 
 #include "backend/backend_function.h"
+#include "llvm_memory_manager.h"
 #include "ir.h"
 #include "storage.h"
 #include "tensor_data.h"
@@ -33,7 +34,8 @@ class LLVMFunction : public backend::Function {
  public:
   LLVMFunction(ir::Func func, const ir::Storage &storage,
                llvm::Function* llvmFunc, llvm::Module* module,
-               std::shared_ptr<llvm::EngineBuilder> engineBuilder);
+               std::shared_ptr<llvm::EngineBuilder> engineBuilder,
+               int allocator=-1);
   virtual ~LLVMFunction();
 
   virtual void bind(const std::string& name, simit::Set* set);
@@ -49,6 +51,8 @@ class LLVMFunction : public backend::Function {
   virtual void print(std::ostream &os) const;
   virtual void printMachine(std::ostream &os) const;
 
+  virtual MemoryReport getMemoryReport() const;
+
  protected:
   /// Get the number of elements in the index domains.
   size_t size(const ir::IndexDomain &dimension);
@@ -76,6 +80,9 @@ class LLVMFunction : public backend::Function {
   std::map<pe::PathExpression, pe::PathIndex>            pathIndices;
 
  private:
+  /// The sections of the generated code, counted as the engines allocate them
+  JITSectionBytes jitSectionBytes;
+
   std::shared_ptr<llvm::EngineBuilder>   engineBuilder;
   std::shared_ptr<llvm::ExecutionEngine> executionEngine;
   std::unique_ptr<llvm::EngineBuilder>    harnessEngineBuilder;
@@ -83,6 +90,12 @@ class LLVMFunction : public backend::Function {
 
   /// Temporaries
   std::map<std::string, void**> temporaryPtrs;
+  std::map<std::string, size_t> temporaryBytes;
+
+  /// The memory tracker allocator of the generated code, or -1 if its buffers
+  /// are not tracked, and the bytes of the buffers that init allocated.
+  int allocator;
+  size_t bufferBytes;
 
   FuncType deinit;
 
@@ -0,0 +1,122 @@
+#include "llvm_jit_listener.h"
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include <unistd.h>
+
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#if LLVM_MAJOR_VERSION > 3 || LLVM_MINOR_VERSION >= 7
+#include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Object/SymbolSize.h"
+#endif
+
+using namespace std;
+
+namespace simit {
+namespace backend {
+
+#if LLVM_MAJOR_VERSION > 3 || LLVM_MINOR_VERSION >= 7
+/// Appends the functions of every object that MCJIT loads to the perf map of
+/// the process.
+class PerfMapListener : public llvm::JITEventListener {
+public:
+  PerfMapListener() {
+    string fileName = "/tmp/perf-" + to_string(getpid()) + ".map";
+    perfMap = fopen(fileName.c_str(), "a");
+  }
+
+  ~PerfMapListener() {
+    if (perfMap != nullptr) {
+      fclose(perfMap);
+    }
+  }
+
+#if LLVM_MAJOR_VERSION >= 8
+  void notifyObjectLoaded(ObjectKey key, const llvm::object::ObjectFile& object,
+                          const llvm::RuntimeDyld::LoadedObjectInfo& info) {
+    writeFunctions(object, info);
+  }
+#else
+  void NotifyObjectEmitted(const llvm::object::ObjectFile& object,
+                           const llvm::RuntimeDyld::LoadedObjectInfo& info) {
+    writeFunctions(object, info);
+  }
+#endif
+
+private:
+  FILE* perfMap;
+  std::mutex mutex;
+
+  void writeFunctions(const llvm::object::ObjectFile& object,
+                      const llvm::RuntimeDyld::LoadedObjectInfo& info) {
+    if (perfMap == nullptr) {
+      return;
+    }
+
+    // The debug object has the symbols relocated to their load addresses
+    llvm::object::OwningBinary<llvm::object::ObjectFile> debugObject =
+        info.getObjectForDebug(object);
+    if (debugObject.getBinary() == nullptr) {
+      return;
+    }
+
+    lock_guard<std::mutex> lock(mutex);
+    for (auto& symbolSize :
+         llvm::object::computeSymbolSizes(*debugObject.getBinary())) {
+      const llvm::object::SymbolRef& symbol = symbolSize.first;
+      uint64_t size = symbolSize.second;
+#if LLVM_MAJOR_VERSION >= 11
+      auto type = symbol.getType();
+      if (!type) {
+        llvm::consumeError(type.takeError());
+        continue;
+      }
+      if (*type != llvm::object::SymbolRef::ST_Function) {
+        continue;
+      }
+#else
+      if (symbol.getType() != llvm::object::SymbolRef::ST_Function) {
+        continue;
+      }
+#endif
+      auto name = symbol.getName();
+      auto address = symbol.getAddress();
+#if LLVM_MAJOR_VERSION >= 4
+      if (!name || !address) {
+        if (!name) llvm::consumeError(name.takeError());
+        if (!address) llvm::consumeError(address.takeError());
+        continue;
+      }
+#else
+      if (!name || !address) {
+        continue;
+      }
+#endif
+      if (size == 0) {
+        continue;
+      }
+      fprintf(perfMap, "%llx %llx simit:%s\n", (unsigned long long)*address,
+              (unsigned long long)size, name->str().c_str());
+    }
+    fflush(perfMap);
+  }
+};
+#endif
+
+void registerJITEventListeners(llvm::ExecutionEngine* engine) {
+#if LLVM_MAJOR_VERSION > 3 || LLVM_MINOR_VERSION >= 5
+  // The gdb listener is shared by all engines
+  engine->RegisterJITEventListener(
+      llvm::JITEventListener::createGDBRegistrationListener());
+#endif
+#if LLVM_MAJOR_VERSION > 3 || LLVM_MINOR_VERSION >= 7
+  static PerfMapListener perfMapListener;
+  engine->RegisterJITEventListener(&perfMapListener);
+#endif
+}
+
+}}
@@ -0,0 +1,20 @@
+#ifndef SIMIT_LLVM_JIT_LISTENER_H
+#define SIMIT_LLVM_JIT_LISTENER_H
+
+namespace llvm {
+class ExecutionEngine;
+}
+
+namespace simit {
+namespace backend {
+
+/// Register the listeners that make the code generated by the engine visible
+/// to debuggers and profilers: gdb's JIT interface, and a perf map file
+/// (/tmp/perf-<pid>.map) that lists the address, size and name of every
+/// generated function, so that `perf report` attributes samples to them.
+/// Functions are named `simit:<name>` in the perf map. The listeners must be
+/// registered before the engine generates code.
+void registerJITEventListeners(llvm::ExecutionEngine* engine);
+
+}}
+#endif
@@ -0,0 +1,55 @@
+#include "llvm_memory_manager.h"
+
+#include <memory>
+
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+
+using namespace std;
+
+namespace simit {
+namespace backend {
+
+/// A section memory manager that counts the bytes of the sections it allocates.
+class CountingMemoryManager : public llvm::SectionMemoryManager {
+public:
+  CountingMemoryManager(JITSectionBytes* bytes) : bytes(bytes) {}
+
+  uint8_t *allocateCodeSection(uintptr_t size, unsigned alignment,
+                               unsigned sectionID,
+                               llvm::StringRef sectionName) {
+    bytes->code += size;
+    return llvm::SectionMemoryManager::allocateCodeSection(
+        size, alignment, sectionID, sectionName);
+  }
+
+  uint8_t *allocateDataSection(uintptr_t size, unsigned alignment,
+                               unsigned sectionID, llvm::StringRef sectionName,
+                               bool isReadOnly) {
+    bytes->data += size;
+    return llvm::SectionMemoryManager::allocateDataSection(
+        size, alignment, sectionID, sectionName, isReadOnly);
+  }
+
+private:
+  JITSectionBytes* bytes;
+};
+
+llvm::ExecutionEngine* createExecutionEngine(llvm::EngineBuilder* builder,
+                                             JITSectionBytes* bytes) {
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  builder->setUseMCJIT(true);
+  builder->setMCJITMemoryManager(new CountingMemoryManager(bytes));
+  llvm::ExecutionEngine* engine = builder->create();
+  // The engine owns the memory manager, so engines that the builder creates
+  // later must not share it
+  builder->setMCJITMemoryManager(nullptr);
+  return engine;
+#else
+  builder->setMCJITMemoryManager(
+      unique_ptr<llvm::RTDyldMemoryManager>(new CountingMemoryManager(bytes)));
+  return builder->create();
+#endif
+}
+
+}}
@@ -0,0 +1,26 @@
+#ifndef SIMIT_LLVM_MEMORY_MANAGER_H
+#define SIMIT_LLVM_MEMORY_MANAGER_H
+
+#include <cstddef>
+
+namespace llvm {
+class EngineBuilder;
+class ExecutionEngine;
+}
+
+namespace simit {
+namespace backend {
+
+/// The bytes of the code and data sections that engines have allocated.
+struct JITSectionBytes {
+  size_t code = 0;
+  size_t data = 0;
+};
+
+/// Create an MCJIT execution engine whose memory manager adds the sizes of the
+/// code and data sections it allocates to `bytes'.
+llvm::ExecutionEngine* createExecutionEngine(llvm::EngineBuilder* builder,
+                                             JITSectionBytes* bytes);
+
+}}
+#endif
@@ -100,6 +100,10 @@ llvm::StructType *llvmType(const ir::UnstructuredSetType& setType,
         llvm::Type::getInt32PtrTy(LLVM_CTX, addrspace));
   }
 
+  // Partition table
+  llvmFieldTypes.push_back(
+      llvm::Type::getInt32PtrTy(LLVM_CTX, addrspace));
+
   // Fields
   for (const Field &field : elemType->fields) {
     llvmFieldTypes.push_back(llvmType(field.type, addrspace));
@@ -158,6 +158,11 @@ std::vector<fir::FuncDecl::Ptr> createIntrinsics() {
                ir::intrinsics::dot().getName(),
                {Type::Ptr(), Type::Ptr()},
                {makeTensorType(ScalarType::Type::FLOAT)});
+  addIntrinsic(&intrinsics,
+               ir::intrinsics::mgsolve().getName(),
+               {nMatrixType, nVectorType},
+               {nVectorType},
+               {genericParam});
   addIntrinsic(&intrinsics,
                ir::intrinsics::chol().getName(),
                {nMatrixType},
@@ -6,6 +6,7 @@
 
 #include "program_context.h"
 #include "error.h"
+#include "profile.h"
 #include "token.h"
 #include "scanner.h"
 #include "parser.h"
@@ -23,19 +24,25 @@ using namespace simit::internal;
 
 // Frontend
 int Frontend::parseStream(std::istream &programStream, ProgramContext *ctx,
-                          std::vector<ParseError> *errors) {
+                          std::vector<ParseError> *errors,
+                          CompileProfile *profile) {
+  CompileTimer timer(profile);
   std::vector<fir::FuncDecl::Ptr> intrinsics = fir::createIntrinsics();
 
   // Lexical and syntactic analyses.
   TokenStream tokens = Scanner(errors).lex(programStream);
+  timer.endStage("Scan");
   fir::Program::Ptr program = Parser(errors).parse(tokens);
+  timer.endStage("Parse");
 
   // Semantic analyses.
   program = fir::ConstantFolding().rewrite(program);
   fir::ConstChecker(errors).check(program);
   fir::InferElementSources().infer(program);
   fir::CloneGenericFunctions(intrinsics).specialize(program);
+  timer.endStage("Semantic Analyses");
   fir::TypeChecker(intrinsics, errors).check(program);
+  timer.endStage("Type Check");
 
   // Only emit IR if no syntactic or semantic error was found.
   if (!errors->empty()) {
@@ -45,20 +52,23 @@ int Frontend::parseStream(std::istream &programStream, ProgramContext *ctx,
 
   // IR generation.
   fir::IREmitter(ctx).emitIR(program);
+  timer.endStage("Emit IR");
   return 0;
 }
 
 int Frontend::parseString(const std::string &programString, ProgramContext *ctx,
-                          std::vector<ParseError> *errors) {
+                          std::vector<ParseError> *errors,
+                          CompileProfile *profile) {
   std::istringstream programStream(programString);
-  return parseStream(programStream, ctx, errors);
+  return parseStream(programStream, ctx, errors, profile);
 }
 
 int Frontend::parseFile(const std::string &filename, ProgramContext *ctx,
-                        std::vector<ParseError> *errors) {
+                        std::vector<ParseError> *errors,
+                        CompileProfile *profile) {
   std::ifstream programStream(filename);
   if (!programStream.good()) {
     return 2;
   }
-  return parseStream(programStream, ctx, errors);
+  return parseStream(programStream, ctx, errors, profile);
 }
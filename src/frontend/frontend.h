@@ -7,6 +7,7 @@
 
 namespace simit {
 class ParseError;
+class CompileProfile;
 namespace internal {
 class ProgramContext;
 
@@ -15,20 +16,24 @@ class ProgramContext;
 /// Strings and files can be parsed using the \ref parseString and
 /// \ref parseFile methods and the resulting IR can be retrieved using the
 /// \ref getIR method. If the parse methods return an error value information
-/// about the errors can be retrieved using the getErrors method.
+/// about the errors can be retrieved using the getErrors method. If a compile
+/// profile is given, the time of each analysis is added to it.
 class Frontend {
 public:
   /// Parses, typechecks and turns a given Simit-formated stream into Simit IR.
   int parseStream(std::istream &programStream, ProgramContext *ctx,
-                  std::vector<ParseError> *errors);
+                  std::vector<ParseError> *errors,
+                  CompileProfile *profile=nullptr);
 
   /// Parses, typechecks and turns a given Simit-formated string into Simit IR.
   int parseString(const std::string &programString, ProgramContext *ctx,
-                  std::vector<ParseError> *errors);
+                  std::vector<ParseError> *errors,
+                  CompileProfile *profile=nullptr);
 
   /// Parses, typechecks and turns a given Simit-formated file into Simit IR.
   int parseFile(const std::string &filename, ProgramContext *ctx,
-                std::vector<ParseError> *errors);
+                std::vector<ParseError> *errors,
+                CompileProfile *profile=nullptr);
 };
 
 }} // namespace simit::internal
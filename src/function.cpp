@@ -3,6 +3,8 @@
 #include "backend/backend_function.h"
 #include "types_convert.h"
 #include "graph.h"  // TODO: should not need this include
+#include "reorder.h"
+#include "timers.h"
 
 using namespace std;
 
@@ -12,7 +14,11 @@ namespace simit {
 Function::Function() : Function(nullptr) {
 }
 
-Function::Function(backend::Function* func) : impl(func), funcPtr(nullptr) {
+Function::Function(backend::Function* func) : Function(func, -1) {
+}
+
+Function::Function(backend::Function* func, int profile)
+    : impl(func), profile(profile), funcPtr(nullptr) {
 }
 
 void Function::clear() {
@@ -87,6 +93,9 @@ void Function::bind(const std::string& name, simit::Set *set) {
   }
 #endif
 
+  // Move the set elements to a more local order before the backend sees them
+  reorderSet(*set, kReorderPolicy);
+
   impl->bind(name, set);
 }
 
@@ -152,6 +161,36 @@ void Function::printMachine(std::ostream& os) const {
   }
 }
 
+void Function::startProfile() {
+  uassert(hasProfile()) << "function was not compiled with timers";
+  ir::TimerStorage::getInstance().setEnabled(profile, true);
+}
+
+void Function::stopProfile() {
+  uassert(hasProfile()) << "function was not compiled with timers";
+  ir::TimerStorage::getInstance().setEnabled(profile, false);
+}
+
+void Function::resetProfile() {
+  uassert(hasProfile()) << "function was not compiled with timers";
+  ir::TimerStorage::getInstance().reset(profile);
+}
+
+Profile Function::getProfile() const {
+  uassert(hasProfile()) << "function was not compiled with timers";
+  return Profile(ir::TimerStorage::getInstance().getRecords(profile));
+}
+
+MemoryReport Function::getMemoryReport() const {
+  uassert(defined()) << "undefined function";
+  return impl->getMemoryReport();
+}
+
+CompileProfile Function::getCompileProfile() const {
+  uassert(defined()) << "undefined function";
+  return impl->getCompileProfile();
+}
+
 std::ostream& operator<<(std::ostream& os, const Function& f) {
   f.print(os);
   return os;
@@ -4,6 +4,8 @@
 #include <string>
 #include <functional>
 #include "tensor.h"
+#include "memory_report.h"
+#include "profile.h"
 
 namespace simit {
 class Set;
@@ -35,6 +37,10 @@ public:
   /// be created using the backend::Backend::compile methods.
   Function(backend::Function* function);
 
+  /// Create a function from a backend::Function compiled with timers, whose
+  /// timed sites form the given profile.
+  Function(backend::Function* function, int profile);
+
   /// Clear Function of data (makes it undefined).
   void clear();
 
@@ -87,8 +93,39 @@ public:
   /// Print the function to the stream as machine assembly code.
   void printMachine(std::ostream& os) const;
 
+  /// True if the function was compiled with timers (see
+  /// Program::compileWithTimers), so that it can be profiled.
+  bool hasProfile() const {return profile != -1;}
+
+  /// Start counting the runs of the function in its profile. Profiling starts
+  /// when the function is compiled.
+  void startProfile();
+
+  /// Stop counting the runs of the function in its profile. Runs of a
+  /// stopped function still read the cycle counter, but their times are
+  /// discarded.
+  void stopProfile();
+
+  /// Clear the times of the function's profile.
+  void resetProfile();
+
+  /// Returns a snapshot of the times of the function's profile.
+  Profile getProfile() const;
+
+  /// Returns a snapshot of the memory held by the function: the fields and
+  /// endpoints of the sets bound to it, its indices and temporaries, the
+  /// buffers its code allocates, and the code itself. Sets bound to several
+  /// functions are included in the report of each.
+  MemoryReport getMemoryReport() const;
+
+  /// Returns the time of each stage of compiling the function. The backend
+  /// stages are always included, and the frontend and lowering stages when
+  /// the function is compiled with CompileOptions::profileCompile.
+  CompileProfile getCompileProfile() const;
+
 private:
   std::shared_ptr<backend::Function> impl;
+  int profile;
 
   // To make the run method faster we store the function pointer here.
   std::function<void()> funcPtr;
@@ -1,6 +1,8 @@
 #include "graph.h"
 
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include "graph_indices.h"
 
 using namespace std;
@@ -12,23 +14,155 @@ Set::~Set() {
     delete f;
   }
   free(endpoints);
-  free(latticePoints);
-  free(latticeLinks);
+  free(elementIndices);
+  free(elementRefs);
+
+  for (const Set* endpointSet : endpointSets) {
+    auto& incident = endpointSet->incidentSets;
+    incident.erase(std::remove(incident.begin(), incident.end(), this),
+                   incident.end());
+  }
 
   delete this->neighbors;
 }
 
-void Set::increaseCapacity() {
+void Set::increaseCapacity(int increment) {
   for (auto f : fields) {
     int typeSize = f->sizeOfType;
-    f->data = realloc(f->data, (capacity+capacityIncrement) * typeSize);
-    memset((char*)(f->data)+capacity*typeSize, 0, capacityIncrement*typeSize);
+    f->data = realloc(f->data, (capacity+increment) * typeSize);
+    memset((char*)(f->data)+capacity*typeSize, 0, increment*typeSize);
 
     for (FieldRefBase *fieldRef : f->fieldReferences) {
       fieldRef->data = f->data;
     }
   }
-  capacity += capacityIncrement;
+
+  if (elementIndices != nullptr) {
+    size_t newSize = (capacity+increment) * sizeof(int);
+    elementIndices = (int*)realloc(elementIndices, newSize);
+    elementRefs = (int*)realloc(elementRefs, newSize);
+    for (auto f : fields) {
+      for (FieldRefBase *fieldRef : f->fieldReferences) {
+        fieldRef->elementIndices = elementIndices;
+      }
+    }
+  }
+  capacity += increment;
+}
+
+void Set::addElements(int n) {
+  iassert(getCardinality() == 0 || kind == LatticeLink)
+      << "Elements of edge sets must be added with their endpoints";
+  iassert(elementIndices == nullptr && partitionTable.empty());
+
+  // Grow once, keeping the invariant numElements < capacity
+  if (numElements + n > capacity-1) {
+    int increment = numElements + n + 1 - capacity;
+    increment = (increment + capacityIncrement-1) / capacityIncrement
+                * capacityIncrement;
+    increaseCapacity(increment);
+  }
+  numElements += n;
+}
+
+int Set::getLatticePointIndex(const std::vector<int>& coords) const {
+  const int ndims = dimensions.size();
+  for (int i = 0; i < ndims; ++i) {
+    uassert(coords[i] >= 0 && coords[i] < dimensions[i])
+        << "Coordinates must not be negative and must fall within the "
+        << "lattice dimensions";
+  }
+
+  int index = 0;
+  if (latticeOrder == Morton) {
+    const int* codes = latticeIndexData.data() + ndims;
+    for (int i = 0; i < ndims; ++i) {
+      index += codes[coords[i]];
+      codes += dimensions[i];
+    }
+  }
+  else {
+    for (int i = ndims-1; i >= 0; --i) {
+      index = index * dimensions[i] + coords[i];
+    }
+  }
+  return index;
+}
+
+std::vector<int> Set::getLatticeCoords(int index) const {
+  const int ndims = dimensions.size();
+  std::vector<int> coords(ndims);
+  if (latticeOrder == Morton) {
+    // The code of the largest coordinate has all the bits of the dimension
+    const int* codes = latticeIndexData.data() + ndims;
+    for (int i = 0; i < ndims; ++i) {
+      int mask = codes[dimensions[i]-1];
+      int bit = 0;
+      for (int pos = 0; (mask >> pos) != 0; ++pos) {
+        if ((mask >> pos) & 1) {
+          coords[i] |= ((index >> pos) & 1) << bit;
+          ++bit;
+        }
+      }
+      codes += dimensions[i];
+    }
+  }
+  else {
+    for (int i = 0; i < ndims; ++i) {
+      coords[i] = index % dimensions[i];
+      index /= dimensions[i];
+    }
+  }
+  return coords;
+}
+
+void Set::buildLatticeIndexData() {
+  latticeIndexData = dimensions;
+  if (latticeOrder != Morton) {
+    return;
+  }
+
+  // Interleave the coordinate bits, lowest first and dimension 0 first at
+  // each level. Dimensions that run out of bits drop out, so the codes of
+  // lattices with unequal dimensions are a permutation of the points too.
+  const int ndims = dimensions.size();
+  std::vector<int> bits(ndims, 0);
+  for (int i = 0; i < ndims; ++i) {
+    while ((1 << bits[i]) < dimensions[i]) {
+      ++bits[i];
+    }
+  }
+  std::vector<std::vector<int>> positions(ndims);
+  int pos = 0;
+  for (int level = 0; level < *std::max_element(bits.begin(), bits.end());
+       ++level) {
+    for (int i = 0; i < ndims; ++i) {
+      if (level < bits[i]) {
+        positions[i].push_back(pos++);
+      }
+    }
+  }
+  for (int i = 0; i < ndims; ++i) {
+    for (int x = 0; x < dimensions[i]; ++x) {
+      int code = 0;
+      for (int b = 0; b < bits[i]; ++b) {
+        code |= ((x >> b) & 1) << positions[i][b];
+      }
+      latticeIndexData.push_back(code);
+    }
+  }
+}
+
+void Set::materializeLatticeEndpoints() const {
+  if (kind != LatticeLink || endpoints != nullptr) {
+    return;
+  }
+  endpoints = (int*)malloc(sizeof(int) * numElements * getCardinality());
+  for (int i=0; i < numElements; ++i) {
+    for (int j=0; j < getCardinality(); ++j) {
+      endpoints[i*getCardinality() + j] = getLatticeLinkEndpointIndex(i, j);
+    }
+  }
 }
 
 const internal::NeighborIndex *Set::getNeighborIndex() const {
@@ -42,6 +176,76 @@ const internal::NeighborIndex *Set::getNeighborIndex() const {
   return this->neighbors;
 }
 
+size_t Set::getFieldBytes() const {
+  size_t bytes = 0;
+  for (auto f : fields) {
+    if (f->data != nullptr) {
+      bytes += capacity * f->sizeOfType;
+    }
+  }
+  return bytes;
+}
+
+size_t Set::getEndpointBytes() const {
+  size_t bytes = 0;
+  if (endpoints != nullptr) {
+    int endpointCapacity = (kind == LatticeLink) ? numElements : capacity;
+    bytes += endpointCapacity * getCardinality() * sizeof(int);
+  }
+  if (elementIndices != nullptr) {
+    bytes += 2 * capacity * sizeof(int);
+  }
+  bytes += latticeIndexData.capacity() * sizeof(int);
+  bytes += partitionTable.capacity() * sizeof(int);
+  return bytes;
+}
+
+size_t Set::getNeighborIndexBytes() const {
+  return (neighbors != nullptr) ? neighbors->getBytes() : 0;
+}
+
+void Set::setElementOrdering(const std::vector<int>& ordering) {
+  uassert((int)ordering.size() == numElements)
+      << "Ordering must be the same size as the set: " << ordering.size()
+      << " != " << numElements;
+  uassert(!hasFixedOrder()) << "Cannot reorder a set with a fixed order";
+
+  if (elementIndices == nullptr) {
+    elementIndices = (int*)malloc(capacity * sizeof(int));
+    elementRefs = (int*)malloc(capacity * sizeof(int));
+    for (int i=0; i < numElements; ++i) {
+      elementIndices[i] = i;
+    }
+    for (auto f : fields) {
+      for (FieldRefBase *fieldRef : f->fieldReferences) {
+        fieldRef->elementIndices = elementIndices;
+      }
+    }
+  }
+
+  for (int i=0; i < numElements; ++i) {
+    elementIndices[i] = ordering[elementIndices[i]];
+    elementRefs[elementIndices[i]] = i;
+  }
+
+  // The storage order no longer matches the partitions
+  partitionTable.clear();
+}
+
+void Set::registerWithEndpointSets() {
+  for (const Set* endpointSet : endpointSets) {
+    auto& incident = endpointSet->incidentSets;
+    if (std::find(incident.begin(), incident.end(), this) == incident.end()) {
+      incident.push_back(this);
+    }
+  }
+}
+
+void Set::invalidateNeighborIndex() {
+  delete this->neighbors;
+  this->neighbors = nullptr;
+}
+
 
 // Graph generators
 void createElements(Set *elements, unsigned num) {
@@ -128,4 +332,38 @@ Box createBox(Set *vertices, Set *edges,
   return Box(numX, numY, numZ, points, coords2edges);
 }
 
+void createPowerLawGraph(Set *vertices, Set *edges, unsigned numVertices,
+                         unsigned edgesPerVertex, unsigned seed) {
+  uassert(edgesPerVertex >= 1 && numVertices > edgesPerVertex);
+  vector<ElementRef> refs;
+  for (unsigned i = 0; i < numVertices; ++i) {
+    refs.push_back(vertices->add());
+  }
+
+  // Picking a uniform entry of the list of edge endpoints picks a vertex with
+  // probability proportional to its degree. The first vertices are listed
+  // once so that the first edges have endpoints to pick from.
+  vector<unsigned> endpoints;
+  for (unsigned i = 0; i < edgesPerVertex; ++i) {
+    endpoints.push_back(i);
+  }
+  mt19937 rng(seed);
+  vector<unsigned> targets;
+  for (unsigned source = edgesPerVertex; source < numVertices; ++source) {
+    uniform_int_distribution<size_t> pick(0, endpoints.size()-1);
+    targets.clear();
+    while (targets.size() < edgesPerVertex) {
+      unsigned target = endpoints[pick(rng)];
+      if (find(targets.begin(), targets.end(), target) == targets.end()) {
+        targets.push_back(target);
+      }
+    }
+    for (unsigned target : targets) {
+      edges->add(refs[source], refs[target]);
+      endpoints.push_back(source);
+      endpoints.push_back(target);
+    }
+  }
+}
+
 } // namespace simit
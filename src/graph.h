@@ -93,6 +93,13 @@ class Set {
 public:
   enum Kind {Unstructured, LatticeLink};
 
+  /// Storage orders of the points of a lattice. Lexicographic order stores
+  /// dimension 0 fastest. Morton (Z-)order interleaves the bits of the
+  /// coordinates, so that points that are close in any direction are mostly
+  /// close in memory. The links of a lattice are stored in the order of the
+  /// points they start at.
+  enum LatticeOrder {Lexicographic, Morton};
+
   /// UNSTRUCTURED constructors
   Set(const std::string &name) : Set(name, Unstructured) {}
 
@@ -103,6 +110,7 @@ public:
         "Set constructor takes an optional name followed by zero or more Sets");
     this->endpointSets = {&sets...};
     this->endpoints    = (int*)calloc(sizeof(int), capacity * getCardinality());
+    registerWithEndpointSets();
   }
 
   template <typename ...Sets>
@@ -111,8 +119,11 @@ public:
   template <typename ...Sets>
   Set(const Sets& ...sets) : Set("", sets...) {}
 
-  /// LATTICE LINK constructors
-  Set(const char *name, Set& points, std::vector<int> dims)
+  /// LATTICE LINK constructors. Morton ordered lattices must have power of
+  /// two dimensions, and can only be bound to functions compiled with
+  /// Settings::mortonLattices.
+  Set(const char *name, Set& points, std::vector<int> dims,
+      LatticeOrder order=Lexicographic)
       : Set(std::string(name), LatticeLink) {
     uassert(dims.size() > 0)
         << "Lattice link Set constructor takes an optional name followed by "
@@ -121,49 +132,35 @@ public:
         << "Lattice link Set constructor must be passed an empty underlying "
         << "point set, which it will then proceed to initialize.";
     this->endpointSets = {&points, &points};
-    this->endpoints    = (int*)calloc(sizeof(int), capacity * getCardinality());
     this->dimensions = dims;
     this->latticePointSet = &points;
+    this->latticeOrder = order;
+    registerWithEndpointSets();
+
+    // Lattice points are addressed by their coordinates, so their storage
+    // order must never change.
+    points.fixedOrder = true;
 
     int totalPoints = 1;
-    std::vector<int> cumDims;
     for (int d : dims) {
+      uassert(d > 0) << "Lattice dimensions must be positive";
+      uassert(order != Morton || (d & (d-1)) == 0)
+          << "Morton ordered lattice dimensions must be powers of two";
       totalPoints *= d;
-      cumDims.push_back(totalPoints);
     }
+    buildLatticeIndexData();
 
-    this->latticePoints = (ElementRef*)calloc(sizeof(ElementRef), totalPoints);
-    this->latticeLinks = (ElementRef*)calloc(
-        sizeof(ElementRef), totalPoints*dims.size());
-    
-    std::vector<int> indices(dims.size());
-    // Pad underlying set to have N_1 x N_2 x ... N_d elements, storing their
-    // references in latticePoints.
-    int count = 0;
-    util::variableLoop(dims.begin(), dims.end(),
-                       indices.begin(), indices.end(), [&](){
-        this->latticePoints[count] = points.add();
-        count++;
-      });
-
-    // Generate N_1 x N_2 x ... N_d x d elements for this set, linking the
-    // underlying points in a lattice structure, and store their references in
-    // the canonically ordered latticeLinks.
-    count = 0;
-    dims.push_back(dims.size()); // dimension index runs outermost
-    indices.push_back(0);
-    util::variableLoop(dims.begin(), dims.end(),
-                       indices.begin(), indices.end(), [&](){
-        int off = cumDims[indices.back()];
-        // Assumes periodic boundary conditions
-        this->latticeLinks[count] = add(
-            this->latticePoints[count%totalPoints],
-            this->latticePoints[(count+off)%totalPoints]);
-        count++;
-      });
-  }
-
-  Set(Set& points, std::vector<int> dims) : Set("", points, dims) {}
+    // Pad the underlying set to N_1 x N_2 x ... N_d points and add
+    // N_1 x N_2 x ... N_d x d links. The element at a lattice coordinate is
+    // found by linearizing the coordinate, and the endpoints of a link follow
+    // from its coordinate (see getEndpointIndex), so neither element
+    // references nor endpoints are stored.
+    points.addElements(totalPoints);
+    addElements(totalPoints * dims.size());
+  }
+
+  Set(Set& points, std::vector<int> dims, LatticeOrder order=Lexicographic)
+      : Set("", points, dims, order) {}
 
   ~Set();
 
@@ -181,6 +178,23 @@ public:
   /// Return the kind of the Set
   inline Kind getKind() const { return kind; }
 
+  /// Return the storage order of the points of a lattice link set
+  inline LatticeOrder getLatticeOrder() const {
+    uassert(kind == LatticeLink)
+        << "Can only retrieve the order of a lattice link set";
+    return latticeOrder;
+  }
+
+  /// Return the data that compiled code uses to index a lattice: its
+  /// dimensions, followed in Morton order by a table of the Morton code of
+  /// every coordinate of each dimension. The index of the point at (x_0,...)
+  /// is then the sum of the codes of x_0, ...
+  inline const int* getLatticeIndexData() const {
+    uassert(kind == LatticeLink)
+        << "Can only retrieve index data for a lattice link set";
+    return latticeIndexData.data();
+  }
+
   /// Return the number of endpoints of the elements in the set.  Non-edge sets
   /// have cardinality 0.
   inline int getCardinality() const { return endpointSets.size(); }
@@ -191,17 +205,7 @@ public:
         << "Cannot retrieve lattice point of non-lattice set";
     uassert(coords.size() == dimensions.size())
         << "Must provide number of coords equal to the number of dimensions";
-    int index = 0;
-    int totalSize = 1;
-    for (int i = dimensions.size()-1; i >= 0; --i) {
-      index *= dimensions[i];
-      index += coords[i];
-      totalSize *= dimensions[i];
-    }
-    uassert(index >= 0 && index < totalSize)
-        << "Coordinates must not be negative and must fall within the "
-        << "lattice dimensions";
-    return latticePoints[index];
+    return ElementRef(getLatticePointIndex(coords));
   }
 
   /// Return the lattice link at the given location and direction.
@@ -210,35 +214,16 @@ public:
         << "Cannot retrieve lattice link of non-lattice set";
     uassert(coords.size() == dimensions.size())
         << "Must provide number of coords equal to dimensions";
-    int index = 0;
-    int totalSize = 1;
-    for (int i = dimensions.size()-1; i >= 0; --i) {
-      index *= dimensions[i];
-      index += coords[i];
-      totalSize *= dimensions[i];
-    }
+    uassert(dir >= 0 && dir < (int)dimensions.size())
+        << "Link direction must fall within the lattice dimensions";
     // Add directional index innermost
-    index *= dimensions.size();
-    index += dir;
-    totalSize *= dimensions.size();
-    uassert(index >= 0 && index < totalSize)
-        << "Coordinates must not be negative and must fall within the "
-        << "lattice dimensions";
-    return latticeLinks[index];
+    return ElementRef(getLatticePointIndex(coords) * dimensions.size() + dir);
   }
 
   inline std::vector<int> getLatticePointCoords(ElementRef elt) const {
     uassert(kind == LatticeLink)
         << "Cannot retrieve lattice point coords of non-lattice set";
-    int index = elt.getIdent();
-    std::vector<int> coords;
-    for (unsigned i = 0; i < dimensions.size(); ++i) {
-      int dimSize = dimensions[i];
-      coords.push_back(index % dimSize);
-      index /= dimSize;
-    }
-    iassert(coords.size() == dimensions.size());
-    return coords;
+    return getLatticeCoords(elt.getIdent());
   }
 
   /// Add a tensor field to the set.  Use the template parameters to specify the
@@ -263,8 +248,9 @@ public:
     FieldData *fieldData = fields[fieldNames[name]];
     uassert(fieldData->type->getOrder() == 1) << "Spatial Data must be order 1. \
       Currently order:" << fieldData->type->getOrder();
-    uassert(fieldData->type->getDimension(0) == 3) << "Spatial Data must be 3D \
-      in order 1. Currently: " << fieldData->type->getDimension(0); 
+    uassert(fieldData->type->getDimension(0) == 2 ||
+            fieldData->type->getDimension(0) == 3) << "Spatial Data must be 2D \
+      or 3D in order 1. Currently: " << fieldData->type->getDimension(0);
     spatialFieldName = name;
   }
 
@@ -287,6 +273,8 @@ public:
   ElementRef add(Endpoints... endpoints) {
     iassert(sizeof...(endpoints) == getCardinality()) <<"Wrong number of \
       endpoints.";
+    uassert(kind != LatticeLink)
+        << "Elements cannot be added to lattice link edge sets";
     if (numElements > capacity-1) {
       increaseEdgeCapacity();
     }
@@ -295,6 +283,13 @@ public:
     if (numElements > capacity-1) {
       increaseCapacity();
     }
+    if (elementIndices != nullptr) {
+      elementIndices[numElements] = numElements;
+      elementRefs[numElements] = numElements;
+    }
+    if (!partitionTable.empty()) {
+      partitionTable.back() = numElements+1;
+    }
     return ElementRef(numElements++);
   }
 
@@ -302,6 +297,8 @@ public:
   void remove(ElementRef element) {
     uassert(kind != LatticeLink)
         << "Element removal disallowed for lattice link edge sets";
+    uassert(!isReordered())
+        << "Element removal disallowed for reordered sets";
     for (auto f : fields){
       switch (f->type->getComponentType()) {
         case ComponentType::Float: {
@@ -419,9 +416,19 @@ public:
 
   /// Get an endpoint of an edge
   ElementRef getEndpoint(ElementRef edge, int endpointNum) const {
-    return ElementRef(endpoints[edge.ident*getCardinality() + endpointNum]);
+    int index = getEndpointIndex(getElementIndex(edge), endpointNum);
+    return endpointSets[endpointNum]->getElementRef(index);
   }
   
+  /// Get the storage index of an endpoint of the edge at the given storage
+  /// index. Unlike getEndpoint this does not translate reordered elements.
+  int getEndpointIndex(int edgeIndex, int endpointNum) const {
+    if (kind == LatticeLink) {
+      return getLatticeLinkEndpointIndex(edgeIndex, endpointNum);
+    }
+    return endpoints[edgeIndex*getCardinality() + endpointNum];
+  }
+
   class Endpoints {
   public:
     /// Iterator that iterates over the endpoints of an edge
@@ -445,12 +452,11 @@ public:
       const ElementRef* operator->() const {return &retElem;}
 
       Iterator& operator++() {
-        const int cardinality = set->getCardinality();
         endpointNum++;
         if (endpointNum > set->getCardinality()-1)
           retElem.ident = -1;   // return invalid element
         else
-          retElem.ident = set->endpoints[curElem.ident*cardinality+endpointNum];
+          retElem = set->getEndpoint(curElem, endpointNum);
         return *this;
       }
 
@@ -460,7 +466,7 @@ public:
         if (endpointNum > cardinality-1)
           retElem.ident = -1;   // return invalid element
         else
-          retElem.ident = set->endpoints[curElem.ident*cardinality+endpointNum];
+          retElem = set->getEndpoint(curElem, endpointNum);
         return *this;
       }
 
@@ -517,13 +523,33 @@ public:
   }
 
   /// Get an array containing, for each edge in a set, the elements it connects.
-  int *getEndpointsData() { return endpoints; }
+  /// The endpoints are storage indices into the endpoint sets, which differ
+  /// from the endpoint ElementRefs if the endpoint sets have been reordered.
+  /// Lattice link sets compute their endpoints, so their array is only built
+  /// (once) when it is requested.
+  int *getEndpointsData() {
+    materializeLatticeEndpoints();
+    return endpoints;
+  }
+  const int *getEndpointsData() const {
+    materializeLatticeEndpoints();
+    return endpoints;
+  }
 
   /// If this set is an edge set with cardinality 2 then return an index that
   /// for each element in the first connected set contains it's neighbors in the
   /// second connceted set. Otherwise, return nullptr.
   const internal::NeighborIndex *getNeighborIndex() const;
 
+  /// The bytes held by the fields of the set, including unused capacity.
+  size_t getFieldBytes() const;
+
+  /// The bytes held by the endpoints of the set and by its ordering data.
+  size_t getEndpointBytes() const;
+
+  /// The bytes held by the neighbor index, or 0 if it has not been created.
+  size_t getNeighborIndexBytes() const;
+
   void setName(const std::string &name) { this->name = name; }
   std::string getName() const { return name; }
 
@@ -594,19 +620,72 @@ public:
   };
 
   // Added getters for reordering
-  inline int* getEndpointsPtr() { return endpoints; }
+  inline int* getEndpointsPtr() { return getEndpointsData(); }
   inline int getFieldIndex(std::string name) { return fieldNames[name]; } inline 
     std::vector<FieldData*>& getFields() { return fields; } inline std::string 
     getSpatialFieldName() const { return spatialFieldName; }
   inline bool hasSpatialField() const { return !spatialFieldName.empty(); }
 
+  /// Drop the lazily created neighbor index. Must be called after the
+  /// endpoints of the set have been modified in place (e.g. by reordering).
+  void invalidateNeighborIndex();
+
+  /// True if the elements of the set have been moved to a storage order that
+  /// differs from the order they were added in. ElementRefs keep referring to
+  /// the same elements, and are translated to storage indices on field access.
+  bool isReordered() const { return elementIndices != nullptr; }
+
+  /// True if the storage order of the set must not change (e.g. lattices).
+  bool hasFixedOrder() const { return fixedOrder || kind == LatticeLink; }
+
+  /// Record that the element stored at index i has been moved to ordering[i].
+  /// This does not move any data; it only updates the ElementRef translation.
+  void setElementOrdering(const std::vector<int>& ordering);
+
+  /// Get the storage index of an element.
+  int getElementIndex(ElementRef element) const {
+    return (elementIndices != nullptr) ? elementIndices[element.ident]
+                                       : element.ident;
+  }
+
+  /// Get the element stored at the given storage index.
+  ElementRef getElementRef(int index) const {
+    return ElementRef((elementRefs != nullptr) ? elementRefs[index] : index);
+  }
+
+  /// Get the edge sets whose endpoints refer to this set.
+  const std::vector<Set*>& getIncidentSets() const { return incidentSets; }
+
+  /// Store the partition table of a set whose elements are stored grouped by
+  /// partition (see getPartitionTable).
+  void setPartitionTable(const std::vector<int>& table) {
+    uassert(table.size() >= 2 && (int)table.size() == 2*table[0]+2 &&
+            table.back() == numElements) << "Invalid partition table";
+    partitionTable = table;
+  }
+
+  /// Get the partition table, or nullptr if the set is not partitioned. The
+  /// table of a set with k partitions is
+  ///   k, begin_0, boundary_0, ..., begin_k-1, boundary_k-1, size
+  /// where partition p holds the elements [begin_p, begin_p+1), with interior
+  /// elements first and elements that touch other partitions from boundary_p.
+  /// Elements added later are appended to the boundary of the last partition.
+  const int* getPartitionTable() const {
+    return partitionTable.empty() ? nullptr : partitionTable.data();
+  }
+
+  /// Get the number of partitions (0 if the set is not partitioned).
+  int getNumPartitions() const {
+    return partitionTable.empty() ? 0 : partitionTable[0];
+  }
+
 private:
 
   // Private constructor for delegation
   Set(const std::string &name, Kind kind)
       : kind(kind), name(name), numElements(0), endpoints(nullptr),
-        latticePoints(nullptr), latticeLinks(nullptr),
-        capacity(capacityIncrement), neighbors(nullptr) {}
+        latticeOrder(Lexicographic), capacity(capacityIncrement), neighbors(nullptr), fixedOrder(false),
+        elementIndices(nullptr), elementRefs(nullptr) {}
 
   // Set data
   Kind kind;
@@ -614,13 +693,13 @@ private:
   std::string spatialFieldName;
   int numElements;                           // number of elements in the set
   std::vector<const Set*> endpointSets;      // the sets the endpoints belong to
-  int* endpoints;                            // the endpoints of edge elements
+  mutable int* endpoints;                    // the endpoints of edge elements
 
   // Lattice link set data
   std::vector<int> dimensions;               // the lattice dimensions
   const Set* latticePointSet;                // the underlying point set
-  ElementRef* latticePoints;                 // ordered refs to lattice points
-  ElementRef* latticeLinks;                  // ordered refs to lattice links
+  LatticeOrder latticeOrder;                 // the storage order of points
+  std::vector<int> latticeIndexData;         // dimensions and Morton codes
 
   int capacity;                              // current capacity of the set
   static const int capacityIncrement = 1024; // increment for capacity increases
@@ -629,12 +708,61 @@ private:
   std::map<std::string, int> fieldNames;     // name to field lookups
   std::vector<FieldData*> fields;            // fields of elements in the set
 
+  // Reordering data
+  mutable std::vector<Set*> incidentSets;    // edge sets with endpoints here
+  bool fixedOrder;                           // storage order must not change
+  int* elementIndices;                       // element ident to storage index
+  int* elementRefs;                          // storage index to element ident
+  std::vector<int> partitionTable;           // partitions (empty if none)
+
   /// disable copy constructors
   Set(const Set& s);
   Set& operator=(const Set& s);
 
   /// increase capacity of all fields
-  void increaseCapacity();
+  void increaseCapacity(int increment=capacityIncrement);
+
+  /// add n elements without endpoints (used to build lattices)
+  void addElements(int n);
+
+  /// the storage index of an endpoint of the lattice link at linkIndex, which
+  /// links the point at linkIndex/ndims to its periodic successor in
+  /// direction linkIndex%ndims
+  int getLatticeLinkEndpointIndex(int linkIndex, int endpointNum) const {
+    iassert(kind == LatticeLink);
+    int ndims = dimensions.size();
+    int point = linkIndex / ndims;
+    if (endpointNum == 0) {
+      return point;
+    }
+    int dir = linkIndex % ndims;
+    if (latticeOrder == Morton) {
+      std::vector<int> coords = getLatticeCoords(point);
+      coords[dir] = (coords[dir] + 1) % dimensions[dir];
+      return getLatticePointIndex(coords);
+    }
+    int stride = 1;
+    for (int i = 0; i < dir; ++i) {
+      stride *= dimensions[i];
+    }
+    int coord = (point / stride) % dimensions[dir];
+    return (coord == dimensions[dir]-1) ? point - coord*stride : point + stride;
+  }
+
+  /// the storage index of the lattice point at the given coordinates
+  int getLatticePointIndex(const std::vector<int>& coords) const;
+
+  /// the coordinates of the lattice point at the given storage index
+  std::vector<int> getLatticeCoords(int index) const;
+
+  /// build latticeIndexData
+  void buildLatticeIndexData();
+
+  /// build the endpoints array of a lattice link set, if it has not been built
+  void materializeLatticeEndpoints() const;
+
+  /// add this set to the incident sets of its endpoint sets
+  void registerWithEndpointSets();
 
   /// helpers for constructing endpoint sets
   template <typename F, typename ...T> std::vector<const Set*>
@@ -660,14 +788,16 @@ private:
   void addEndpoints(int which, F f, T ... eps) {
     uassert(endpointSets[which]->getSize() > f.ident)
         << "Invalid member of set in addEdge";
-    endpoints[numElements*getCardinality()+which] = f.ident;
+    endpoints[numElements*getCardinality()+which] =
+        endpointSets[which]->getElementIndex(f);
     addEndpoints(which+1, eps...);
   }
   template <typename F>
   void addEndpoints(int which, F f) {
     uassert(endpointSets[which]->getSize() > f.ident)
         << "Invalid member of set in addEdge";
-    endpoints[numElements*getCardinality()+which] = f.ident;
+    endpoints[numElements*getCardinality()+which] =
+        endpointSets[which]->getElementIndex(f);
   }
   void addEndpoints(int) {}
 
@@ -714,9 +844,9 @@ private:
       os << it->ident;
       if (getCardinality() > 0) {
         os << ":(";
-        os << endpoints[0];
+        os << getEndpointIndex(0, 0);
         for (int i=1; i<getCardinality(); ++i) {
-          os << "," << endpoints[i];
+          os << "," << getEndpointIndex(0, i);
         }
         os << ")";
       }
@@ -726,9 +856,9 @@ private:
       os << ", " << it->ident;
       if (getCardinality() > 0) {
         os << ":(";
-        os << endpoints[it->ident*getCardinality() + 0];
+        os << getEndpointIndex(it->ident, 0);
         for (int i=1; i<getCardinality(); ++i) {
-          os << "," << endpoints[it->ident*getCardinality() + i];
+          os << "," << getEndpointIndex(it->ident, i);
         }
         os << ")";
       }
@@ -758,12 +888,14 @@ public:
 
   FieldRefBase(const FieldRefBase& other) {
     data = other.data;
+    elementIndices = other.elementIndices;
     fieldData = other.fieldData;
     this->fieldData->fieldReferences.insert(this);
   }
 
   FieldRefBase(FieldRefBase&& other) {
     std::swap (data, other.data);
+    std::swap (elementIndices, other.elementIndices);
     std::swap (fieldData, other.fieldData);
     this->fieldData->fieldReferences.erase(&other);
     this->fieldData->fieldReferences.insert(this);
@@ -771,6 +903,7 @@ public:
 
   FieldRefBase& operator=(const FieldRefBase &other) {
     data = other.data;
+    elementIndices = other.elementIndices;
     fieldData = other.fieldData;
     this->fieldData->fieldReferences.insert(this);
     return *this;
@@ -778,6 +911,7 @@ public:
 
   FieldRefBase& operator=(FieldRefBase&& other) {
     std::swap(data, other.data);
+    std::swap(elementIndices, other.elementIndices);
     std::swap (fieldData, other.fieldData);
     this->fieldData->fieldReferences.erase(&other);
     this->fieldData->fieldReferences.insert(this);
@@ -794,20 +928,24 @@ public:
 protected:
   FieldRefBase(void *fieldData)
       : fieldData(static_cast<Set::FieldData*>(fieldData)),
-        data(this->fieldData->data) {
+        data(this->fieldData->data),
+        elementIndices(this->fieldData->set->elementIndices) {
     this->fieldData->fieldReferences.insert(this);
   }
 
   template <typename T>
   inline T *getElemDataPtr(ElementRef element, size_t elementFieldSize) const {
     iassert(sizeof(T) == componentSize(fieldData->type->getComponentType()));
-    return &static_cast<T*>(data)[element.ident * elementFieldSize];
+    int index = (elementIndices != nullptr) ? elementIndices[element.ident]
+                                            : element.ident;
+    return &static_cast<T*>(data)[index * elementFieldSize];
   }
 
   Set::FieldData *fieldData;
 
 private:
   void *data;
+  const int *elementIndices;  // set element translation (nullptr if identity)
 
   friend Set;
 };
@@ -1100,6 +1238,13 @@ private:
 Box createBox(Set *vertices, Set *edges,
               unsigned numX, unsigned numY, unsigned numZ);
 
+/// Add a graph with a power-law degree distribution to the sets, by
+/// preferential attachment: each vertex after the first `edgesPerVertex' adds
+/// edges from itself to that many distinct earlier vertices, picked with
+/// probability proportional to their degree.
+void createPowerLawGraph(Set *vertices, Set *edges, unsigned numVertices,
+                         unsigned edgesPerVertex, unsigned seed=0);
+
 } // namespace simit
 
 #endif
@@ -13,8 +13,8 @@ VertexToEdgeEndpointIndex:: VertexToEdgeEndpointIndex(const Set &edgeSet) {
 
   for (auto e : edgeSet) {
     for (int epi=0; epi<(int)(endpointSets.size()); epi++) {
-      auto ep = edgeSet.getEndpoint(e, epi);
-      whichEdgesForVertex[std::make_pair(epi, ep.ident)].insert(e.ident);
+      int ep = edgeSet.getEndpointIndex(e.ident, epi);
+      whichEdgesForVertex[std::make_pair(epi, ep)].insert(e.ident);
     }
   }
 }
@@ -34,9 +34,9 @@ VertexToEdgeIndex::VertexToEdgeIndex(const Set &edgeSet) {
 
   for (auto e : edgeSet) {
     for (int epi=0; epi<(int)(endpointSets.size()); epi++) {
-      auto ep = edgeSet.getEndpoint(e, epi);
+      int ep = edgeSet.getEndpointIndex(e.ident, epi);
       whichEdgesForVertex[std::make_pair(
-          endpointSets[epi], ep.ident)].insert(e.ident);
+          endpointSets[epi], ep)].insert(e.ident);
     }
   }
 }
@@ -53,7 +53,8 @@ NeighborIndex::NeighborIndex(const Set &edgeSet) {
   unsigned cardinality = edgeSet.getCardinality();
 
   const Set* vSet = edgeSet.getEndpointSet(0);
-  startIndex = (int*)malloc(sizeof(int) * (vSet->getSize()+1));
+  numElements = vSet->getSize();
+  startIndex = (int*)malloc(sizeof(int) * (numElements+1));
   startIndex[0] = 0;
   for(auto v : *vSet){
     std::set<int> edgeNeighbors = VToE.getWhichEdgesForElement(v, *vSet);
@@ -61,7 +62,7 @@ NeighborIndex::NeighborIndex(const Set &edgeSet) {
     std::vector<int> nbr;
     for(int eIdx : edgeNeighbors) {
       for(unsigned jj = 0; jj<cardinality; jj++){
-        int nbrIdx = edgeSet.getEndpoint(ElementRef(eIdx), jj).ident;
+        int nbrIdx = edgeSet.getEndpointIndex(eIdx, jj);
         addNoCollision(nbrIdx, nbr);
       }
     }
@@ -65,6 +65,11 @@ class NeighborIndex {
     return neighbors.size();
   }
 
+  /// The bytes held by the index.
+  size_t getBytes() const {
+    return (numElements+1) * sizeof(int) + neighbors.capacity() * sizeof(int);
+  }
+
   // Get a pointer to the neighbors of the given element.
   const int* getNeighbors(ElementRef element) const {
     return &neighbors[startIndex[element.ident]];
@@ -83,6 +88,9 @@ class NeighborIndex {
   /// which edges v belongs to
   std::vector<int> neighbors;
 
+  /// number of elements in the first connected set
+  int numElements;
+
   void addNoCollision(int x, std::vector<int> & a);
 };
 
@@ -1,5 +1,23 @@
 #include "init.h"
 
 namespace simit {
-bool kIndexlessStencils;
+std::string kTargetCPU = "native";
+std::string kTargetFeatures = "";
+int kOptLevel = 3;
+bool kFastMath = false;
+int kVectorWidth = 0;
+std::string kMathAccuracy = "libm";
+bool kIndexlessStencils = true;
+bool kPaddedLattices = false;
+bool kMortonLattices = false;
+bool kTileLattices = false;
+std::vector<int> kLatticeTileSizes;
+int kLatticeTileCacheSize = 256*1024;
+bool kVectorizeMaps = false;
+int kMapVectorWidth = 8;
+bool kGatherEndpointFields = false;
+bool kPrefetchIndirectAccesses = false;
+int kPrefetchDistance = 0;
+bool kPerfCounters = false;
+bool kJITSymbols = false;
 }
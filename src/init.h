@@ -3,22 +3,139 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "error.h"
 #include "ir.h"
+#include "multigrid.h"
 #include "program.h"
+#include "reorder.h"
 
 namespace simit {
 
 extern const std::vector<std::string> VALID_BACKENDS;
 extern std::string kBackend;
+extern std::string kTargetCPU;
+extern std::string kTargetFeatures;
+extern int kOptLevel;
+extern bool kFastMath;
+extern int kVectorWidth;
+extern std::string kMathAccuracy;
 extern bool kIndexlessStencils;
+extern bool kPaddedLattices;
+extern bool kMortonLattices;
+extern bool kTileLattices;
+extern std::vector<int> kLatticeTileSizes;
+extern int kLatticeTileCacheSize;
+extern bool kVectorizeMaps;
+extern int kMapVectorWidth;
+extern bool kGatherEndpointFields;
+extern bool kPrefetchIndirectAccesses;
+extern int kPrefetchDistance;
+extern bool kPerfCounters;
+extern bool kJITSymbols;
 
 // Settings struct with default values
 struct Settings {
   std::string backend="cpu";
   int floatSize = 8;
-  bool indexlessStencils = false;
+
+  /// The CPU that the CPU backend generates code for, as an LLVM CPU name
+  /// (e.g. "haswell" or "skylake-avx512"). "native" is the host CPU and ""
+  /// is a generic CPU of the host architecture.
+  std::string cpu = "native";
+
+  /// Comma-separated LLVM target features that are added to, or removed from,
+  /// those of the CPU (e.g. "+avx2,+fma" or "-avx512f").
+  std::string cpuFeatures = "";
+
+  /// Optimization level of the generated code, from 0 (no optimization) to 3.
+  /// Debug builds of Simit never optimize generated code.
+  int optLevel = 3;
+
+  /// Floating point operations may be reassociated and contracted, and may
+  /// assume that no values are NaN or infinite.
+  bool fastMath = false;
+
+  /// Preferred width, in bits, of the vectors of vectorized loops (e.g. 256 to
+  /// keep AVX-512 CPUs on 256-bit vectors). If it is 0 the target decides.
+  int vectorWidth = 0;
+
+  /// Accuracy of sin, cos, exp, log, pow and atan2. "libm" calls the C math
+  /// library. "high" (within a few ulp) and "low" (about half the significand
+  /// bits) use the in-tree math library, whose functions are inlined and
+  /// vectorized with the loops that call them. CPU backend only.
+  std::string mathAccuracy = "libm";
+
+  /// Matrices assembled by maps through lattices are stored as stencils
+  /// (one value per row and stencil offset) and are indexed arithmetically,
+  /// so no endpoint or neighbor arrays are built for lattice link sets.
+  bool indexlessStencils = true;
+
+  /// Lattice stencil maps read neighboring point fields from padded copies
+  /// with halo cells, refreshed before each map, instead of wrapping the
+  /// neighbor indices around the lattice boundaries. CPU backend only.
+  bool paddedLattices = false;
+
+  /// Lattice points are addressed in Morton order, interleaving the bits of
+  /// their coordinates, which keeps the neighbors in every direction close
+  /// in memory. Lattices bound to functions must then be constructed with
+  /// Set::Morton order (and power of two dimensions).
+  bool mortonLattices = false;
+
+  /// Loop nests of maps through lattices are tiled into cache-sized blocks.
+  /// latticeTileSizes gives the tile size of each lattice dimension, innermost
+  /// first. Dimensions it leaves out or sets to 0 get a size such that the
+  /// point and link fields of a tile fill half of latticeTileCacheSize bytes.
+  bool tileLattices = false;
+  std::vector<int> latticeTileSizes;
+  int latticeTileCacheSize = 256*1024;
+
+  /// The element loops of maps over unstructured sets are run in blocks of
+  /// mapVectorWidth elements, with every statement of the kernel executed for
+  /// all elements of a block by a loop that the backend vectorizes. Kernel
+  /// temporaries are widened to one value per element, and the compound adds
+  /// into the map results stay serial. CPU backend only.
+  bool vectorizeMaps = false;
+  int mapVectorWidth = 8;
+
+  /// The vertex fields that maps over edge sets read through the endpoints
+  /// are copied into edge-contiguous buffers, that the maps read with unit
+  /// stride. The buffers are shared by the maps over an edge set and only
+  /// refilled after the fields are written. CPU backend only.
+  bool gatherEndpointFields = false;
+
+  /// Loops over edge sets and over the neighbors of sparse matrix rows
+  /// prefetch the data they access through the endpoints or the column
+  /// indices prefetchDistance iterations ahead. If the distance is 0 it is
+  /// chosen per loop from the amount of work in the loop body. CPU backend
+  /// only.
+  bool prefetchIndirectAccesses = false;
+  int prefetchDistance = 0;
+
+  /// The timed sites of functions compiled with timers also count hardware
+  /// events (cycles, instructions, cache, TLB and branch misses) with
+  /// perf_event_open, which costs two system calls per run of a site. Events
+  /// that the kernel does not let the process count are reported as -1.
+  /// CPU backend on Linux only.
+  bool perfCounters = false;
+
+  /// Generated functions are registered with gdb's JIT interface and listed
+  /// in /tmp/perf-<pid>.map, so that debuggers and perf resolve addresses in
+  /// generated code to the functions. CPU backend only.
+  bool jitSymbols = false;
+
+  /// Sets bound to functions are reordered in place according to this policy,
+  /// to improve locality. ElementRefs keep referring to the same elements,
+  /// but raw field data and endpoint arrays are in the new order.
+  ReorderPolicy reorder = ReorderPolicy::None;
+
+  /// The number of partitions of the Partition reordering policy. If it is 0
+  /// there is one partition per hardware thread.
+  int partitions = 0;
+
+  /// Smoother, cycle and tolerance parameters of the mgsolve intrinsic.
+  MultigridOptions multigrid;
 };
 
 inline void init(const Settings& settings) {
@@ -34,8 +151,75 @@ inline void init(const Settings& settings) {
       << "Invalid float bytes: " << settings.floatSize;
   ir::ScalarType::floatBytes = settings.floatSize;
 
+  // code generation
+  uassert(settings.optLevel >= 0 && settings.optLevel <= 3)
+      << "Invalid optimization level: " << settings.optLevel;
+  uassert(settings.vectorWidth >= 0 && settings.vectorWidth % 64 == 0)
+      << "Invalid vector width: " << settings.vectorWidth;
+  kTargetCPU = settings.cpu;
+  kTargetFeatures = settings.cpuFeatures;
+  kOptLevel = settings.optLevel;
+  kFastMath = settings.fastMath;
+  kVectorWidth = settings.vectorWidth;
+  uassert(settings.mathAccuracy == "libm" || settings.mathAccuracy == "high" ||
+          settings.mathAccuracy == "low")
+      << "Invalid math accuracy: " << settings.mathAccuracy;
+  kMathAccuracy = settings.mathAccuracy;
+
   // indexlessStencils
   kIndexlessStencils = settings.indexlessStencils;
+
+  // paddedLattices
+  kPaddedLattices = settings.paddedLattices;
+
+  // mortonLattices
+  kMortonLattices = settings.mortonLattices;
+
+  // lattice tiling
+  for (int tileSize : settings.latticeTileSizes) {
+    uassert(tileSize >= 0) << "Invalid lattice tile size: " << tileSize;
+  }
+  uassert(settings.latticeTileCacheSize > 0)
+      << "Invalid lattice tile cache size: " << settings.latticeTileCacheSize;
+  kTileLattices = settings.tileLattices;
+  kLatticeTileSizes = settings.latticeTileSizes;
+  kLatticeTileCacheSize = settings.latticeTileCacheSize;
+
+  // map vectorization
+  uassert(settings.mapVectorWidth > 0)
+      << "Invalid map vector width: " << settings.mapVectorWidth;
+  kVectorizeMaps = settings.vectorizeMaps;
+  kMapVectorWidth = settings.mapVectorWidth;
+  kGatherEndpointFields = settings.gatherEndpointFields;
+
+  // prefetching
+  uassert(settings.prefetchDistance >= 0)
+      << "Invalid prefetch distance: " << settings.prefetchDistance;
+  kPrefetchIndirectAccesses = settings.prefetchIndirectAccesses;
+  kPrefetchDistance = settings.prefetchDistance;
+
+  // profiling
+  kPerfCounters = settings.perfCounters;
+  kJITSymbols = settings.jitSymbols;
+
+  // reorder
+  kReorderPolicy = settings.reorder;
+  uassert(settings.partitions >= 0)
+      << "Invalid number of partitions: " << settings.partitions;
+  kPartitions = settings.partitions;
+
+  // multigrid
+  const MultigridOptions& multigrid = settings.multigrid;
+  uassert(multigrid.jacobiWeight > 0.0 && multigrid.jacobiWeight <= 1.0)
+      << "Invalid multigrid Jacobi weight: " << multigrid.jacobiWeight;
+  uassert(multigrid.preSmoothingSteps >= 0 &&
+          multigrid.postSmoothingSteps >= 0)
+      << "Invalid number of multigrid smoothing steps";
+  uassert(multigrid.maxCycles > 0)
+      << "Invalid number of multigrid cycles: " << multigrid.maxCycles;
+  uassert(multigrid.coarsestSize > 0)
+      << "Invalid multigrid coarsest size: " << multigrid.coarsestSize;
+  kMultigridOptions = multigrid;
 }
 
 inline void init(std::string backend="cpu", int floatSize=8) {
@@ -1,7 +1,10 @@
 #include "inline.h"
 
+#include <cmath>
+#include <cstdlib>
 #include <vector>
 #include <map>
+#include <set>
 
 #include "init.h"
 #include "temps.h"
@@ -18,19 +21,23 @@ namespace simit {
 namespace ir {
 
 Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
-                       MapFunctionRewriter &rewriter, Storage* storage);
+                       MapFunctionRewriter &rewriter, Storage* storage,
+                       std::map<std::string,LatticeGhostBuffer> ghostBuffers);
 
 Stmt MapFunctionRewriter::inlineMapFunc(const Map *map, Var targetLoopVar,
                                         Storage *storage,
                                         Var endpoints, Var locs,
                                         std::map<vector<int>, Expr> clocs,
-                                        vector<Var> latticeIndexVars) {
+                                        vector<Var> latticeIndexVars,
+                                        std::map<std::string,LatticeGhostBuffer>
+                                            ghostBuffers) {
   this->endpoints = endpoints;
   this->locs = locs;
   this->clocs = clocs;
   this->reduction = map->reduction;
   this->targetLoopVar = targetLoopVar;
   this->latticeIndexVars = latticeIndexVars;
+  this->ghostBuffers = ghostBuffers;
   this->storage = storage;
 
   Func kernel = map->function;
@@ -137,6 +144,19 @@ void MapFunctionRewriter::visit(const FieldRead *op) {
       Expr index = IRRewriter::rewrite(op->elementOrSet);
       expr = TensorRead::make(setFieldRead, {index});
     }
+    // Lattice offset points, read from the padded copy if there is one
+    else if (to<VarExpr>(sr->set)->var == throughPoints &&
+             ghostBuffers.find(op->fieldName) != ghostBuffers.end()) {
+      const LatticeGhostBuffer& ghosts = ghostBuffers.at(op->fieldName);
+      vector<int> offsets = getOffsets(sr->indices);
+      iassert(offsets.size() == latticeIndexVars.size());
+      vector<Expr> indices;
+      for (size_t i = 0; i < offsets.size(); ++i) {
+        indices.push_back(latticeIndexVars[i] + offsets[i]);
+      }
+      Expr index = getPaddedLatticeCoord(indices, ghosts.halo, throughSet);
+      expr = Load::make(ghosts.buffer, index);
+    }
     // Lattice offset points
     else if (to<VarExpr>(sr->set)->var == throughPoints) {
       Expr setFieldRead = FieldRead::make(
@@ -263,7 +283,8 @@ StencilContent* buildStencilLocs(Func kernel, Var stencilVar, Var loopVar,
 /// Inlines the mapped function with respect to the given loop variable over
 /// the target set, using the given rewriter.
 Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
-                       MapFunctionRewriter &rewriter, Storage* storage) {
+                       MapFunctionRewriter &rewriter, Storage* storage,
+                       std::map<std::string,LatticeGhostBuffer> ghostBuffers) {
   // Compute locations of the mapped edge
   bool returnsMatrix = false;
   for (auto& result : map->function.getResults()) {
@@ -376,13 +397,233 @@ Stmt inlineMapFunction(const Map *map, Var lv, vector<Var> ivs,
       storage->getStorage(mapVar).getTensorIndex().setStencilLayout(s);
     }
     iassert(ivs.size() > 0);
-    return rewriter.inlineMapFunc(map, lv, storage, Var(), Var(), clocs, ivs);
+    return rewriter.inlineMapFunc(map, lv, storage, Var(), Var(), clocs, ivs,
+                                  ghostBuffers);
+  }
+  // Map through a lattice, e.g. a stencil computing point fields
+  else if (map->through.defined()) {
+    iassert(ivs.size() > 0);
+    return rewriter.inlineMapFunc(map, lv, storage, Var(), Var(), {}, ivs,
+                                  ghostBuffers);
   }
   else {
     return rewriter.inlineMapFunc(map, lv, storage);
   }
 }
 
+/// Creates a ghost buffer for each lattice point field the kernel reads at a
+/// neighbor offset, with a halo as wide as the largest offset. Fields the
+/// kernel writes keep being read in place, since a copy taken before the map
+/// would not see the writes, and so do blocked fields.
+static std::map<std::string,LatticeGhostBuffer>
+createGhostBuffers(const Map *map, Func kernel) {
+  std::map<std::string,LatticeGhostBuffer> ghostBuffers;
+  Var points;
+  for (const Var& arg : kernel.getArguments()) {
+    if (arg.getType().isLatticeLinkSet()) {
+      Expr pointSet = arg.getType().toLatticeLinkSet()->latticePointSet.getSet();
+      if (isa<VarExpr>(pointSet)) {
+        points = to<VarExpr>(pointSet)->var;
+      }
+      break;
+    }
+  }
+  if (!points.defined()) {
+    return ghostBuffers;
+  }
+
+  std::map<std::string,int> halos;
+  std::set<std::string> writtenFields;
+  match(kernel,
+    function<void(const FieldRead*,Matcher*)>(
+        [&](const FieldRead* op, Matcher* ctx) {
+      if (isa<SetRead>(op->elementOrSet)) {
+        const SetRead *sr = to<SetRead>(op->elementOrSet);
+        if (isa<VarExpr>(sr->set) && to<VarExpr>(sr->set)->var == points) {
+          int& halo = halos[op->fieldName];
+          for (int offset : getOffsets(sr->indices)) {
+            halo = std::max(halo, std::abs(offset));
+          }
+        }
+      }
+      ctx->match(op->elementOrSet);
+    }),
+    function<void(const FieldWrite*,Matcher*)>(
+        [&](const FieldWrite* op, Matcher* ctx) {
+      writtenFields.insert(op->fieldName);
+      ctx->match(op->elementOrSet);
+      ctx->match(op->value);
+    })
+  );
+
+  Expr pointSet =
+      map->through.type().toLatticeLinkSet()->latticePointSet.getSet();
+  for (auto& halo : halos) {
+    const std::string& fieldName = halo.first;
+    if (halo.second == 0 || writtenFields.count(fieldName) > 0) {
+      continue;
+    }
+    Type fieldType = FieldRead::make(pointSet, fieldName).type();
+    if (!isScalar(fieldType.toTensor()->getBlockType())) {
+      continue;
+    }
+    Var buffer(INTERNAL_PREFIX(fieldName + "_ghosts"),
+               ArrayType::make(fieldType.toTensor()->getComponentType()));
+    ghostBuffers[fieldName] = {buffer, halo.second};
+  }
+  return ghostBuffers;
+}
+
+/// Allocates the ghost buffer of a lattice point field and copies the field
+/// into it, filling the halo cells with the periodic neighbors of the boundary
+/// points. Rows along the innermost dimension are copied with unit stride (in
+/// lexicographically ordered lattices), and only the outer row coordinates
+/// and the halo cells wrap around.
+static Stmt fillGhostBuffer(const LatticeGhostBuffer& ghosts, Expr field,
+                            Expr latticeSet) {
+  const int dims = latticeSet.type().toLatticeLinkSet()->dimensions;
+  const int halo = ghosts.halo;
+  Expr buffer = ghosts.buffer;
+
+  vector<Expr> sizes;
+  vector<Expr> paddedSizes;
+  for (int i = 0; i < dims; ++i) {
+    sizes.push_back(IndexRead::make(latticeSet, IndexRead::LatticeDim, i));
+    paddedSizes.push_back(sizes[i] + 2*halo);
+  }
+  Expr length = paddedSizes[0];
+  for (int i = 1; i < dims; ++i) {
+    length = length * paddedSizes[i];
+  }
+  ScalarType componentType = ghosts.buffer.getType().toArray()->elementType;
+  Stmt alloc = CallStmt::make({ghosts.buffer}, intrinsics::malloc(),
+                              {length * (int)componentType.bytes()});
+
+  // Start of the padded row, and the outer coordinates of the lattice row it
+  // copies
+  vector<Var> rowVars;
+  Expr dstRow = 0;
+  vector<Expr> srcRow(dims);
+  for (int i = dims-1; i > 0; --i) {
+    Var q(INTERNAL_PREFIX("ghost_d") + to_string(i), Int);
+    rowVars.push_back(q);
+    srcRow[i] = ((q - halo) % sizes[i] + sizes[i]) % sizes[i];
+    dstRow = (i == dims-1) ? Expr(q) : dstRow * paddedSizes[i] + q;
+  }
+  if (dims > 1) {
+    dstRow = dstRow * paddedSizes[0];
+  }
+  auto src = [&](Expr x) {
+    srcRow[0] = x;
+    return TensorRead::make(field, {getLatticeCoord(srcRow, latticeSet)});
+  };
+
+  Var i(INTERNAL_PREFIX("ghost_d0"), Int);
+  Expr n = sizes[0];
+  Stmt interior = ForRange::make(i, 0, n,
+      Store::make(buffer, dstRow + halo + i, src(i)));
+  Stmt lowerHalo = Store::make(buffer, dstRow + i,
+                               src(((i - halo) % n + n) % n));
+  Stmt upperHalo = Store::make(buffer, dstRow + halo + n + i, src(i % n));
+  Stmt copy = Block::make(interior,
+                          ForRange::make(i, 0, halo,
+                                         Block::make(lowerHalo, upperHalo)));
+  for (int k = (int)rowVars.size()-1; k >= 0; --k) {
+    copy = ForRange::make(rowVars[k], 0, paddedSizes[dims-1-k], copy);
+  }
+
+  return Block::make({VarDecl::make(ghosts.buffer), alloc, copy});
+}
+
+// Bytes of the fields of an element
+static int elementBytes(Type elementType) {
+  int bytes = 0;
+  for (const Field& field : elementType.toElement()->fields) {
+    if (field.type.isTensor()) {
+      const TensorType *type = field.type.toTensor();
+      bytes += type->size() * type->getComponentType().bytes();
+    }
+  }
+  return bytes;
+}
+
+/// Tile sizes of the loop nest of a map through a lattice, innermost dimension
+/// first. Sizes set in the settings are used as given. The others are equal
+/// and chosen so that the point and link fields of a tile fill half of the
+/// tile cache size, rounded down to a multiple of 8 points.
+static vector<int> getLatticeTileSizes(const Map *map) {
+  const LatticeLinkSetType *linkSetType =
+      map->through.type().toLatticeLinkSet();
+  const int dims = linkSetType->dimensions;
+  Expr pointSet = linkSetType->latticePointSet.getSet();
+
+  vector<int> tileSizes(dims, 0);
+  int autoDims = 0;
+  int64_t fixedPoints = 1;
+  for (int i = 0; i < dims; ++i) {
+    if (i < (int)kLatticeTileSizes.size() && kLatticeTileSizes[i] > 0) {
+      tileSizes[i] = kLatticeTileSizes[i];
+      fixedPoints *= tileSizes[i];
+    }
+    else {
+      autoDims++;
+    }
+  }
+  if (autoDims == 0) {
+    return tileSizes;
+  }
+
+  const int pointBytes = elementBytes(pointSet.type().toSet()->elementType)
+                       + dims * elementBytes(linkSetType->elementType);
+  const int64_t tilePoints =
+      kLatticeTileCacheSize / 2 / std::max(pointBytes, 1) / fixedPoints;
+  int autoSize = (int)std::pow((double)std::max(tilePoints, (int64_t)1),
+                               1.0 / autoDims);
+  autoSize = std::max(8, autoSize - autoSize % 8);
+  for (int i = 0; i < dims; ++i) {
+    if (tileSizes[i] == 0) {
+      tileSizes[i] = autoSize;
+    }
+  }
+  return tileSizes;
+}
+
+/// Builds the tiled loop nest of a map through a lattice. The outer loops
+/// visit the tiles and the inner loops the lattice points of a tile, and the
+/// target loop variable is set to the linearized lattice coordinate of each
+/// point.
+static Stmt makeTiledLatticeLoops(const Map *map, Var loopVar,
+                                  const vector<Var>& latticeIndexVars,
+                                  Stmt body, vector<Stmt>& initializers) {
+  const int dims = latticeIndexVars.size();
+  vector<int> tileSizes = getLatticeTileSizes(map);
+  iassert((int)tileSizes.size() == dims);
+
+  vector<Expr> indices(latticeIndexVars.begin(), latticeIndexVars.end());
+  Stmt loop = Block::make(
+      AssignStmt::make(loopVar, getLatticeCoord(indices, map->through)), body);
+
+  vector<Var> tileVars;
+  vector<Var> tileEnds;
+  for (int i = 0; i < dims; ++i) {
+    const string name = latticeIndexVars[i].getName();
+    tileVars.push_back(Var(name + "_tile", Int));
+    tileEnds.push_back(Var(name + "_end", Int));
+    initializers.push_back(VarDecl::make(tileEnds[i]));
+    loop = ForRange::make(latticeIndexVars[i], tileVars[i]*tileSizes[i],
+                          tileEnds[i], loop, i == 0);
+  }
+  for (int i = 0; i < dims; ++i) {
+    Expr size = IndexRead::make(map->through, IndexRead::LatticeDim, i);
+    Expr numTiles = (size + (tileSizes[i]-1)) / tileSizes[i];
+    Stmt computeEnd = min(tileEnds[i], {tileVars[i]*tileSizes[i]
+                                        + tileSizes[i], size});
+    loop = ForRange::make(tileVars[i], 0, numTiles,
+                          Block::make(computeEnd, loop));
+  }
+  return loop;
+}
+
 Stmt inlineMap(const Map *map, MapFunctionRewriter &rewriter,
                Storage* storage) {
   Func kernel = map->function;
@@ -403,8 +644,14 @@ Stmt inlineMap(const Map *map, MapFunctionRewriter &rewriter,
     latticeIndexVars.emplace_back(targetVar.getName()+"_d"+to_string(i), Int);
   }
 
+  // Stencils read neighboring point fields from padded ghost buffers
+  std::map<std::string,LatticeGhostBuffer> ghostBuffers;
+  if (map->through.defined() && kPaddedLattices && kBackend == "cpu") {
+    ghostBuffers = createGhostBuffers(map, kernel);
+  }
+
   Stmt inlinedMapFunc = inlineMapFunction(map, loopVar, latticeIndexVars,
-                                          rewriter, storage);
+                                          rewriter, storage, ghostBuffers);
 
   Stmt inlinedMap;
   auto initializers = vector<Stmt>();
@@ -418,17 +665,36 @@ Stmt inlineMap(const Map *map, MapFunctionRewriter &rewriter,
   if (!map->through.defined()) {
     iassert(latticeIndexVars.size() == 0);
     ForDomain domain(map->target);
-    loop = For::make(loopVar, domain, inlinedMapFunc);
+    loop = For::make(loopVar, domain, inlinedMapFunc, true);
   }
   else {
     iassert(map->through.type().isLatticeLinkSet());
-    initializers.push_back(AssignStmt::make(loopVar, 0));
-    int dims = map->through.type().toLatticeLinkSet()->dimensions;
-    loop = Block::make(inlinedMapFunc, AssignStmt::make(
-        loopVar, 1, CompoundOperator::Add));
-    for (int i = 0; i < dims; ++i) {
-      loop = ForRange::make(latticeIndexVars[i], 0, IndexRead::make(
-          map->through, IndexRead::LatticeDim, i), loop);
+    if (kTileLattices) {
+      loop = makeTiledLatticeLoops(map, loopVar, latticeIndexVars,
+                                   inlinedMapFunc, initializers);
+    }
+    else {
+      // The target index is computed from the lattice indices rather than
+      // incremented, so that the innermost loop carries no induction besides
+      // its own index and can be vectorized.
+      vector<Expr> indices(latticeIndexVars.begin(), latticeIndexVars.end());
+      loop = Block::make(AssignStmt::make(
+          loopVar, getLatticeCoord(indices, map->through)), inlinedMapFunc);
+      for (size_t i = 0; i < latticeIndexVars.size(); ++i) {
+        loop = ForRange::make(latticeIndexVars[i], 0, IndexRead::make(
+            map->through, IndexRead::LatticeDim, i), loop, i == 0);
+      }
+    }
+
+    // Refresh the ghost buffers before the map and free them after it
+    Expr pointSet =
+        map->through.type().toLatticeLinkSet()->latticePointSet.getSet();
+    for (auto& ghosts : ghostBuffers) {
+      Expr field = FieldRead::make(pointSet, ghosts.first);
+      initializers.push_back(fillGhostBuffer(ghosts.second, field,
+                                             map->through));
+      loop = Block::make(loop, CallStmt::make({}, intrinsics::free(),
+                                              {ghosts.second.buffer}));
     }
   }
   
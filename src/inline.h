@@ -12,6 +12,13 @@ using namespace std;
 namespace simit {
 namespace ir {
 
+/// A padded copy of a lattice point field, whose halo cells hold the periodic
+/// neighbors of the boundary points so that stencil reads need no wraparound.
+struct LatticeGhostBuffer {
+  Var buffer;
+  int halo;
+};
+
 /// Rewrites a mapped function body to compute on sets w.r.t. a loop variable,
 /// instead of arguments.
 class MapFunctionRewriter : protected IRRewriter {
@@ -22,7 +29,8 @@ public:
                      Storage *storage,
                      Var endpoints=Var(), Var locs=Var(),
                      std::map<vector<int>, Expr> clocs={},
-                     vector<Var> latticeIndexVars={});
+                     vector<Var> latticeIndexVars={},
+                     std::map<std::string,LatticeGhostBuffer> ghostBuffers={});
 
 protected:
   std::map<Var,Var> resultToMapVar;
@@ -30,6 +38,7 @@ protected:
 
   Expr targetLoopVar;
   vector<Var> latticeIndexVars;
+  std::map<std::string,LatticeGhostBuffer> ghostBuffers;
 
   // Arguments to map expr
   Expr targetSet;
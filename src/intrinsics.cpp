@@ -305,6 +305,20 @@ const Func& solve() {
   return solveVar;
 }
 
+static Func mgsolveVar;
+void mgsolveInit() {
+  mgsolveVar = Func("mgsolve",
+                    {Var("A", Type()), Var("b", Type())},
+                    {Var("x", Type())},
+                    Func::External);
+}
+const Func& mgsolve() {
+  if (!mgsolveVar.defined()) {
+    mgsolveInit();
+  }
+  return mgsolveVar;
+}
+
 static Func cholVar;
 void cholInit() {
   cholVar = Func("chol",
@@ -487,6 +501,43 @@ const Func& loc() {
   return locVar;
 }
 
+static Func prefetchVar;
+void prefetchInit() {
+  prefetchVar = Func("__prefetch",
+                     {Var("buffer", String), Var("index", Int)},
+                     {},
+                     Func::Intrinsic);
+}
+const Func& prefetch() {
+  if (!prefetchVar.defined()) {
+    prefetchInit();
+  }
+  return prefetchVar;
+}
+
+static Func timerStartVar;
+void timerStartInit() {
+  timerStartVar = Func("__timerStart", {Var("site", Int)}, {}, Func::Intrinsic);
+}
+const Func& timerStart() {
+  if (!timerStartVar.defined()) {
+    timerStartInit();
+  }
+  return timerStartVar;
+}
+
+static Func timerStopVar;
+void timerStopInit() {
+  timerStopVar = Func("__timerStop",
+                      {Var("site", Int), Var("flops", Int), Var("bytes", Int)},
+                      {}, Func::Intrinsic);
+}
+const Func& timerStop() {
+  if (!timerStopVar.defined()) {
+    timerStopInit();
+  }
+  return timerStopVar;
+}
 
 const std::map<std::string,Func> &byNames() {
   static std::map<std::string,Func> byNameMap;
@@ -512,6 +563,7 @@ const std::map<std::string,Func> &byNames() {
     detInit();
     invInit();
     solveInit();
+    mgsolveInit();
     cholInit();
     cholfreeInit();
     lltsolveInit();
@@ -525,6 +577,9 @@ const std::map<std::string,Func> &byNames() {
     mallocInit();
     freeInit();
     locInit();
+    prefetchInit();
+    timerStartInit();
+    timerStopInit();
     byNameMap.insert({{"mod",modVar},
                       {"sin",sinVar},
                       {"cos",cosVar},
@@ -546,6 +601,7 @@ const std::map<std::string,Func> &byNames() {
                       {"det",detVar},
                       {"inv",invVar},
                       {"__solve",solveVar},
+                      {"mgsolve", mgsolveVar},
                       {"chol", cholVar},
                       {"cholfree", cholfreeVar},
                       {"lltsolve", lltsolveVar},
@@ -558,7 +614,10 @@ const std::map<std::string,Func> &byNames() {
                       {"storeTime",storeTimeVar},
                       {"malloc", mallocVar},
                       {"free", freeVar},
-                      {"__loc", locVar}});
+                      {"__loc", locVar},
+                      {"__prefetch", prefetchVar},
+                      {"__timerStart", timerStartVar},
+                      {"__timerStop", timerStopVar}});
   }
   return byNameMap;
 }
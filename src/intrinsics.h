@@ -42,6 +42,7 @@ const Func& inv();
 
 // Solvers
 const Func& solve();
+const Func& mgsolve();
 const Func& chol();
 const Func& cholfree();
 const Func& lltsolve();
@@ -61,6 +62,9 @@ const Func& storeTime();
 const Func& malloc();
 const Func& free();
 const Func& loc();
+const Func& prefetch();
+const Func& timerStart();
+const Func& timerStop();
 
 const std::map<std::string,Func> &byNames();
 
@@ -497,10 +497,12 @@ Expr IndexRead::make(Expr edgeSet, Kind kind) {
 
 Expr IndexRead::make(Expr edgeSet, Kind kind, int index) {
   iassert(edgeSet.type().isLatticeLinkSet());
-  iassert(kind == LatticeDim);
+  iassert(kind == LatticeDim || kind == LatticeMortonCodes);
 
   IndexRead *node = new IndexRead;
-  node->type = TensorType::make(ScalarType(ScalarType::Int));
+  node->type = (kind == LatticeDim)
+               ? TensorType::make(ScalarType(ScalarType::Int))
+               : ArrayType::make(ScalarType(ScalarType::Int));
 
   node->edgeSet = edgeSet;
   node->kind = kind;
@@ -725,7 +727,7 @@ Stmt Store::make(Expr buf, Expr index, Expr value, CompoundOperator cop) {
           TensorType::make(buf.type().toTensor()->getComponentType())==value.type())
       << "Stored value type " << util::quote(value.type())
       << " does not match the component type of tensor "
-      << util::quote(buf.type().toTensor()->getBlockType()) ;
+      << util::quote(buf.type());
   Store *node = new Store;
   node->buffer = buf;
   node->index = index;
@@ -781,7 +783,8 @@ Stmt IfThenElse::make(Expr condition, Stmt thenBody, Stmt elseBody) {
 }
 
 // struct ForRange
-Stmt ForRange::make(Var var, Expr start, Expr end, Stmt body) {
+Stmt ForRange::make(Var var, Expr start, Expr end, Stmt body,
+                    bool vectorize) {
   iassert(var.defined());
   iassert(body.defined());
   iassert(start.defined());
@@ -792,15 +795,17 @@ Stmt ForRange::make(Var var, Expr start, Expr end, Stmt body) {
   node->start = start;
   node->end = end;
   node->body = Scope::make(body);
+  node->vectorize = vectorize;
   return Scope::make(node);  // Put loop variable in a scope
 }
 
 // struct For
-Stmt For::make(Var var, ForDomain domain, Stmt body) {
+Stmt For::make(Var var, ForDomain domain, Stmt body, bool vectorize) {
   For *node = new For;
   node->var = var;
   node->domain = domain;
   node->body = Scope::make(body);
+  node->vectorize = vectorize;
   return Scope::make(node);  // Put loop variable in a scope
 }
 
@@ -206,12 +206,15 @@ struct Length : public ExprNode {
 /// is the endpoints of the edges in the set.
 /// TODO DEPRECATED: This node has been deprecated with the old lowering pass
 struct IndexRead : public ExprNode {
-  enum Kind { Endpoints=0, NeighborsStart=1, Neighbors=2, LatticeDim=3 };
+  enum Kind { Endpoints=0, NeighborsStart=1, Neighbors=2, LatticeDim=3,
+              LatticeMortonCodes=4 };
   Expr edgeSet;
   Kind kind;
   unsigned int index;
   static Expr make(Expr edgeSet, Kind kind);
-  // Read the index'th lattice dimensions. kind must be LatticeDim.
+  // Read the index'th lattice dimensions (LatticeDim), or the array of the
+  // Morton codes of the coordinates of the index'th dimension
+  // (LatticeMortonCodes).
   static Expr make(Expr edgeSet, Kind kind, int index);
   void accept(IRVisitorStrict *v) const {v->visit((const IndexRead*)this);}
 };
@@ -376,7 +379,13 @@ struct ForRange : public StmtNode {
   Expr start;
   Expr end;
   Stmt body;
-  static Stmt make(Var var, Expr start, Expr end, Stmt body);
+
+  /// Hint to the backend that the loop should be vectorized, e.g. because it
+  /// is the innermost (unit stride) loop of a lattice sweep.
+  bool vectorize;
+
+  static Stmt make(Var var, Expr start, Expr end, Stmt body,
+                   bool vectorize=false);
   void accept(IRVisitorStrict *v) const {v->visit((const ForRange*)this);}
 };
 
@@ -419,7 +428,13 @@ struct For : public StmtNode {
   Var var;
   ForDomain domain;
   Stmt body;
-  static Stmt make(Var var, ForDomain domain, Stmt body);
+
+  /// Marks the element loop of a map, whose iterations only interact through
+  /// compound assignments to the map results, so that it may be vectorized
+  /// across elements.
+  bool vectorize;
+
+  static Stmt make(Var var, ForDomain domain, Stmt body, bool vectorize=false);
   void accept(IRVisitorStrict *v) const {v->visit((const For*)this);}
 };
 
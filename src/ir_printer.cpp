@@ -204,6 +204,9 @@ void IRPrinter::visit(const IndexRead *op) {
     case IndexRead::LatticeDim:
       os << "latticedim[" << op->index << "]";
       break;
+    case IndexRead::LatticeMortonCodes:
+      os << "mortoncodes[" << op->index << "]";
+      break;
     default:
       not_supported_yet;
       break;
@@ -283,4 +283,55 @@ std::vector<Func> getCallTree(Func func) {
   return GetCallTree().get(func);
 }
 
+size_t countNodes(Func func) {
+  class CountNodesVisitor : public IRVisitorCallGraph {
+  public:
+    size_t count(Func func) {
+      nodes = 0;
+      func.accept(this);
+      return nodes;
+    }
+
+  private:
+    size_t nodes;
+
+    using IRVisitorCallGraph::visit;
+
+    #define COUNT(Type, Visitor) \
+    void visit(const Type* op) { ++nodes; Visitor::visit(op); }
+    COUNT(Literal,        IRVisitor)
+    COUNT(VarExpr,        IRVisitor)
+    COUNT(Load,           IRVisitor)
+    COUNT(FieldRead,      IRVisitor)
+    COUNT(Length,         IRVisitor)
+    COUNT(IndexRead,      IRVisitor)
+    COUNT(UnaryExpr,      IRVisitor)
+    COUNT(BinaryExpr,     IRVisitor)
+    COUNT(VarDecl,        IRVisitor)
+    COUNT(AssignStmt,     IRVisitor)
+    COUNT(CallStmt,       IRVisitorCallGraph)
+    COUNT(Store,          IRVisitor)
+    COUNT(FieldWrite,     IRVisitor)
+    COUNT(Scope,          IRVisitor)
+    COUNT(IfThenElse,     IRVisitor)
+    COUNT(ForRange,       IRVisitor)
+    COUNT(For,            IRVisitor)
+    COUNT(While,          IRVisitor)
+    COUNT(Kernel,         IRVisitor)
+    COUNT(Block,          IRVisitor)
+    COUNT(Print,          IRVisitor)
+    COUNT(Comment,        IRVisitor)
+    COUNT(Pass,           IRVisitor)
+    COUNT(TupleRead,      IRVisitor)
+    COUNT(SetRead,        IRVisitor)
+    COUNT(TensorRead,     IRVisitor)
+    COUNT(TensorWrite,    IRVisitor)
+    COUNT(IndexedTensor,  IRVisitor)
+    COUNT(IndexExpr,      IRVisitor)
+    COUNT(Map,            IRVisitorCallGraph)
+    #undef COUNT
+  };
+  return CountNodesVisitor().count(func);
+}
+
 }}
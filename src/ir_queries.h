@@ -32,6 +32,10 @@ bool isBlocked(Stmt stmt);
 /// (transitively) called from `func`.
 std::vector<Func> getCallTree(Func func);
 
+/// Returns the number of expression and statement nodes in `func` and the
+/// functions and kernels it calls.
+size_t countNodes(Func func);
+
 }}
 
 #endif
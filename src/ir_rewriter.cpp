@@ -99,7 +99,8 @@ void IRRewriter::visit(const IndexRead *op) {
   if (edgeSet == op->edgeSet) {
     expr = op;
   }
-  else if (op->kind != IndexRead::LatticeDim) {
+  else if (op->kind != IndexRead::LatticeDim &&
+           op->kind != IndexRead::LatticeMortonCodes) {
     expr = IndexRead::make(edgeSet, op->kind);
   }
   else {
@@ -290,7 +291,7 @@ void IRRewriter::visit(const ForRange *op) {
     stmt = op;
   }
   else {
-    stmt = ForRange::make(op->var, start, end, body);
+    stmt = ForRange::make(op->var, start, end, body, op->vectorize);
     if (spilledBounds.defined()) {
       stmt = Block::make(spilledBounds, stmt);
     }
@@ -303,7 +304,7 @@ void IRRewriter::visit(const For *op) {
     stmt = op;
   }
   else {
-    stmt = For::make(op->var, op->domain, body);
+    stmt = For::make(op->var, op->domain, body, op->vectorize);
   }
 }
 
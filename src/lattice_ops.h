@@ -1,6 +1,7 @@
 #ifndef SIMIT_LATTICE_OPS
 #define SIMIT_LATTICE_OPS
 
+#include "init.h"
 #include "ir.h"
 #include "types.h"
 
@@ -9,7 +10,8 @@ namespace ir {
 
 /// Compute the index in the linearized lattice set of the given set of indices
 /// `indices' should run from innermost (fastest running) to outermost
-/// (slowest running).
+/// (slowest running). With Morton ordered lattices the index is the sum of
+/// the Morton codes of the indices.
 inline Expr getLatticeCoord(vector<Expr> indices, Expr latticeSet) {
   iassert(latticeSet.type().isLatticeLinkSet());
 
@@ -18,6 +20,18 @@ inline Expr getLatticeCoord(vector<Expr> indices, Expr latticeSet) {
 
   iassert(indices.size() == ndims);
 
+  if (kMortonLattices) {
+    Expr totalInd = Load::make(
+        IndexRead::make(latticeSet, IndexRead::LatticeMortonCodes, 0),
+        indices[0]);
+    for (size_t i = 1; i < ndims; ++i) {
+      totalInd = totalInd + Load::make(
+          IndexRead::make(latticeSet, IndexRead::LatticeMortonCodes, i),
+          indices[i]);
+    }
+    return totalInd;
+  }
+
   // index = (... ((indices[d-1]) * sizes[d-2] + indices[d-2]) * sizes[d-3] ...)
   Expr totalInd = indices.back();
   for (int i = ndims-2; i >= 0; --i) {
@@ -27,6 +41,28 @@ inline Expr getLatticeCoord(vector<Expr> indices, Expr latticeSet) {
   return totalInd;
 }
 
+/// Compute the index in a linearized copy of the lattice that is padded with
+/// `halo' cells on both sides of every dimension. `indices' are unpadded
+/// lattice indices, from innermost to outermost, that may lie up to `halo'
+/// cells outside the lattice.
+inline Expr getPaddedLatticeCoord(vector<Expr> indices, int halo,
+                                  Expr latticeSet) {
+  iassert(latticeSet.type().isLatticeLinkSet());
+
+  const LatticeLinkSetType *setType = latticeSet.type().toLatticeLinkSet();
+  int ndims = setType->dimensions;
+
+  iassert(static_cast<int>(indices.size()) == ndims);
+
+  Expr totalInd = indices.back() + halo;
+  for (int i = ndims-2; i >= 0; --i) {
+    Expr dimSize = IndexRead::make(latticeSet, IndexRead::LatticeDim, i)
+                   + 2*halo;
+    totalInd = totalInd * dimSize + (indices[i] + halo);
+  }
+  return totalInd;
+}
+
 /// Compute the index in the linearized lattice set of the given set of indices
 /// `indices' should run from innermost (fastest running) to outermost
 /// (slowest running), and include a directional index (mu) innermost.
@@ -39,24 +75,16 @@ inline Expr getLatticeLinkCoord(vector<Expr> indices, Expr latticeSet) {
   // ndims + 1 indices define a lattice link
   iassert(static_cast<int>(indices.size()) == ndims + 1);
 
-  // index = (... ((indices[d]) * sizes[d-1] + indices[d-1]) * sizes[d-2] ...)
-  Expr totalInd = indices.back();
-  for (int i = ndims-1; i >= 0; --i) {
-    Expr dimSize;
-    if (i-1 >= 0) {
-      dimSize = IndexRead::make(latticeSet, IndexRead::LatticeDim, i-1);
-    }
-    else {
-      dimSize = Expr(ndims);
-    }
-    totalInd = totalInd * dimSize + indices[i];
-  }
-  return totalInd;
+  // Links are stored in the order of their base points
+  // index = point(indices[1], ..., indices[d]) * d + indices[0]
+  vector<Expr> pointIndices(indices.begin()+1, indices.end());
+  return getLatticeCoord(pointIndices, latticeSet) * ndims + indices[0];
 }
 
 /// Compute the set of lattice indices from a linearized grid coordinate
 inline vector<Expr> getLatticeIndices(Expr coord, Expr latticeSet) {
   iassert(latticeSet.type().isLatticeLinkSet());
+  iassert(!kMortonLattices) << "Cannot decode Morton ordered coordinates";
 
   const LatticeLinkSetType *setType = latticeSet.type().toLatticeLinkSet();
   int ndims = setType->dimensions;
@@ -75,6 +103,7 @@ inline vector<Expr> getLatticeIndices(Expr coord, Expr latticeSet) {
 /// Compute the set of lattice indices from a linearized link coordinate
 inline vector<Expr> getLatticeLinkIndices(Expr coord, Expr latticeSet) {
   iassert(latticeSet.type().isLatticeLinkSet());
+  iassert(!kMortonLattices) << "Cannot decode Morton ordered coordinates";
 
   const LatticeLinkSetType *setType = latticeSet.type().toLatticeLinkSet();
   int ndims = setType->dimensions;
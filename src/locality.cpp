@@ -0,0 +1,193 @@
+#include "locality.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <unordered_map>
+
+#include "graph.h"
+#include "graph_indices.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+// Append the cache lines touched by reading `size` bytes at `addr`
+static inline void touch(vector<uintptr_t>& trace, const void* addr,
+                         size_t size, unsigned lineSize) {
+  uintptr_t begin = reinterpret_cast<uintptr_t>(addr);
+  for (uintptr_t line = begin / lineSize; line <= (begin+size-1) / lineSize;
+       ++line) {
+    trace.push_back(line);
+  }
+}
+
+static void touchElement(vector<uintptr_t>& trace, const Set& set, int index,
+                         unsigned lineSize) {
+  for (auto field : const_cast<Set&>(set).getFields()) {
+    touch(trace, static_cast<char*>(field->data) + index*field->sizeOfType,
+          field->sizeOfType, lineSize);
+  }
+}
+
+// Binary indexed tree over access times, marking the last access to each line
+class AccessTree {
+public:
+  AccessTree(size_t size) : tree(size+1, 0) {}
+
+  void add(size_t i, int value) {
+    for (++i; i < tree.size(); i += i & -i) {
+      tree[i] += value;
+    }
+  }
+
+  // Sum of the marks in [0, i)
+  int64_t prefix(size_t i) const {
+    int64_t sum = 0;
+    for (; i > 0; i -= i & -i) {
+      sum += tree[i];
+    }
+    return sum;
+  }
+
+private:
+  vector<int> tree;
+};
+
+LocalityMetrics computeLocalityMetrics(const Set& edgeSet,
+                                       unsigned cacheLineSize) {
+  uassert(edgeSet.getCardinality() > 0)
+      << "Locality metrics are computed for edge sets";
+  uassert(cacheLineSize > 0) << "Cache line size must be positive";
+
+  LocalityMetrics metrics;
+  metrics.numEdges = edgeSet.getSize();
+  metrics.cardinality = edgeSet.getCardinality();
+  metrics.cacheLineSize = cacheLineSize;
+  const int cardinality = metrics.cardinality;
+
+  // Endpoint spans
+  int64_t totalSpan = 0;
+  for (int e = 0; e < metrics.numEdges; ++e) {
+    int lo = edgeSet.getEndpointIndex(e, 0);
+    int hi = lo;
+    for (int k = 1; k < cardinality; ++k) {
+      lo = min(lo, edgeSet.getEndpointIndex(e, k));
+      hi = max(hi, edgeSet.getEndpointIndex(e, k));
+    }
+    totalSpan += hi - lo;
+    metrics.maxSpan = max(metrics.maxSpan, hi - lo);
+  }
+  if (metrics.numEdges > 0) {
+    metrics.averageSpan = (double)totalSpan / metrics.numEdges;
+  }
+
+  // Bandwidth and profile of the neighbor matrix
+  if (edgeSet.isHomogeneous() && cardinality >= 2) {
+    const internal::NeighborIndex* nbrs = edgeSet.getNeighborIndex();
+    const int* start = nbrs->getStartIndex();
+    const int* cols = nbrs->getNeighborIndex();
+    const int numVertices = edgeSet.getEndpointSet(0)->getSize();
+    for (int v = 0; v < numVertices; ++v) {
+      int first = v;
+      for (int j = start[v]; j < start[v+1]; ++j) {
+        metrics.bandwidth = max(metrics.bandwidth, abs(cols[j] - v));
+        first = min(first, cols[j]);
+      }
+      metrics.profile += v - first;
+    }
+  }
+
+  // Cache-line trace of a map over the edges
+  vector<uintptr_t> trace;
+  const int* endpoints = edgeSet.getEndpointsData();
+  for (int e = 0; e < metrics.numEdges; ++e) {
+    touch(trace, endpoints + e*cardinality, cardinality*sizeof(int),
+          cacheLineSize);
+    touchElement(trace, edgeSet, e, cacheLineSize);
+    for (int k = 0; k < cardinality; ++k) {
+      touchElement(trace, *edgeSet.getEndpointSet(k),
+                   edgeSet.getEndpointIndex(e, k), cacheLineSize);
+    }
+  }
+
+  // Reuse distance: the number of distinct lines touched since the last
+  // access to the same line
+  metrics.accesses = trace.size();
+  AccessTree lastAccesses(trace.size());
+  unordered_map<uintptr_t, size_t> lastAccess;
+  for (size_t t = 0; t < trace.size(); ++t) {
+    auto it = lastAccess.find(trace[t]);
+    if (it == lastAccess.end()) {
+      metrics.coldAccesses++;
+      lastAccess.insert({trace[t], t});
+    }
+    else {
+      size_t prev = it->second;
+      uint64_t distance = lastAccesses.prefix(t) - lastAccesses.prefix(prev+1);
+      size_t bucket = 0;
+      while (distance >> bucket) {
+        ++bucket;
+      }
+      if (bucket >= metrics.reuseDistances.size()) {
+        metrics.reuseDistances.resize(bucket+1, 0);
+      }
+      metrics.reuseDistances[bucket]++;
+      lastAccesses.add(prev, -1);
+      it->second = t;
+    }
+    lastAccesses.add(t, 1);
+  }
+
+  return metrics;
+}
+
+double LocalityMetrics::missRate(uint64_t cacheLines) const {
+  if (accesses == 0) {
+    return 0.0;
+  }
+  // A cache of 2^k lines hits on distances below 2^k, i.e. buckets 0 to k
+  size_t hitBuckets = 0;
+  while ((cacheLines >> hitBuckets) > 1) {
+    ++hitBuckets;
+  }
+  uint64_t misses = coldAccesses;
+  for (size_t i = hitBuckets+1; i < reuseDistances.size(); ++i) {
+    misses += reuseDistances[i];
+  }
+  return (double)misses / accesses;
+}
+
+std::ostream& operator<<(std::ostream& os, const LocalityMetrics& metrics) {
+  ios_base::fmtflags flags = os.flags();
+  streamsize precision = os.precision();
+  os << "edges:            " << metrics.numEdges
+     << " (cardinality " << metrics.cardinality << ")" << endl;
+  os << "endpoint span:    avg " << fixed << setprecision(2)
+     << metrics.averageSpan << ", max " << metrics.maxSpan << endl;
+  os << "bandwidth:        " << metrics.bandwidth << endl;
+  os << "profile:          " << metrics.profile << endl;
+  os << "line accesses:    " << metrics.accesses << " (" << metrics.coldAccesses
+     << " cold, " << metrics.cacheLineSize << "-byte lines)" << endl;
+  os << "reuse distances:" << endl;
+  for (size_t i = 0; i < metrics.reuseDistances.size(); ++i) {
+    if (i == 0) {
+      os << "  0";
+    }
+    else {
+      os << "  [" << (1ull << (i-1)) << "," << (1ull << i) << ")";
+    }
+    os << ": " << metrics.reuseDistances[i] << endl;
+  }
+  const uint64_t kb = 1024 / metrics.cacheLineSize;
+  os << "LRU miss rate:    "
+     << setprecision(4)
+     << metrics.missRate(32*kb)    << " (32KB), "
+     << metrics.missRate(256*kb)   << " (256KB), "
+     << metrics.missRate(8192*kb)  << " (8MB)";
+  os.flags(flags);
+  os.precision(precision);
+  return os;
+}
+
+}
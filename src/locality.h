@@ -0,0 +1,50 @@
+#ifndef SIMIT_LOCALITY_H
+#define SIMIT_LOCALITY_H
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace simit {
+class Set;
+
+/// Locality metrics of an edge set in its current storage order. They are
+/// cheap proxies for memory behavior, used to compare set orderings and
+/// layouts without running on hardware counters.
+struct LocalityMetrics {
+  int numEdges = 0;
+  int cardinality = 0;
+
+  /// Mean and maximum, over the edges, of the distance between the smallest
+  /// and the largest endpoint storage index.
+  double averageSpan = 0.0;
+  int maxSpan = 0;
+
+  /// Bandwidth and profile (envelope size) of the vertex by vertex matrix of
+  /// the neighbor index. Only computed for homogeneous edge sets.
+  int bandwidth = 0;
+  int64_t profile = 0;
+
+  /// Cache-line reuse distances of a simulated map over the edge set, which
+  /// reads the endpoints and fields of each edge and the fields of each of its
+  /// endpoints, in storage order. Bucket 0 counts reuse distance 0 and bucket
+  /// i > 0 counts distances in [2^(i-1), 2^i). First touches are cold
+  /// accesses and are not in the histogram.
+  unsigned cacheLineSize = 64;
+  std::vector<uint64_t> reuseDistances;
+  uint64_t coldAccesses = 0;
+  uint64_t accesses = 0;
+
+  /// The fraction of the simulated accesses that miss in a fully associative
+  /// LRU cache with `cacheLines` lines (rounded down to a power of two).
+  double missRate(uint64_t cacheLines) const;
+};
+
+/// Compute the locality metrics of an edge set.
+LocalityMetrics computeLocalityMetrics(const Set& edgeSet,
+                                       unsigned cacheLineSize=64);
+
+std::ostream& operator<<(std::ostream& os, const LocalityMetrics& metrics);
+
+}
+#endif
@@ -6,6 +6,7 @@
 #include "ir_rewriter.h"
 #include "ir_transforms.h"
 #include "ir_printer.h"
+#include "lattice_ops.h"
 #include "sig.h"
 #include "path_expressions.h"
 #include "tensor_index.h"
@@ -610,19 +611,19 @@ Stmt lowerIndexStatement(Stmt stmt, Environment* environment, Storage storage) {
       }
     }
     else if (loopVar->getDomain().kind == ForDomain::Lattice) {
-      int ndims = loopVar->getDomain().latticeVars.size();
-      // Add overall variable advancement
-      loopNest = Block::make(loopNest, AssignStmt::make(
-          loopVar->getDomain().var, 1, CompoundOperator::Add));
+      const vector<Var>& latticeVars = loopVar->getDomain().latticeVars;
+      int ndims = latticeVars.size();
+      // Compute the overall variable from the lattice indices, so that the
+      // innermost loop can be vectorized
+      vector<Expr> indices(latticeVars.begin(), latticeVars.end());
+      loopNest = Block::make(AssignStmt::make(loopVar->getDomain().var,
+          getLatticeCoord(indices, loopVar->getDomain().set)), loopNest);
       for (int i = 0; i < ndims; ++i) {
         Expr dimSize = IndexRead::make(loopVar->getDomain().set,
                                        IndexRead::LatticeDim, i);
-        loopNest = ForRange::make(loopVar->getDomain().latticeVars[i],
-                                  0, dimSize, loopNest);
+        loopNest = ForRange::make(latticeVars[i], 0, dimSize, loopNest,
+                                  i == 0);
       }
-      // Zero out the overall variable
-      Stmt initVar = AssignStmt::make(loopVar->getDomain().var, 0);
-      loopNest = Block::make(initVar, loopNest);
     }
     else if (loopVar->getDomain().kind == ForDomain::Neighbors ||
              loopVar->getDomain().kind == ForDomain::NeighborsOf) {
@@ -677,12 +678,12 @@ Stmt lowerIndexStatement(Stmt stmt, Environment* environment, Storage storage) {
         // Use canonical memory ordering to infer j from stencil offsets
         Expr latticeSet = stencil.getLatticeSet();
         iassert(latticeSet.type().isLatticeLinkSet());
-        unsigned dims = latticeSet.type().toLatticeLinkSet()->dimensions;
 
         // Fetch the full LoopVar corresponding to the i lattice loop
         iassert(latticeLoopVars.count(i));
         const LoopVar *latticeLoopVar = latticeLoopVars[i];
-        iassert(latticeLoopVar->getDomain().latticeVars.size() == dims);
+        iassert(latticeLoopVar->getDomain().latticeVars.size() ==
+                latticeSet.type().toLatticeLinkSet()->dimensions);
         const vector<Var> &latticeVars = latticeLoopVar->getDomain().latticeVars;
 
         // Use fixed stencil size to do an unrolled DIA-style loop for ij, j
@@ -693,13 +694,12 @@ Stmt lowerIndexStatement(Stmt stmt, Environment* environment, Storage storage) {
           ijLoop.push_back(AssignStmt::make(ij, stencilSize*i+ijInd));
           // Compute and assign j
           vector<int> offsets = flipped[ijInd];
-          Expr totalInd = Literal::make(0);
-          for (int d = dims-1; d >= 0; --d) {
-            Expr dimSize = IndexRead::make(latticeSet, IndexRead::LatticeDim, d);
-            // Periodic boundary conditions
-            Expr ind = ((latticeVars[d]+offsets[d])%dimSize+dimSize)%dimSize;
-            totalInd = totalInd * dimSize + ind;
-          }
+          vector<Expr> base(latticeVars.begin(), latticeVars.end());
+          vector<Expr> offsetExprs(offsets.begin(), offsets.end());
+          // Periodic boundary conditions
+          Expr totalInd = getLatticeCoord(
+              getLatticeOffsetIndices(base, offsetExprs, latticeSet),
+              latticeSet);
           ijLoop.push_back(AssignStmt::make(j, totalInd));
           // Perform inner loop
           ijLoop.push_back(loopNest);
@@ -7,10 +7,16 @@
 #include "index_expressions/lower_index_expressions.h"
 
 #include "lower_accesses.h"
+#include "lower_endpoint_gathers.h"
+#include "lower_map_simd.h"
+#include "lower_prefetches.h"
 #include "lower_prints.h"
 #include "lower_string_ops.h"
 #include "lower_stencil_assemblies.h"
+#include "operation_counts.h"
 
+#include "init.h"
+#include "profile.h"
 #include "storage.h"
 #include "timers.h"
 #include "temps.h"
@@ -19,6 +25,7 @@
 #include "ir_rewriter.h"
 #include "ir_transforms.h"
 #include "ir_printer.h"
+#include "ir_queries.h"
 #include "path_expressions.h"
 
 #ifdef GPU
@@ -71,14 +78,6 @@ void visitCallGraph(Func func, const function<void(Func)>& visitRule) {
   func.accept(&visitor);
 }
 
-static inline
-void printTimedCallGraph(string headerText, Func func, ostream* os) {
-  stringstream ss;
-  simit::ir::IRPrinterCallGraph(ss).print(func);
-  TimerStorage::getInstance().addSourceLines(ss);
-  *os << ss.rdbuf();
-}
-
 static inline
 void printCallGraph(string headerText, Func func, ostream* os) {
   if (os) {
@@ -88,25 +87,36 @@ void printCallGraph(string headerText, Func func, ostream* os) {
   }
 }
 
-Func lower(Func func, std::ostream* os, bool time) {
+/// End a lowering step: add it to the compile profile and print the IR. The
+/// time it takes to count and print the IR is not added to the profile.
+static inline
+void endStep(string headerText, Func func, ostream* os, CompileTimer* timer) {
+  timer->endStage(headerText, [&func]() -> int64_t {return countNodes(func);});
+  printCallGraph(headerText, func, os);
+  timer->restart();
+}
+
+Func lower(Func func, std::ostream* os, bool time, CompileProfile* profile) {
+  CompileTimer timer(profile);
 #ifdef GPU
   // Rewrite system assignments
   if (kBackend == "gpu") {
     func = rewriteCallGraph(func, rewriteSystemAssigns);
-    printCallGraph("Rewrite System Assigns (GPU)", func, print);
+    endStep("Rewrite System Assigns (GPU)", func, print, &timer);
   }
 #endif
 
   // Flatten index expressions and insert temporaries
   func = rewriteCallGraph(func, (Func(*)(Func))flattenIndexExpressions);
   func = rewriteCallGraph(func, insertTemporaries);
-  printCallGraph("Insert Temporaries and Flatten Index Expressions", func, os);
+  endStep("Insert Temporaries and Flatten Index Expressions", func, os, &timer);
 
   // Determine Storage
   func = rewriteCallGraph(func, [](Func func) -> Func {
     updateStorage(func, &func.getStorage(), &func.getEnvironment());
     return func;
   });
+  timer.endStage("Determine Storage");
   if (os) {
     *os << "%% Tensor storage" << endl;
     visitCallGraph(func, [os](Func func) {
@@ -118,52 +128,77 @@ Func lower(Func func, std::ostream* os, bool time) {
     });
     *os << endl;
   }
+  timer.restart();
 
   func = rewriteCallGraph(func, insertFrees);
-  printCallGraph("Insert Frees", func, os);
+  endStep("Insert Frees", func, os, &timer);
 
   func = rewriteCallGraph(func, lowerStringOps);
   func = rewriteCallGraph(func, lowerPrints);
-  printCallGraph("Lower String Operations and Prints", func, os);
+  endStep("Lower String Operations and Prints", func, os, &timer);
 
   func = rewriteCallGraph(func, lowerFieldAccesses);
-  printCallGraph("Lower Field Accesses", func, os);
+  endStep("Lower Field Accesses", func, os, &timer);
 
   // Lower stencil assemblies
   func = rewriteCallGraph(func, lowerStencilAssemblies);
-  printCallGraph("Normalize Row Indices", func, os);
+  endStep("Normalize Row Indices", func, os, &timer);
+
+  // Time functions, loops and maps, before maps are lowered to loops
+  if (time && kBackend == "cpu") {
+    func = insertTimers(func);
+    endStep("Insert Timers", func, os, &timer);
+  }
 
   // Lower maps
   func = rewriteCallGraph(func, lowerMaps);
-  printCallGraph("Lower Maps", func, os);
+  endStep("Lower Maps", func, os, &timer);
 
   // Lower Index Expressions
   func = rewriteCallGraph(func, lowerIndexExpressions);
-  printCallGraph("Lower Index Expressions", func, os);
+  endStep("Lower Index Expressions", func, os, &timer);
 
   // Lower Tensor Reads and Writes
   func = rewriteCallGraph(func, lowerTensorAccesses);
-  printCallGraph("Lower Tensor Reads and Writes", func, os);
+  endStep("Lower Tensor Reads and Writes", func, os, &timer);
+
+  // Count the operations of timed sites, to place them on a roofline
+  if (time && kBackend == "cpu") {
+    func = rewriteCallGraph(func, countTimedOperations);
+    endStep("Count Timed Operations", func, os, &timer);
+  }
+
+  // Gather endpoint fields into edge-contiguous buffers
+  if (kGatherEndpointFields && kBackend == "cpu") {
+    func = rewriteCallGraph(func, gatherEndpointFields);
+    endStep("Gather Endpoint Fields", func, os, &timer);
+  }
+
+  // Prefetch indirect accesses of set and neighbor loops
+  if (kPrefetchIndirectAccesses && kBackend == "cpu") {
+    func = rewriteCallGraph(func, insertPrefetches);
+    endStep("Insert Prefetches", func, os, &timer);
+  }
 
-  if (time) {
-    printTimedCallGraph("Insert Timers", func, os);
-    func = rewriteCallGraph(func, insertTimers);
-    printCallGraph("Insert Timers", func, os);
+  // Vectorize map element loops across elements
+  if (kVectorizeMaps && kBackend == "cpu") {
+    func = rewriteCallGraph(func, vectorizeMapLoops);
+    endStep("Vectorize Maps", func, os, &timer);
   }
 
   // Lower to GPU Kernels
 #if GPU
   if (kBackend == "gpu") {
     func = rewriteCallGraph(func, shardLoops);
-    printCallGraph("Shard Loops", func, os);
+    endStep("Shard Loops", func, os, &timer);
     func = rewriteCallGraph(func, rewriteVarDecls);
-    printCallGraph("Rewritten Var Decls", func, os);
+    endStep("Rewritten Var Decls", func, os, &timer);
     func = rewriteCallGraph(func, localizeTemps);
-    printCallGraph("Localize Temps", func, os);
+    endStep("Localize Temps", func, os, &timer);
     func = rewriteCallGraph(func, kernelRWAnalysis);
-    printCallGraph("Kernel RW Analysis", func, os);
+    endStep("Kernel RW Analysis", func, os, &timer);
     func = rewriteCallGraph(func, fuseKernels);
-    printCallGraph("Fuse Kernels", func, os);
+    endStep("Fuse Kernels", func, os, &timer);
   }
 #endif
   return func;
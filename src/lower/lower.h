@@ -4,12 +4,15 @@
 #include "ir.h"
 
 namespace simit {
+class CompileProfile;
 namespace ir {
 
 /// Optimize and lower `func` into the low level part of the Simit IR, that is
 /// is supported by backends. If `print` is true, then the IR will be printed
-/// to stdout between each lowering step.
-Func lower(Func func, std::ostream* os=nullptr, bool time=false);
+/// to stdout between each lowering step. If a compile profile is given, the
+/// time of each lowering step and the IR nodes after it are added to it.
+Func lower(Func func, std::ostream* os=nullptr, bool time=false,
+           CompileProfile* profile=nullptr);
 
 }}
 #endif
@@ -0,0 +1,430 @@
+#include "lower_endpoint_gathers.h"
+
+#include <map>
+#include <set>
+
+#include "intrinsics.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "macros.h"
+#include "util/collections.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+/// Written by statements whose writes are not known, such as calls to
+/// functions that write fields.
+static const string kAnyField = "*";
+
+/// An edge-contiguous copy of an endpoint field. It holds the field block of
+/// every endpoint of every edge, in the order of the endpoint index, so that
+/// `field[endpoints[slot]*blockSize + c]' is `buffer[slot*blockSize + c]'.
+struct EndpointGather {
+  Expr edgeSet;
+  Expr field;
+  Var buffer;
+  int blockSize;
+};
+
+/// A field of the endpoints of an edge set, that is gathered into a buffer.
+typedef pair<Expr,Expr> EndpointField;
+
+static string getKey(const EndpointField& endpointField) {
+  return util::toString(endpointField.first) + " " +
+         util::toString(endpointField.second);
+}
+
+/// Returns the printed fields that a statement may write.
+static set<string> getWrittenFields(Stmt stmt) {
+  class GetWrittenFields : public IRVisitor {
+  public:
+    set<string> fields;
+  private:
+    using IRVisitor::visit;
+    void visit(const Store *op) {
+      if (isa<FieldRead>(op->buffer)) {
+        fields.insert(util::toString(op->buffer));
+      }
+      IRVisitor::visit(op);
+    }
+    void visit(const FieldWrite *op) {
+      fields.insert(util::toString(FieldRead::make(op->elementOrSet,
+                                                   op->fieldName)));
+      IRVisitor::visit(op);
+    }
+    void visit(const TensorWrite *op) {
+      if (isa<FieldRead>(op->tensor)) {
+        fields.insert(util::toString(op->tensor));
+      }
+      IRVisitor::visit(op);
+    }
+    void visit(const CallStmt *op) {
+      // The fields a function writes are named after its arguments, so calls
+      // to functions that write fields may write any field
+      if (op->callee.getKind() != Func::Intrinsic &&
+          (!op->callee.getBody().defined() ||
+           getWrittenFields(op->callee.getBody()).size() > 0)) {
+        fields.insert(kAnyField);
+      }
+      IRVisitor::visit(op);
+    }
+  };
+  GetWrittenFields getWrittenFields;
+  stmt.accept(&getWrittenFields);
+  return getWrittenFields.fields;
+}
+
+/// Returns the edge set of a loop over the edges of an unstructured set, or
+/// an undefined expression if the loop is not such a loop.
+static Expr getEdgeSet(const For *loop) {
+  if (loop->domain.kind != ForDomain::IndexSet ||
+      loop->domain.indexSet.getKind() != IndexSet::Set) {
+    return Expr();
+  }
+  Expr set = loop->domain.indexSet.getSet();
+  if (!set.type().isUnstructuredSet() ||
+      set.type().toUnstructuredSet()->getCardinality() == 0) {
+    return Expr();
+  }
+  return set;
+}
+
+/// Returns the set of the endpoints of an edge set, or the empty string if
+/// the endpoints are not all in the same set.
+static string getEndpointSet(Expr edgeSet) {
+  const UnstructuredSetType *type = edgeSet.type().toUnstructuredSet();
+  string endpointSet = util::toString(*type->endpointSets[0]);
+  for (auto& set : type->endpointSets) {
+    if (util::toString(*set) != endpointSet) {
+      return "";
+    }
+  }
+  return endpointSet;
+}
+
+static string getEndpoints(Expr edgeSet) {
+  return util::toString(IndexRead::make(edgeSet, IndexRead::Endpoints));
+}
+
+/// If `index' indexes an endpoint field as `endpoints[slot]*blockSize' plus
+/// an optional component offset, returns the index of the same component in
+/// the gather buffer of the field, `slot*blockSize' plus the offset.
+/// Otherwise returns an undefined expression.
+static Expr getGatheredIndex(Expr index, const string& endpoints) {
+  auto isEndpoint = [&](Expr expr) {
+    return isa<Load>(expr) && util::toString(to<Load>(expr)->buffer)==endpoints;
+  };
+  auto getSlotIndex = [&](Expr expr) -> Expr {
+    if (isEndpoint(expr)) {
+      return to<Load>(expr)->index;
+    }
+    if (isa<Mul>(expr) && isEndpoint(to<Mul>(expr)->a) &&
+        util::toString(to<Mul>(expr)->b).find(endpoints) == string::npos) {
+      return Mul::make(to<Load>(to<Mul>(expr)->a)->index, to<Mul>(expr)->b);
+    }
+    return Expr();
+  };
+
+  if (isa<Add>(index)) {
+    const Add *add = to<Add>(index);
+    Expr slotIndex = getSlotIndex(add->a);
+    if (slotIndex.defined() &&
+        util::toString(add->b).find(endpoints) == string::npos) {
+      return Add::make(slotIndex, add->b);
+    }
+  }
+  return getSlotIndex(index);
+}
+
+/// Returns the endpoint fields that the body of a loop over an edge set reads
+/// through the endpoint index and does not write, in order of first read.
+static vector<EndpointField> getEndpointReads(const For *loop) {
+  class GetEndpointReads : public IRVisitor {
+  public:
+    GetEndpointReads(Expr edgeSet)
+        : edgeSet(edgeSet), endpointSet(getEndpointSet(edgeSet)),
+          endpoints(getEndpoints(edgeSet)) {}
+    vector<EndpointField> reads;
+  private:
+    Expr edgeSet;
+    string endpointSet;
+    string endpoints;
+    using IRVisitor::visit;
+    void visit(const Load *op) {
+      if (isa<FieldRead>(op->buffer) &&
+          util::toString(to<FieldRead>(op->buffer)->elementOrSet)==endpointSet &&
+          getGatheredIndex(op->index, endpoints).defined()) {
+        EndpointField read(edgeSet, op->buffer);
+        bool found = false;
+        for (auto& other : reads) {
+          found |= getKey(other) == getKey(read);
+        }
+        if (!found) {
+          reads.push_back(read);
+        }
+      }
+      IRVisitor::visit(op);
+    }
+  };
+
+  Expr edgeSet = getEdgeSet(loop);
+  iassert(edgeSet.defined());
+  GetEndpointReads getEndpointReads(edgeSet);
+  loop->body.accept(&getEndpointReads);
+
+  set<string> written = getWrittenFields(loop->body);
+  vector<EndpointField> reads;
+  for (auto& read : getEndpointReads.reads) {
+    if (!util::contains(written, kAnyField) &&
+        !util::contains(written, util::toString(read.second))) {
+      reads.push_back(read);
+    }
+  }
+  return reads;
+}
+
+/// Returns the endpoint fields read by the loops over edge sets in `stmt'.
+static vector<EndpointField> getNestedEndpointReads(Stmt stmt) {
+  class GetNestedEndpointReads : public IRVisitor {
+  public:
+    vector<EndpointField> reads;
+  private:
+    using IRVisitor::visit;
+    void visit(const For *op) {
+      if (getEdgeSet(op).defined()) {
+        for (auto& read : getEndpointReads(op)) {
+          reads.push_back(read);
+        }
+      }
+      IRVisitor::visit(op);
+    }
+  };
+  GetNestedEndpointReads getNestedEndpointReads;
+  stmt.accept(&getNestedEndpointReads);
+  return getNestedEndpointReads.reads;
+}
+
+static set<string> intersect(const set<string>& a, const set<string>& b) {
+  set<string> result;
+  for (auto& key : a) {
+    if (util::contains(b, key)) {
+      result.insert(key);
+    }
+  }
+  return result;
+}
+
+/// Replaces the endpoint field reads of a loop over an edge set by reads of
+/// the gather buffers of the fields.
+class ReadGatheredFields : public IRRewriter {
+public:
+  ReadGatheredFields(const string& endpoints, const map<string,Var>& buffers)
+      : endpoints(endpoints), buffers(buffers) {}
+
+private:
+  string endpoints;
+  const map<string,Var>& buffers;
+
+  using IRRewriter::visit;
+
+  void visit(const Load *op) {
+    string field = util::toString(op->buffer);
+    if (isa<FieldRead>(op->buffer) && util::contains(buffers, field)) {
+      Expr index = getGatheredIndex(op->index, endpoints);
+      if (index.defined()) {
+        expr = Load::make(buffers.at(field), rewrite(index));
+        return;
+      }
+    }
+    IRRewriter::visit(op);
+  }
+};
+
+/// Rewrites the loops over edge sets to read gathered endpoint fields, and
+/// fills the gather buffers where they are stale. The statements are visited
+/// in execution order while tracking which buffers hold the current values of
+/// their fields.
+class GatherEndpointFields : public IRRewriter {
+public:
+  const vector<EndpointGather>& getGathers() const {return gathers;}
+
+private:
+  vector<EndpointGather> gathers;
+  map<string,size_t> gatherIndices;
+
+  /// Keys of the gathers whose buffers hold the current field values.
+  set<string> fresh;
+
+  const EndpointGather& getGather(const EndpointField& endpointField) {
+    string key = getKey(endpointField);
+    if (!util::contains(gatherIndices, key)) {
+      Expr edgeSet = endpointField.first;
+      Expr field = endpointField.second;
+      const TensorType *fieldType = field.type().toTensor();
+      string name = util::toString(edgeSet) + "_" +
+                    to<FieldRead>(field)->fieldName;
+      Var buffer(INTERNAL_PREFIX(name),
+                 ArrayType::make(fieldType->getComponentType()));
+      int blockSize = fieldType->getBlockType().toTensor()->size();
+      gatherIndices[key] = gathers.size();
+      gathers.push_back({edgeSet, field, buffer, blockSize});
+    }
+    return gathers[gatherIndices.at(key)];
+  }
+
+  /// Fill the buffers of the endpoint fields that are stale.
+  Stmt refresh(const vector<EndpointField>& endpointFields) {
+    vector<Stmt> fills;
+    for (auto& endpointField : endpointFields) {
+      string key = getKey(endpointField);
+      if (util::contains(fresh, key)) {
+        continue;
+      }
+      fresh.insert(key);
+
+      const EndpointGather& gather = getGather(endpointField);
+      const int cardinality =
+          gather.edgeSet.type().toUnstructuredSet()->getCardinality();
+      Var slot(INTERNAL_PREFIX("slot"), Int);
+      Expr endpoint = Load::make(IndexRead::make(gather.edgeSet,
+                                                 IndexRead::Endpoints), slot);
+      Expr numSlots = Length::make(IndexSet(gather.edgeSet)) * cardinality;
+
+      Stmt copy;
+      if (gather.blockSize == 1) {
+        copy = Store::make(gather.buffer, slot,
+                           Load::make(gather.field, endpoint));
+      }
+      else {
+        Var c(INTERNAL_PREFIX("component"), Int);
+        copy = ForRange::make(c, 0, gather.blockSize,
+            Store::make(gather.buffer, slot * gather.blockSize + c,
+                        Load::make(gather.field,
+                                   endpoint * gather.blockSize + c)));
+      }
+      fills.push_back(ForRange::make(slot, 0, numSlots, copy));
+    }
+    return (fills.size() > 0) ? Block::make(fills) : Stmt();
+  }
+
+  void invalidate(const set<string>& writtenFields) {
+    for (auto& gather : gathers) {
+      if (util::contains(writtenFields, kAnyField) ||
+          util::contains(writtenFields, util::toString(gather.field))) {
+        fresh.erase(getKey({gather.edgeSet, gather.field}));
+      }
+    }
+  }
+
+  static Stmt prepend(Stmt stmt, Stmt fills) {
+    return fills.defined() ? Block::make(fills, stmt) : stmt;
+  }
+
+  /// Loop bodies run repeatedly, so the fields they read but do not write are
+  /// gathered before the loop, and the fields they write are stale at the
+  /// start of every iteration.
+  template <typename T>
+  void visitLoop(const T *op) {
+    set<string> writtenFields = getWrittenFields(op->body);
+    vector<EndpointField> hoisted;
+    for (auto& read : getNestedEndpointReads(op->body)) {
+      if (!util::contains(writtenFields, kAnyField) &&
+          !util::contains(writtenFields, util::toString(read.second))) {
+        hoisted.push_back(read);
+      }
+    }
+    Stmt fills = refresh(hoisted);
+    invalidate(writtenFields);
+    set<string> entry = fresh;
+    IRRewriter::visit(op);
+    fresh = intersect(entry, fresh);
+    stmt = prepend(stmt, fills);
+  }
+
+  using IRRewriter::visit;
+
+  void visit(const For *op) {
+    Expr edgeSet = getEdgeSet(op);
+    if (!edgeSet.defined()) {
+      visitLoop(op);
+      return;
+    }
+
+    vector<EndpointField> reads = getEndpointReads(op);
+    Stmt fills = refresh(reads);
+    map<string,Var> buffers;
+    for (auto& read : reads) {
+      buffers[util::toString(read.second)] = getGather(read).buffer;
+    }
+    Stmt body = ReadGatheredFields(getEndpoints(edgeSet), buffers)
+        .rewrite(op->body);
+    invalidate(getWrittenFields(op->body));
+    stmt = prepend(For::make(op->var, op->domain, body, op->vectorize), fills);
+  }
+
+  void visit(const ForRange *op) {
+    visitLoop(op);
+  }
+
+  void visit(const While *op) {
+    visitLoop(op);
+  }
+
+  void visit(const IfThenElse *op) {
+    set<string> entry = fresh;
+    Stmt thenBody = rewrite(op->thenBody);
+    set<string> thenFresh = fresh;
+    fresh = entry;
+    Stmt elseBody = rewrite(op->elseBody);
+    fresh = intersect(thenFresh, fresh);
+    stmt = elseBody.defined()
+        ? IfThenElse::make(op->condition, thenBody, elseBody)
+        : IfThenElse::make(op->condition, thenBody);
+  }
+
+  void visit(const Store *op) {
+    invalidate(getWrittenFields(op));
+    stmt = op;
+  }
+
+  void visit(const FieldWrite *op) {
+    invalidate(getWrittenFields(op));
+    stmt = op;
+  }
+
+  void visit(const CallStmt *op) {
+    invalidate(getWrittenFields(op));
+    stmt = op;
+  }
+};
+
+Func gatherEndpointFields(Func func) {
+  GatherEndpointFields rewriter;
+  Stmt body = rewriter.rewrite(func.getBody());
+  if (rewriter.getGathers().size() == 0) {
+    return func;
+  }
+
+  // The buffers hold the gathered fields for the duration of the function
+  vector<Stmt> stmts;
+  for (auto& gather : rewriter.getGathers()) {
+    const int cardinality =
+        gather.edgeSet.type().toUnstructuredSet()->getCardinality();
+    ScalarType componentType = gather.buffer.getType().toArray()->elementType;
+    Expr bytes = Length::make(IndexSet(gather.edgeSet)) *
+                 (cardinality * gather.blockSize * (int)componentType.bytes());
+    stmts.push_back(VarDecl::make(gather.buffer));
+    stmts.push_back(CallStmt::make({gather.buffer}, intrinsics::malloc(),
+                                   {bytes}));
+  }
+  stmts.push_back(body);
+  for (auto& gather : rewriter.getGathers()) {
+    stmts.push_back(CallStmt::make({}, intrinsics::free(), {gather.buffer}));
+  }
+  return Func(func, Block::make(stmts));
+}
+
+}}
@@ -0,0 +1,18 @@
+#ifndef SIMIT_LOWER_ENDPOINT_GATHERS_H
+#define SIMIT_LOWER_ENDPOINT_GATHERS_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Gather the endpoint fields that the element loops of maps over edge sets
+/// read through the endpoint index into edge-contiguous buffers, with one
+/// copy of the field per edge endpoint, so that the loops read them with unit
+/// stride. A buffer is filled before the first loop that reads it and only
+/// refilled after the field may have been written, so it is shared by all the
+/// maps over the edge set and is filled once per run in the common case.
+Func gatherEndpointFields(Func func);
+
+}}
+#endif
@@ -0,0 +1,522 @@
+#include "lower_map_simd.h"
+
+#include <set>
+#include <map>
+
+#include "init.h"
+#include "intrinsics.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "macros.h"
+#include "storage.h"
+#include "util/collections.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+/// The number of components of a dense tensor variable.
+static int getSize(Var var) {
+  return static_cast<int>(var.getType().toTensor()->size());
+}
+
+/// Collects the variables declared in the body of an element loop, in order
+/// of declaration. These are the kernel temporaries, that get one value per
+/// element of a block.
+static vector<Var> getLocals(Stmt body) {
+  class GetLocals : public IRVisitor {
+  public:
+    vector<Var> locals;
+    using IRVisitor::visit;
+    void visit(const VarDecl *op) {
+      if (!util::contains(locals, op->var)) {
+        locals.push_back(op->var);
+      }
+    }
+  };
+  GetLocals getLocals;
+  body.accept(&getLocals);
+  return getLocals.locals;
+}
+
+/// Returns true if the expression takes the same value for every element,
+/// i.e. if it does not use the element or any of the kernel temporaries.
+static bool isUniform(Expr expr, Var element, const set<Var>& locals) {
+  class IsUniform : public IRVisitor {
+  public:
+    IsUniform(Var element, const set<Var>& locals)
+        : element(element), locals(locals) {}
+    bool uniform = true;
+  private:
+    Var element;
+    const set<Var>& locals;
+    using IRVisitor::visit;
+    void visit(const VarExpr *op) {
+      if (op->var == element || util::contains(locals, op->var)) {
+        uniform = false;
+      }
+    }
+  };
+  IsUniform isUniform(element, locals);
+  expr.accept(&isUniform);
+  return isUniform.uniform;
+}
+
+/// Checks whether an element loop body can be run a block of elements at a
+/// time. That is the case if it consists of assignments, stores, calls,
+/// conditionals and loops over uniform ranges, if its temporaries are dense
+/// tensors that are only accessed through loads, stores and calls, and if it
+/// does not read any of the tensors or fields it writes, so that statements of
+/// different elements may be reordered.
+class CanVectorize : public IRVisitor {
+public:
+  CanVectorize(Var element, const set<Var>& locals)
+      : element(element), locals(locals) {}
+
+  bool check(Stmt body) {
+    body.accept(this);
+    for (auto& write : writes) {
+      if (util::contains(reads, write)) {
+        supported = false;
+      }
+    }
+    return supported;
+  }
+
+private:
+  Var element;
+  const set<Var>& locals;
+  bool supported = true;
+  set<string> reads;
+  set<string> writes;
+
+  bool isLocal(Expr expr) {
+    return isa<VarExpr>(expr) && util::contains(locals, to<VarExpr>(expr)->var);
+  }
+
+  using IRVisitor::visit;
+
+  void visit(const VarExpr *op) {
+    if (util::contains(locals, op->var)) {
+      // Temporary tensors must be accessed through loads and stores
+      if (!isScalar(op->var.getType())) {
+        supported = false;
+      }
+    }
+    else if (op->var != element) {
+      reads.insert(op->var.getName());
+    }
+  }
+
+  void visit(const Load *op) {
+    if (!isLocal(op->buffer)) {
+      reads.insert(util::toString(op->buffer));
+      op->buffer.accept(this);
+    }
+    op->index.accept(this);
+  }
+
+  void visit(const VarDecl *op) {
+    Type type = op->var.getType();
+    if (!type.isTensor() || type.toTensor()->hasSystemDimensions() ||
+        type.toTensor()->getComponentType().isString()) {
+      supported = false;
+    }
+  }
+
+  void visit(const AssignStmt *op) {
+    if (util::contains(locals, op->var)) {
+      if (!isScalar(op->value.type())) {
+        supported = false;
+      }
+    }
+    else {
+      writes.insert(op->var.getName());
+    }
+    op->value.accept(this);
+  }
+
+  void visit(const Store *op) {
+    if (!isLocal(op->buffer)) {
+      writes.insert(util::toString(op->buffer));
+      if (!isa<VarExpr>(op->buffer)) {
+        op->buffer.accept(this);
+      }
+    }
+    op->index.accept(this);
+    op->value.accept(this);
+  }
+
+  void visit(const CallStmt *op) {
+    // Prefetches do not read the buffers they prefetch from
+    if (op->callee == intrinsics::prefetch()) {
+      op->actuals[1].accept(this);
+      return;
+    }
+    for (auto& actual : op->actuals) {
+      if (!isLocal(actual)) {
+        actual.accept(this);
+      }
+    }
+    for (auto& result : op->results) {
+      if (!util::contains(locals, result)) {
+        writes.insert(result.getName());
+      }
+    }
+  }
+
+  void visit(const IfThenElse *op) {
+    op->condition.accept(this);
+    op->thenBody.accept(this);
+    if (op->elseBody.defined()) {
+      op->elseBody.accept(this);
+    }
+  }
+
+  void visit(const ForRange *op) {
+    if (!isUniform(op->start, element, locals) ||
+        !isUniform(op->end, element, locals)) {
+      supported = false;
+    }
+    op->start.accept(this);
+    op->end.accept(this);
+    op->body.accept(this);
+  }
+
+  void visit(const For *op) {
+    if (op->domain.kind != ForDomain::IndexSet) {
+      supported = false;
+    }
+    op->body.accept(this);
+  }
+
+  void visit(const FieldWrite *op) {supported = false;}
+  void visit(const While *op) {supported = false;}
+  void visit(const Kernel *op) {supported = false;}
+  void visit(const Print *op) {supported = false;}
+  void visit(const TensorWrite *op) {supported = false;}
+  void visit(const Map *op) {supported = false;}
+};
+
+/// Rewrites a kernel statement to execute it for one lane (element) of a
+/// block. The element loop variable is replaced by the element of the lane,
+/// and the temporaries by their lane's components in the widened temporaries.
+class LaneRewriter : public IRRewriter {
+public:
+  LaneRewriter(Var element, Expr laneElement, Var lane, int width,
+               const map<Var,Var>& widened)
+      : element(element), laneElement(laneElement), lane(lane), width(width),
+        widened(widened) {}
+
+  /// The index of the `component' of a temporary for the lane.
+  Expr laneIndex(Expr component) {
+    return component * width + lane;
+  }
+
+  const map<Var,Var>& getWidened() const {return widened;}
+
+private:
+  Var element;
+  Expr laneElement;
+  Var lane;
+  int width;
+  const map<Var,Var>& widened;
+
+  bool isLocal(Expr expr) {
+    return isa<VarExpr>(expr) &&
+           util::contains(widened, to<VarExpr>(expr)->var);
+  }
+
+  using IRRewriter::visit;
+
+  void visit(const VarExpr *op) {
+    if (op->var == element) {
+      expr = laneElement;
+    }
+    else if (util::contains(widened, op->var)) {
+      iassert(isScalar(op->var.getType()));
+      expr = Load::make(widened.at(op->var), lane);
+    }
+    else {
+      expr = op;
+    }
+  }
+
+  void visit(const Load *op) {
+    if (isLocal(op->buffer)) {
+      Var var = widened.at(to<VarExpr>(op->buffer)->var);
+      expr = Load::make(var, laneIndex(rewrite(op->index)));
+    }
+    else {
+      IRRewriter::visit(op);
+    }
+  }
+
+  void visit(const Store *op) {
+    if (isLocal(op->buffer)) {
+      Var var = widened.at(to<VarExpr>(op->buffer)->var);
+      stmt = Store::make(var, laneIndex(rewrite(op->index)),
+                         rewrite(op->value), op->cop);
+    }
+    else {
+      IRRewriter::visit(op);
+    }
+  }
+
+  void visit(const AssignStmt *op) {
+    if (!util::contains(widened, op->var)) {
+      IRRewriter::visit(op);
+      return;
+    }
+
+    Var var = widened.at(op->var);
+    Expr value = rewrite(op->value);
+    if (isScalar(op->var.getType())) {
+      stmt = Store::make(var, lane, value, op->cop);
+    }
+    else {
+      // Assign the scalar to every component of the lane
+      Var k("k", Int);
+      stmt = ForRange::make(k, 0, getSize(op->var),
+                            Store::make(var, laneIndex(k), value, op->cop));
+    }
+  }
+};
+
+/// Vectorizes the element loops of maps (For loops marked for vectorization).
+class VectorizeMapLoops : public IRRewriter {
+public:
+  VectorizeMapLoops(int width) : width(width) {}
+
+private:
+  int width;
+
+  // State of the element loop being vectorized
+  Var lane;
+  vector<Stmt> decls;
+  set<Var> scratch;
+  LaneRewriter* laneRewriter;
+
+  using IRRewriter::visit;
+
+  void visit(const For *op) {
+    if (!op->vectorize || op->domain.kind != ForDomain::IndexSet) {
+      IRRewriter::visit(op);
+      return;
+    }
+
+    Var element = op->var;
+    vector<Var> declared = getLocals(op->body);
+    set<Var> locals(declared.begin(), declared.end());
+    if (!CanVectorize(element, locals).check(op->body)) {
+      stmt = op;
+      return;
+    }
+
+    // Widen the temporaries to one value per lane, innermost
+    map<Var,Var> widened;
+    decls.clear();
+    scratch.clear();
+    for (auto& local : declared) {
+      ScalarType componentType = local.getType().toTensor()->getComponentType();
+      Var var(local.getName()+"_lanes", TensorType::make(
+          componentType, {IndexDomain(getSize(local) * width)}));
+      widened.insert({local, var});
+      decls.push_back(VarDecl::make(var));
+    }
+
+    Var block(INTERNAL_PREFIX(element.getName()+"_block"), Int);
+    lane = Var(INTERNAL_PREFIX(element.getName()+"_lane"), Int);
+    LaneRewriter rewriter(element, block * width + lane, lane, width, widened);
+    laneRewriter = &rewriter;
+
+    Stmt blockBody = vectorizeBlock(op->body, Expr(), element, locals);
+
+    // Elements that do not fill a block are run by the scalar loop
+    Expr numElements = Length::make(op->domain.indexSet);
+    Expr numBlocks = numElements / width;
+    Stmt blocks = ForRange::make(block, 0, numBlocks, blockBody);
+    Stmt remainder = ForRange::make(element, numBlocks * width, numElements,
+                                    op->body);
+
+    vector<Stmt> stmts = decls;
+    stmts.push_back(blocks);
+    stmts.push_back(remainder);
+    stmt = Block::make(stmts);
+  }
+
+  /// Vectorize `body', executing it for the lanes for which `mask' holds (all
+  /// lanes if `mask' is undefined).
+  Stmt vectorizeBlock(Stmt body, Expr mask, Var element,
+                      const set<Var>& locals) {
+    vector<Stmt> stmts;
+    vector<Stmt> laneStmts;
+    vectorize(body, mask, element, locals, &stmts, &laneStmts);
+    flushLaneStmts(mask, &stmts, &laneStmts);
+    return (stmts.size() > 0) ? Block::make(stmts) : Pass::make();
+  }
+
+  /// Emit a loop over the lanes that executes the pending lane statements.
+  void flushLaneStmts(Expr mask, vector<Stmt>* stmts,
+                      vector<Stmt>* laneStmts) {
+    if (laneStmts->size() == 0) {
+      return;
+    }
+    Stmt laneBody = Block::make(*laneStmts);
+    if (mask.defined()) {
+      laneBody = IfThenElse::make(mask, laneBody);
+    }
+    stmts->push_back(ForRange::make(lane, 0, width, laneBody, true));
+    laneStmts->clear();
+  }
+
+  void vectorize(Stmt stmt, Expr mask, Var element, const set<Var>& locals,
+                 vector<Stmt>* stmts, vector<Stmt>* laneStmts) {
+    if (isa<Block>(stmt)) {
+      const Block* block = to<Block>(stmt);
+      vectorize(block->first, mask, element, locals, stmts, laneStmts);
+      if (block->rest.defined()) {
+        vectorize(block->rest, mask, element, locals, stmts, laneStmts);
+      }
+    }
+    else if (isa<Scope>(stmt)) {
+      vectorize(to<Scope>(stmt)->scopedStmt, mask, element, locals,
+                stmts, laneStmts);
+    }
+    else if (isa<Comment>(stmt)) {
+      const Comment* comment = to<Comment>(stmt);
+      if (comment->commentedStmt.defined()) {
+        vectorize(comment->commentedStmt, mask, element, locals,
+                  stmts, laneStmts);
+      }
+    }
+    else if (isa<VarDecl>(stmt) || isa<Pass>(stmt)) {
+      // Temporaries are declared before the block loop
+    }
+    else if (isa<ForRange>(stmt)) {
+      // Loops with uniform bounds run for all lanes at once
+      const ForRange* loop = to<ForRange>(stmt);
+      flushLaneStmts(mask, stmts, laneStmts);
+      stmts->push_back(ForRange::make(loop->var, loop->start, loop->end,
+          vectorizeBlock(loop->body, mask, element, locals)));
+    }
+    else if (isa<For>(stmt)) {
+      const For* loop = to<For>(stmt);
+      iassert(loop->domain.kind == ForDomain::IndexSet);
+      flushLaneStmts(mask, stmts, laneStmts);
+      stmts->push_back(ForRange::make(loop->var, 0,
+          Length::make(loop->domain.indexSet),
+          vectorizeBlock(loop->body, mask, element, locals)));
+    }
+    else if (isa<IfThenElse>(stmt)) {
+      const IfThenElse* ifThenElse = to<IfThenElse>(stmt);
+      flushLaneStmts(mask, stmts, laneStmts);
+      if (isUniform(ifThenElse->condition, element, locals)) {
+        Stmt thenBody = vectorizeBlock(ifThenElse->thenBody, mask,
+                                       element, locals);
+        stmts->push_back(ifThenElse->elseBody.defined()
+            ? IfThenElse::make(ifThenElse->condition, thenBody,
+                               vectorizeBlock(ifThenElse->elseBody, mask,
+                                              element, locals))
+            : IfThenElse::make(ifThenElse->condition, thenBody));
+        return;
+      }
+
+      // Compute the condition of each lane into a mask
+      Var condition(INTERNAL_PREFIX("mask"), TensorType::make(
+          ScalarType::Boolean, {IndexDomain(width)}));
+      decls.push_back(VarDecl::make(condition));
+      Stmt computeCondition = Store::make(
+          condition, lane, laneRewriter->rewrite(ifThenElse->condition));
+      if (mask.defined()) {
+        computeCondition = IfThenElse::make(
+            mask, computeCondition,
+            Store::make(condition, lane, Literal::make(false)));
+      }
+      stmts->push_back(ForRange::make(lane, 0, width, computeCondition, true));
+
+      Expr thenMask = Load::make(condition, lane);
+      stmts->push_back(vectorizeBlock(ifThenElse->thenBody, thenMask,
+                                      element, locals));
+      if (ifThenElse->elseBody.defined()) {
+        Expr elseMask = mask.defined() ? And::make(mask, Not::make(thenMask))
+                                       : Not::make(thenMask);
+        stmts->push_back(vectorizeBlock(ifThenElse->elseBody, elseMask,
+                                        element, locals));
+      }
+    }
+    else if (isa<CallStmt>(stmt)) {
+      laneStmts->push_back(vectorizeCall(to<CallStmt>(stmt)));
+    }
+    else {
+      iassert(isa<AssignStmt>(stmt) || isa<Store>(stmt)) << stmt;
+      laneStmts->push_back(laneRewriter->rewrite(stmt));
+    }
+  }
+
+  /// Calls take the temporary tensors of a lane as arguments and results, so
+  /// they are copied to and from the scalar temporaries around the call.
+  Stmt vectorizeCall(const CallStmt* op) {
+    const map<Var,Var>& widened = laneRewriter->getWidened();
+    vector<Stmt> stmts;
+
+    vector<Expr> actuals;
+    for (auto& actual : op->actuals) {
+      if (isa<VarExpr>(actual) &&
+          util::contains(widened, to<VarExpr>(actual)->var) &&
+          !isScalar(actual.type())) {
+        Var var = to<VarExpr>(actual)->var;
+        Var k("k", Int);
+        stmts.push_back(ForRange::make(k, 0, getSize(var), Store::make(
+            var, k, Load::make(widened.at(var), laneRewriter->laneIndex(k)))));
+        declareScratch(var);
+        actuals.push_back(actual);
+      }
+      else {
+        actuals.push_back(laneRewriter->rewrite(actual));
+      }
+    }
+
+    vector<Stmt> copyResults;
+    for (auto& result : op->results) {
+      if (!util::contains(widened, result)) {
+        continue;
+      }
+      declareScratch(result);
+      if (isScalar(result.getType())) {
+        copyResults.push_back(Store::make(widened.at(result), lane, result));
+      }
+      else {
+        Var k("k", Int);
+        copyResults.push_back(ForRange::make(k, 0, getSize(result),
+            Store::make(widened.at(result), laneRewriter->laneIndex(k),
+                        Load::make(result, k))));
+      }
+    }
+
+    stmts.push_back(CallStmt::make(op->results, op->callee, actuals));
+    stmts.insert(stmts.end(), copyResults.begin(), copyResults.end());
+    return Block::make(stmts);
+  }
+
+  void declareScratch(Var var) {
+    if (!util::contains(scratch, var)) {
+      scratch.insert(var);
+      decls.push_back(VarDecl::make(var));
+    }
+  }
+};
+
+Func vectorizeMapLoops(Func func) {
+  Stmt body = VectorizeMapLoops(kMapVectorWidth).rewrite(func.getBody());
+  if (body == func.getBody()) {
+    return func;
+  }
+  func = Func(func, body);
+  updateStorage(func.getBody(), &func.getStorage(), &func.getEnvironment());
+  return func;
+}
+
+}}
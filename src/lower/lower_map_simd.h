@@ -0,0 +1,21 @@
+#ifndef SIMIT_LOWER_MAP_SIMD_H
+#define SIMIT_LOWER_MAP_SIMD_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Vectorize the element loops of maps across elements. Each loop is run in
+/// blocks of kMapVectorWidth elements, and every statement of the kernel is
+/// executed for all the elements of a block by an innermost loop marked for
+/// vectorization. Kernel temporaries get one value per element of the block,
+/// with the element index innermost, so that these loops access them with unit
+/// stride, while endpoint field reads become gathers and compound adds into
+/// the map results are executed serially. Loops whose kernels read the
+/// tensors or fields they write, or contain statements that cannot be run for
+/// a block at a time, are left unchanged.
+Func vectorizeMapLoops(Func func);
+
+}}
+#endif
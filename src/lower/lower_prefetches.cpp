@@ -0,0 +1,255 @@
+#include "lower_prefetches.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "init.h"
+#include "intrinsics.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "macros.h"
+#include "util/collections.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+/// The number of operations that a loop executes during one memory access,
+/// used to choose how many iterations ahead to prefetch.
+static const int kMemoryLatencyOperations = 1024;
+static const int kMaxPrefetchDistance = 64;
+
+/// The cost of a call, in operations.
+static const int kCallCost = 8;
+
+/// Estimates the number of operations executed by a statement.
+static int getCost(Stmt stmt) {
+  class GetCost : public IRVisitor {
+  public:
+    int cost = 0;
+  private:
+    using IRVisitor::visit;
+    void visit(const Load *op) {cost += 1; IRVisitor::visit(op);}
+    void visit(const Store *op) {cost += 1; IRVisitor::visit(op);}
+    void visit(const Add *op) {cost += 1; IRVisitor::visit(op);}
+    void visit(const Sub *op) {cost += 1; IRVisitor::visit(op);}
+    void visit(const Mul *op) {cost += 1; IRVisitor::visit(op);}
+    void visit(const Div *op) {cost += 1; IRVisitor::visit(op);}
+    void visit(const CallStmt *op) {cost += kCallCost; IRVisitor::visit(op);}
+    void visit(const For *op) {
+      int trips = 1;
+      if (op->domain.kind == ForDomain::IndexSet &&
+          op->domain.indexSet.getKind() == IndexSet::Range) {
+        trips = op->domain.indexSet.getSize();
+      }
+      cost += trips * getCost(op->body);
+    }
+    void visit(const ForRange *op) {
+      int trips = 1;
+      if (isa<Literal>(op->start) && isa<Literal>(op->end)) {
+        trips = max(1, to<Literal>(op->end)->getIntVal(0) -
+                       to<Literal>(op->start)->getIntVal(0));
+      }
+      cost += trips * getCost(op->body);
+    }
+  };
+  GetCost getCost;
+  stmt.accept(&getCost);
+  return getCost.cost;
+}
+
+/// The number of iterations ahead of the current iteration to prefetch.
+static int getPrefetchDistance(Stmt body, bool vectorized) {
+  int distance = kPrefetchDistance;
+  if (distance == 0) {
+    int cost = max(1, getCost(body));
+    distance = min(kMaxPrefetchDistance,
+                   max(1, (kMemoryLatencyOperations + cost - 1) / cost));
+  }
+  // Vectorized map loops run a block of elements at a time, so they prefetch
+  // for the next block
+  if (vectorized) {
+    distance = max(distance, kMapVectorWidth);
+  }
+  return distance;
+}
+
+/// An indirect access of a loop: the buffer it accesses, and the stride of
+/// the indirection (the block size of the buffer).
+typedef pair<Expr,Expr> IndirectAccess;
+
+/// Returns the indirect accesses of a loop body, to buffers that are not
+/// declared in the body, with indices of the form `i*stride' plus an optional
+/// offset, where `i' is an expression for which `isIndirection' holds.
+static vector<IndirectAccess>
+getIndirectAccesses(Stmt body, const function<bool(Expr)>& isIndirection) {
+  class GetIndirectAccesses : public IRVisitor {
+  public:
+    GetIndirectAccesses(const function<bool(Expr)>& isIndirection)
+        : isIndirection(isIndirection) {}
+    vector<IndirectAccess> accesses;
+  private:
+    const function<bool(Expr)>& isIndirection;
+    set<Var> locals;
+    set<string> buffers;
+
+    void addAccess(Expr buffer, Expr index) {
+      if (isa<VarExpr>(buffer) &&
+          util::contains(locals, to<VarExpr>(buffer)->var)) {
+        return;
+      }
+      if (isa<Add>(index)) {
+        index = to<Add>(index)->a;
+      }
+      Expr stride;
+      if (isIndirection(index)) {
+        stride = 1;
+      }
+      else if (isa<Mul>(index) && isIndirection(to<Mul>(index)->a)) {
+        stride = to<Mul>(index)->b;
+      }
+      string key = util::toString(buffer);
+      if (stride.defined() && !util::contains(buffers, key)) {
+        buffers.insert(key);
+        accesses.push_back(IndirectAccess(buffer, stride));
+      }
+    }
+
+    using IRVisitor::visit;
+    void visit(const VarDecl *op) {
+      locals.insert(op->var);
+    }
+    void visit(const Load *op) {
+      addAccess(op->buffer, op->index);
+      IRVisitor::visit(op);
+    }
+    void visit(const Store *op) {
+      addAccess(op->buffer, op->index);
+      IRVisitor::visit(op);
+    }
+  };
+  GetIndirectAccesses getIndirectAccesses(isIndirection);
+  body.accept(&getIndirectAccesses);
+  return getIndirectAccesses.accesses;
+}
+
+/// Returns the variable that a loop over the neighbors of a sparse matrix
+/// row, `for ij in coords[i]:coords[i+1]', assigns the column index
+/// `sinks[ij]' to, and the column index array. The variable is undefined if
+/// the loop is not such a loop.
+static pair<Var,Expr> getNeighborVar(const ForRange *loop) {
+  class GetNeighborVar : public IRVisitor {
+  public:
+    GetNeighborVar(Var loopVar) : loopVar(loopVar) {}
+    Var neighbor;
+    Expr sinks;
+  private:
+    Var loopVar;
+    using IRVisitor::visit;
+    void visit(const AssignStmt *op) {
+      if (neighbor.defined() || !isa<Load>(op->value)) {
+        return;
+      }
+      const Load *load = to<Load>(op->value);
+      if (load->buffer.type().isArray() && isa<VarExpr>(load->index) &&
+          to<VarExpr>(load->index)->var == loopVar) {
+        neighbor = op->var;
+        sinks = load->buffer;
+      }
+    }
+  };
+  if (!isa<Load>(loop->start)) {
+    return {Var(), Expr()};
+  }
+  GetNeighborVar getNeighborVar(loop->var);
+  loop->body.accept(&getNeighborVar);
+  return {getNeighborVar.neighbor, getNeighborVar.sinks};
+}
+
+/// Emit a prefetch of each indirect access for the given indirection.
+static Stmt prefetch(const vector<IndirectAccess>& accesses,
+                     Expr indirection) {
+  vector<Stmt> prefetches;
+  for (auto& access : accesses) {
+    prefetches.push_back(CallStmt::make({}, intrinsics::prefetch(),
+                                        {access.first,
+                                         indirection * access.second}));
+  }
+  return Block::make(prefetches);
+}
+
+class InsertPrefetches : public IRRewriter {
+  using IRRewriter::visit;
+
+  void visit(const For *op) {
+    Stmt body = rewrite(op->body);
+
+    Expr edgeSet;
+    if (op->domain.kind == ForDomain::IndexSet &&
+        op->domain.indexSet.getKind() == IndexSet::Set &&
+        op->domain.indexSet.getSet().type().isUnstructuredSet()) {
+      edgeSet = op->domain.indexSet.getSet();
+    }
+    int cardinality = edgeSet.defined()
+        ? edgeSet.type().toUnstructuredSet()->getCardinality() : 0;
+    if (cardinality == 0) {
+      stmt = (body == op->body) ? op
+                                : For::make(op->var, op->domain, body,
+                                            op->vectorize);
+      return;
+    }
+
+    Expr endpoints = IndexRead::make(edgeSet, IndexRead::Endpoints);
+    string endpointsString = util::toString(endpoints);
+    auto isEndpoint = [&](Expr expr) {
+      return isa<Load>(expr) &&
+             util::toString(to<Load>(expr)->buffer) == endpointsString;
+    };
+    vector<IndirectAccess> accesses = getIndirectAccesses(op->body, isEndpoint);
+    if (accesses.size() > 0) {
+      // Prefetch the endpoint data of the edge `distance' edges ahead
+      bool vectorized = op->vectorize && kVectorizeMaps;
+      Expr ahead = Expr(op->var) + getPrefetchDistance(op->body, vectorized);
+      Var k(INTERNAL_PREFIX("endpoint"), Int);
+      Stmt prefetches = ForRange::make(k, 0, cardinality, prefetch(
+          accesses, Load::make(endpoints, ahead * cardinality + k)));
+      body = Block::make(IfThenElse::make(
+          Lt::make(ahead, Length::make(op->domain.indexSet)), prefetches),
+          body);
+    }
+    stmt = For::make(op->var, op->domain, body, op->vectorize);
+  }
+
+  void visit(const ForRange *op) {
+    Stmt body = rewrite(op->body);
+
+    pair<Var,Expr> neighbor = getNeighborVar(op);
+    if (neighbor.first.defined()) {
+      Var neighborVar = neighbor.first;
+      auto isNeighbor = [&](Expr expr) {
+        return isa<VarExpr>(expr) && to<VarExpr>(expr)->var == neighborVar;
+      };
+      vector<IndirectAccess> accesses =
+          getIndirectAccesses(op->body, isNeighbor);
+      if (accesses.size() > 0) {
+        // Prefetch the data of the neighbor `distance' neighbors ahead in the
+        // row
+        Expr ahead = Expr(op->var) + getPrefetchDistance(op->body, false);
+        body = Block::make(IfThenElse::make(Lt::make(ahead, op->end),
+            prefetch(accesses, Load::make(neighbor.second, ahead))), body);
+      }
+    }
+    stmt = (body == op->body)
+        ? op : ForRange::make(op->var, op->start, op->end, body, op->vectorize);
+  }
+};
+
+Func insertPrefetches(Func func) {
+  Stmt body = InsertPrefetches().rewrite(func.getBody());
+  return (body == func.getBody()) ? func : Func(func, body);
+}
+
+}}
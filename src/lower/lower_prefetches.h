@@ -0,0 +1,18 @@
+#ifndef SIMIT_LOWER_PREFETCHES_H
+#define SIMIT_LOWER_PREFETCHES_H
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Insert software prefetches for the indirect accesses of loops over edge
+/// sets, whose indices are read from the edge endpoints, and of loops over the
+/// neighbors of a sparse matrix row, whose indices are read from the column
+/// index array. Every iteration prefetches the data accessed by the iteration
+/// kPrefetchDistance iterations ahead, or by an iteration chosen from the
+/// amount of work in the loop body if the distance is 0.
+Func insertPrefetches(Func func);
+
+}}
+#endif
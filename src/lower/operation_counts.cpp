@@ -0,0 +1,300 @@
+#include "operation_counts.h"
+
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "intrinsics.h"
+#include "ir_rewriter.h"
+#include "ir_visitor.h"
+#include "util/collections.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+double OperationCounts::getIntensity() const {
+  return (getBytes() == 0) ? 0.0 : (double)flops / getBytes();
+}
+
+std::ostream& operator<<(std::ostream& os, const OperationCounts& counts) {
+  stringstream intensity;
+  intensity << setprecision(3) << counts.getIntensity();
+  os << "flops: " << counts.flops << ", loads: " << counts.bytesLoaded
+     << " B, stores: " << counts.bytesStored << " B, intensity: "
+     << intensity.str() << " flop/B";
+  if (!counts.exact) {
+    os << " (loops of unknown length counted once)";
+  }
+  return os;
+}
+
+static bool isFloatType(const Type& type) {
+  return type.isTensor() &&
+         (type.toTensor()->getComponentType().isFloat() ||
+          type.toTensor()->getComponentType().isComplex());
+}
+
+static int64_t getBytes(const Type& type) {
+  return type.isTensor() ? type.toTensor()->getComponentType().bytes() : 0;
+}
+
+/// Counts the operations of a statement as a sum of terms, each the counts of
+/// the operations in a loop nest multiplied by the trip counts of the nest.
+/// Trip counts are constants, or, if `symbolic', expressions of set sizes and
+/// of variables that are not defined in the statement.
+class CountOperations : public IRVisitor {
+public:
+  CountOperations(Stmt stmt, bool symbolic) : symbolic(symbolic) {
+    match(stmt, function<void(const VarDecl*)>([&](const VarDecl* op) {
+      definedVars.insert(op->var);
+    }), function<void(const AssignStmt*)>([&](const AssignStmt* op) {
+      definedVars.insert(op->var);
+    }));
+    stmt.accept(this);
+  }
+
+  /// The terms of the count, keyed by their multiplier.
+  map<string,pair<Expr,OperationCounts>> terms;
+  bool exact = true;
+
+private:
+  bool symbolic;
+  set<Var> definedVars;
+
+  /// The product of the trip counts of the enclosing loops, or undefined if
+  /// there are none.
+  Expr multiplier;
+
+  OperationCounts& getTerm() {
+    string key = multiplier.defined() ? util::toString(multiplier) : "";
+    if (!util::contains(terms, key)) {
+      terms[key] = {multiplier, OperationCounts()};
+    }
+    return terms.at(key).second;
+  }
+
+  bool isInvariant(Expr expr) {
+    bool invariant = true;
+    match(expr,
+      function<void(const VarExpr*)>([&](const VarExpr* op) {
+        invariant &= !util::contains(definedVars, op->var);
+      }),
+      function<void(const Load*)>([&](const Load* op) {
+        invariant = false;
+      })
+    );
+    return invariant;
+  }
+
+  /// Count the body of a loop that runs `trips' times, or an unknown number
+  /// of times if `trips' is undefined.
+  void countLoop(Expr trips, Stmt body) {
+    if (!trips.defined()) {
+      exact = false;
+      body.accept(this);
+      return;
+    }
+    Expr enclosing = multiplier;
+    if (!multiplier.defined()) {
+      multiplier = trips;
+    }
+    else if (isa<Literal>(multiplier) && isa<Literal>(trips)) {
+      multiplier = to<Literal>(multiplier)->getIntVal(0) *
+                   to<Literal>(trips)->getIntVal(0);
+    }
+    else {
+      multiplier = Mul::make(multiplier, trips);
+    }
+    body.accept(this);
+    multiplier = enclosing;
+  }
+
+  using IRVisitor::visit;
+
+  void visit(const Add *op) {countFlop(op); IRVisitor::visit(op);}
+  void visit(const Sub *op) {countFlop(op); IRVisitor::visit(op);}
+  void visit(const Mul *op) {countFlop(op); IRVisitor::visit(op);}
+  void visit(const Div *op) {countFlop(op); IRVisitor::visit(op);}
+  void visit(const Neg *op) {countFlop(op); IRVisitor::visit(op);}
+
+  void countFlop(const ExprNode *op) {
+    if (isFloatType(op->type)) {
+      getTerm().flops += 1;
+    }
+  }
+
+  void visit(const Load *op) {
+    getTerm().bytesLoaded += getBytes(op->type);
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Store *op) {
+    int64_t bytes = getBytes(op->value.type());
+    getTerm().bytesStored += bytes;
+    if (op->cop != CompoundOperator::None) {
+      getTerm().bytesLoaded += bytes;
+      if (isFloatType(op->value.type())) {
+        getTerm().flops += 1;
+      }
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const AssignStmt *op) {
+    if (op->cop != CompoundOperator::None && isFloatType(op->value.type())) {
+      getTerm().flops += 1;
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const For *op) {
+    Expr trips;
+    if (op->domain.kind == ForDomain::IndexSet) {
+      const IndexSet& indexSet = op->domain.indexSet;
+      if (indexSet.getKind() == IndexSet::Range) {
+        trips = (int)indexSet.getSize();
+      }
+      else if (symbolic && indexSet.getKind() == IndexSet::Set) {
+        trips = Length::make(indexSet);
+      }
+    }
+    countLoop(trips, op->body);
+  }
+
+  void visit(const ForRange *op) {
+    Expr trips;
+    if (isa<Literal>(op->start) && isa<Literal>(op->end)) {
+      trips = to<Literal>(op->end)->getIntVal(0) -
+              to<Literal>(op->start)->getIntVal(0);
+    }
+    else if (symbolic && isInvariant(op->start) && isInvariant(op->end)) {
+      bool fromZero = isa<Literal>(op->start) &&
+                      to<Literal>(op->start)->getIntVal(0) == 0;
+      trips = fromZero ? op->end : Sub::make(op->end, op->start);
+    }
+    countLoop(trips, op->body);
+  }
+
+  void visit(const While *op) {
+    countLoop(Expr(), op->body);
+  }
+};
+
+OperationCounts countOperations(Stmt stmt) {
+  CountOperations countOperations(stmt, false);
+  OperationCounts counts;
+  for (auto& term : countOperations.terms) {
+    Expr multiplier = term.second.first;
+    int64_t trips = multiplier.defined()
+                    ? to<Literal>(multiplier)->getIntVal(0) : 1;
+    counts.flops += trips * term.second.second.flops;
+    counts.bytesLoaded += trips * term.second.second.bytesLoaded;
+    counts.bytesStored += trips * term.second.second.bytesStored;
+  }
+  counts.exact = countOperations.exact;
+  return counts;
+}
+
+class AnnotateOperationCounts : public IRRewriterCallGraph {
+  using IRRewriter::visit;
+
+  template <typename T>
+  void annotate(const T *op) {
+    OperationCounts counts = countOperations(op->body);
+    IRRewriter::visit(op);
+    stmt = Comment::make(util::toString(counts) + " per iteration", stmt);
+  }
+
+  void visit(const For *op) {annotate(op);}
+  void visit(const ForRange *op) {annotate(op);}
+  void visit(const While *op) {annotate(op);}
+};
+
+Func annotateOperationCounts(Func func) {
+  return AnnotateOperationCounts().rewrite(func);
+}
+
+/// Appends the statements of a block, and of the blocks in it, to `stmts'.
+static void flattenBlock(Stmt stmt, vector<Stmt>* stmts) {
+  if (isa<Block>(stmt)) {
+    flattenBlock(to<Block>(stmt)->first, stmts);
+    if (to<Block>(stmt)->rest.defined()) {
+      flattenBlock(to<Block>(stmt)->rest, stmts);
+    }
+  }
+  else {
+    stmts->push_back(stmt);
+  }
+}
+
+/// The site of a timerStart or timerStop call, or -1.
+static int getTimerSite(Stmt stmt, const Func& timer) {
+  if (!isa<CallStmt>(stmt) || to<CallStmt>(stmt)->callee != timer) {
+    return -1;
+  }
+  return to<Literal>(to<CallStmt>(stmt)->actuals[0])->getIntVal(0);
+}
+
+class CountTimedOperations : public IRRewriter {
+  using IRRewriter::visit;
+
+  void visit(const Block *op) {
+    vector<Stmt> stmts;
+    flattenBlock(op, &stmts);
+    for (auto& s : stmts) {
+      s = rewrite(s);
+    }
+
+    for (size_t i = 0; i < stmts.size(); ++i) {
+      int site = getTimerSite(stmts[i], intrinsics::timerStart());
+      if (site == -1) {
+        continue;
+      }
+      size_t stop = i+1;
+      while (stop < stmts.size() &&
+             getTimerSite(stmts[stop], intrinsics::timerStop()) != site) {
+        ++stop;
+      }
+      if (stop == stmts.size()) {
+        continue;
+      }
+
+      vector<Stmt> timed(stmts.begin()+i+1, stmts.begin()+stop);
+      if (timed.size() == 0) {
+        continue;
+      }
+      CountOperations count(Block::make(timed), true);
+      Expr flops = 0;
+      Expr bytes = 0;
+      for (auto& term : count.terms) {
+        Expr multiplier = term.second.first;
+        const OperationCounts& counts = term.second.second;
+        auto add = [&](Expr sum, int64_t n) -> Expr {
+          if (n == 0) {
+            return sum;
+          }
+          Expr product = multiplier.defined()
+                         ? Mul::make(multiplier, Expr((int)n)) : Expr((int)n);
+          return (isa<Literal>(sum) && to<Literal>(sum)->getIntVal(0) == 0)
+                 ? product : Add::make(sum, product);
+        };
+        flops = add(flops, counts.flops);
+        bytes = add(bytes, counts.getBytes());
+      }
+      stmts[stop] = CallStmt::make({}, intrinsics::timerStop(),
+                                   {site, flops, bytes});
+    }
+    stmt = Block::make(stmts);
+  }
+};
+
+Func countTimedOperations(Func func) {
+  Stmt body = CountTimedOperations().rewrite(func.getBody());
+  return (body == func.getBody()) ? func : Func(func, body);
+}
+
+}}
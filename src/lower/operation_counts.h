@@ -0,0 +1,47 @@
+#ifndef SIMIT_OPERATION_COUNTS_H
+#define SIMIT_OPERATION_COUNTS_H
+
+#include <cstdint>
+#include <ostream>
+
+#include "ir.h"
+
+namespace simit {
+namespace ir {
+
+/// Estimated work of lowered code: floating point operations, and bytes read
+/// and written by loads and stores. Caches are not modeled, so the bytes are
+/// those that the memory instructions access.
+struct OperationCounts {
+  int64_t flops = 0;
+  int64_t bytesLoaded = 0;
+  int64_t bytesStored = 0;
+
+  /// False if the code has loops whose trip counts are not known, that are
+  /// counted as one iteration.
+  bool exact = true;
+
+  int64_t getBytes() const {return bytesLoaded + bytesStored;}
+
+  /// Floating point operations per byte, or 0 if no bytes are accessed.
+  double getIntensity() const;
+};
+
+std::ostream& operator<<(std::ostream& os, const OperationCounts& counts);
+
+/// Count the operations of one execution of a lowered statement. Loops with
+/// constant trip counts are counted for each iteration.
+OperationCounts countOperations(Stmt stmt);
+
+/// Annotate every loop in the lowered call graph of the function with a
+/// comment that gives the operation counts of one iteration.
+Func annotateOperationCounts(Func func);
+
+/// Pass the floating point operations and the bytes that one run of each
+/// timed site executes to its timerStop, as expressions of the sizes of the
+/// sets that the site loops over, so that profiles can place the sites on a
+/// roofline. Must run after tensor accesses are lowered.
+Func countTimedOperations(Func func);
+
+}}
+#endif
@@ -0,0 +1,78 @@
+#include "memory_report.h"
+
+#include <iomanip>
+
+#include "error.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+
+const char* getMemoryCategoryName(MemoryCategory category) {
+  switch (category) {
+    case SetMemory:       return "sets";
+    case IndexMemory:     return "indices";
+    case TemporaryMemory: return "temporaries";
+    case BufferMemory:    return "buffers";
+    case SolverMemory:    return "solvers";
+    case CodeMemory:      return "code";
+  }
+  unreachable;
+  return "";
+}
+
+// class MemoryReport
+size_t MemoryReport::getTotal() const {
+  size_t total = 0;
+  for (auto& record : records) {
+    total += record.bytes;
+  }
+  return total;
+}
+
+size_t MemoryReport::getTotal(MemoryCategory category) const {
+  size_t total = 0;
+  for (auto& record : records) {
+    if (record.category == category) {
+      total += record.bytes;
+    }
+  }
+  return total;
+}
+
+void MemoryReport::writeJSON(std::ostream& os) const {
+  os << "{\"total\": " << getTotal() << ", \"peak\": " << getPeak()
+     << ", \"records\": [";
+  for (size_t i = 0; i < records.size(); ++i) {
+    const MemoryRecord& record = records[i];
+    os << (i == 0 ? "" : ",") << endl
+       << "  {\"category\": "
+       << util::jsonString(getMemoryCategoryName(record.category))
+       << ", \"name\": " << util::jsonString(record.name)
+       << ", \"bytes\": " << record.bytes << "}";
+  }
+  os << endl << "]}" << endl;
+}
+
+std::ostream& operator<<(std::ostream& os, const MemoryReport& report) {
+  os << setw(14) << "bytes" << "  " << "name" << endl;
+  for (int category = 0; category < kNumMemoryCategories; ++category) {
+    size_t total = report.getTotal(MemoryCategory(category));
+    if (total == 0) {
+      continue;
+    }
+    os << setw(14) << total << "  "
+       << getMemoryCategoryName(MemoryCategory(category)) << endl;
+    for (auto& record : report.getRecords()) {
+      if (record.category == category && record.bytes > 0) {
+        os << setw(14) << record.bytes << "    " << record.name << endl;
+      }
+    }
+  }
+  os << setw(14) << report.getTotal() << "  total" << endl;
+  os << setw(14) << report.getPeak() << "  peak buffers" << endl;
+  return os;
+}
+
+}
@@ -0,0 +1,65 @@
+#ifndef SIMIT_MEMORY_REPORT_H
+#define SIMIT_MEMORY_REPORT_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simit {
+
+/// The kinds of memory that a compiled function holds.
+enum MemoryCategory {
+  SetMemory,        ///< Fields and endpoints of bound sets
+  IndexMemory,      ///< Neighbor indices and path indices
+  TemporaryMemory,  ///< Temporaries allocated when the function is initialized
+  BufferMemory,     ///< Buffers allocated by the generated code
+  SolverMemory,     ///< Cached solver factorizations
+  CodeMemory        ///< Code and data sections of the generated code
+};
+static const int kNumMemoryCategories = 6;
+
+/// The name of the category in memory reports, e.g. "temporaries".
+const char* getMemoryCategoryName(MemoryCategory category);
+
+/// The bytes held by one data structure.
+struct MemoryRecord {
+  MemoryCategory category;
+  std::string name;
+  size_t bytes;
+};
+
+/// A snapshot of the memory held by a function, retrieved with
+/// Function::getMemoryReport.
+class MemoryReport {
+public:
+  MemoryReport() : peak(0) {}
+  MemoryReport(const std::vector<MemoryRecord>& records, size_t peak)
+      : records(records), peak(peak) {}
+
+  const std::vector<MemoryRecord>& getRecords() const {return records;}
+
+  /// The bytes of all the records.
+  size_t getTotal() const;
+
+  /// The bytes of the records of the category.
+  size_t getTotal(MemoryCategory category) const;
+
+  /// The most bytes that buffers allocated by the generated code have held at
+  /// once since the function was compiled.
+  size_t getPeak() const {return peak;}
+
+  /// Write the records to the stream as a JSON object with the total and
+  /// peak, and an array of records.
+  void writeJSON(std::ostream& os) const;
+
+private:
+  std::vector<MemoryRecord> records;
+  size_t peak;
+};
+
+/// Write the report as a table, with the records grouped by category.
+std::ostream& operator<<(std::ostream& os, const MemoryReport& report);
+
+}
+#endif
@@ -0,0 +1,75 @@
+#include "memory_tracker.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+namespace internal {
+
+// class MemoryTracker
+int MemoryTracker::addAllocator() {
+  lock_guard<std::mutex> lock(mutex);
+  allocators.push_back({0, 0});
+  return allocators.size()-1;
+}
+
+void* MemoryTracker::allocate(int allocator, size_t bytes) {
+  void* buffer = malloc(bytes);
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  lock_guard<std::mutex> lock(mutex);
+  iassert(allocator >= 0 && allocator < (int)allocators.size());
+  buffers[buffer] = {allocator, bytes};
+  Allocator& stats = allocators[allocator];
+  stats.allocated += bytes;
+  stats.peak = max(stats.peak, stats.allocated);
+  return buffer;
+}
+
+void MemoryTracker::release(void* buffer) {
+  if (buffer != nullptr) {
+    lock_guard<std::mutex> lock(mutex);
+    auto it = buffers.find(buffer);
+    if (it != buffers.end()) {
+      allocators[it->second.first].allocated -= it->second.second;
+      buffers.erase(it);
+    }
+  }
+  free(buffer);
+}
+
+size_t MemoryTracker::getAllocated(int allocator) {
+  lock_guard<std::mutex> lock(mutex);
+  return allocators[allocator].allocated;
+}
+
+size_t MemoryTracker::getPeak(int allocator) {
+  lock_guard<std::mutex> lock(mutex);
+  return allocators[allocator].peak;
+}
+
+void MemoryTracker::addFactorization(const void* solver, size_t bytes) {
+  lock_guard<std::mutex> lock(mutex);
+  factorizations[solver] = bytes;
+}
+
+void MemoryTracker::removeFactorization(const void* solver) {
+  lock_guard<std::mutex> lock(mutex);
+  factorizations.erase(solver);
+}
+
+std::vector<size_t> MemoryTracker::getFactorizations() {
+  lock_guard<std::mutex> lock(mutex);
+  vector<size_t> bytes;
+  for (auto& factorization : factorizations) {
+    bytes.push_back(factorization.second);
+  }
+  return bytes;
+}
+
+}}
@@ -0,0 +1,67 @@
+#ifndef SIMIT_MEMORY_TRACKER_H
+#define SIMIT_MEMORY_TRACKER_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace simit {
+namespace internal {
+
+/// Tracks the buffers that generated code allocates with the malloc and free
+/// intrinsics, and the solver factorizations that the runtime caches. Each
+/// compiled function allocates from its own allocator, whose current and peak
+/// bytes the tracker keeps.
+class MemoryTracker {
+public:
+  static MemoryTracker& getInstance() {
+    static MemoryTracker instance;
+    return instance;
+  }
+
+  /// Add an allocator and return its id.
+  int addAllocator();
+
+  /// Allocate a buffer from the allocator.
+  void* allocate(int allocator, size_t bytes);
+
+  /// Free a buffer. Buffers that were not allocated by the tracker are freed
+  /// without being tracked.
+  void release(void* buffer);
+
+  /// The bytes of the allocator's buffers that have not been freed.
+  size_t getAllocated(int allocator);
+
+  /// The most bytes that the allocator's buffers have held at once.
+  size_t getPeak(int allocator);
+
+  /// Record a factorization cached by a solver, or that it was freed.
+  void addFactorization(const void* solver, size_t bytes);
+  void removeFactorization(const void* solver);
+
+  /// The bytes of each cached factorization.
+  std::vector<size_t> getFactorizations();
+
+private:
+  struct Allocator {
+    size_t allocated;
+    size_t peak;
+  };
+
+  std::mutex mutex;
+  std::vector<Allocator> allocators;
+
+  /// The allocator and bytes of each buffer that has not been freed.
+  std::unordered_map<void*,std::pair<int,size_t>> buffers;
+
+  std::map<const void*,size_t> factorizations;
+
+  MemoryTracker() {}
+  MemoryTracker(const MemoryTracker&) = delete;
+  MemoryTracker& operator=(const MemoryTracker&) = delete;
+};
+
+}}
+#endif
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <string>
 #include <map>
+#include <random>
 #include "mesh.h"
 
 using namespace simit;
@@ -605,3 +606,79 @@ void MeshVol::makeTetSurf()
   }
 }
 
+namespace simit {
+
+MeshVol createTetBox(unsigned nX, unsigned nY, unsigned nZ,
+                     double jitter, unsigned seed)
+{
+  MeshVol mesh;
+  double h = 1.0 / max(nX, max(nY, nZ));
+  mt19937 rng(seed);
+  uniform_real_distribution<double> offset(-jitter*h, jitter*h);
+  auto vertex = [=](unsigned x, unsigned y, unsigned z) {
+    return int((z*(nY+1) + y)*(nX+1) + x);
+  };
+  for(unsigned z = 0; z<=nZ; z++){
+    for(unsigned y = 0; y<=nY; y++){
+      for(unsigned x = 0; x<=nX; x++){
+        Vector3d pos = {{x*h, y*h, z*h}};
+        bool interior = x>0 && x<nX && y>0 && y<nY && z>0 && z<nZ;
+        if(interior && jitter>0){
+          for(int ii = 0; ii<3; ii++){
+            pos[ii] += offset(rng);
+          }
+        }
+        mesh.v.push_back(pos);
+      }
+    }
+  }
+
+  //each tet walks from the cube's first corner to its opposite corner along
+  //one permutation of the axes
+  const int axes[6][3] = {
+    {0,1,2},{0,2,1},{1,0,2},{1,2,0},{2,0,1},{2,1,0}};
+  for(unsigned z = 0; z<nZ; z++){
+    for(unsigned y = 0; y<nY; y++){
+      for(unsigned x = 0; x<nX; x++){
+        for(int tt = 0; tt<6; tt++){
+          unsigned c[3] = {x, y, z};
+          vector<int> tet(1, vertex(c[0], c[1], c[2]));
+          for(int step = 0; step<3; step++){
+            c[axes[tt][step]]++;
+            tet.push_back(vertex(c[0], c[1], c[2]));
+          }
+          //orient the tet
+          double M[3][3];
+          for(int ii = 0; ii<3; ii++){
+            for(int jj = 0; jj<3; jj++){
+              M[jj][ii] = mesh.v[tet[ii]][jj] - mesh.v[tet[3]][jj];
+            }
+          }
+          double det = M[0][0]*(M[1][1]*M[2][2] - M[1][2]*M[2][1])
+                     - M[0][1]*(M[1][0]*M[2][2] - M[1][2]*M[2][0])
+                     + M[0][2]*(M[1][0]*M[2][1] - M[1][1]*M[2][0]);
+          if(det>0){
+            swap(tet[0], tet[1]);
+          }
+          mesh.e.push_back(tet);
+        }
+      }
+    }
+  }
+
+  //collect the unique edges of the tets
+  vector<array<int,2> > edges;
+  for(auto & tet : mesh.e){
+    for(int ii = 0; ii<4; ii++){
+      for(int jj = ii+1; jj<4; jj++){
+        edges.push_back({{min(tet[ii], tet[jj]), max(tet[ii], tet[jj])}});
+      }
+    }
+  }
+  sort(edges.begin(), edges.end());
+  edges.erase(unique(edges.begin(), edges.end()), edges.end());
+  mesh.edges = edges;
+  return mesh;
+}
+
+}
@@ -93,6 +93,16 @@ struct MeshVol{
   void makeTetSurf();
 };
 
+///Generate a tetrahedral mesh of a box of nX x nY x nZ cubes, for benchmarks
+///that scale the mesh size. The box spans [0,1] along its longest side, each
+///cube is split into six tets that share its main diagonal, and the tet
+///edges are stored in `edges'. Interior vertices are moved by a random offset
+///of up to `jitter' times the cube side along each axis; jitters below 0.1 do
+///not invert tets. Tets are ordered so that (x0-x3, x1-x3, x2-x3) has a
+///negative determinant, as the loaded meshes are.
+MeshVol createTetBox(unsigned nX, unsigned nY, unsigned nZ,
+                     double jitter=0.0, unsigned seed=0);
+
 }
 
 #endif
@@ -0,0 +1,532 @@
+#include "multigrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+MultigridOptions kMultigridOptions;
+
+// Coarsest levels up to this size are factorized densely
+static const int kMaxDirectSize = 1024;
+
+namespace {
+
+template <typename Float>
+struct Matrix {
+  vector<int> rowptr;
+  vector<int> colidx;
+  vector<Float> vals;
+
+  int rows() const {return (int)rowptr.size() - 1;}
+};
+
+template <typename Float>
+struct Level {
+  vector<int> dims;
+  int size;
+
+  Matrix<Float> A;
+  vector<Float> diag;
+  vector<char> color;  // Parity of the sum of the lattice coordinates
+
+  // Interpolation from the next coarser level, and its transpose
+  Matrix<Float> P;
+  Matrix<Float> R;
+
+  vector<Float> x;
+  vector<Float> b;
+  vector<Float> r;
+};
+
+}
+
+static vector<int> latticeCoords(int index, const vector<int>& dims) {
+  vector<int> coords(dims.size());
+  for (size_t d = 0; d < dims.size(); ++d) {
+    coords[d] = index % dims[d];
+    index /= dims[d];
+  }
+  return coords;
+}
+
+static int latticeIndex(const vector<int>& coords, const vector<int>& dims) {
+  int index = 0;
+  for (int d = (int)dims.size()-1; d >= 0; --d) {
+    index = index * dims[d] + coords[d];
+  }
+  return index;
+}
+
+template <typename Float>
+static Matrix<Float> transpose(const Matrix<Float>& A, int cols) {
+  Matrix<Float> T;
+  T.rowptr.assign(cols+1, 0);
+  for (int j : A.colidx) {
+    T.rowptr[j+1]++;
+  }
+  for (int j = 0; j < cols; ++j) {
+    T.rowptr[j+1] += T.rowptr[j];
+  }
+  T.colidx.resize(A.colidx.size());
+  T.vals.resize(A.vals.size());
+  vector<int> next(T.rowptr.begin(), T.rowptr.end()-1);
+  for (int i = 0; i < A.rows(); ++i) {
+    for (int ij = A.rowptr[i]; ij < A.rowptr[i+1]; ++ij) {
+      int pos = next[A.colidx[ij]]++;
+      T.colidx[pos] = i;
+      T.vals[pos] = A.vals[ij];
+    }
+  }
+  return T;
+}
+
+template <typename Float>
+static void residual(const Level<Float>& level, vector<Float>& r) {
+  const Matrix<Float>& A = level.A;
+  for (int i = 0; i < level.size; ++i) {
+    Float sum = level.b[i];
+    for (int ij = A.rowptr[i]; ij < A.rowptr[i+1]; ++ij) {
+      sum -= A.vals[ij] * level.x[A.colidx[ij]];
+    }
+    r[i] = sum;
+  }
+}
+
+template <typename Float>
+static double norm(const vector<Float>& v) {
+  double sum = 0.0;
+  for (Float value : v) {
+    sum += (double)value * value;
+  }
+  return sqrt(sum);
+}
+
+template <typename Float>
+static void smooth(Level<Float>& level, int sweeps, bool reverse,
+                   const MultigridOptions& options) {
+  const Matrix<Float>& A = level.A;
+  switch (options.smoother) {
+    case MultigridSmoother::Jacobi: {
+      const Float weight = options.jacobiWeight;
+      for (int sweep = 0; sweep < sweeps; ++sweep) {
+        residual(level, level.r);
+        for (int i = 0; i < level.size; ++i) {
+          level.x[i] += weight * level.r[i] / level.diag[i];
+        }
+      }
+      break;
+    }
+    case MultigridSmoother::RedBlackGaussSeidel: {
+      // Post-smoothing sweeps the colors in reverse, keeping V-cycles
+      // symmetric
+      for (int sweep = 0; sweep < sweeps; ++sweep) {
+        for (int c = 0; c < 2; ++c) {
+          const char color = reverse ? 1-c : c;
+          for (int i = 0; i < level.size; ++i) {
+            if (level.color[i] != color) {
+              continue;
+            }
+            Float sum = level.b[i];
+            for (int ij = A.rowptr[i]; ij < A.rowptr[i+1]; ++ij) {
+              if (A.colidx[ij] != i) {
+                sum -= A.vals[ij] * level.x[A.colidx[ij]];
+              }
+            }
+            level.x[i] = sum / level.diag[i];
+          }
+        }
+      }
+      break;
+    }
+  }
+}
+
+// Returns the interpolation from the coarse lattice to the fine lattice, that
+// halves the even dimensions of the fine lattice. Coarse point I lies on fine
+// point 2I, and fine points between two coarse points take their average.
+template <typename Float>
+static Matrix<Float> interpolation(const vector<int>& fineDims,
+                                   const vector<int>& coarseDims) {
+  const size_t ndims = fineDims.size();
+  int fineSize = 1;
+  for (int dim : fineDims) {
+    fineSize *= dim;
+  }
+
+  Matrix<Float> P;
+  P.rowptr.push_back(0);
+  for (int f = 0; f < fineSize; ++f) {
+    const vector<int> fine = latticeCoords(f, fineDims);
+
+    // The coarse parents and weights along each dimension
+    vector<vector<pair<int,Float>>> parents(ndims);
+    for (size_t d = 0; d < ndims; ++d) {
+      if (coarseDims[d] == fineDims[d]) {
+        parents[d].push_back({fine[d], 1.0});
+      }
+      else if (fine[d] % 2 == 0) {
+        parents[d].push_back({fine[d]/2, 1.0});
+      }
+      else {
+        parents[d].push_back({fine[d]/2, 0.5});
+        parents[d].push_back({(fine[d]/2 + 1) % coarseDims[d], 0.5});
+      }
+    }
+
+    // Tensor product of the parents of each dimension
+    vector<size_t> choice(ndims, 0);
+    while (true) {
+      vector<int> coarse(ndims);
+      Float weight = 1.0;
+      for (size_t d = 0; d < ndims; ++d) {
+        coarse[d] = parents[d][choice[d]].first;
+        weight *= parents[d][choice[d]].second;
+      }
+      P.colidx.push_back(latticeIndex(coarse, coarseDims));
+      P.vals.push_back(weight);
+
+      size_t d = 0;
+      while (d < ndims && ++choice[d] == parents[d].size()) {
+        choice[d++] = 0;
+      }
+      if (d == ndims) {
+        break;
+      }
+    }
+    P.rowptr.push_back(P.colidx.size());
+  }
+  return P;
+}
+
+// Returns the Galerkin coarse operator RAP
+template <typename Float>
+static Matrix<Float> galerkin(const Matrix<Float>& R, const Matrix<Float>& A,
+                              const Matrix<Float>& P) {
+  const int coarseSize = R.rows();
+  Matrix<Float> Ac;
+  Ac.rowptr.push_back(0);
+
+  // Dense accumulator of the current row
+  vector<Float> row(coarseSize, 0.0);
+  vector<int> marker(coarseSize, -1);
+  vector<int> cols;
+  for (int I = 0; I < coarseSize; ++I) {
+    cols.clear();
+    for (int Ii = R.rowptr[I]; Ii < R.rowptr[I+1]; ++Ii) {
+      const int f = R.colidx[Ii];
+      for (int fg = A.rowptr[f]; fg < A.rowptr[f+1]; ++fg) {
+        const int g = A.colidx[fg];
+        const Float ra = R.vals[Ii] * A.vals[fg];
+        for (int gJ = P.rowptr[g]; gJ < P.rowptr[g+1]; ++gJ) {
+          const int J = P.colidx[gJ];
+          if (marker[J] != I) {
+            marker[J] = I;
+            row[J] = 0.0;
+            cols.push_back(J);
+          }
+          row[J] += ra * P.vals[gJ];
+        }
+      }
+    }
+    sort(cols.begin(), cols.end());
+    for (int J : cols) {
+      Ac.colidx.push_back(J);
+      Ac.vals.push_back(row[J]);
+    }
+    Ac.rowptr.push_back(Ac.colidx.size());
+  }
+  return Ac;
+}
+
+template <typename Float>
+static void initLevel(Level<Float>& level) {
+  const Matrix<Float>& A = level.A;
+  level.diag.assign(level.size, 0.0);
+  level.color.resize(level.size);
+  for (int i = 0; i < level.size; ++i) {
+    for (int ij = A.rowptr[i]; ij < A.rowptr[i+1]; ++ij) {
+      if (A.colidx[ij] == i) {
+        level.diag[i] += A.vals[ij];
+      }
+    }
+    uassert(level.diag[i] != 0.0)
+        << "mgsolve requires a matrix with a nonzero diagonal";
+
+    int sum = 0;
+    for (int coord : latticeCoords(i, level.dims)) {
+      sum += coord;
+    }
+    level.color[i] = sum % 2;
+  }
+  level.x.assign(level.size, 0.0);
+  level.b.assign(level.size, 0.0);
+  level.r.assign(level.size, 0.0);
+}
+
+namespace {
+
+template <typename Float>
+class Multigrid {
+public:
+  Multigrid(int ndims, const int* dims, Matrix<Float> A,
+            const MultigridOptions& options) : options(options) {
+    uassert(ndims > 0) << "mgsolve requires a lattice";
+    uassert(options.maxCycles > 0 && options.coarsestSize > 0 &&
+            options.preSmoothingSteps >= 0 && options.postSmoothingSteps >= 0)
+        << "Invalid multigrid options";
+
+    Level<Float> fine;
+    fine.dims.assign(dims, dims+ndims);
+    fine.size = 1;
+    for (int dim : fine.dims) {
+      fine.size *= dim;
+    }
+    uassert(A.rows() == fine.size)
+        << "mgsolve matrix has " << A.rows() << " rows, but the lattice has "
+        << fine.size << " points";
+    fine.A = std::move(A);
+    initLevel(fine);
+    levels.push_back(std::move(fine));
+
+    // Halve the even dimensions until the lattice is small enough
+    while (levels.back().size > options.coarsestSize) {
+      Level<Float>& level = levels.back();
+      vector<int> coarseDims = level.dims;
+      int coarseSize = 1;
+      for (int& dim : coarseDims) {
+        if (dim % 2 == 0 && dim >= 4) {
+          dim /= 2;
+        }
+        coarseSize *= dim;
+      }
+      if (coarseSize == level.size) {
+        break;
+      }
+
+      level.P = interpolation<Float>(level.dims, coarseDims);
+      level.R = transpose(level.P, coarseSize);
+
+      Level<Float> coarse;
+      coarse.dims = coarseDims;
+      coarse.size = coarseSize;
+      coarse.A = galerkin(level.R, level.A, level.P);
+      initLevel(coarse);
+      levels.push_back(std::move(coarse));
+    }
+
+    factorize(levels.back());
+  }
+
+  int solve(const Float* b, Float* x) {
+    Level<Float>& fine = levels.front();
+    copy(b, b+fine.size, fine.b.begin());
+    fill(fine.x.begin(), fine.x.end(), 0.0);
+
+    const double bnorm = norm(fine.b);
+    int result = -1;
+    if (bnorm == 0.0) {
+      result = 0;
+    }
+    for (int cycle = 1; cycle <= options.maxCycles && result < 0; ++cycle) {
+      vcycle(0);
+      residual(fine, fine.r);
+      if (norm(fine.r) <= options.tolerance * bnorm) {
+        result = cycle;
+      }
+    }
+    copy(fine.x.begin(), fine.x.end(), x);
+    return result;
+  }
+
+private:
+  MultigridOptions options;
+  vector<Level<Float>> levels;
+
+  // Dense LU factors of the coarsest level, with partial pivoting
+  vector<double> lu;
+  vector<int> pivots;
+
+  void factorize(const Level<Float>& level) {
+    const int n = level.size;
+    if (n > kMaxDirectSize) {
+      return;
+    }
+    lu.assign((size_t)n*n, 0.0);
+    for (int i = 0; i < n; ++i) {
+      for (int ij = level.A.rowptr[i]; ij < level.A.rowptr[i+1]; ++ij) {
+        lu[(size_t)i*n + level.A.colidx[ij]] += level.A.vals[ij];
+      }
+    }
+    double scale = 0.0;
+    for (double value : lu) {
+      scale = max(scale, fabs(value));
+    }
+
+    pivots.resize(n);
+    for (int k = 0; k < n; ++k) {
+      int pivot = k;
+      for (int i = k+1; i < n; ++i) {
+        if (fabs(lu[(size_t)i*n+k]) > fabs(lu[(size_t)pivot*n+k])) {
+          pivot = i;
+        }
+      }
+      // Singular (e.g. periodic Poisson) coarse operators are smoothed instead
+      if (fabs(lu[(size_t)pivot*n+k]) <= 1e-12 * scale * n) {
+        lu.clear();
+        return;
+      }
+      pivots[k] = pivot;
+      for (int j = 0; j < n; ++j) {
+        swap(lu[(size_t)k*n+j], lu[(size_t)pivot*n+j]);
+      }
+      for (int i = k+1; i < n; ++i) {
+        double factor = lu[(size_t)i*n+k] /= lu[(size_t)k*n+k];
+        for (int j = k+1; j < n; ++j) {
+          lu[(size_t)i*n+j] -= factor * lu[(size_t)k*n+j];
+        }
+      }
+    }
+  }
+
+  void coarsestSolve(Level<Float>& level) {
+    if (lu.empty()) {
+      smooth(level, 20 * max(1, options.preSmoothingSteps +
+                                 options.postSmoothingSteps), false, options);
+      return;
+    }
+    const int n = level.size;
+    vector<double> y(level.b.begin(), level.b.end());
+    for (int k = 0; k < n; ++k) {
+      swap(y[k], y[pivots[k]]);
+      for (int i = k+1; i < n; ++i) {
+        y[i] -= lu[(size_t)i*n+k] * y[k];
+      }
+    }
+    for (int i = n-1; i >= 0; --i) {
+      for (int j = i+1; j < n; ++j) {
+        y[i] -= lu[(size_t)i*n+j] * y[j];
+      }
+      y[i] /= lu[(size_t)i*n+i];
+    }
+    copy(y.begin(), y.end(), level.x.begin());
+  }
+
+  void vcycle(size_t l) {
+    Level<Float>& level = levels[l];
+    if (l+1 == levels.size()) {
+      coarsestSolve(level);
+      return;
+    }
+    Level<Float>& coarse = levels[l+1];
+
+    smooth(level, options.preSmoothingSteps, false, options);
+
+    // Restrict the residual
+    residual(level, level.r);
+    for (int I = 0; I < coarse.size; ++I) {
+      Float sum = 0.0;
+      for (int Ii = level.R.rowptr[I]; Ii < level.R.rowptr[I+1]; ++Ii) {
+        sum += level.R.vals[Ii] * level.r[level.R.colidx[Ii]];
+      }
+      coarse.b[I] = sum;
+    }
+    fill(coarse.x.begin(), coarse.x.end(), 0.0);
+
+    vcycle(l+1);
+
+    // Interpolate the correction
+    for (int i = 0; i < level.size; ++i) {
+      Float sum = 0.0;
+      for (int iJ = level.P.rowptr[i]; iJ < level.P.rowptr[i+1]; ++iJ) {
+        sum += level.P.vals[iJ] * coarse.x[level.P.colidx[iJ]];
+      }
+      level.x[i] += sum;
+    }
+
+    smooth(level, options.postSmoothingSteps, true, options);
+  }
+};
+
+}
+
+template <typename Float>
+int multigridSolve(int ndims, const int* dims,
+                   const int* rowptr, const int* colidx, const Float* vals,
+                   const Float* b, Float* x,
+                   const MultigridOptions& options) {
+  int size = 1;
+  for (int d = 0; d < ndims; ++d) {
+    size *= dims[d];
+  }
+  Matrix<Float> A;
+  A.rowptr.assign(rowptr, rowptr+size+1);
+  A.colidx.assign(colidx, colidx+rowptr[size]);
+  A.vals.assign(vals, vals+rowptr[size]);
+  return Multigrid<Float>(ndims, dims, std::move(A), options).solve(b, x);
+}
+
+template <typename Float>
+int multigridSolve(int ndims, const int* dims,
+                   int numOffsets, const int* offsets, const Float* vals,
+                   const Float* b, Float* x,
+                   const MultigridOptions& options) {
+  const vector<int> latticeDims(dims, dims+ndims);
+  int size = 1;
+  for (int dim : latticeDims) {
+    size *= dim;
+  }
+
+  // Convert the stencil to CSR, merging offsets that wrap to the same column
+  Matrix<Float> A;
+  A.rowptr.push_back(0);
+  vector<pair<int,Float>> row;
+  for (int p = 0; p < size; ++p) {
+    const vector<int> coords = latticeCoords(p, latticeDims);
+    row.clear();
+    for (int k = 0; k < numOffsets; ++k) {
+      vector<int> neighbor(ndims);
+      for (int d = 0; d < ndims; ++d) {
+        neighbor[d] = ((coords[d] + offsets[k*ndims+d]) % dims[d] + dims[d])
+                      % dims[d];
+      }
+      row.push_back({latticeIndex(neighbor, latticeDims),
+                     vals[(size_t)p*numOffsets+k]});
+    }
+    sort(row.begin(), row.end(),
+         [](const pair<int,Float>& a, const pair<int,Float>& b) {
+           return a.first < b.first;
+         });
+    for (size_t k = 0; k < row.size(); ++k) {
+      if (k > 0 && row[k].first == row[k-1].first) {
+        A.vals.back() += row[k].second;
+      }
+      else {
+        A.colidx.push_back(row[k].first);
+        A.vals.push_back(row[k].second);
+      }
+    }
+    A.rowptr.push_back(A.colidx.size());
+  }
+  return Multigrid<Float>(ndims, dims, std::move(A), options).solve(b, x);
+}
+
+template int multigridSolve<float>(int, const int*, const int*, const int*,
+                                   const float*, const float*, float*,
+                                   const MultigridOptions&);
+template int multigridSolve<double>(int, const int*, const int*, const int*,
+                                    const double*, const double*, double*,
+                                    const MultigridOptions&);
+template int multigridSolve<float>(int, const int*, int, const int*,
+                                   const float*, const float*, float*,
+                                   const MultigridOptions&);
+template int multigridSolve<double>(int, const int*, int, const int*,
+                                    const double*, const double*, double*,
+                                    const MultigridOptions&);
+
+}
@@ -0,0 +1,62 @@
+#ifndef SIMIT_MULTIGRID_H
+#define SIMIT_MULTIGRID_H
+
+namespace simit {
+
+/// Smoothers of the geometric multigrid solver.
+enum class MultigridSmoother {
+  Jacobi,             ///< Weighted Jacobi
+  RedBlackGaussSeidel ///< Gauss-Seidel sweeping the even, then the odd points
+};
+
+/// Parameters of the geometric multigrid solver.
+struct MultigridOptions {
+  MultigridSmoother smoother = MultigridSmoother::RedBlackGaussSeidel;
+
+  /// Damping factor of the weighted Jacobi smoother.
+  double jacobiWeight = 2.0/3.0;
+
+  /// Smoother sweeps before and after each coarse grid correction.
+  int preSmoothingSteps = 2;
+  int postSmoothingSteps = 2;
+
+  /// V-cycles stop once the residual norm is below tolerance times the norm
+  /// of the right-hand side, or after maxCycles cycles.
+  double tolerance = 1e-8;
+  int maxCycles = 100;
+
+  /// Lattices are not coarsened below this many points. The coarsest level
+  /// is solved directly if it has at most 1024 points and is nonsingular, and
+  /// by repeated smoothing otherwise.
+  int coarsestSize = 64;
+};
+
+/// The multigrid options used by the mgsolve intrinsic (set by simit::init).
+extern MultigridOptions kMultigridOptions;
+
+/// Solves Ax=b with V-cycles of geometric multigrid, where A is a scalar CSR
+/// matrix over the points of a periodic lattice with `ndims` dimensions of
+/// sizes `dims`, innermost first (the point at (i0,i1,...) is row
+/// i0 + dims[0]*(i1 + dims[1]*(...))). The hierarchy halves every even
+/// lattice dimension, using multilinear interpolation and Galerkin coarse
+/// operators, so that the solve is O(n) for Poisson-like systems. `x` is
+/// overwritten, starting from zero. Returns the number of V-cycles, or -1 if
+/// the tolerance was not reached.
+template <typename Float>
+int multigridSolve(int ndims, const int* dims,
+                   const int* rowptr, const int* colidx, const Float* vals,
+                   const Float* b, Float* x,
+                   const MultigridOptions& options=kMultigridOptions);
+
+/// Solves Ax=b like multigridSolve, where A is stored as a stencil: the
+/// values of row p are vals[p*numOffsets .. (p+1)*numOffsets), and value k is
+/// in the column of the point at lattice offset offsets[k*ndims .. (k+1)*ndims)
+/// from p.
+template <typename Float>
+int multigridSolve(int ndims, const int* dims,
+                   int numOffsets, const int* offsets, const Float* vals,
+                   const Float* b, Float* x,
+                   const MultigridOptions& options=kMultigridOptions);
+
+}
+#endif
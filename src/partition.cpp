@@ -0,0 +1,479 @@
+#include "partition.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <random>
+
+#include "graph.h"
+#include "graph_indices.h"
+#include "reorder.h"
+#include "error.h"
+
+using namespace std;
+
+namespace simit {
+
+namespace {
+// A weighted undirected graph in CSR form
+struct Graph {
+  int numVertices = 0;
+  vector<int> start;
+  vector<int> nbrs;
+  vector<int> edgeWeights;
+  vector<int> vertexWeights;
+
+  int totalWeight() const {
+    int total = 0;
+    for (int w : vertexWeights) {
+      total += w;
+    }
+    return total;
+  }
+};
+}
+
+// Stop coarsening when the graph has this many vertices per partition
+static const int kCoarseVerticesPerPartition = 20;
+
+// Maximum number of refinement passes per level
+static const int kRefinementPasses = 8;
+
+// Collapse a heavy-edge matching of the graph. cmap maps each vertex of the
+// fine graph to its vertex in the coarse graph.
+static Graph coarsen(const Graph& graph, vector<int>& cmap, mt19937& rng) {
+  const int n = graph.numVertices;
+
+  vector<int> visitOrder(n);
+  for (int v = 0; v < n; ++v) {
+    visitOrder[v] = v;
+  }
+  shuffle(visitOrder.begin(), visitOrder.end(), rng);
+
+  vector<int> match(n, -1);
+  for (int v : visitOrder) {
+    if (match[v] != -1) continue;
+    int best = v;
+    int bestWeight = 0;
+    for (int j = graph.start[v]; j < graph.start[v+1]; ++j) {
+      int u = graph.nbrs[j];
+      if (match[u] == -1 && graph.edgeWeights[j] > bestWeight) {
+        best = u;
+        bestWeight = graph.edgeWeights[j];
+      }
+    }
+    match[v] = best;
+    match[best] = v;
+  }
+
+  cmap.assign(n, -1);
+  vector<int> members;
+  for (int v = 0; v < n; ++v) {
+    if (cmap[v] != -1) continue;
+    cmap[v] = cmap[match[v]] = members.size()/2;
+    members.push_back(v);
+    members.push_back(match[v]);
+  }
+
+  Graph coarse;
+  coarse.numVertices = members.size()/2;
+  coarse.start.push_back(0);
+  coarse.vertexWeights.resize(coarse.numVertices);
+  vector<int> position(coarse.numVertices, -1);
+  for (int c = 0; c < coarse.numVertices; ++c) {
+    int rowBegin = coarse.nbrs.size();
+    int v0 = members[2*c];
+    int v1 = members[2*c+1];
+    coarse.vertexWeights[c] = graph.vertexWeights[v0] +
+                              ((v1 != v0) ? graph.vertexWeights[v1] : 0);
+    for (int v : {v0, v1}) {
+      for (int j = graph.start[v]; j < graph.start[v+1]; ++j) {
+        int cu = cmap[graph.nbrs[j]];
+        if (cu == c) continue;
+        if (position[cu] < rowBegin) {
+          position[cu] = coarse.nbrs.size();
+          coarse.nbrs.push_back(cu);
+          coarse.edgeWeights.push_back(graph.edgeWeights[j]);
+        }
+        else {
+          coarse.edgeWeights[position[cu]] += graph.edgeWeights[j];
+        }
+      }
+      if (v1 == v0) break;
+    }
+    coarse.start.push_back(coarse.nbrs.size());
+  }
+  return coarse;
+}
+
+// Number of seeds tried when bisecting the coarsest graph
+static const int kBisectionSeeds = 4;
+
+// Breadth-first order of the vertices in the subset, restarting at unvisited
+// vertices if the subset is disconnected.
+static vector<int> bfsOrder(const Graph& graph, const vector<int>& vertices,
+                            int root, const vector<char>& inSubset) {
+  vector<int> order;
+  order.reserve(vertices.size());
+  vector<char> visited(graph.numVertices, false);
+  size_t next = 0;
+  while (order.size() < vertices.size()) {
+    if (visited[root]) {
+      while (visited[vertices[next]]) ++next;
+      root = vertices[next];
+    }
+    visited[root] = true;
+    order.push_back(root);
+    for (size_t head = order.size()-1; head < order.size(); ++head) {
+      int v = order[head];
+      for (int j = graph.start[v]; j < graph.start[v+1]; ++j) {
+        int u = graph.nbrs[j];
+        if (inSubset[u] && !visited[u]) {
+          visited[u] = true;
+          order.push_back(u);
+        }
+      }
+    }
+  }
+  return order;
+}
+
+// Grow a region of the subset from the seed until it reaches the target
+// weight, always adding the frontier vertex that reduces the cut the most.
+// Returns the weight of the edges cut between the region and the rest.
+static int64_t growRegion(const Graph& graph, const vector<int>& vertices,
+                          const vector<char>& inSubset, int seed,
+                          int64_t target, vector<char>& inRegion) {
+  inRegion.assign(graph.numVertices, false);
+  vector<int> gain(graph.numVertices, 0);
+  for (int v : vertices) {
+    for (int j = graph.start[v]; j < graph.start[v+1]; ++j) {
+      if (inSubset[graph.nbrs[j]]) {
+        gain[v] -= graph.edgeWeights[j];
+      }
+    }
+  }
+
+  priority_queue<pair<int,int>> frontier;
+  frontier.push({gain[seed], seed});
+  int64_t weight = 0;
+  size_t next = 0;
+  while (weight < target) {
+    int v = -1;
+    while (!frontier.empty()) {
+      pair<int,int> top = frontier.top();
+      frontier.pop();
+      if (!inRegion[top.second] && top.first == gain[top.second]) {
+        v = top.second;
+        break;
+      }
+    }
+    if (v == -1) {
+      // The region's component is exhausted
+      while (inRegion[vertices[next]]) ++next;
+      v = vertices[next];
+    }
+    inRegion[v] = true;
+    weight += graph.vertexWeights[v];
+    for (int j = graph.start[v]; j < graph.start[v+1]; ++j) {
+      int u = graph.nbrs[j];
+      if (inSubset[u] && !inRegion[u]) {
+        gain[u] += 2*graph.edgeWeights[j];
+        frontier.push({gain[u], u});
+      }
+    }
+  }
+
+  int64_t cut = 0;
+  for (int v : vertices) {
+    if (!inRegion[v]) continue;
+    for (int j = graph.start[v]; j < graph.start[v+1]; ++j) {
+      int u = graph.nbrs[j];
+      if (inSubset[u] && !inRegion[u]) {
+        cut += graph.edgeWeights[j];
+      }
+    }
+  }
+  return cut;
+}
+
+// Split the vertices into numPartitions parts by recursive bisection. Each
+// bisection grows a region from a few seeds, starting with a
+// pseudo-peripheral vertex, and keeps the one with the smallest cut.
+static void bisect(const Graph& graph, const vector<int>& vertices,
+                   int numPartitions, int firstPartition, vector<int>& parts) {
+  if (numPartitions == 1 || vertices.size() <= 1) {
+    for (int v : vertices) {
+      parts[v] = firstPartition;
+    }
+    return;
+  }
+
+  vector<char> inSubset(graph.numVertices, false);
+  int64_t totalWeight = 0;
+  for (int v : vertices) {
+    inSubset[v] = true;
+    totalWeight += graph.vertexWeights[v];
+  }
+  const int leftPartitions = numPartitions / 2;
+  const int64_t target = totalWeight * leftPartitions / numPartitions;
+
+  vector<int> seeds;
+  seeds.push_back(bfsOrder(graph, vertices, vertices[0], inSubset).back());
+  for (int i = 1; i < kBisectionSeeds; ++i) {
+    seeds.push_back(vertices[(vertices.size() * i) / kBisectionSeeds]);
+  }
+  vector<char> bestRegion;
+  int64_t bestCut = -1;
+  for (int seed : seeds) {
+    vector<char> region;
+    int64_t cut = growRegion(graph, vertices, inSubset, seed, target, region);
+    if (bestCut == -1 || cut < bestCut) {
+      bestCut = cut;
+      bestRegion.swap(region);
+    }
+  }
+
+  vector<int> left;
+  vector<int> right;
+  for (int v : vertices) {
+    (bestRegion[v] ? left : right).push_back(v);
+  }
+  bisect(graph, left, leftPartitions, firstPartition, parts);
+  bisect(graph, right, numPartitions-leftPartitions,
+         firstPartition+leftPartitions, parts);
+}
+
+// Greedily move boundary vertices to the neighboring partition they are most
+// connected to, as long as the move reduces the edge cut (or keeps the cut and
+// improves the balance) and the target partition stays within its weight
+// limit. Vertices of overweight partitions may move with a negative gain.
+static void refine(const Graph& graph, int numPartitions, double imbalance,
+                   vector<int>& parts) {
+  const int n = graph.numVertices;
+  vector<int64_t> partWeights(numPartitions, 0);
+  int maxVertexWeight = 0;
+  for (int v = 0; v < n; ++v) {
+    partWeights[parts[v]] += graph.vertexWeights[v];
+    maxVertexWeight = max(maxVertexWeight, graph.vertexWeights[v]);
+  }
+  const int64_t maxWeight = max<int64_t>(
+      (int64_t)ceil(imbalance * graph.totalWeight() / numPartitions),
+      graph.totalWeight() / numPartitions + maxVertexWeight);
+
+  vector<int> connectivity(numPartitions, 0);
+  vector<int> touched;
+  for (int pass = 0; pass < kRefinementPasses; ++pass) {
+    int moves = 0;
+    for (int v = 0; v < n; ++v) {
+      const int from = parts[v];
+      for (int j = graph.start[v]; j < graph.start[v+1]; ++j) {
+        int p = parts[graph.nbrs[j]];
+        if (connectivity[p] == 0) {
+          touched.push_back(p);
+        }
+        connectivity[p] += graph.edgeWeights[j];
+      }
+
+      const int weight = graph.vertexWeights[v];
+      const bool overweight = partWeights[from] > maxWeight;
+      int best = from;
+      int bestGain = 0;
+      for (int p : touched) {
+        if (p == from || partWeights[p] + weight > maxWeight) continue;
+        int gain = connectivity[p] - connectivity[from];
+        bool balances = partWeights[p] + weight < partWeights[from];
+        if ((best == from && (gain > 0 || (gain == 0 && balances) ||
+                              overweight)) ||
+            (best != from && gain > bestGain)) {
+          best = p;
+          bestGain = gain;
+        }
+      }
+      for (int p : touched) {
+        connectivity[p] = 0;
+      }
+      touched.clear();
+
+      if (best != from) {
+        parts[v] = best;
+        partWeights[from] -= weight;
+        partWeights[best] += weight;
+        ++moves;
+      }
+    }
+    if (moves == 0) break;
+  }
+}
+
+void partitionGraph(int numVertices, const int* start, const int* nbrs,
+                    int numPartitions, vector<int>& parts, double imbalance) {
+  uassert(numPartitions > 0) << "Must have at least one partition";
+  parts.assign(numVertices, 0);
+  if (numPartitions == 1 || numVertices == 0) {
+    return;
+  }
+  if (numPartitions >= numVertices) {
+    for (int v = 0; v < numVertices; ++v) {
+      parts[v] = v;
+    }
+    return;
+  }
+
+  // Build the finest graph without self-loops
+  vector<Graph> graphs(1);
+  Graph& fine = graphs[0];
+  fine.numVertices = numVertices;
+  fine.start.push_back(0);
+  for (int v = 0; v < numVertices; ++v) {
+    for (int j = start[v]; j < start[v+1]; ++j) {
+      if (nbrs[j] != v) {
+        fine.nbrs.push_back(nbrs[j]);
+      }
+    }
+    fine.start.push_back(fine.nbrs.size());
+  }
+  fine.edgeWeights.assign(fine.nbrs.size(), 1);
+  fine.vertexWeights.assign(numVertices, 1);
+
+  // Coarsen until the graph is small or stops shrinking
+  mt19937 rng(numVertices);
+  vector<vector<int>> cmaps;
+  const int coarseSize = kCoarseVerticesPerPartition * numPartitions;
+  while (graphs.back().numVertices > coarseSize) {
+    vector<int> cmap;
+    Graph coarse = coarsen(graphs.back(), cmap, rng);
+    if (coarse.numVertices > 0.95 * graphs.back().numVertices) break;
+    graphs.push_back(std::move(coarse));
+    cmaps.push_back(std::move(cmap));
+  }
+
+  // Partition the coarsest graph
+  const Graph& coarsest = graphs.back();
+  vector<int> coarseParts(coarsest.numVertices);
+  vector<int> vertices(coarsest.numVertices);
+  for (int v = 0; v < coarsest.numVertices; ++v) {
+    vertices[v] = v;
+  }
+  bisect(coarsest, vertices, numPartitions, 0, coarseParts);
+  refine(coarsest, numPartitions, imbalance, coarseParts);
+
+  // Project the partition back to the finest graph, refining at every level
+  for (int level = cmaps.size()-1; level >= 0; --level) {
+    const vector<int>& cmap = cmaps[level];
+    vector<int> fineParts(cmap.size());
+    for (size_t v = 0; v < cmap.size(); ++v) {
+      fineParts[v] = coarseParts[cmap[v]];
+    }
+    refine(graphs[level], numPartitions, imbalance, fineParts);
+    coarseParts.swap(fineParts);
+  }
+  parts.swap(coarseParts);
+}
+
+// Order elements by partition and, within each, interior before boundary.
+// Elements in the same block keep their relative order in visitOrder (if
+// given). Returns the ordering (old to new) and fills the partition table.
+static vector<int> partitionOrdering(const vector<int>& parts,
+                                     const vector<char>& boundary,
+                                     int numPartitions, vector<int>& table,
+                                     const vector<int>* visitOrder=nullptr) {
+  const int n = parts.size();
+  vector<int> counts(2*numPartitions+1, 0);
+  for (int i = 0; i < n; ++i) {
+    counts[2*parts[i] + boundary[i] + 1]++;
+  }
+  for (int k = 0; k < 2*numPartitions; ++k) {
+    counts[k+1] += counts[k];
+  }
+  table.resize(2*numPartitions+2);
+  table[0] = numPartitions;
+  for (int k = 0; k < 2*numPartitions; ++k) {
+    table[k+1] = counts[k];
+  }
+  table.back() = n;
+
+  vector<int> ordering(n);
+  for (int j = 0; j < n; ++j) {
+    int i = visitOrder ? (*visitOrder)[j] : j;
+    ordering[i] = counts[2*parts[i] + boundary[i]]++;
+  }
+  return ordering;
+}
+
+void partitionSets(Set& edgeSet, int numPartitions) {
+  uassert(edgeSet.getCardinality() >= 2 && edgeSet.isHomogeneous())
+      << "Can only partition homogeneous edge sets";
+  uassert(numPartitions > 0) << "Must have at least one partition";
+  Set& vertexSet = *const_cast<Set*>(edgeSet.getEndpointSet(0));
+  const int numVertices = vertexSet.getSize();
+  const int cardinality = edgeSet.getCardinality();
+
+  if (!vertexSet.isReordered() && !vertexSet.hasFixedOrder()) {
+    const internal::NeighborIndex* nbrIndex = edgeSet.getNeighborIndex();
+    const int* start = nbrIndex->getStartIndex();
+    const int* nbrs = nbrIndex->getNeighborIndex();
+
+    vector<int> parts;
+    partitionGraph(numVertices, start, nbrs, numPartitions, parts);
+
+    vector<char> boundary(numVertices, false);
+    for (int v = 0; v < numVertices; ++v) {
+      for (int j = start[v]; j < start[v+1]; ++j) {
+        if (parts[nbrs[j]] != parts[v]) {
+          boundary[v] = true;
+          break;
+        }
+      }
+    }
+    vector<int> table;
+    vector<int> ordering = partitionOrdering(parts, boundary, numPartitions,
+                                             table);
+    applyOrdering(vertexSet, ordering);
+    vertexSet.setPartitionTable(table);
+  }
+
+  // Partition the edges by the vertex partitions
+  const int* vertexTable = vertexSet.getPartitionTable();
+  if (vertexTable == nullptr) {
+    return;
+  }
+  numPartitions = vertexTable[0];
+  vector<int> vertexParts(numVertices);
+  for (int p = 0; p < numPartitions; ++p) {
+    for (int v = vertexTable[1+2*p]; v < vertexTable[3+2*p]; ++v) {
+      vertexParts[v] = p;
+    }
+  }
+
+  const int numEdges = edgeSet.getSize();
+  vector<int> edgeParts(numEdges);
+  vector<char> boundary(numEdges, false);
+  for (int e = 0; e < numEdges; ++e) {
+    int lowest = edgeSet.getEndpointIndex(e, 0);
+    for (int k = 1; k < cardinality; ++k) {
+      lowest = min(lowest, edgeSet.getEndpointIndex(e, k));
+    }
+    edgeParts[e] = vertexParts[lowest];
+    for (int k = 0; k < cardinality; ++k) {
+      if (vertexParts[edgeSet.getEndpointIndex(e, k)] != edgeParts[e]) {
+        boundary[e] = true;
+      }
+    }
+  }
+
+  // Within each block, keep edges sorted by their endpoints
+  vector<int> sortOrdering;
+  edgeVertexSortReordering(edgeSet, sortOrdering);
+  vector<int> sortedEdges(numEdges);
+  for (int e = 0; e < numEdges; ++e) {
+    sortedEdges[sortOrdering[e]] = e;
+  }
+  vector<int> table;
+  vector<int> ordering = partitionOrdering(edgeParts, boundary, numPartitions,
+                                           table, &sortedEdges);
+  applyOrdering(edgeSet, ordering);
+  edgeSet.setPartitionTable(table);
+}
+
+}
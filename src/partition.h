@@ -0,0 +1,33 @@
+#ifndef SIMIT_PARTITION_H
+#define SIMIT_PARTITION_H
+
+#include <vector>
+
+namespace simit {
+class Set;
+
+/// Computes a k-way partition of an undirected graph with unit vertex and edge
+/// weights, given in CSR form (`start` has numVertices+1 entries and
+/// self-loops in `nbrs` are ignored). The partitioner is multilevel: the graph
+/// is coarsened by heavy-edge matching, the coarsest graph is split by
+/// recursive graph-growing bisection, and the partition is projected back and
+/// refined with greedy boundary moves at every level. `parts` receives the
+/// partition of each vertex. Partition weights are kept within `imbalance` of
+/// the average.
+void partitionGraph(int numVertices, const int* start, const int* nbrs,
+                    int numPartitions, std::vector<int>& parts,
+                    double imbalance=1.03);
+
+/// Partitions the vertices of a homogeneous edge set (using its neighbor index)
+/// and then the edges, and reorders both sets so that each partition is stored
+/// contiguously with its interior elements before its boundary elements. An
+/// edge belongs to the partition of its lowest endpoint and is interior if all
+/// its endpoints are in that partition. The orderings are recorded in the
+/// sets, so ElementRefs stay valid, and the resulting partition tables are
+/// stored in the sets (see Set::getPartitionTable). A vertex set that has
+/// already been reordered is not repartitioned; the edges are then
+/// partitioned by the existing vertex partition table, if there is one.
+void partitionSets(Set& edgeSet, int numPartitions);
+
+}
+#endif
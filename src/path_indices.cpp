@@ -50,34 +50,45 @@ SetEndpointPathIndex::neighbors(unsigned elemID) const {
   class SetEndpointNeighbors : public PathIndexImpl::Neighbors::Base {
     class Iterator : public PathIndexImpl::Neighbors::Iterator::Base {
     public:
-      Iterator(const simit::Set::Endpoints::Iterator &epit) : epit(epit) {}
+      Iterator(const simit::Set &edgeSet, unsigned elemID, int endpointNum)
+          : edgeSet(edgeSet), elemID(elemID), endpointNum(endpointNum) {}
 
-      void operator++() {++epit;}
-      unsigned operator*() const {return epit->getIdent();}
+      void operator++() {++endpointNum;}
+      unsigned operator*() const {
+        return edgeSet.getEndpointIndex(elemID, endpointNum);
+      }
       Base* clone() const {return new Iterator(*this);}
 
     protected:
       bool eq(const Base& o) const {
         const Iterator *other = static_cast<const Iterator*>(&o);
-        return epit == other->epit;
+        return &edgeSet == &other->edgeSet && elemID == other->elemID &&
+               endpointNum == other->endpointNum;
       }
 
     private:
-      simit::Set::Endpoints::Iterator epit;
+      const simit::Set &edgeSet;
+      unsigned elemID;
+      int endpointNum;
     };
 
   public:
-    SetEndpointNeighbors(const simit::Set::Endpoints &endpoints)
-        : endpoints(endpoints) {}
+    SetEndpointNeighbors(const simit::Set &edgeSet, unsigned elemID)
+        : edgeSet(edgeSet), elemID(elemID) {}
 
-    Neighbors::Iterator begin() const {return new Iterator(endpoints.begin());}
-    Neighbors::Iterator end() const {return new Iterator(endpoints.end());}
+    Neighbors::Iterator begin() const {
+      return new Iterator(edgeSet, elemID, 0);
+    }
+    Neighbors::Iterator end() const {
+      return new Iterator(edgeSet, elemID, edgeSet.getCardinality());
+    }
 
   private:
-    simit::Set::Endpoints endpoints;
+    const simit::Set &edgeSet;
+    unsigned elemID;
   };
 
-  return new SetEndpointNeighbors(edgeSet.getEndpoints(ElementRef(elemID)));
+  return new SetEndpointNeighbors(edgeSet, elemID);
 }
 
 void SetEndpointPathIndex::print(std::ostream &os) const {
@@ -229,9 +240,10 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
           // populate neighbor lists
           for (auto &e : edgeSet) {
             iassert(e.getIdent() >= 0);
-            for (auto &ep : edgeSet.getEndpoints(e)) {
-              iassert(ep.getIdent() >= 0);
-              pathNeighbors.at(ep.getIdent()).push_back(e.getIdent());
+            for (int i = 0; i < edgeSet.getCardinality(); ++i) {
+              int ep = edgeSet.getEndpointIndex(e.getIdent(), i);
+              iassert(ep >= 0);
+              pathNeighbors.at(ep).push_back(e.getIdent());
             }
           }
           pi = pack(pathNeighbors);
@@ -185,6 +185,11 @@ public:
   const unsigned* getCoordData() const {return coordsData;}
   const unsigned* getSinkData() const {return sinksData;}
 
+  /// The bytes held by the index.
+  size_t getBytes() const {
+    return (numElems + 1 + numNeighbors()) * sizeof(uint32_t);
+  }
+
   unsigned numNeighbors(unsigned elemID) const {
     iassert(numElems > elemID);
     return coordsData[elemID+1]-coordsData[elemID];
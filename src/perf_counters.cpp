@@ -0,0 +1,99 @@
+#include "perf_counters.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace simit {
+namespace ir {
+
+#ifdef __linux__
+static int openEvent(PerfEvent event, int leader) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  switch (event) {
+    case Cycles:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case Instructions:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case LLCMisses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_LL |
+                    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case DTLBMisses:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                    (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case BranchMisses:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+  }
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+}
+#endif
+
+// class PerfCounterGroup
+PerfCounterGroup::PerfCounterGroup() : leader(-1), numOpen(0) {
+  for (int event = 0; event < kNumPerfEvents; ++event) {
+    fds[event] = -1;
+    positions[event] = -1;
+  }
+#ifdef __linux__
+  // The first event that opens leads the group
+  for (int event = 0; event < kNumPerfEvents; ++event) {
+    int fd = openEvent(PerfEvent(event), leader);
+    if (fd == -1) {
+      continue;
+    }
+    if (leader == -1) {
+      leader = fd;
+    }
+    fds[event] = fd;
+    positions[event] = numOpen++;
+  }
+#endif
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+#ifdef __linux__
+  for (int event = 0; event < kNumPerfEvents; ++event) {
+    if (fds[event] != -1) {
+      close(fds[event]);
+    }
+  }
+#endif
+}
+
+void PerfCounterGroup::read(int64_t* counts) const {
+  // The group reads as the number of events followed by their counts
+  uint64_t values[1 + kNumPerfEvents] = {0};
+#ifdef __linux__
+  if (leader != -1 &&
+      ::read(leader, values, sizeof(values)) < (ssize_t)sizeof(uint64_t)) {
+    memset(values, 0, sizeof(values));
+  }
+#endif
+  for (int event = 0; event < kNumPerfEvents; ++event) {
+    counts[event] = (positions[event] == -1) ? 0
+                                             : values[1 + positions[event]];
+  }
+}
+
+}}
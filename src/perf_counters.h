@@ -0,0 +1,43 @@
+#ifndef SIMIT_PERF_COUNTERS_H
+#define SIMIT_PERF_COUNTERS_H
+
+#include <cstdint>
+
+#include "profile.h"
+
+namespace simit {
+namespace ir {
+
+/// The hardware event counters of the calling thread, opened with
+/// perf_event_open as one group, so that all the events are read at once.
+/// Only user-space events are counted. Events that the kernel or the hardware
+/// does not let the process count are unavailable, and if none is available
+/// (e.g. perf_event_paranoid forbids it, or the host is not Linux) the group
+/// is unavailable.
+class PerfCounterGroup {
+public:
+  PerfCounterGroup();
+  ~PerfCounterGroup();
+
+  bool isAvailable() const {return leader != -1;}
+  bool isAvailable(PerfEvent event) const {return fds[event] != -1;}
+
+  /// Read the counts of the events, indexed by PerfEvent. Unavailable events
+  /// read 0.
+  void read(int64_t* counts) const;
+
+private:
+  int leader;
+  int fds[kNumPerfEvents];
+
+  /// The position of each event in the group.
+  int positions[kNumPerfEvents];
+  int numOpen;
+
+  PerfCounterGroup(PerfCounterGroup const&) = delete;
+  void operator=(PerfCounterGroup const&)   = delete;
+};
+
+}}
+
+#endif
@@ -0,0 +1,249 @@
+#include "profile.h"
+
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "error.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+
+const char* getPerfEventName(PerfEvent event) {
+  switch (event) {
+    case Cycles:       return "cycles";
+    case Instructions: return "instructions";
+    case LLCMisses:    return "llc_misses";
+    case DTLBMisses:   return "dtlb_misses";
+    case BranchMisses: return "branch_misses";
+  }
+  unreachable;
+  return "";
+}
+
+/// Write the events of the record as members of a JSON object.
+static void writeEvents(std::ostream& os, const ProfileRecord& record) {
+  for (size_t event = 0; event < record.events.size(); ++event) {
+    os << ", " << util::jsonString(getPerfEventName(PerfEvent(event)))
+       << ": " << record.events[event];
+  }
+}
+
+// class Profile
+double Profile::getTotalTime() const {
+  double total = 0.0;
+  for (auto& record : records) {
+    if (record.parent == -1) {
+      total += record.total;
+    }
+  }
+  return total;
+}
+
+void Profile::writeJSON(std::ostream& os) const {
+  auto precision = os.precision(9);
+  os << "[";
+  for (size_t i = 0; i < records.size(); ++i) {
+    const ProfileRecord& record = records[i];
+    os << (i == 0 ? "" : ",") << endl
+       << "  {\"site\": " << record.site
+       << ", \"parent\": " << record.parent
+       << ", \"function\": " << util::jsonString(record.function)
+       << ", \"statement\": " << util::jsonString(record.statement)
+       << ", \"thread\": " << record.thread
+       << ", \"count\": " << record.count
+       << ", \"total\": " << record.total
+       << ", \"min\": " << record.min
+       << ", \"max\": " << record.max
+       << ", \"flops\": " << record.flops
+       << ", \"bytes\": " << record.bytes;
+    writeEvents(os, record);
+    os << "}";
+  }
+  os << endl << "]" << endl;
+  os.precision(precision);
+}
+
+void Profile::writeChromeTrace(std::ostream& os) const {
+  // The roots of each thread, and the children of each site on a thread. Sites
+  // whose parent did not run on their thread are roots of the thread.
+  set<pair<int,int>> threadSites;
+  for (auto& record : records) {
+    threadSites.insert({record.thread, record.site});
+  }
+  map<int,vector<const ProfileRecord*>> roots;
+  map<pair<int,int>,vector<const ProfileRecord*>> children;
+  for (auto& record : records) {
+    if (threadSites.find({record.thread, record.parent}) ==
+        threadSites.end()) {
+      roots[record.thread].push_back(&record);
+    }
+    else {
+      children[{record.thread, record.parent}].push_back(&record);
+    }
+  }
+
+  auto precision = os.precision(3);
+  auto flags = os.setf(ios::fixed, ios::floatfield);
+  os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  auto separate = [&]() {
+    os << (first ? "" : ",") << endl << "  ";
+    first = false;
+  };
+
+  // Lay out a site and its children, in microseconds from the thread start
+  function<void(const ProfileRecord*,double)> writeEvent =
+      [&](const ProfileRecord* record, double start) {
+    separate();
+    os << "{\"name\": " << util::jsonString(record->statement)
+       << ", \"cat\": " << util::jsonString(record->function)
+       << ", \"ph\": \"X\", \"pid\": 0, \"tid\": " << record->thread
+       << ", \"ts\": " << start
+       << ", \"dur\": " << record->total * 1e6
+       << ", \"args\": {\"site\": " << record->site
+       << ", \"count\": " << record->count
+       << ", \"min_us\": " << record->min * 1e6
+       << ", \"max_us\": " << record->max * 1e6
+       << ", \"flops\": " << record->flops
+       << ", \"bytes\": " << record->bytes;
+    writeEvents(os, *record);
+    os << "}}";
+    auto siteChildren = children.find({record->thread, record->site});
+    if (siteChildren != children.end()) {
+      for (const ProfileRecord* child : siteChildren->second) {
+        writeEvent(child, start);
+        start += child->total * 1e6;
+      }
+    }
+  };
+
+  for (auto& threadRoots : roots) {
+    separate();
+    os << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": "
+       << threadRoots.first << ", \"args\": {\"name\": \"simit thread "
+       << threadRoots.first << "\"}}";
+    double start = 0.0;
+    for (const ProfileRecord* root : threadRoots.second) {
+      writeEvent(root, start);
+      start += root->total * 1e6;
+    }
+  }
+  os << endl << "]}" << endl;
+  os.flags(flags);
+  os.precision(precision);
+}
+
+void Profile::writeRoofline(std::ostream& os, double peakFlops,
+                            double peakBandwidth) const {
+  auto flags = os.setf(ios::fixed, ios::floatfield);
+  auto precision = os.precision(2);
+  os << "Roofline: " << peakFlops / 1e9 << " GFLOP/s, "
+     << peakBandwidth / 1e9 << " GB/s, balance "
+     << peakFlops / peakBandwidth << " flop/B" << endl;
+  os << setw(10) << "flop/B" << setw(10) << "GFLOP/s" << setw(10) << "GB/s"
+     << setw(10) << "of roof" << setw(8) << "bound" << "  site" << endl;
+  for (auto& record : records) {
+    if (record.flops == 0 || record.total <= 0.0) {
+      continue;
+    }
+    double intensity = (record.bytes == 0)
+        ? numeric_limits<double>::infinity() : (double)record.flops/record.bytes;
+    double flops = record.flops / record.total;
+    double bandwidth = record.bytes / record.total;
+    bool memoryBound = intensity * peakBandwidth < peakFlops;
+    double bound = memoryBound ? intensity * peakBandwidth : peakFlops;
+    os << setw(10) << intensity << setw(10) << flops / 1e9
+       << setw(10) << bandwidth / 1e9 << setw(9) << 100.0 * flops / bound
+       << "%" << setw(8) << (memoryBound ? "memory" : "compute") << "  "
+       << record.function << ": " << record.statement;
+    if (record.thread != 0) {
+      os << " (thread " << record.thread << ")";
+    }
+    os << endl;
+  }
+  os.precision(precision);
+  os.flags(flags);
+}
+
+// class CompileProfile
+void CompileProfile::addStage(const std::string& name, double time,
+                              int64_t nodes) {
+  stages.push_back({name, time, nodes});
+}
+
+void CompileProfile::append(const CompileProfile& profile) {
+  stages.insert(stages.end(), profile.stages.begin(), profile.stages.end());
+}
+
+double CompileProfile::getTotalTime() const {
+  double total = 0.0;
+  for (auto& stage : stages) {
+    total += stage.time;
+  }
+  return total;
+}
+
+void CompileProfile::writeJSON(std::ostream& os) const {
+  auto precision = os.precision(9);
+  os << "[";
+  for (size_t i = 0; i < stages.size(); ++i) {
+    os << (i == 0 ? "" : ",") << endl
+       << "  {\"stage\": " << util::jsonString(stages[i].name)
+       << ", \"time\": " << stages[i].time
+       << ", \"nodes\": " << stages[i].nodes << "}";
+  }
+  os << endl << "]" << endl;
+  os.precision(precision);
+}
+
+std::ostream& operator<<(std::ostream& os, const CompileProfile& profile) {
+  double total = profile.getTotalTime();
+  auto flags = os.setf(ios::fixed, ios::floatfield);
+  auto precision = os.precision(6);
+  os << setw(12) << "seconds" << setw(9) << "total" << setw(10) << "nodes"
+     << "  stage" << endl;
+  for (auto& stage : profile.getStages()) {
+    os << setw(12) << stage.time << setprecision(2) << setw(8)
+       << ((total > 0.0) ? 100.0 * stage.time / total : 0.0) << "%"
+       << setprecision(6) << setw(10);
+    if (stage.nodes >= 0) {
+      os << stage.nodes;
+    }
+    else {
+      os << "";
+    }
+    os << "  " << stage.name << endl;
+  }
+  os << setw(12) << total << "  total" << endl;
+  os.precision(precision);
+  os.flags(flags);
+  return os;
+}
+
+// class CompileTimer
+CompileTimer::CompileTimer(CompileProfile* profile) : profile(profile) {
+  restart();
+}
+
+void CompileTimer::endStage(const std::string& name,
+                            const std::function<int64_t()>& countNodes) {
+  if (profile != nullptr) {
+    chrono::duration<double> time = chrono::steady_clock::now() - start;
+    profile->addStage(name, time.count(), countNodes ? countNodes() : -1);
+    restart();
+  }
+}
+
+void CompileTimer::restart() {
+  if (profile != nullptr) {
+    start = chrono::steady_clock::now();
+  }
+}
+
+}
@@ -0,0 +1,148 @@
+#ifndef SIMIT_PROFILE_H
+#define SIMIT_PROFILE_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simit {
+
+/// Hardware events that the timed sites of functions count when
+/// Settings::perfCounters is set.
+enum PerfEvent {
+  Cycles,
+  Instructions,
+  LLCMisses,     ///< Last level cache read misses
+  DTLBMisses,    ///< Data TLB read misses
+  BranchMisses
+};
+static const int kNumPerfEvents = 5;
+
+/// The name of the event in exported profiles, e.g. "llc_misses".
+const char* getPerfEventName(PerfEvent event);
+
+/// The times of a timed site of a function on one thread. The sites of a
+/// function are its functions, loops, maps and system-level calls, and a site
+/// nests in its parent site.
+struct ProfileRecord {
+  int site;
+  int parent;             ///< The enclosing site, or -1 if it is a root
+
+  std::string function;   ///< The Simit function that contains the site
+  std::string statement;  ///< The first line of the lowered IR statement
+
+  int thread;             ///< The thread that ran the site, in order of use
+  uint64_t count;         ///< The number of runs
+
+  /// The total, shortest and longest run time in seconds.
+  double total;
+  double min;
+  double max;
+
+  /// The floating point operations and bytes of memory accesses of the runs,
+  /// estimated from the lowered code of the site.
+  uint64_t flops;
+  uint64_t bytes;
+
+  /// The hardware events counted in the runs, indexed by PerfEvent, or empty
+  /// if events were not counted. Events that the process may not count are
+  /// -1.
+  std::vector<int64_t> events;
+};
+
+/// A snapshot of the timers of a function compiled with timers, retrieved
+/// with Function::getProfile.
+class Profile {
+public:
+  Profile() {}
+  explicit Profile(const std::vector<ProfileRecord>& records)
+      : records(records) {}
+
+  const std::vector<ProfileRecord>& getRecords() const {return records;}
+
+  /// The time of the root sites in seconds, summed over threads.
+  double getTotalTime() const;
+
+  /// Write the records to the stream as a flat JSON array of objects.
+  void writeJSON(std::ostream& os) const;
+
+  /// Write the profile to the stream in the Chrome trace event format, that
+  /// chrome://tracing and Perfetto load. The timers accumulate time rather
+  /// than record events, so every site is one complete event whose duration
+  /// is its total time, laid out inside its parent after its earlier siblings.
+  void writeChromeTrace(std::ostream& os) const;
+
+  /// Write a roofline report of the sites that execute floating point
+  /// operations, given the peak floating point rate (flop/s) and memory
+  /// bandwidth (bytes/s) of the machine. For each site it gives the
+  /// arithmetic intensity, the achieved flop rate and bandwidth, and the rate
+  /// the roofline bounds the site to: the bandwidth bound if the site's
+  /// intensity is below the machine balance, and the peak rate otherwise.
+  void writeRoofline(std::ostream& os, double peakFlops,
+                     double peakBandwidth) const;
+
+private:
+  std::vector<ProfileRecord> records;
+};
+
+/// A stage of compiling a function: a frontend analysis, a lowering pass or a
+/// backend stage.
+struct CompileStage {
+  std::string name;
+  double time;     ///< Seconds
+  int64_t nodes;   ///< IR nodes of the call graph after the stage, or -1
+};
+
+/// The times of the stages of compiling a function, retrieved with
+/// Function::getCompileProfile.
+class CompileProfile {
+public:
+  const std::vector<CompileStage>& getStages() const {return stages;}
+
+  void addStage(const std::string& name, double time, int64_t nodes=-1);
+
+  /// Add the stages of the profile after the stages of this profile.
+  void append(const CompileProfile& profile);
+
+  /// The time of all the stages in seconds.
+  double getTotalTime() const;
+
+  /// Write the stages to the stream as a flat JSON array of objects.
+  void writeJSON(std::ostream& os) const;
+
+private:
+  std::vector<CompileStage> stages;
+};
+
+/// Write the stages of the profile as a table with their share of the time.
+std::ostream& operator<<(std::ostream& os, const CompileProfile& profile);
+
+/// Times consecutive stages of compilation into a compile profile. A stage
+/// starts when the timer is created or the previous stage ends. Timers
+/// without a profile do nothing.
+class CompileTimer {
+public:
+  explicit CompileTimer(CompileProfile* profile);
+
+  bool isTiming() const {return profile != nullptr;}
+
+  /// End the current stage and add it to the profile. If `countNodes` is
+  /// given, it is called after the stage's time is taken to count the IR
+  /// nodes after the stage.
+  void endStage(const std::string& name,
+                const std::function<int64_t()>& countNodes=nullptr);
+
+  /// Restart the current stage, so that the time since it started (e.g. to
+  /// print IR) is not included.
+  void restart();
+
+private:
+  CompileProfile* profile;
+  std::chrono::steady_clock::time_point start;
+};
+
+}
+#endif
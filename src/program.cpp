@@ -27,17 +27,31 @@ const std::vector<std::string> VALID_BACKENDS = {
 std::string kBackend;
 
 static
-Function compile(ir::Func func, backend::Backend *backend, bool addTimers) {
+Function compile(ir::Func func, backend::Backend *backend,
+                 const CompileOptions &options,
+                 const CompileProfile &frontendProfile) {
   ir::Storage storage;
   // Fill in storage path expressions, etc.
   /// map<Var,pe::PathExpressions> pes = assignPathExpressions(func);
   /// storage.addPathExpressions(pes);
-  func = lower(func, nullptr, addTimers);
-  return Function(backend->compile(func, storage));
+  // The first site that lowering adds with timers is the site of the
+  // function, which identifies its profile
+  int profile = (options.timers && kBackend == "cpu")
+                ? ir::TimerStorage::getInstance().getSites().size() : -1;
+
+  CompileProfile compileProfile = frontendProfile;
+  func = lower(func, nullptr, options.timers,
+               options.profileCompile ? &compileProfile : nullptr);
+  backend::Function *function = backend->compile(func, storage);
+  if (options.profileCompile) {
+    compileProfile.append(function->getCompileProfile());
+    function->setCompileProfile(compileProfile);
+  }
+  return Function(function, profile);
 }
 
 static Function compile(ir::Func func, backend::Backend *backend) {
-  return simit::compile(func, backend, false);
+  return simit::compile(func, backend, CompileOptions(), CompileProfile());
 }
 
 // class ProgramContent
@@ -46,6 +60,9 @@ struct Program::ProgramContent {
   internal::Frontend *frontend;
   backend::Backend   *backend;
   Diagnostics diags;
+
+  /// The frontend stages of loading the program's code
+  CompileProfile frontendProfile;
 };
 
 // class Program
@@ -68,7 +85,8 @@ void Program::clear() {
 int Program::loadString(const string &programString) {
   std::vector<ParseError> errors;
   int status = content->frontend->parseString(programString, &content->ctx,
-                                              &errors);
+                                              &errors,
+                                              &content->frontendProfile);
   for (auto &error : errors) {
     content->diags.report() << error.toString();
   }
@@ -80,7 +98,8 @@ int Program::loadString(const string &programString) {
 int Program::loadFile(const std::string &filename) {
   uassert(ifstream(filename).good()) << "Could not load file: " << filename;
   std::vector<ParseError> errors;
-  int status = content->frontend->parseFile(filename, &content->ctx, &errors);
+  int status = content->frontend->parseFile(filename, &content->ctx, &errors,
+                                            &content->frontendProfile);
   for (auto &error : errors) {
     content->diags.report() << error.toString();
   }
@@ -98,17 +117,22 @@ std::vector<std::string> Program::getFunctionNames() const {
 }
 
 Function Program::compile(const std::string &function) {
+  return compile(function, CompileOptions());
+}
+
+Function Program::compile(const std::string &function,
+                          const CompileOptions &options) {
   ir::Func simitFunc = content->ctx.getFunction(function);
   uassert(simitFunc.defined()) << "Attempting to compile an unknown function "
                                << "(" << function << ")";
-  return simit::compile(simitFunc, content->backend);
+  return simit::compile(simitFunc, content->backend, options,
+                        content->frontendProfile);
 }
 
 Function Program::compileWithTimers(const std::string &function) {
-  ir::Func simitFunc = content->ctx.getFunction(function);
-  uassert(simitFunc.defined()) << "Attempting to compile an unknown function "
-                               << "(" << function << ")";
-  return simit::compile(simitFunc, content->backend, true);
+  CompileOptions options;
+  options.timers = true;
+  return compile(function, options);
 }
 
 int Program::verify() {
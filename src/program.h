@@ -17,6 +17,17 @@ extern std::string kBackend;
 
 class Diagnostics;
 
+/// Options that control how Program::compile compiles a function.
+struct CompileOptions {
+  /// Time the function and its loops and maps, so that it can be profiled
+  /// (see Function::getProfile).
+  bool timers = false;
+
+  /// Time the frontend and lowering stages of compilation and count the IR
+  /// nodes after each lowering pass (see Function::getCompileProfile).
+  bool profileCompile = false;
+};
+
 /// A Simit program. You can load Simit source code using the \ref loadString
 /// and \ref loadFile and compile the program using the \ref compile method.
 class Program : private interfaces::Uncopyable {
@@ -46,6 +57,7 @@ public:
   /// Compile and return a runnable function, or an undefined function if an
   /// error occured.
   Function compile(const std::string &function);
+  Function compile(const std::string &function, const CompileOptions &options);
   Function compileWithTimers(const std::string &function);
 
   /// Verify the program by executing in-code comment tests.
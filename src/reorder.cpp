@@ -1,234 +1,403 @@
 #include "reorder.h"
 #include "graph.h"
 #include "hilbert.h"
+#include "partition.h"
+#include "util/parallel.h"
 
+#include <algorithm>
 #include <vector>
+#include <limits>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
 #include <climits>
 #include <cfloat>
 #include <string>
+#include <functional>
+#include <thread>
 
 using namespace std;
 namespace simit {
 
   // ---------- Hilbert Reordering Heuristic ----------
   namespace hilbert {
-    // This function populates the hilbertId field of each vertex_t in nodes, by
-    // remapping every vertex onto an n^3 lattice using appropriate scaling 
-    // factors,
-    // and then traversing the lattice using a 3-D Hilbert curve.
-    //
-    // hilbertBits = number of bits in Hilbert grid (grid with side 
-    // 2^hilbertBits)
-    void assignHilbertIds(vertex_t * const nodes, const int cntNodes,
-                          const unsigned hilbertBits) {
-      // We first traverse all vertices to find the maximal and minimal 
-      // coordinates
-      // along each axis: xMin, xMax, yMin, yMax, zMin, zMax.
-
-      double xMin, xMax, yMin, yMax, zMin, zMax;
-      uint64_t hilbertGridN = 1 << hilbertBits; xMin = yMin = zMin = DBL_MAX;
-      xMax = yMax = zMax = DBL_MIN;
-      for (int i = 0; i < cntNodes; ++i) {
-        xMin = fmin(xMin, nodes[i].x);
-        yMin = fmin(yMin, nodes[i].y);
-        zMin = fmin(zMin, nodes[i].z);
-        xMax = fmax(xMax, nodes[i].x);
-        yMax = fmax(yMax, nodes[i].y);
-        zMax = fmax(zMax, nodes[i].z);
-      }
+    // Minimum number of points/keys per worker thread.
+    static const size_t kGrainSize = 1 << 15;
 
-      // We now create a mapping that maps:
-      //   (xMin, yMin, zMin) to lattice point (0, 0, 0)
-      //   (xMax, yMax, zMax) to lattice point (n-1, n-1, n-1)
-      // where n = hilbertGridN
-      //
-      // This mapping is the following: for the T axis,
-      // tLattice = round((t - tMin) * (hilbertGridN - 1) / tMax);
+    // Spread the lowest 21 bits of x so that there are two zero bits between
+    // each of them.
+    static inline curvekey_t spreadBits3(curvekey_t x) {
+      x &= 0x1fffff;
+      x = (x | x << 32) & 0x1f00000000ffffULL;
+      x = (x | x << 16) & 0x1f0000ff0000ffULL;
+      x = (x | x << 8)  & 0x100f00f00f00f00fULL;
+      x = (x | x << 4)  & 0x10c30c30c30c30c3ULL;
+      x = (x | x << 2)  & 0x1249249249249249ULL;
+      return x;
+    }
 
-      for (int i = 0; i < cntNodes; ++i) {
-        bitmask_t latticeCoords[3];
-        bitmask_t hilbertIndex;
+    // Spread the lowest 32 bits of x so that there is a zero bit between each
+    // of them.
+    static inline curvekey_t spreadBits2(curvekey_t x) {
+      x &= 0xffffffffULL;
+      x = (x | x << 16) & 0x0000ffff0000ffffULL;
+      x = (x | x << 8)  & 0x00ff00ff00ff00ffULL;
+      x = (x | x << 4)  & 0x0f0f0f0f0f0f0f0fULL;
+      x = (x | x << 2)  & 0x3333333333333333ULL;
+      x = (x | x << 1)  & 0x5555555555555555ULL;
+      return x;
+    }
 
-        nodes[i].id = (vid_t)i;
+    static inline curvekey_t mortonKey(const bitmask_t* lattice, int dims) {
+      if (dims == 2) {
+        return spreadBits2(lattice[0]) | (spreadBits2(lattice[1]) << 1);
+      }
+      return spreadBits3(lattice[0]) | (spreadBits3(lattice[1]) << 1) |
+             (spreadBits3(lattice[2]) << 2);
+    }
 
-        latticeCoords[0] = (uint64_t) round((nodes[i].x - xMin) * (hilbertGridN 
-              - 1) / xMax);
-        latticeCoords[1] = (uint64_t) round((nodes[i].y - yMin) * (hilbertGridN 
-              - 1) / yMax);
-        latticeCoords[2] = (uint64_t) round((nodes[i].z - zMin) * (hilbertGridN 
-              - 1) / zMax);
+    template <typename T>
+    void computeKeys(const T* coords, int numPoints, int dims, unsigned bits,
+                     Curve curve, vector<curvekey_t>& keys) {
+      uassert(dims == 2 || dims == 3)
+          << "Spatial ordering requires 2 or 3 dimensional coordinates";
+      uassert(bits >= 1 && bits <= kMaxBitsPerAxis)
+          << "Spatial ordering supports between 1 and " << kMaxBitsPerAxis
+          << " bits per axis, got " << bits;
+      keys.resize(numPoints);
+      if (numPoints == 0) {
+        return;
+      }
 
-        hilbertIndex = hilbert_c2i(3, hilbertBits, latticeCoords);
-        nodes[i].hilbertId = (vid_t) hilbertIndex;
+      // Find the bounding box of the points, with one partial box per thread.
+      unsigned numThreads = util::numWorkers(numPoints, kGrainSize);
+      vector<double> mins(numThreads*dims,  numeric_limits<double>::max());
+      vector<double> maxs(numThreads*dims, -numeric_limits<double>::max());
+      util::parallelChunks(0, numPoints, numThreads,
+                           [&](unsigned t, size_t begin, size_t end) {
+        double* tMin = &mins[t*dims];
+        double* tMax = &maxs[t*dims];
+        for (size_t i = begin; i < end; ++i) {
+          for (int d = 0; d < dims; ++d) {
+            double c = coords[i*dims + d];
+            tMin[d] = fmin(tMin[d], c);
+            tMax[d] = fmax(tMax[d], c);
+          }
+        }
+      });
 
+      // We map the bounding box onto a 2^bits lattice, so that for each axis t
+      //   tLattice = round((t - tMin) * (2^bits - 1) / (tMax - tMin))
+      double lo[3];
+      double scale[3];
+      const double latticeMax = (double)((1ULL << bits) - 1);
+      for (int d = 0; d < dims; ++d) {
+        lo[d] = mins[d];
+        double hi = maxs[d];
+        for (unsigned t = 1; t < numThreads; ++t) {
+          lo[d] = fmin(lo[d], mins[t*dims + d]);
+          hi    = fmax(hi,    maxs[t*dims + d]);
+        }
+        double extent = hi - lo[d];
+        scale[d] = (extent > 0.0) ? latticeMax / extent : 0.0;
       }
+
+      util::parallelFor(0, numPoints, kGrainSize, [&](size_t i) {
+        bitmask_t lattice[3];
+        for (int d = 0; d < dims; ++d) {
+          double l = round((coords[i*dims + d] - lo[d]) * scale[d]);
+          lattice[d] = (bitmask_t)fmin(fmax(l, 0.0), latticeMax);
+        }
+        keys[i] = (curve == Hilbert) ? (curvekey_t)hilbert_c2i(dims, bits, lattice)
+                                     : mortonKey(lattice, dims);
+      });
     }
 
-    bool vertexComparator(const vertex_t& a, const vertex_t& b) {
-      if (a.hilbertId != b.hilbertId) {
-        return a.hilbertId < b.hilbertId;
-      } else {
-        return a.id < b.id;
+    template void computeKeys<float>(const float*, int, int, unsigned, Curve,
+                                     vector<curvekey_t>&);
+    template void computeKeys<double>(const double*, int, int, unsigned, Curve,
+                                      vector<curvekey_t>&);
+
+    void radixSortByKey(vector<curvekey_t>& keys, vector<int>& ids,
+                        unsigned keyBits) {
+      iassert(keys.size() == ids.size());
+      const size_t n = keys.size();
+      const unsigned radixBits = 8;
+      const size_t numBuckets = 1 << radixBits;
+      const curvekey_t radixMask = numBuckets - 1;
+
+      vector<curvekey_t> keysTmp(n);
+      vector<int> idsTmp(n);
+
+      // Each thread histograms and scatters its own chunk. Buckets are
+      // assigned offsets in digit-major, thread-minor order, which keeps each
+      // pass (and hence the sort) stable.
+      unsigned numThreads = util::numWorkers(n, kGrainSize);
+      vector<size_t> offsets(numThreads*numBuckets);
+      for (unsigned shift = 0; shift < keyBits; shift += radixBits) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        util::parallelChunks(0, n, numThreads,
+                             [&](unsigned t, size_t begin, size_t end) {
+          size_t* count = &offsets[t*numBuckets];
+          for (size_t i = begin; i < end; ++i) {
+            count[(keys[i] >> shift) & radixMask]++;
+          }
+        });
+
+        // Skip passes where every key has the same digit
+        bool trivial = false;
+        size_t offset = 0;
+        for (size_t digit = 0; digit < numBuckets; ++digit) {
+          size_t digitCount = 0;
+          for (unsigned t = 0; t < numThreads; ++t) {
+            size_t count = offsets[t*numBuckets + digit];
+            offsets[t*numBuckets + digit] = offset;
+            offset += count;
+            digitCount += count;
+          }
+          trivial |= (digitCount == n);
+        }
+        if (trivial) {
+          continue;
+        }
+
+        util::parallelChunks(0, n, numThreads,
+                             [&](unsigned t, size_t begin, size_t end) {
+          size_t* offset = &offsets[t*numBuckets];
+          for (size_t i = begin; i < end; ++i) {
+            size_t loc = offset[(keys[i] >> shift) & radixMask]++;
+            keysTmp[loc] = keys[i];
+            idsTmp[loc] = ids[i];
+          }
+        });
+        keys.swap(keysTmp);
+        ids.swap(idsTmp);
       }
     }
 
-    static void createIdTranslationMapping(vertex_t * reorderedNodes, 
-        vector<int>& vertexOrdering, int cntNodes) {
-      iassert(vertexOrdering.size() == 0);
-      vertexOrdering.resize(cntNodes);
+    void hilbertReorder(Set& vertexSet, vector<int>& vertexOrdering,
+                        unsigned bits, Curve curve) {
+      uassert(vertexSet.hasSpatialField())
+          << "Vertex Set must have a spatial field set prior to reordering";
+      const int numNodes = vertexSet.getSize();
+      Set::FieldData* spatialField = vertexSet.getFields()[
+          vertexSet.getFieldIndex(vertexSet.getSpatialFieldName())];
+      const int dims = spatialField->type->getDimension(0);
 
-      for (int i = 0; i < cntNodes; ++i) {
-        vertexOrdering[reorderedNodes[i].id] = i;
+      vector<curvekey_t> keys;
+      switch (spatialField->type->getComponentType()) {
+        case ComponentType::Float:
+          computeKeys(static_cast<const float*>(spatialField->data), numNodes,
+                      dims, bits, curve, keys);
+          break;
+        case ComponentType::Double:
+          computeKeys(static_cast<const double*>(spatialField->data), numNodes,
+                      dims, bits, curve, keys);
+          break;
+        default:
+          uerror << "Spatial field must have float or double components";
       }
-    }
 
-    void loadNodes(Set& vertexSet, vertex_t ** outNodes, int numNodes) {
-      vertex_t * nodes = new (nothrow) vertex_t[numNodes];
-      
-      auto& fields = vertexSet.getFields();
-      int fieldIndex = vertexSet.getFieldIndex(vertexSet.getSpatialFieldName());
-      double * spatialData = static_cast<double*>(fields[fieldIndex]->data);  
-     
+      // Sort vertex ids by key. The ids start out in order and the sort is
+      // stable, so vertices with equal keys keep their relative order.
+      vector<int> ids(numNodes);
       for (int i = 0; i < numNodes; ++i) {
-        nodes[i].id = i; nodes[i].x = spatialData[i*3+0];
-        nodes[i].y = spatialData[i*3+1];
-        nodes[i].z = spatialData[i*3+2];
+        ids[i] = i;
       }
-      
-      *outNodes = nodes;
-    }
-
-    void hilbertReorder(Set& vertexSet, vector<int>& vertexOrdering) {
-      vertex_t * nodes;
-      const int hilbertBits = 8;  int cntNodes = vertexSet.getSize();
-      loadNodes(vertexSet, &nodes, cntNodes);
+      radixSortByKey(keys, ids, dims*bits);
 
-      assignHilbertIds(nodes, cntNodes, hilbertBits);
-      stable_sort(nodes, nodes + cntNodes, vertexComparator);
-      createIdTranslationMapping(nodes, vertexOrdering, cntNodes);
+      vertexOrdering.resize(numNodes);
+      util::parallelFor(0, numNodes, kGrainSize, [&](size_t i) {
+        vertexOrdering[ids[i]] = i;
+      });
     }
   } // namespace simit::hilbert
  
   // ---------- Simit Level Reordering Heuristics ----------
-  int qsortCompare( const void* a, const void* b) {
-       int int_a = * ( (int*) a );
-       int int_b = * ( (int*) b );
-
-       if ( int_a == int_b ) return 0;
-       else if ( int_a < int_b ) return -1;
-       else return 1;
-  } 
-  
-  struct edgeCompare{
-    edgeCompare(int* endpoints, const int cardinality) : endpoints(endpoints),
-      cardinality(cardinality)
-      {}
-    
-    bool operator()(int const&left, int const&right) const {
-      
-      for (int i=0; i < cardinality; ++i) {
-        int leftID = endpoints[left*cardinality + i];
-        int rightID = endpoints[right*cardinality + i];
-        if (leftID != rightID) {
-          return leftID < rightID; }
+  void edgeVertexSortReordering(const Set& edgeSet, vector<int>& edgeOrdering,
+                                const vector<int>* vertexOrdering) {
+    const int* endpoints = const_cast<Set&>(edgeSet).getEndpointsPtr();
+    const int size = edgeSet.getSize();
+    const int cardinality = edgeSet.getCardinality();
+    iassert(cardinality > 0) << "Can only sort the edges of an edge set";
+
+    // Key each edge by its two smallest endpoints. Edges that share these keep
+    // their relative order, since the radix sort is stable.
+    int maxVertex = 1;
+    for (int i = 0; i < cardinality; ++i) {
+      maxVertex = max(maxVertex, edgeSet.getEndpointSet(i)->getSize());
+    }
+    unsigned vertexBits = 1;
+    while (vertexBits < 31 && (1 << vertexBits) < maxVertex) {
+      ++vertexBits;
+    }
+
+    vector<hilbert::curvekey_t> keys(size);
+    util::parallelFor(0, size, 1 << 14, [&](size_t e) {
+      hilbert::curvekey_t first  = numeric_limits<int>::max();
+      hilbert::curvekey_t second = numeric_limits<int>::max();
+      for (int i = 0; i < cardinality; ++i) {
+        int ep = endpoints[e*cardinality + i];
+        hilbert::curvekey_t v = vertexOrdering ? (*vertexOrdering)[ep] : ep;
+        if (v < first) {
+          second = first;
+          first = v;
+        }
+        else if (v < second) {
+          second = v;
+        }
       }
-      return true;
+      if (cardinality == 1) {
+        second = 0;
+      }
+      keys[e] = (first << vertexBits) | second;
+    });
+
+    vector<int> sortedEdges(size);
+    for (int e = 0; e < size; ++e) {
+      sortedEdges[e] = e;
     }
-    private:
-      int* endpoints;
-      const int cardinality;
-  };
+    hilbert::radixSortByKey(keys, sortedEdges, 2*vertexBits);
 
-  void edgeVertexSortReordering(Set& edgeSet, vector<int>& edgeOrdering) {
-    int* endpoints = edgeSet.getEndpointsPtr();
-    const int size = edgeSet.getSize();
-    const int cardinality = edgeSet.getCardinality();
-    
-    assert(edgeOrdering.size() == 0);
     edgeOrdering.resize(size);
-    int* sortableEndpoints = static_cast<int *>(malloc(size * cardinality * 
-          sizeof(int)));
-    memcpy(sortableEndpoints, endpoints, size * cardinality * sizeof(int));
-
-    for (int index=0; index < size; ++index) {
-      edgeOrdering[index] = index;
-      qsort(sortableEndpoints+ index*cardinality, cardinality, sizeof(int), 
-          qsortCompare);
-    } 
-    
-    sort(edgeOrdering.begin(), edgeOrdering.end(), 
-        edgeCompare(sortableEndpoints, cardinality));
-    free(sortableEndpoints);
+    for (int e = 0; e < size; ++e) {
+      edgeOrdering[sortedEdges[e]] = e;
+    }
   }
 
-  // ---------- Reordering Helper Functions ----------
-  void reorderFields(vector<Set::FieldData*>& fields, const vector<int>& 
-      ordering) {
-    for (auto f : fields) {
-      switch (f->type->getComponentType()) {
-        case ComponentType::Float: {
-          float* data = static_cast<float *>(f->data);
-          reorderFieldData(data, ordering, f->sizeOfType);
-          break;
-        }
-        case ComponentType::Double: {
-          double* data = static_cast<double *>(f->data);
-          reorderFieldData(data, ordering, f->sizeOfType);
-          break;
-        }
-        case ComponentType::Int: {
-          int* data = static_cast<int *>(f->data);
-          reorderFieldData(data, ordering, f->sizeOfType);
-          break;
-        }
-        case ComponentType::Boolean: {
-          bool* data = static_cast<bool *>(f->data);
-          reorderFieldData(data, ordering, f->sizeOfType);
-        }
-        case ComponentType::DoubleComplex: {
-          double_complex* data = static_cast<double_complex *>(f->data);
-          reorderFieldData(data, ordering, f->sizeOfType);
-        }
-        case ComponentType::FloatComplex: {
-          float_complex* data = static_cast<float_complex *>(f->data);
-          reorderFieldData(data, ordering, f->sizeOfType);
+  // ---------- Permutation Engine ----------
+  // Number of elements each thread gathers at a time.
+  static const size_t kPermuteBlockSize = 1 << 14;
+
+  // Gather elements of ElemSize bytes: dst[i] = src[newToOld[i]]
+  template <size_t ElemSize>
+  static void gatherElements(char* dst, const char* src, const int* newToOld,
+                             size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      memcpy(dst + i*ElemSize, src + (size_t)newToOld[i]*ElemSize, ElemSize);
+    }
+  }
+
+  static void gatherElements(char* dst, const char* src, const int* newToOld,
+                             size_t elemSize, size_t begin, size_t end) {
+    switch (elemSize) {
+      case 1:  gatherElements<1> (dst, src, newToOld, begin, end); break;
+      case 4:  gatherElements<4> (dst, src, newToOld, begin, end); break;
+      case 8:  gatherElements<8> (dst, src, newToOld, begin, end); break;
+      case 12: gatherElements<12>(dst, src, newToOld, begin, end); break;
+      case 16: gatherElements<16>(dst, src, newToOld, begin, end); break;
+      case 24: gatherElements<24>(dst, src, newToOld, begin, end); break;
+      case 32: gatherElements<32>(dst, src, newToOld, begin, end); break;
+      case 36: gatherElements<36>(dst, src, newToOld, begin, end); break;
+      case 72: gatherElements<72>(dst, src, newToOld, begin, end); break;
+      default:
+        for (size_t i = begin; i < end; ++i) {
+          memcpy(dst + i*elemSize, src + (size_t)newToOld[i]*elemSize,
+                 elemSize);
         }
+    }
+  }
+
+  // Gather endpoint tuples and remap them through the endpoint ordering
+  static void gatherEndpoints(int* dst, const int* src, const int* newToOld,
+                              int cardinality, const int* endpointOrdering,
+                              size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const int* from = src + (size_t)newToOld[i]*cardinality;
+      int* to = dst + i*cardinality;
+      for (int k = 0; k < cardinality; ++k) {
+        to[k] = endpointOrdering ? endpointOrdering[from[k]] : from[k];
       }
     }
   }
-  
-  void reorderEdgeSet(Set& edgeSet, const vector<int>& edgeOrdering) {
-    iassert(edgeOrdering.size() == (unsigned int) edgeSet.getSize()) << "Edge \
-      Mapping must be the same size as the edge set" << edgeOrdering.size() <<
-      " != " << edgeSet.getSize(); int* endpoints = edgeSet.getEndpointsPtr();
-    const unsigned int size = edgeSet.getSize();
-    const int cardinality = edgeSet.getCardinality();
 
-    int* newEndpoints = static_cast<int *>(malloc(size * cardinality * 
-          sizeof(int)));
-    memcpy(newEndpoints, endpoints, size * cardinality * sizeof(int));
+  void permuteSet(Set& set, const vector<int>& ordering,
+                  const vector<int>* endpointOrdering) {
+    const size_t size = set.getSize();
+    uassert(ordering.size() == size)
+        << "Ordering must be the same size as the set: " << ordering.size()
+        << " != " << size;
+    if (size == 0) {
+      return;
+    }
+    const int cardinality = set.getCardinality();
+    int* endpoints = set.getEndpointsPtr();
+    vector<Set::FieldData*>& fields = set.getFields();
+
+    // Invert the ordering so that every array is written sequentially
+    vector<int> newToOld(size);
+    util::parallelFor(0, size, kPermuteBlockSize, [&](size_t i) {
+      iassert(ordering[i] >= 0 && (size_t)ordering[i] < size)
+          << "Invalid ordering entry: " << ordering[i];
+      newToOld[ordering[i]] = i;
+    });
 
-    for (unsigned int edgeIndex=0; edgeIndex < size; ++edgeIndex) {
-      iassert(edgeIndex < edgeOrdering.size());
-      iassert(edgeOrdering[edgeIndex] < (int) ((size - 1) * cardinality * 
-            sizeof(int)));
-      memcpy(newEndpoints + edgeIndex * cardinality, endpoints + 
-          edgeOrdering[edgeIndex] * cardinality, cardinality * sizeof(int));
+    size_t scratchSize = cardinality * sizeof(int);
+    for (auto f : fields) {
+      scratchSize = max(scratchSize, f->sizeOfType);
     }
-    memcpy(endpoints, newEndpoints, size * cardinality * sizeof(int));
-    free(newEndpoints);
-    
-    reorderFields(edgeSet.getFields(), edgeOrdering);
+    scratchSize *= size;
+    char* scratch = static_cast<char*>(malloc(scratchSize));
+
+    // Each array is gathered into the scratch buffer by blocks, and then
+    // streamed back into place.
+    auto permute = [&](char* data, size_t elemSize,
+                       function<void(size_t,size_t)> gather) {
+      util::parallelFor(0, (size + kPermuteBlockSize-1) / kPermuteBlockSize,
+                        1, [&](size_t block) {
+        size_t begin = block * kPermuteBlockSize;
+        gather(begin, min(size, begin + kPermuteBlockSize));
+      });
+      util::parallelFor(0, (size + kPermuteBlockSize-1) / kPermuteBlockSize,
+                        1, [&](size_t block) {
+        size_t begin = block * kPermuteBlockSize;
+        size_t end = min(size, begin + kPermuteBlockSize);
+        memcpy(data + begin*elemSize, scratch + begin*elemSize,
+               (end-begin)*elemSize);
+      });
+    };
+
+    if (cardinality > 0) {
+      const int* epOrdering = endpointOrdering ? endpointOrdering->data()
+                                               : nullptr;
+      permute(reinterpret_cast<char*>(endpoints), cardinality * sizeof(int),
+              [&](size_t begin, size_t end) {
+        gatherEndpoints(reinterpret_cast<int*>(scratch), endpoints,
+                        newToOld.data(), cardinality, epOrdering, begin, end);
+      });
+      set.invalidateNeighborIndex();
+    }
+    else {
+      uassert(endpointOrdering == nullptr)
+          << "Cannot remap the endpoints of a set without endpoints";
+    }
+
+    for (auto f : fields) {
+      char* data = static_cast<char*>(f->data);
+      size_t elemSize = f->sizeOfType;
+      permute(data, elemSize, [&](size_t begin, size_t end) {
+        gatherElements(scratch, data, newToOld.data(), elemSize, begin, end);
+      });
+    }
+    free(scratch);
+  }
+
+  // ---------- Reordering Helper Functions ----------
+  void reorderEdgeSet(Set& edgeSet, const vector<int>& edgeOrdering) {
+    iassert(edgeOrdering.size() == (unsigned int) edgeSet.getSize()) << "Edge \
+      Mapping must be the same size as the edge set" << edgeOrdering.size() <<
+      " != " << edgeSet.getSize();
+    permuteSet(edgeSet, edgeOrdering);
   }
 
   void reorderEdgeSetByVertexOrdering(Set& edgeSet, const vector<int>& 
       vertexOrdering) {
-    for (int i=0; i < edgeSet.getSize() * edgeSet.getCardinality(); ++i) {
-      edgeSet.getEndpointsPtr()[i] = 
-        vertexOrdering[edgeSet.getEndpointsPtr()[i]]; }
+    int* endpoints = edgeSet.getEndpointsPtr();
+    util::parallelFor(0, edgeSet.getSize() * edgeSet.getCardinality(),
+                      kPermuteBlockSize, [&](size_t i) {
+      endpoints[i] = vertexOrdering[endpoints[i]];
+    });
+    edgeSet.invalidateNeighborIndex();
   }
     
   void reorderVertexSet(Set& edgeSet, Set& vertexSet, vector<int>& 
@@ -240,10 +409,7 @@ namespace simit {
     // Vertex ordering maps old to new identity This itertates over all enpoints 
     // translating from old to new
     reorderEdgeSetByVertexOrdering(edgeSet, vertexOrdering); 
-
-    iassert(vertexOrdering.size() == (unsigned int) vertexSet.getSize()) << 
-      vertexOrdering.size() << ", " << vertexSet.getSize();
-    reorderFields(vertexSet.getFields(), vertexOrdering);
+    permuteSet(vertexSet, vertexOrdering);
   }
   
   void reorder(Set& edgeSet, Set& vertexSet, vector<int>& edgeOrdering, 
@@ -255,11 +421,12 @@ namespace simit {
     
     // Get new vertex ordering based on given heuristic 
     hilbert::hilbertReorder(vertexSet, vertexOrdering);
-    reorderVertexSet(edgeSet, vertexSet, vertexOrdering);
+    permuteSet(vertexSet, vertexOrdering);
 
-    // Get new edge ordering based on given heuristic 
-    edgeVertexSortReordering(edgeSet, edgeOrdering); reorderEdgeSet(edgeSet, 
-        edgeOrdering);
+    // Get new edge ordering based on given heuristic, and apply it together
+    // with the vertex ordering of the endpoints in a single pass
+    edgeVertexSortReordering(edgeSet, edgeOrdering, &vertexOrdering);
+    permuteSet(edgeSet, edgeOrdering, &vertexOrdering);
   }
   
   void reorder(Set& edgeSet, Set& vertexSet) {
@@ -267,4 +434,168 @@ namespace simit {
     vector<int> edgeOrdering;
     reorder(edgeSet, vertexSet, edgeOrdering, vertexOrdering);
   }
+
+  // ---------- Reverse Cuthill-McKee Heuristic ----------
+  void rcmReorder(const Set& vertexSet, vector<int>& vertexOrdering) {
+    const int n = vertexSet.getSize();
+
+    // Build the vertex adjacency in CSR form. Vertices are adjacent if they
+    // are endpoints of the same edge in any incident edge set.
+    vector<int> start(n+1, 0);
+    for (const Set* edgeSet : vertexSet.getIncidentSets()) {
+      const int cardinality = edgeSet->getCardinality();
+      vector<int> columns;
+      for (int k = 0; k < cardinality; ++k) {
+        if (edgeSet->getEndpointSet(k) == &vertexSet) {
+          columns.push_back(k);
+        }
+      }
+      for (int e = 0; e < edgeSet->getSize(); ++e) {
+        for (int k : columns) {
+          start[edgeSet->getEndpointIndex(e, k)+1] += columns.size()-1;
+        }
+      }
+    }
+    for (int v = 0; v < n; ++v) {
+      start[v+1] += start[v];
+    }
+    vector<int> nbrs(start[n]);
+    vector<int> fill(start.begin(), start.end()-1);
+    for (const Set* edgeSet : vertexSet.getIncidentSets()) {
+      const int cardinality = edgeSet->getCardinality();
+      for (int e = 0; e < edgeSet->getSize(); ++e) {
+        for (int k = 0; k < cardinality; ++k) {
+          if (edgeSet->getEndpointSet(k) != &vertexSet) continue;
+          int v = edgeSet->getEndpointIndex(e, k);
+          for (int l = 0; l < cardinality; ++l) {
+            if (l == k || edgeSet->getEndpointSet(l) != &vertexSet) continue;
+            nbrs[fill[v]++] = edgeSet->getEndpointIndex(e, l);
+          }
+        }
+      }
+    }
+
+    // Remove duplicate neighbors, which also gives the true degrees
+    vector<int> degree(n);
+    util::parallelFor(0, n, kPermuteBlockSize, [&](size_t v) {
+      auto begin = nbrs.begin() + start[v];
+      auto end = nbrs.begin() + start[v+1];
+      sort(begin, end);
+      end = unique(begin, end);
+      degree[v] = remove(begin, end, (int)v) - begin;
+    });
+
+    auto byDegree = [&](int a, int b) {return degree[a] < degree[b];};
+    vector<int> startCandidates(n);
+    for (int v = 0; v < n; ++v) {
+      startCandidates[v] = v;
+    }
+    stable_sort(startCandidates.begin(), startCandidates.end(), byDegree);
+
+    // Breadth-first traversal of each connected component, starting from a
+    // vertex of minimum degree and visiting neighbors by increasing degree
+    vector<int> order;
+    order.reserve(n);
+    vector<bool> visited(n, false);
+    for (int root : startCandidates) {
+      if (visited[root]) continue;
+      visited[root] = true;
+      order.push_back(root);
+      for (size_t head = order.size()-1; head < order.size(); ++head) {
+        int v = order[head];
+        size_t levelBegin = order.size();
+        for (int i = start[v]; i < start[v] + degree[v]; ++i) {
+          if (!visited[nbrs[i]]) {
+            visited[nbrs[i]] = true;
+            order.push_back(nbrs[i]);
+          }
+        }
+        stable_sort(order.begin()+levelBegin, order.end(), byDegree);
+      }
+    }
+    iassert((int)order.size() == n);
+
+    vertexOrdering.resize(n);
+    for (int i = 0; i < n; ++i) {
+      vertexOrdering[order[i]] = n-1-i;
+    }
+  }
+
+  // ---------- Automatic Reordering ----------
+  ReorderPolicy kReorderPolicy = ReorderPolicy::None;
+  int kPartitions = 0;
+
+  // Remap the endpoints of the edge sets that refer to the reordered set
+  static void remapIncidentEndpoints(const Set& set,
+                                     const vector<int>& ordering) {
+    for (Set* edgeSet : set.getIncidentSets()) {
+      const int cardinality = edgeSet->getCardinality();
+      int* endpoints = edgeSet->getEndpointsPtr();
+      for (int k = 0; k < cardinality; ++k) {
+        if (edgeSet->getEndpointSet(k) != &set) continue;
+        util::parallelFor(0, edgeSet->getSize(), kPermuteBlockSize,
+                          [&](size_t e) {
+          int& endpoint = endpoints[e*cardinality + k];
+          endpoint = ordering[endpoint];
+        });
+      }
+      edgeSet->invalidateNeighborIndex();
+    }
+  }
+
+  void applyOrdering(Set& set, const vector<int>& ordering) {
+    permuteSet(set, ordering);
+    remapIncidentEndpoints(set, ordering);
+    set.setElementOrdering(ordering);
+  }
+
+  // Partition the set with the first homogeneous edge set among the set itself
+  // and its incident sets. Returns false if there is no such set.
+  static bool partitionSet(Set& set) {
+    int numPartitions = (kPartitions > 0)
+        ? kPartitions : (int)max(1u, thread::hardware_concurrency());
+    if (set.getCardinality() >= 2 && set.isHomogeneous()) {
+      partitionSets(set, numPartitions);
+      return true;
+    }
+    for (Set* edgeSet : set.getIncidentSets()) {
+      if (edgeSet->getCardinality() >= 2 && edgeSet->isHomogeneous()) {
+        partitionSets(*edgeSet, numPartitions);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void reorderSet(Set& set, ReorderPolicy policy) {
+    if (policy == ReorderPolicy::None || set.isReordered() ||
+        set.hasFixedOrder() || set.getSize() < 2) {
+      return;
+    }
+    if (policy == ReorderPolicy::Partition && partitionSet(set)) {
+      return;
+    }
+
+    vector<int> ordering;
+    if (set.getCardinality() > 0) {
+      for (int i = 0; i < set.getCardinality(); ++i) {
+        reorderSet(*const_cast<Set*>(set.getEndpointSet(i)), policy);
+      }
+      edgeVertexSortReordering(set, ordering);
+    }
+    else if (set.hasSpatialField() &&
+             (policy == ReorderPolicy::Hilbert ||
+              policy == ReorderPolicy::Auto)) {
+      hilbert::hilbertReorder(set, ordering);
+    }
+    else if (!set.getIncidentSets().empty() &&
+             (policy == ReorderPolicy::RCM || policy == ReorderPolicy::Auto)) {
+      rcmReorder(set, ordering);
+    }
+    else {
+      return;
+    }
+
+    applyOrdering(set, ordering);
+  }
 }
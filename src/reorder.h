@@ -2,6 +2,7 @@
 #define SIMIT_REORDER_H
 
 #include <graph.h>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <cassert>
@@ -10,11 +11,11 @@
 
 namespace simit { 
   /// Reorders edge set and vertex set by hilbert reordering of the vertex set.
-  /// Vertex set must have a set spatial field in 3 dimensions.
+  /// Vertex set must have a set spatial field in 2 or 3 dimensions.
   void reorder(Set& edgeSet, Set& vertexSet);
 
   /// Reorders edge set and vertex set by hilbert reordering of the vertex set.
-  /// Vertex set must have a set spatial field in 3 dimensions.
+  /// Vertex set must have a set spatial field in 2 or 3 dimensions.
   /// The supplied edge and vertex ordering vectors are populated with the new 
   /// mapping from old to new indices. 
   void reorder(Set& edgeSet, Set& vertexSet, std::vector<int>& edgeOrdering, 
@@ -31,49 +32,89 @@ namespace simit {
   void reorderEdgeSetByVertexOrdering(Set& edgeSet, const std::vector<int>& 
       vertexOrdering);
 
- 
-  template<typename T>
-  void reorderFieldData(T* data, const std::vector<int>& vertexOrdering, const 
-      int typeSize) {
-    const int capacity = vertexOrdering.size(); T* newData = 
-      static_cast<T*>(malloc(capacity * typeSize));
-    int dim = typeSize/sizeof(T);
-    assert(dim > 0);
-    for (int i=0; i < capacity; ++i) {
-      for (int x=0; x < dim; ++x) {
-        assert(vertexOrdering[i]*dim + x < capacity * dim);
-        newData[vertexOrdering[i]*dim+x] = data[i*dim+x];
-      }
-    }
-
-    memcpy(data, newData, capacity * typeSize); free(newData);
-  }
+  /// Permutes the elements of a set so that element i moves to ordering[i].
+  /// Every field, and the endpoints of an edge set, are permuted in one
+  /// parallel pass that reuses a single scratch buffer. If an endpoint
+  /// ordering is given, the endpoints are also remapped through it in the same
+  /// pass. Field data stays at the same address, so FieldRefs remain valid.
+  void permuteSet(Set& set, const std::vector<int>& ordering,
+                  const std::vector<int>* endpointOrdering=nullptr);
+
+  /// Computes an edge ordering (old to new) that sorts edges by their sorted
+  /// endpoints. If a vertex ordering is given, the edges are sorted as if
+  /// their endpoints had already been remapped through it.
+  void edgeVertexSortReordering(const Set& edgeSet,
+                                std::vector<int>& edgeOrdering,
+                                const std::vector<int>* vertexOrdering=nullptr);
+
+  /// Policies for reordering sets automatically when they are bound to a
+  /// function.
+  enum class ReorderPolicy {
+    None,     ///< Keep the elements in the order they were added
+    Hilbert,  ///< Sort vertex sets with a spatial field along a Hilbert curve
+    RCM,      ///< Reverse Cuthill-McKee ordering of the vertex connectivity
+    Auto,     ///< Hilbert if there is a spatial field, otherwise RCM
+    Partition ///< Contiguous k-way partitions (see partitionSets)
+  };
+
+  /// The reordering policy applied by Function::bind (set by simit::init).
+  extern ReorderPolicy kReorderPolicy;
+
+  /// The number of partitions of the Partition policy. If it is 0 there is
+  /// one partition per hardware thread.
+  extern int kPartitions;
+
+  /// Moves the elements of a set to a new order (ordering maps old to new
+  /// storage indices) and records the ordering in the set, so that existing
+  /// ElementRefs keep referring to the same elements. The endpoints of the
+  /// edge sets incident to the set are remapped.
+  void applyOrdering(Set& set, const std::vector<int>& ordering);
+
+  /// Computes a reverse Cuthill-McKee ordering (old to new) of the vertex set
+  /// from the connectivity of the edge sets that have endpoints in it.
+  void rcmReorder(const Set& vertexSet, std::vector<int>& vertexOrdering);
+
+  /// Reorders a set in place according to the policy, and records the
+  /// ordering in the set so that existing ElementRefs keep referring to the
+  /// same elements. The endpoint sets of an edge set are reordered first, and
+  /// the endpoints of the edge sets incident to a reordered set are remapped.
+  /// Edge sets are sorted by their endpoints under every policy but None and
+  /// Partition, which partitions homogeneous edge sets with their vertices.
+  /// Sets that are already reordered, or whose order is fixed (lattices), are
+  /// left untouched.
+  void reorderSet(Set& set, ReorderPolicy policy);
 
   namespace hilbert {
-    
-    typedef uint64_t vid_t;  // vertex id type
-
-    struct edges_t {
-      vid_t cntEdges;
-      vid_t * edges;
-    };
-    typedef struct edges_t edges_t;
-
-    struct vertex_t {
-      vid_t id;
-      vid_t hilbertId;
-      double x;
-      double y;
-      double z;
-      void * data;
-      edges_t edgeData;
-    };
-    typedef struct vertex_t vertex_t;
-
-    typedef std::pair<vid_t, vid_t> edge_t;
-
-    void hilbertReorder(Set& vertexSet, std::vector<int>& vertexOrdering, int 
-        vertexCount);
+
+    /// Space-filling curves that can be used to order spatial elements.
+    enum Curve {Hilbert, Morton};
+
+    /// Keys of the spatial ordering. A key packs `dims * bits` bits.
+    typedef uint64_t curvekey_t;
+
+    /// The maximum number of lattice bits per axis (a 2^21 grid per axis). With
+    /// three axes this packs 63 bits into a curvekey_t.
+    const unsigned kMaxBitsPerAxis = 21;
+
+    /// Compute the space-filling curve key of each of the `numPoints` points in
+    /// `coords`, which stores `dims` (2 or 3) components per point. The points
+    /// are mapped onto a 2^bits lattice that spans their bounding box, so the
+    /// key of a point depends on its position relative to the other points.
+    /// Keys are computed in parallel.
+    template <typename T>
+    void computeKeys(const T* coords, int numPoints, int dims, unsigned bits,
+                     Curve curve, std::vector<curvekey_t>& keys);
+
+    /// Stable LSD radix sort of `ids` by `keys`, where only the lowest
+    /// `keyBits` bits of the keys are significant. Both vectors are permuted.
+    void radixSortByKey(std::vector<curvekey_t>& keys, std::vector<int>& ids,
+                        unsigned keyBits);
+
+    /// Compute a vertex ordering of the vertex set from its spatial field
+    /// (2 or 3 float or double components) by sorting the vertices along a
+    /// space-filling curve. `vertexOrdering` maps old to new vertex indices.
+    void hilbertReorder(Set& vertexSet, std::vector<int>& vertexOrdering,
+                        unsigned bits=kMaxBitsPerAxis, Curve curve=Hilbert);
   } // namespace simit::hilbert
 
 } // namespace simit 
@@ -5,6 +5,8 @@
 #include <chrono>
 #include <vector>
 
+#include "memory_tracker.h"
+#include "multigrid.h"
 #include "timers.h"
 #include "stdio.h"
 
@@ -16,129 +18,25 @@ using namespace Eigen;
 #endif
 
 extern "C" {
-int loc(int v0, int v1, int *neighbors_start, int *neighbors) {
-  int l = neighbors_start[v0];
-  while(neighbors[l] != v1) l++;
-  return l;
+int64_t* simitTimerCounters(int profile) {
+  return simit::ir::TimerStorage::getInstance().getCounters(profile);
 }
 
-double atan2_f64(double y, double x) {
-  return atan2(y, x);
+void simitTimerStartEvents(int site) {
+  simit::ir::TimerStorage::getInstance().startEvents(site);
 }
 
-float atan2_f32(float y, float x) {
-  double d_y = y;
-  double d_x = x;
-  return (float)atan2(d_y, d_x);
+void simitTimerStopEvents(int site) {
+  simit::ir::TimerStorage::getInstance().stopEvents(site);
 }
 
-double tan_f64(double x) {
-  return tan(x);
+void* simitMalloc(int allocator, int bytes) {
+  return simit::internal::MemoryTracker::getInstance().allocate(allocator,
+                                                                bytes);
 }
 
-float tan_f32(float x) {
-  double d_x = x;
-  return (float)tan(d_x);
-}
-
-double asin_f64(double x) {
-  return asin(x);
-}
-
-float asin_f32(float x) {
-  double d_x = x;
-  return (float)asin(d_x);
-}
-
-double acos_f64(double x) {
-  return acos(x);
-}
-
-float acos_f32(float x) {
-  double d_x = x;
-  return (float)acos(d_x);
-}
-
-double det3_f64(double * a){
-  return a[0] * (a[4]*a[8]-a[5]*a[7])
-       - a[1] * (a[3]*a[8]-a[5]*a[6])
-       + a[2] * (a[3]*a[7]-a[4]*a[6]);
-}
-
-float det3_f32(float * a){
-  return a[0] * (a[4]*a[8]-a[5]*a[7])
-       - a[1] * (a[3]*a[8]-a[5]*a[6])
-       + a[2] * (a[3]*a[7]-a[4]*a[6]);
-}
-
-void inv3_f64(double * a, double * inv){
-  double cof00 = a[4]*a[8]-a[5]*a[7];
-  double cof01 =-a[3]*a[8]+a[5]*a[6];
-  double cof02 = a[3]*a[7]-a[4]*a[6];
-
-  double cof10 =-a[1]*a[8]+a[2]*a[7];
-  double cof11 = a[0]*a[8]-a[2]*a[6];
-  double cof12 =-a[0]*a[7]+a[1]*a[6];
-
-  double cof20 = a[1]*a[5]-a[2]*a[4];
-  double cof21 =-a[0]*a[5]+a[2]*a[3];
-  double cof22 = a[0]*a[4]-a[1]*a[3];
-
-  double determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
-
-  determ = 1.0/determ;
-  inv[0] = cof00 * determ;
-  inv[1] = cof10 * determ;
-  inv[2] = cof20 * determ;
-
-  inv[3] = cof01 * determ;
-  inv[4] = cof11 * determ;
-  inv[5] = cof21 * determ;
-
-  inv[6] = cof02 * determ;
-  inv[7] = cof12 * determ;
-  inv[8] = cof22 * determ;
-}
-
-void inv3_f32(float * a, float * inv){
-  float cof00 = a[4]*a[8]-a[5]*a[7];
-  float cof01 =-a[3]*a[8]+a[5]*a[6];
-  float cof02 = a[3]*a[7]-a[4]*a[6];
-
-  float cof10 =-a[1]*a[8]+a[2]*a[7];
-  float cof11 = a[0]*a[8]-a[2]*a[6];
-  float cof12 =-a[0]*a[7]+a[1]*a[6];
-
-  float cof20 = a[1]*a[5]-a[2]*a[4];
-  float cof21 =-a[0]*a[5]+a[2]*a[3];
-  float cof22 = a[0]*a[4]-a[1]*a[3];
-
-  float determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
-
-  determ = 1.0/determ;
-  inv[0] = cof00 * determ;
-  inv[1] = cof10 * determ;
-  inv[2] = cof20 * determ;
-
-  inv[3] = cof01 * determ;
-  inv[4] = cof11 * determ;
-  inv[5] = cof21 * determ;
-
-  inv[6] = cof02 * determ;
-  inv[7] = cof12 * determ;
-  inv[8] = cof22 * determ;
-}
-
-double complexNorm_f64(double r, double i) {
-  return sqrt(r*r+i*i);
-}
-
-float complexNorm_f32(float r, float i) {
-  return sqrt(r*r+i*i);
-}
-
-void simitStoreTime(int i, double value) {
-  simit::ir::TimerStorage::getInstance().storeTime(i, value);
+void simitFree(void* buffer) {
+  simit::internal::MemoryTracker::getInstance().release(buffer);
 }
 
 double simitClock() {
@@ -224,6 +122,48 @@ extern "C" void cMatSolve_f32(int n,  int m,  int* rowptr, int* colidx,
   return solve(n, m, rowptr, colidx, nn, mm, A, x, b);
 }
 
+/// Solve `Ax=b` with geometric multigrid V-cycles, where `A` is a matrix
+/// assembled by a map through a lattice and stored as a stencil. Returns 1 if
+/// the solver did not converge.
+template <typename Float>
+int mgsolve(int Andims, int* Adims, int AnumOffsets, int* Aoffsets,
+            int Ann, int Amm, Float* Avals,
+            int bn, Float* bvals, int xn, Float* xvals) {
+  uassert(Ann == 1 && Amm == 1) << "mgsolve requires a matrix of scalars";
+  int cycles = simit::multigridSolve(Andims, Adims, AnumOffsets, Aoffsets,
+                                     Avals, bvals, xvals);
+  return (cycles < 0) ? 1 : 0;
+}
+extern "C" int smgsolve(int Andims, int* Adims, int AnumOffsets, int* Aoffsets,
+                        int Ann, int Amm, float* Avals,
+                        int bn, float* bvals, int xn, float* xvals) {
+  return mgsolve(Andims, Adims, AnumOffsets, Aoffsets, Ann, Amm, Avals,
+                 bn, bvals, xn, xvals);
+}
+extern "C" int dmgsolve(int Andims, int* Adims, int AnumOffsets, int* Aoffsets,
+                        int Ann, int Amm, double* Avals,
+                        int bn, double* bvals, int xn, double* xvals) {
+  return mgsolve(Andims, Adims, AnumOffsets, Aoffsets, Ann, Amm, Avals,
+                 bn, bvals, xn, xvals);
+}
+
+#ifdef EIGEN
+/// A Cholesky solver that reports the bytes of its factorization, so that the
+/// factorizations that generated code caches are included in memory reports.
+template <typename Float>
+class Cholesky : public SimplicialCholesky<SparseMatrix<Float>> {
+public:
+  size_t getBytes() const {
+    // The factor, its diagonal, the permutation and its inverse, and the
+    // elimination tree and column counts
+    size_t n = this->m_matrix.cols();
+    return this->m_matrix.data().allocatedSize() * (sizeof(Float)+sizeof(int))
+           + (n+1) * sizeof(int) + this->m_diag.size() * sizeof(Float)
+           + 4 * n * sizeof(int);
+  }
+};
+#endif
+
 /// Cholesky factorization. Returns a solver object that can be used with
 /// `lltsolve` and `lltmatsolve`. The solver object must be freed using
 /// `cholfree`.
@@ -234,8 +174,10 @@ int chol(int An,  int Am,  int* Arowptr, int* Acolidx,
 #ifdef EIGEN
   auto A = csr2eigen<Float,Eigen::ColMajor>(An, Am, Arowptr, Acolidx,
                                             Ann, Amm, Avals);
-  auto solver = new SimplicialCholesky<SparseMatrix<Float>>();
+  auto solver = new Cholesky<Float>();
   solver->compute(A);
+  simit::internal::MemoryTracker::getInstance().addFactorization(
+      solver, solver->getBytes());
   *solverPtr = static_cast<void*>(solver);
 #else
   SOLVER_ERROR;
@@ -257,7 +199,8 @@ extern "C" int dchol(int An,  int Am,  int* Arowptr, int* Acolidx,
 template <typename Float>
 int cholfree(void** solverPtr) {
 #ifdef EIGEN
-  auto solver=static_cast<SimplicialCholesky<SparseMatrix<Float>>*>(*solverPtr);
+  auto solver = static_cast<Cholesky<Float>*>(*solverPtr);
+  simit::internal::MemoryTracker::getInstance().removeFactorization(solver);
   delete solver;
 #else
   SOLVER_ERROR;
@@ -276,7 +219,7 @@ extern "C" int dcholfree(void** solverPtr){
 template <typename Float>
 int lltsolve(void** solverPtr, int nb, Float *bvals, int nx, Float *xvals) {
 #ifdef EIGEN
-  auto solver=static_cast<SimplicialCholesky<SparseMatrix<Float>>*>(*solverPtr);
+  auto solver = static_cast<Cholesky<Float>*>(*solverPtr);
   auto b = dense2eigen(nb, bvals);
   auto x = Eigen::Matrix<Float,Eigen::Dynamic,1>(nx);
   x = solver->solve(b);
@@ -306,7 +249,7 @@ int lltmatsolve(void** solverPtr,
                  int Xn,  int Xm,  int** Xrowptr, int** Xcolidx,
                  int Xnn, int Xmm, Float** Xvals){
 #ifdef EIGEN
-  auto solver=static_cast<SimplicialCholesky<SparseMatrix<Float>>*>(*solverPtr);
+  auto solver = static_cast<Cholesky<Float>*>(*solverPtr);
   auto B = csr2eigen<Float>(Bn, Bm, Browptr, Bcolidx, Bnn, Bmm, Bvals);
   SparseMatrix<Float> X(Xn, Xm);
   X = solver->solve(B);
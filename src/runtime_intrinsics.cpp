@@ -0,0 +1,163 @@
+// The runtime intrinsics that the code generated by the LLVM backend calls
+// for the Simit intrinsics with no direct LLVM equivalent. They are compiled
+// into the library, and also to LLVM bitcode that the backend links into the
+// code it generates, so that the calls can be inlined and vectorized. They
+// must therefore not depend on anything but the C math library and the math
+// library of runtime_math.h.
+#include <cmath>
+
+#include "runtime_math.h"
+
+extern "C" {
+int loc(int v0, int v1, int *neighbors_start, int *neighbors) {
+  int l = neighbors_start[v0];
+  while(neighbors[l] != v1) l++;
+  return l;
+}
+
+double atan2_f64(double y, double x) {
+  return atan2(y, x);
+}
+
+float atan2_f32(float y, float x) {
+  double d_y = y;
+  double d_x = x;
+  return (float)atan2(d_y, d_x);
+}
+
+double tan_f64(double x) {
+  return tan(x);
+}
+
+float tan_f32(float x) {
+  double d_x = x;
+  return (float)tan(d_x);
+}
+
+double asin_f64(double x) {
+  return asin(x);
+}
+
+float asin_f32(float x) {
+  double d_x = x;
+  return (float)asin(d_x);
+}
+
+double acos_f64(double x) {
+  return acos(x);
+}
+
+float acos_f32(float x) {
+  double d_x = x;
+  return (float)acos(d_x);
+}
+
+double det3_f64(double * a){
+  return a[0] * (a[4]*a[8]-a[5]*a[7])
+       - a[1] * (a[3]*a[8]-a[5]*a[6])
+       + a[2] * (a[3]*a[7]-a[4]*a[6]);
+}
+
+float det3_f32(float * a){
+  return a[0] * (a[4]*a[8]-a[5]*a[7])
+       - a[1] * (a[3]*a[8]-a[5]*a[6])
+       + a[2] * (a[3]*a[7]-a[4]*a[6]);
+}
+
+void inv3_f64(double * a, double * inv){
+  double cof00 = a[4]*a[8]-a[5]*a[7];
+  double cof01 =-a[3]*a[8]+a[5]*a[6];
+  double cof02 = a[3]*a[7]-a[4]*a[6];
+
+  double cof10 =-a[1]*a[8]+a[2]*a[7];
+  double cof11 = a[0]*a[8]-a[2]*a[6];
+  double cof12 =-a[0]*a[7]+a[1]*a[6];
+
+  double cof20 = a[1]*a[5]-a[2]*a[4];
+  double cof21 =-a[0]*a[5]+a[2]*a[3];
+  double cof22 = a[0]*a[4]-a[1]*a[3];
+
+  double determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
+
+  determ = 1.0/determ;
+  inv[0] = cof00 * determ;
+  inv[1] = cof10 * determ;
+  inv[2] = cof20 * determ;
+
+  inv[3] = cof01 * determ;
+  inv[4] = cof11 * determ;
+  inv[5] = cof21 * determ;
+
+  inv[6] = cof02 * determ;
+  inv[7] = cof12 * determ;
+  inv[8] = cof22 * determ;
+}
+
+void inv3_f32(float * a, float * inv){
+  float cof00 = a[4]*a[8]-a[5]*a[7];
+  float cof01 =-a[3]*a[8]+a[5]*a[6];
+  float cof02 = a[3]*a[7]-a[4]*a[6];
+
+  float cof10 =-a[1]*a[8]+a[2]*a[7];
+  float cof11 = a[0]*a[8]-a[2]*a[6];
+  float cof12 =-a[0]*a[7]+a[1]*a[6];
+
+  float cof20 = a[1]*a[5]-a[2]*a[4];
+  float cof21 =-a[0]*a[5]+a[2]*a[3];
+  float cof22 = a[0]*a[4]-a[1]*a[3];
+
+  float determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
+
+  determ = 1.0/determ;
+  inv[0] = cof00 * determ;
+  inv[1] = cof10 * determ;
+  inv[2] = cof20 * determ;
+
+  inv[3] = cof01 * determ;
+  inv[4] = cof11 * determ;
+  inv[5] = cof21 * determ;
+
+  inv[6] = cof02 * determ;
+  inv[7] = cof12 * determ;
+  inv[8] = cof22 * determ;
+}
+
+double complexNorm_f64(double r, double i) {
+  return sqrt(r*r+i*i);
+}
+
+float complexNorm_f32(float r, float i) {
+  return sqrt(r*r+i*i);
+}
+
+// The transcendental intrinsics of each accuracy tier of the math library,
+// named <intrinsic>_<tier>_<type>
+#define SIMIT_MATH_UNARY(name, tier, Tier, Float, type)                   \
+  Float name##_##tier##_##type(Float x) {                                 \
+    return simit::math::name<Float,simit::math::Tier>(x);                 \
+  }
+#define SIMIT_MATH_BINARY(name, tier, Tier, Float, type)                  \
+  Float name##_##tier##_##type(Float x, Float y) {                        \
+    return simit::math::name<Float,simit::math::Tier>(x, y);              \
+  }
+#define SIMIT_MATH_TIER(tier, Tier)                                       \
+  SIMIT_MATH_UNARY(sin, tier, Tier, double, f64)                          \
+  SIMIT_MATH_UNARY(sin, tier, Tier, float, f32)                           \
+  SIMIT_MATH_UNARY(cos, tier, Tier, double, f64)                          \
+  SIMIT_MATH_UNARY(cos, tier, Tier, float, f32)                           \
+  SIMIT_MATH_UNARY(exp, tier, Tier, double, f64)                          \
+  SIMIT_MATH_UNARY(exp, tier, Tier, float, f32)                           \
+  SIMIT_MATH_UNARY(log, tier, Tier, double, f64)                          \
+  SIMIT_MATH_UNARY(log, tier, Tier, float, f32)                           \
+  SIMIT_MATH_BINARY(pow, tier, Tier, double, f64)                         \
+  SIMIT_MATH_BINARY(pow, tier, Tier, float, f32)                          \
+  SIMIT_MATH_BINARY(atan2, tier, Tier, double, f64)                       \
+  SIMIT_MATH_BINARY(atan2, tier, Tier, float, f32)
+
+SIMIT_MATH_TIER(high, High)
+SIMIT_MATH_TIER(low, Low)
+
+#undef SIMIT_MATH_TIER
+#undef SIMIT_MATH_BINARY
+#undef SIMIT_MATH_UNARY
+} // extern "C"
@@ -0,0 +1,248 @@
+#ifndef SIMIT_RUNTIME_MATH_H
+#define SIMIT_RUNTIME_MATH_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace simit {
+namespace math {
+
+// Implementations of the transcendental intrinsics without branches, calls or
+// tables, so that once they are inlined into a loop the loop can be
+// vectorized. They are parameterized by the floating point type and by an
+// accuracy tier, that trades the number of polynomial terms for accuracy.
+
+/// Accuracy tiers of the math library.
+enum Accuracy {
+  High, ///< Within a few ulp
+  Low   ///< About half the significand bits
+};
+
+template <typename Float> struct FloatTraits;
+
+template <> struct FloatTraits<double> {
+  typedef int64_t Bits;
+  static const int significandBits = 52;
+  static const int exponentBias = 1023;
+
+  /// pi/2 in three parts, the first two with trailing zeros, so that
+  /// multiples of them are exact for the arguments of sin and cos.
+  static constexpr double pio2a = 1.57079625129699707031e+00;
+  static constexpr double pio2b = 7.54978941586159635335e-08;
+  static constexpr double pio2c = 5.39030285815811905290e-15;
+
+  /// ln(2) in two parts, the first with trailing zeros.
+  static constexpr double ln2a = 6.93145751953125e-1;
+  static constexpr double ln2b = 1.42860682030941723212e-6;
+};
+
+template <> struct FloatTraits<float> {
+  typedef int32_t Bits;
+  static const int significandBits = 23;
+  static const int exponentBias = 127;
+  static constexpr float pio2a = 1.5703125f;
+  static constexpr float pio2b = 4.837512969970703125e-4f;
+  static constexpr float pio2c = 7.54978995489188216e-8f;
+  static constexpr float ln2a = 0.693359375f;
+  static constexpr float ln2b = -2.12194440e-4f;
+};
+
+template <typename Float>
+inline typename FloatTraits<Float>::Bits toBits(Float x) {
+  typename FloatTraits<Float>::Bits bits;
+  std::memcpy(&bits, &x, sizeof(x));
+  return bits;
+}
+
+template <typename Float>
+inline Float fromBits(typename FloatTraits<Float>::Bits bits) {
+  Float x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+/// 2^n, for n in the range of normal exponents.
+template <typename Float>
+inline Float pow2(int n) {
+  typedef typename FloatTraits<Float>::Bits Bits;
+  return fromBits<Float>(Bits(n + FloatTraits<Float>::exponentBias)
+                         << FloatTraits<Float>::significandBits);
+}
+
+/// The number of polynomial terms to evaluate for the type and accuracy.
+template <typename Float, Accuracy accuracy>
+inline int terms(int highDouble, int lowDouble, int highFloat, int lowFloat) {
+  return (sizeof(Float) == sizeof(double))
+         ? (accuracy == High ? highDouble : lowDouble)
+         : (accuracy == High ? highFloat  : lowFloat);
+}
+
+/// Evaluates the polynomial with the first n coefficients c, constant term
+/// first, at x.
+template <typename Float, int N>
+inline Float polynomial(Float x, const double (&c)[N], int n) {
+  Float p = Float(c[n-1]);
+  for (int i = n-2; i >= 0; --i) {
+    p = p*x + Float(c[i]);
+  }
+  return p;
+}
+
+/// e^x, reduced to e^r * 2^n with |r| <= ln(2)/2.
+template <typename Float, Accuracy accuracy>
+inline Float exp(Float x) {
+  typedef FloatTraits<Float> Traits;
+  // Taylor coefficients of e^r
+  static const double c[] = {1.0, 1.0, 1.0/2, 1.0/6, 1.0/24, 1.0/120,
+                             1.0/720, 1.0/5040, 1.0/40320, 1.0/362880,
+                             1.0/3628800, 1.0/39916800, 1.0/479001600,
+                             1.0/6227020800};
+  const int n = terms<Float,accuracy>(14, 8, 8, 5);
+
+  // Beyond these bounds the result overflows or underflows
+  const Float maxArg = Float(Traits::exponentBias + 2) * Float(M_LN2);
+  const Float minArg = -Float(Traits::exponentBias + Traits::significandBits +
+                              2) * Float(M_LN2);
+  Float xc = (x > maxArg) ? maxArg : x;
+  xc = (xc < minArg) ? minArg : xc;
+  xc = (x != x) ? Float(0) : xc;
+
+  Float k = std::floor(xc * Float(M_LOG2E) + Float(0.5));
+  Float r = (xc - k*Traits::ln2a) - k*Traits::ln2b;
+
+  // Scale by 2^k in two steps, so that results that overflow are infinite
+  // and subnormal results are exact
+  int ki = int(k);
+  int k1 = ki / 2;
+  Float result = polynomial(r, c, n) * pow2<Float>(k1) * pow2<Float>(ki - k1);
+  return (x != x) ? x : result;
+}
+
+/// The natural logarithm, reduced to log(m) + e*log(2) with m in
+/// [sqrt(1/2), sqrt(2)), where log(m) = 2*atanh((m-1)/(m+1)).
+template <typename Float, Accuracy accuracy>
+inline Float log(Float x) {
+  typedef FloatTraits<Float> Traits;
+  typedef typename Traits::Bits Bits;
+  // Coefficients of 2*atanh(s)/s in s^2
+  static const double c[] = {2.0, 2.0/3, 2.0/5, 2.0/7, 2.0/9, 2.0/11, 2.0/13,
+                             2.0/15, 2.0/17, 2.0/19};
+  const int n = terms<Float,accuracy>(10, 5, 5, 3);
+
+  // Subnormals are scaled into the normal range
+  bool subnormal = x < std::numeric_limits<Float>::min();
+  Float y = subnormal ? x * pow2<Float>(Traits::significandBits) : x;
+
+  const Bits significandMask = (Bits(1) << Traits::significandBits) - 1;
+  Bits bits = toBits(y);
+  int e = int(bits >> Traits::significandBits) - Traits::exponentBias;
+  Float m = fromBits<Float>((bits & significandMask) |
+                            (Bits(Traits::exponentBias) <<
+                             Traits::significandBits));
+  bool large = m > Float(M_SQRT2);
+  m = large ? m * Float(0.5) : m;
+  e = large ? e + 1 : e;
+  e = subnormal ? e - Traits::significandBits : e;
+
+  Float s = (m - Float(1)) / (m + Float(1));
+  Float fe = Float(e);
+  Float result = (s*polynomial(s*s, c, n) + fe*Traits::ln2b) +
+                 fe*Traits::ln2a;
+
+  const Float infinity = std::numeric_limits<Float>::infinity();
+  result = (x == infinity) ? infinity : result;
+  result = (x == Float(0)) ? -infinity : result;
+  result = (x < Float(0) || x != x) ? std::numeric_limits<Float>::quiet_NaN()
+                                    : result;
+  return result;
+}
+
+/// x^y, computed as e^(y*log(|x|)), so its relative error grows with the
+/// magnitude of y*log(|x|).
+template <typename Float, Accuracy accuracy>
+inline Float pow(Float x, Float y) {
+  Float result = exp<Float,accuracy>(y * log<Float,accuracy>(std::fabs(x)));
+
+  Float half = y * Float(0.5);
+  bool integer = std::floor(y) == y;
+  bool odd = integer && std::floor(half) != half;
+  result = (x < Float(0) && odd) ? -result : result;
+  result = (x < Float(0) && !integer)
+           ? std::numeric_limits<Float>::quiet_NaN() : result;
+  result = (y == Float(0) || x == Float(1)) ? Float(1) : result;
+  return result;
+}
+
+/// sin(x + quadrant*pi/2), reduced to +-sin(r) or +-cos(r) with |r| <= pi/4.
+/// The reduction is exact for |x| < 2^30 (doubles) and |x| < 2^13 (floats).
+template <typename Float, Accuracy accuracy>
+inline Float sinQuadrant(Float x, int quadrant) {
+  typedef FloatTraits<Float> Traits;
+  // Taylor coefficients of (sin(r)-r)/r^3 and (cos(r)-1)/r^2 in r^2
+  static const double s[] = {-1.0/6, 1.0/120, -1.0/5040, 1.0/362880,
+                             -1.0/39916800, 1.0/6227020800,
+                             -1.0/1307674368000, 1.0/355687428096000};
+  static const double c[] = {-1.0/2, 1.0/24, -1.0/720, 1.0/40320,
+                             -1.0/3628800, 1.0/479001600,
+                             -1.0/87178291200, 1.0/20922789888000};
+  const int ns = terms<Float,accuracy>(7, 4, 4, 2);
+  const int nc = terms<Float,accuracy>(8, 5, 5, 3);
+
+  // The quadrant must fit in an int
+  const Float maxArg = Float(1 << 30);
+  Float xq = (std::fabs(x) < maxArg) ? x : Float(0);
+  Float k = std::floor(xq * Float(M_2_PI) + Float(0.5));
+  Float r = ((x - k*Traits::pio2a) - k*Traits::pio2b) - k*Traits::pio2c;
+  quadrant = (int(k) + quadrant) & 3;
+
+  Float r2 = r*r;
+  Float sinr = r + r*r2*polynomial(r2, s, ns);
+  Float cosr = Float(1) + r2*polynomial(r2, c, nc);
+  Float result = (quadrant & 1) ? cosr : sinr;
+  return (quadrant & 2) ? -result : result;
+}
+
+template <typename Float, Accuracy accuracy>
+inline Float sin(Float x) {
+  return sinQuadrant<Float,accuracy>(x, 0);
+}
+
+template <typename Float, Accuracy accuracy>
+inline Float cos(Float x) {
+  return sinQuadrant<Float,accuracy>(x, 1);
+}
+
+/// atan2(y,x), reduced to atan(t) with t in [0,1] by symmetry, and further to
+/// t in [0,tan(pi/16)] with two applications of
+/// atan(t) = 2*atan(t/(1+sqrt(1+t^2))).
+template <typename Float, Accuracy accuracy>
+inline Float atan2(Float y, Float x) {
+  // Taylor coefficients of (atan(u)-u)/u^3 in u^2
+  static const double c[] = {-1.0/3, 1.0/5, -1.0/7, 1.0/9, -1.0/11, 1.0/13,
+                             -1.0/15, 1.0/17, -1.0/19, 1.0/21};
+  const int n = terms<Float,accuracy>(10, 5, 4, 2);
+
+  const Float infinity = std::numeric_limits<Float>::infinity();
+  Float ax = std::fabs(x);
+  Float ay = std::fabs(y);
+  bool steep = ay > ax;
+  Float lo = steep ? ax : ay;
+  Float hi = steep ? ay : ax;
+  Float t = (hi == Float(0)) ? Float(0) : lo / hi;
+  t = (lo == infinity) ? Float(1) : t;
+
+  Float u = t / (Float(1) + std::sqrt(Float(1) + t*t));
+  u = u / (Float(1) + std::sqrt(Float(1) + u*u));
+  Float u2 = u*u;
+  Float result = Float(4) * (u + u*u2*polynomial(u2, c, n));
+
+  result = steep ? Float(M_PI_2) - result : result;
+  result = std::signbit(x) ? Float(M_PI) - result : result;
+  result = std::signbit(y) ? -result : result;
+  return (x != x || y != y) ? x + y : result;
+}
+
+}}
+#endif
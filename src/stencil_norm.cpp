@@ -28,9 +28,12 @@ class NormalizeRowIndices : public IRRewriter {
   }
 
   void visit(const SetRead *op) {
-    iassert(rowNormOff.size() != 0)
-        << "Set read visit not paired to output write";
-    
+    // Set reads outside output writes are already relative to the origin
+    if (rowNormOff.size() == 0) {
+      expr = op;
+      return;
+    }
+
     vector<int> litInds = getLitInds(op);
     vector<Expr> newInds;
     if (litInds.size() == rowNormOff.size()) { // point set
@@ -1,171 +1,375 @@
 #include "timers.h"
 
-#include "storage.h"
-#include "ir_builder.h"
-#include "ir_rewriter.h"
-#include "ir_transforms.h"
-#include "inline.h"
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #include "ir.h"
+#include "ir_rewriter.h"
+#include "init.h"
 #include "intrinsics.h"
+#include "perf_counters.h"
+#include "util/util.h"
 
 using namespace std;
 
 namespace simit {
 namespace ir {
 
-void printTimes() {
-  const int LINE_LIMIT = 80;
-  double percentageSum = 0.0;
-
-  for (auto line: simit::ir::TimerStorage::getInstance().getSourceLines()) {
-    size_t first = line.find_first_not_of(' ');
-    size_t last = line.find_last_not_of('\n');
-    std::string test = "";
-    if ( first != last ) {
-      test = line.substr(first, (last-first+1));
-      line = line.substr(0, (last+1));
-    }
-    int index = simit::ir::TimerStorage::getInstance().getTimedLineIndex(test);
-    if ( index >= 0) {
-      double percentage= TimerStorage::getInstance().getTimingPercentage(index);
-      percentageSum += percentage;
-      unsigned long long int timerCount =
-          TimerStorage::getInstance().getCounter(index);
-      if (line.length() < LINE_LIMIT) {
-        line.append(LINE_LIMIT - line.length(), ' ');
-        printf("%s (%f%s, %llu)\n", line.c_str(), percentage , "%", timerCount);
-      } else {
-        printf("%s (%f%s, %llu)\n", line.substr(0,LINE_LIMIT).c_str(),
-               percentage, "%", timerCount);
-        for (unsigned x=LINE_LIMIT; x < line.length(); x+= LINE_LIMIT) {
-          printf("\t %s\n",line.substr(x, LINE_LIMIT).c_str());
-        }
-      }
-    } else {
-      if (line.length() < LINE_LIMIT) {
-        line.append(LINE_LIMIT - line.length(), ' ');
-        printf("%s\n", line.c_str());
-      } else {
-        printf("%s\n", line.substr(0,LINE_LIMIT).c_str());
-        for (unsigned x=LINE_LIMIT; x < line.length(); x+= LINE_LIMIT) {
-          printf("\t %s\n",line.substr(x, LINE_LIMIT).c_str());
-        }
-      }
-    }
+uint64_t readCycleCounter() {
+  // The counter that llvm.readcyclecounter reads on the host
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#elif defined(__aarch64__)
+  uint64_t cycles;
+  asm volatile("mrs %0, cntvct_el0" : "=r"(cycles));
+  return cycles;
+#else
+  return chrono::duration_cast<chrono::nanoseconds>(
+      chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// class TimerStorage
+TimerStorage::TimerStorage() {
+  startCycles = readCycleCounter();
+  startTime = chrono::steady_clock::now();
+}
+
+TimerStorage::~TimerStorage() {
+  for (auto counters : threadCounters) {
+    delete counters;
   }
+}
 
-  printf("Total Time: %f (seconds)\n",
-         simit::ir::TimerStorage::getInstance().getTotalTime() / 1000000.0);
+int TimerStorage::addSite(const TimerSite& site) {
+  lock_guard<std::mutex> lock(mutex);
+  int slot = sites.size();
+  sites.push_back(site);
+  if (site.profile == -1) {
+    sites.back().profile = slot;
+  }
+  enabled.push_back(true);
+  return slot;
 }
 
-// Singleton
-class InsertTimers : public IRRewriter {
-  using IRRewriter::visit;
-  public: 
-    static InsertTimers& getInstance() {
-      static InsertTimers instance; 
-      return instance;
+void TimerStorage::setParent(int site, int parent) {
+  lock_guard<std::mutex> lock(mutex);
+  sites[site].parent = parent;
+}
+
+/// Zero the counters of the site, with no shortest run.
+static void resetCounters(int64_t* counters) {
+  counters[0] = 0;
+  counters[1] = 0;
+  counters[2] = numeric_limits<int64_t>::max();
+  counters[3] = 0;
+  counters[4] = 0;
+  counters[5] = 0;
+}
+
+TimerStorage::ThreadCounters* TimerStorage::getThreadCounters() {
+  static thread_local ThreadCounters* counters = nullptr;
+  if (counters == nullptr || counters->timers.size() <
+                             kCountersPerSite * sites.size()) {
+    lock_guard<std::mutex> lock(mutex);
+    if (counters == nullptr) {
+      counters = new ThreadCounters();
+      threadCounters.push_back(counters);
     }
-    
-    void visit(const TensorWrite *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+    size_t oldSize = counters->timers.size();
+    size_t size = kCountersPerSite * sites.size();
+    counters->timers.resize(size);
+    for (size_t i = oldSize; i < size; i += kCountersPerSite) {
+      resetCounters(&counters->timers[i]);
     }
+    counters->events.resize(kNumPerfEvents * sites.size(), 0);
+    counters->eventStarts.resize(kNumPerfEvents * sites.size(), 0);
+  }
+  return counters;
+}
 
-    void visit(const FieldWrite *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+int64_t* TimerStorage::getCounters(int profile) {
+  if (!enabled[profile]) {
+    static thread_local vector<int64_t> discarded;
+    discarded.resize(kCountersPerSite * sites.size());
+    return discarded.data();
+  }
+  return getThreadCounters()->timers.data();
+}
+
+void TimerStorage::startEvents(int site) {
+  if (!enabled[sites[site].profile]) {
+    return;
+  }
+  ThreadCounters* counters = getThreadCounters();
+  if (counters->perfCounters == nullptr) {
+    counters->perfCounters.reset(new PerfCounterGroup());
+  }
+  counters->perfCounters->read(&counters->eventStarts[kNumPerfEvents*site]);
+}
+
+void TimerStorage::stopEvents(int site) {
+  ThreadCounters* counters = getThreadCounters();
+  if (!enabled[sites[site].profile] || counters->perfCounters == nullptr) {
+    return;
+  }
+  int64_t events[kNumPerfEvents];
+  counters->perfCounters->read(events);
+  for (int event = 0; event < kNumPerfEvents; ++event) {
+    counters->events[kNumPerfEvents*site + event] +=
+        events[event] - counters->eventStarts[kNumPerfEvents*site + event];
+  }
+}
+
+void TimerStorage::setEnabled(int profile, bool enabled) {
+  lock_guard<std::mutex> lock(mutex);
+  this->enabled[profile] = enabled;
+}
+
+int64_t TimerStorage::sumCounters(size_t index) {
+  lock_guard<std::mutex> lock(mutex);
+  int64_t sum = 0;
+  for (auto counters : threadCounters) {
+    if (index < counters->timers.size()) {
+      sum += counters->timers[index];
     }
-    
-    void visit(const Map *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+  }
+  return sum;
+}
+
+double TimerStorage::getCyclesPerSecond() {
+  // Measure the frequency over at least 10 milliseconds
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - startTime;
+  if (elapsed.count() < 0.01) {
+    this_thread::sleep_for(chrono::milliseconds(10));
+    elapsed = chrono::steady_clock::now() - startTime;
+  }
+  return (readCycleCounter() - startCycles) / elapsed.count();
+}
+
+double TimerStorage::getTime(int site) {
+  return sumCounters(kCountersPerSite*site) / getCyclesPerSecond();
+}
+
+uint64_t TimerStorage::getCount(int site) {
+  return sumCounters(kCountersPerSite*site + 1);
+}
+
+double TimerStorage::getTotalTime() {
+  double total = 0.0;
+  for (size_t i = 0; i < sites.size(); ++i) {
+    if (sites[i].parent == -1) {
+      total += getTime(i);
     }
-    
-    void visit(const Store *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+  }
+  return total;
+}
+
+std::vector<ProfileRecord> TimerStorage::getRecords(int profile) {
+  double cyclesPerSecond = getCyclesPerSecond();
+  lock_guard<std::mutex> lock(mutex);
+  vector<ProfileRecord> records;
+  for (size_t thread = 0; thread < threadCounters.size(); ++thread) {
+    const ThreadCounters& thisThread = *threadCounters[thread];
+    const vector<int64_t>& counters = thisThread.timers;
+    for (size_t site = 0; site < sites.size(); ++site) {
+      size_t index = kCountersPerSite*site;
+      if (sites[site].profile != profile || index >= counters.size() ||
+          counters[index+1] == 0) {
+        continue;
+      }
+      ProfileRecord record = {(int)site, sites[site].parent,
+                              sites[site].function, sites[site].label,
+                              (int)thread, (uint64_t)counters[index+1],
+                              counters[index]   / cyclesPerSecond,
+                              counters[index+2] / cyclesPerSecond,
+                              counters[index+3] / cyclesPerSecond,
+                              (uint64_t)counters[index+4],
+                              (uint64_t)counters[index+5], {}};
+      if (sites[site].countsEvents) {
+        const PerfCounterGroup* perfCounters = thisThread.perfCounters.get();
+        for (int event = 0; event < kNumPerfEvents; ++event) {
+          bool available = perfCounters != nullptr &&
+                           perfCounters->isAvailable(PerfEvent(event));
+          record.events.push_back(
+              available ? thisThread.events[kNumPerfEvents*site + event] : -1);
+        }
+      }
+      records.push_back(record);
     }
-    
-    void visit(const CallStmt *op) {
-      if (op->callee.getKind() == Func::Intrinsic) { 
-        Var timeStartVar = initTimer(util::toString(*op),stmt);
-        stmt = Block::make(stmt,op);
-        storeTimer(stmt, timeStartVar);
-      } else {
-        stmt = Block::make(stmt, op);
+  }
+  return records;
+}
+
+void TimerStorage::reset(int profile) {
+  lock_guard<std::mutex> lock(mutex);
+  for (auto counters : threadCounters) {
+    for (size_t site = 0; site < sites.size(); ++site) {
+      size_t index = kCountersPerSite*site;
+      if ((profile == -1 || sites[site].profile == profile) &&
+          index < counters->timers.size()) {
+        resetCounters(&counters->timers[index]);
+        fill_n(&counters->events[kNumPerfEvents*site], kNumPerfEvents, 0);
       }
     }
-    
-    void visit(const AssignStmt *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+  }
+}
+
+static void printSite(int site, double rootTime, int depth,
+                      const map<int,vector<int>>& children) {
+  TimerStorage& timers = TimerStorage::getInstance();
+  double time = timers.getTime(site);
+  double selfTime = time;
+  if (children.find(site) != children.end()) {
+    for (int child : children.at(site)) {
+      selfTime -= timers.getTime(child);
     }
-    
-    void visit(const IfThenElse *op) {
-      Expr start = rewrite(op->condition);
-      Stmt thenBody = rewrite(op->thenBody);
-      Stmt elseBody = rewrite(op->elseBody);
-      
-      stmt = IfThenElse::make(op->condition, thenBody, elseBody);
+  }
+  double total = (rootTime > 0.0) ? 100.0 * time / rootTime : 0.0;
+  double self = (rootTime > 0.0) ? 100.0 * selfTime / rootTime : 0.0;
+  printf("%12.6f %7.2f%% %7.2f%% %12llu  %s%s\n", time, total, self,
+         (unsigned long long)timers.getCount(site), string(2*depth, ' ').c_str(),
+         timers.getSites()[site].label.c_str());
+  if (children.find(site) != children.end()) {
+    for (int child : children.at(site)) {
+      printSite(child, rootTime, depth+1, children);
     }
-    
-    void visit(const ForRange *op) {
-      Expr start = rewrite(op->start);
-      Expr end = rewrite(op->end);
-      Stmt body = rewrite(op->body);
-      
-      stmt = ForRange::make(op->var, start, end, body);
+  }
+}
+
+void printTimes() {
+  TimerStorage& timers = TimerStorage::getInstance();
+  const vector<TimerSite>& sites = timers.getSites();
+
+  map<int,vector<int>> children;
+  for (size_t i = 0; i < sites.size(); ++i) {
+    children[sites[i].parent].push_back(i);
+  }
+
+  printf("%12s %8s %8s %12s  %s\n", "seconds", "total", "self", "runs",
+         "site");
+  for (int root : children[-1]) {
+    printSite(root, timers.getTime(root), 0, children);
+  }
+  printf("Total Time: %f (seconds)\n", timers.getTotalTime());
+}
+
+/// Calls of intrinsics or externs on system tensors are timed, as they are
+/// solves and other system-level operations.
+static bool isSystemCall(const CallStmt *op) {
+  if (op->callee.getKind() == Func::Internal) {
+    return false;
+  }
+  for (auto& actual : op->actuals) {
+    if (isSystemTensorType(actual.type())) {
+      return true;
     }
-    
-    void visit(const For *op) {
-      Stmt body = rewrite(op->body);
-      
-      stmt = For::make(op->var, op->domain, body);
+  }
+  for (auto& result : op->results) {
+    if (isSystemTensorType(result.getType())) {
+      return true;
     }
-  
-    Var getTimeVar() {
-      return timeStartVar;
+  }
+  return false;
+}
+
+class InsertTimers : public IRRewriterCallGraph {
+  /// The site of the code being rewritten, and the function that contains it.
+  int parent = -1;
+  string function;
+
+  /// The profile of the rewritten call graph, the site of its root function.
+  int profile = -1;
+
+  /// The site of each timed function, and the site it was first called from.
+  map<Func,pair<int,int>> functionSites;
+
+  /// The label of a site: the first line of its statement.
+  static string getLabel(const Stmt& stmt) {
+    string label = util::toString(stmt);
+    return util::trim(label.substr(0, label.find('\n')));
+  }
+
+  Stmt time(int site, Stmt stmt) {
+    return Block::make({CallStmt::make({}, intrinsics::timerStart(), {site}),
+                        stmt,
+                        CallStmt::make({}, intrinsics::timerStop(),
+                                       {site, 0, 0})});
+  }
+
+  /// Time the statement, with the statements it contains nested in its site.
+  template <typename T>
+  void timeStmt(const T *op) {
+    int site = TimerStorage::getInstance().addSite(
+        {getLabel(Stmt(op)), function, parent, profile, kPerfCounters});
+    int enclosing = parent;
+    parent = site;
+    IRRewriter::visit(op);
+    parent = enclosing;
+    stmt = time(site, stmt);
+  }
+
+  using IRRewriter::visit;
+
+  void visit(const Func *op) {
+    if (op->getKind() != Func::Internal) {
+      func = *op;
+      return;
     }
-  private:
-    int counter = 0;
-    Var timeStartVar = Var("simit_internal_time_var", Float);
-    InsertTimers() {};
-    InsertTimers(InsertTimers const&)    = delete;
-    void operator=(InsertTimers const&)  = delete;
-
-    Var initTimer(string line, Stmt& stmt) {
-      TimerStorage::getInstance().addTimedLine(line);
-      Stmt timeStartStmt =
-          CallStmt::make({getTimeVar()}, intrinsics::clock(), {});
-      stmt = Block::make(timeStartStmt, stmt);
-      return timeStartVar;
+    int site = TimerStorage::getInstance().addSite(
+        {"func " + op->getName(), op->getName(), parent, profile,
+         kPerfCounters});
+    if (profile == -1) {
+      profile = site;
     }
+    functionSites[*op] = {site, parent};
+    int enclosing = parent;
+    string enclosingFunction = function;
+    parent = site;
+    function = op->getName();
+    Stmt body = rewrite(op->getBody());
+    parent = enclosing;
+    function = enclosingFunction;
+    func = Func(*op, time(site, body));
+  }
 
-    void storeTimer(Stmt& stmt, Var& timeStartVar) {
-      Var clock("clock", Float);
-      Stmt clockDecl = VarDecl::make(clock);
-      Stmt clockStmt = CallStmt::make({clock}, intrinsics::clock(), {});
-      Expr subtraction = Sub::make(clock, VarExpr::make(timeStartVar));
-      Stmt store = CallStmt::make({}, intrinsics::storeTime(),
-          {counter, subtraction});
-      stmt = Block::make({clockDecl, clockStmt, stmt, store});
-      counter++;
+  void visit(const CallStmt *op) {
+    if (op->callee.getKind() == Func::Internal) {
+      // Functions called from more than one site are roots
+      auto functionSite = functionSites.find(op->callee);
+      if (functionSite != functionSites.end() &&
+          functionSite->second.second != parent) {
+        TimerStorage::getInstance().setParent(functionSite->second.first, -1);
+      }
+      IRRewriterCallGraph::visit(op);
     }
+    else if (isSystemCall(op)) {
+      timeStmt(op);
+    }
+    else {
+      stmt = op;
+    }
+  }
+
+  // Map kernels are not rewritten, so they are not timed
+  void visit(const Map *op) {timeStmt(op);}
+
+  void visit(const For *op) {timeStmt(op);}
+  void visit(const ForRange *op) {timeStmt(op);}
+  void visit(const While *op) {timeStmt(op);}
 };
 
 Func insertTimers(Func func) {
-  Var timeStartVar = InsertTimers::getInstance().getTimeVar();
-  Func timerFunc = Func(func, Block::make(VarDecl::make(timeStartVar), 
-        func.getBody()));
-  timerFunc = InsertTimers::getInstance().rewrite(timerFunc);
-  return timerFunc;
+  return InsertTimers().rewrite(func);
 }
 
 }}
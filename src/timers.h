@@ -1,81 +1,148 @@
 #ifndef SIMIT_TIMERS_H
 #define SIMIT_TIMERS_H
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include "ir.h"
+#include "profile.h"
 
 namespace simit {
 namespace ir {
 
+/// Print the profile of the functions compiled with timers, as a tree of the
+/// timed sites with their time, share of the time of their root and runs.
 void printTimes();
+
+/// Time the call graph of the function: the functions, the loops, the maps
+/// and the calls of intrinsics on system tensors. Each timed site is given a
+/// static slot in the TimerStorage, and is enclosed in timerStart and
+/// timerStop intrinsics. Map kernels are not timed, as they are inlined into
+/// the element loops of the maps. The sites form a profile, identified by
+/// the site of the function.
 Func insertTimers(Func func);
 
-// Singleton
-class TimerStorage {
-public:
-  static TimerStorage& getInstance() {
-    static TimerStorage instance; 
-    return instance;
-  }
+/// Read the cycle counter that generated code reads to time sites.
+uint64_t readCycleCounter();
 
-  inline std::vector<std::string>& getSourceLines() {
-    return sourceLines;
-  }
+/// A timed site of generated code.
+struct TimerSite {
+  std::string label;
 
-  inline void addSourceLines(std::stringstream& ss) {
-    for (std::string line; getline(ss, line); sourceLines.push_back(line));
-  }
+  /// The function that contains the site.
+  std::string function;
 
-  inline void addTimedLine(std::string line) {
-    timedLines.push_back(line);
-  }
+  /// The site that encloses this site, or -1 if it is a root. A function
+  /// called from more than one site is a root.
+  int parent;
 
-  inline int getTimedLineIndex(std::string line) {
-    size_t pos = find(timedLines.begin(), timedLines.end(),
-        line.c_str()) - timedLines.begin();
-    if (pos >= timedLines.size()){
-      pos = -1;
-    }
-    return pos;
-  }
+  /// The profile of the site: the site of the function that was compiled
+  /// with timers.
+  int profile;
 
-  inline void storeTime(size_t index, double time) {
-    while (timerCount.size() < index + 1) {
-      timerCount.push_back(0);
-      timerSums.push_back(0);
-    }
-    timerCount[index] += 1;
-    timerSums[index] += time;
-  }
+  /// The site also counts hardware events (see Settings::perfCounters).
+  bool countsEvents;
+};
 
-  inline double getTime(int index) {
-    return timerSums[index];
+class PerfCounterGroup;
+
+/// Storage of the timed sites and of their counters. Generated code reads
+/// the cycle counter at the start and stop of a site, and adds the elapsed
+/// cycles and one run to the counters of the site's slot, and updates the
+/// shortest and longest run. Every thread has its own counters, which the
+/// storage sums when times are read.
+///
+/// The sites of a function compiled with timers form a profile, that can be
+/// stopped so that runs of the function are not counted.
+///
+/// Sites that count hardware events also call startEvents and stopEvents,
+/// which read the thread's perf event counters and add the events of the run
+/// to the site.
+class TimerStorage {
+public:
+  static TimerStorage& getInstance() {
+    static TimerStorage instance;
+    return instance;
   }
 
-  inline unsigned long long int getCounter(int index) {
-    return timerCount[index];
-  }
+  /// The counters of each site: elapsed cycles, runs, the cycles of the
+  /// shortest and the longest run, and the floating point operations and
+  /// bytes of the runs (see countTimedOperations).
+  static const int kCountersPerSite = 6;
 
-  inline double getTotalTime() {
-    double sum = 0;
-    for(auto const &time : timerSums) {
-      sum += time;
-    }
-    return sum;
-  }
+  /// Add a site, and return its slot. A site added with profile -1 starts a
+  /// new profile, that is identified by the site.
+  int addSite(const TimerSite& site);
 
-  inline double getTimingPercentage(int index) {
-    return getTime(index) * 100.0 / getTotalTime(); 
+  void setParent(int site, int parent);
+
+  const std::vector<TimerSite>& getSites() const {
+    return sites;
   }
-  
-  private:
-    std::vector<std::string> sourceLines;
-    std::vector<std::string> timedLines;
-    std::vector<double> timerSums;
-    std::vector<unsigned long long int> timerCount;
-
-    TimerStorage() {};
-    TimerStorage(TimerStorage const&)    = delete;
-    void operator=(TimerStorage const&)  = delete;
+
+  /// The counters of the calling thread for the sites of the profile, at
+  /// kCountersPerSite*i for site i. If the profile is stopped the counters
+  /// are discarded. Sites added later are only counted by the counters
+  /// returned after they were added.
+  int64_t* getCounters(int profile);
+
+  /// Read the hardware event counters of the calling thread at the start and
+  /// at the stop of a run of the site.
+  void startEvents(int site);
+  void stopEvents(int site);
+
+  /// Start or stop counting the runs of the sites of the profile.
+  void setEnabled(int profile, bool enabled);
+
+  /// The records of the sites of the profile that ran, per thread.
+  std::vector<ProfileRecord> getRecords(int profile);
+
+  /// The time of the site in seconds, summed over threads.
+  double getTime(int site);
+
+  /// The runs of the site, summed over threads.
+  uint64_t getCount(int site);
+
+  /// The time of the root sites in seconds.
+  double getTotalTime();
+
+  /// Zero the counters of the sites of the profile, or of all sites if the
+  /// profile is -1, on all threads.
+  void reset(int profile=-1);
+
+private:
+  std::mutex mutex;
+  std::vector<TimerSite> sites;
+  std::vector<char> enabled;
+
+  /// The counters of a thread. The events of site i are at
+  /// kNumPerfEvents*i, and the event counts at the start of its current run
+  /// at the same position of eventStarts.
+  struct ThreadCounters {
+    std::vector<int64_t> timers;
+    std::vector<int64_t> events;
+    std::vector<int64_t> eventStarts;
+    std::unique_ptr<PerfCounterGroup> perfCounters;
+  };
+  std::vector<ThreadCounters*> threadCounters;
+
+  // The cycle counter and the time when the storage was created, to measure
+  // the frequency of the cycle counter
+  uint64_t startCycles;
+  std::chrono::steady_clock::time_point startTime;
+
+  ThreadCounters* getThreadCounters();
+  double getCyclesPerSecond();
+  int64_t sumCounters(size_t index);
+
+  TimerStorage();
+  ~TimerStorage();
+  TimerStorage(TimerStorage const&)    = delete;
+  void operator=(TimerStorage const&)  = delete;
 };
 
 }}
@@ -0,0 +1,62 @@
+#ifndef SIMIT_UTIL_PARALLEL_H
+#define SIMIT_UTIL_PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace simit {
+namespace util {
+
+/// Return the number of worker threads to use for `numWork` units of work,
+/// given that each thread should get at least `grainSize` units.
+inline unsigned numWorkers(size_t numWork, size_t grainSize=1) {
+  unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+  size_t byGrain = (grainSize == 0) ? numWork : numWork / grainSize;
+  return (unsigned)std::max<size_t>(1, std::min<size_t>(hw, byGrain));
+}
+
+/// Split [begin, end) into `numThreads` contiguous chunks and call
+/// `f(threadId, chunkBegin, chunkEnd)` for each of them, one chunk per thread.
+/// Chunk boundaries are deterministic, so callers may use threadId to index
+/// per-thread scratch state.
+template <typename F>
+void parallelChunks(size_t begin, size_t end, unsigned numThreads, F f) {
+  if (end <= begin) {
+    return;
+  }
+  size_t n = end - begin;
+  numThreads = (unsigned)std::max<size_t>(1, std::min<size_t>(numThreads, n));
+  if (numThreads == 1) {
+    f(0u, begin, end);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads-1);
+  for (unsigned t = 1; t < numThreads; ++t) {
+    size_t chunkBegin = begin + (n * t) / numThreads;
+    size_t chunkEnd   = begin + (n * (t+1)) / numThreads;
+    threads.push_back(std::thread(f, t, chunkBegin, chunkEnd));
+  }
+  f(0u, begin, begin + n / numThreads);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+/// Call `f(i)` for every i in [begin, end), splitting the range over as many
+/// threads as the hardware and `grainSize` allow.
+template <typename F>
+void parallelFor(size_t begin, size_t end, size_t grainSize, F f) {
+  unsigned numThreads = numWorkers(end > begin ? end - begin : 0, grainSize);
+  parallelChunks(begin, end, numThreads,
+                 [&f](unsigned, size_t chunkBegin, size_t chunkEnd) {
+    for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+      f(i);
+    }
+  });
+}
+
+}}
+#endif
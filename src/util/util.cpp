@@ -1,6 +1,8 @@
 #include "util.h"
 
 #include <fstream>
+#include <iomanip>
+#include <sstream>
 
 namespace simit {
 namespace util {
@@ -64,6 +66,29 @@ std::string trim(const std::string &str, const std::string &ws) {
   return str.substr(strBegin, strRange);
 }
 
+std::string jsonString(const std::string &str) {
+  std::stringstream ss;
+  ss << "\"";
+  for (char c : str) {
+    switch (c) {
+      case '"':  ss << "\\\""; break;
+      case '\\': ss << "\\\\"; break;
+      case '\n': ss << "\\n";  break;
+      case '\t': ss << "\\t";  break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          ss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << (int)c << std::dec;
+        }
+        else {
+          ss << c;
+        }
+    }
+  }
+  ss << "\"";
+  return ss.str();
+}
+
 void variableLoop(std::vector<int>::const_iterator rangesBegin,
                   std::vector<int>::const_iterator rangesEnd,
                   std::vector<int>::iterator indicesBegin,
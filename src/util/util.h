@@ -69,6 +69,9 @@ int loadText(const std::string &file, std::string *text);
 /// Trim whitespace from string
 std::string trim(const std::string &str, const std::string &ws = " \t\n");
 
+/// Quote the string as a JSON string, escaping quotes and control characters.
+std::string jsonString(const std::string &str);
+
 template <typename T>
 std::string quote(const T& t) {return "'" + simit::util::toString(t) + "'";}
 
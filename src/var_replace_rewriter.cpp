@@ -75,7 +75,7 @@ public:
     Expr end = rewrite(op->end);
     Stmt body = rewrite(op->body);
     if (op->var == init) {
-      stmt = ForRange::make(final, start, end, body);
+      stmt = ForRange::make(final, start, end, body, op->vectorize);
     }
     else {
       IRRewriter::visit(op);
@@ -88,10 +88,10 @@ public:
 
       ForDomain domain = ForDomain(op->domain.set, final,
                                    op->domain.kind, op->domain.indexSet);
-      stmt = For::make(op->var, domain, body);
+      stmt = For::make(op->var, domain, body, op->vectorize);
     }
     else if (op->var == init) {
-      stmt = For::make(final, op->domain, body);
+      stmt = For::make(final, op->domain, body, op->vectorize);
     }
     else {
       IRRewriter::visit(op);
@@ -2,8 +2,13 @@
 
 #include <memory>
 #include <cmath>
+#include <fstream>
+#include <iterator>
+
+#include <unistd.h>
 
 #include "tensor.h"
+#include "init.h"
 #include "ir.h"
 #include "intrinsics.h"
 #include "ir_printer.h"
@@ -176,6 +181,81 @@ TEST(Codegen, atan2) {
   SIMIT_ASSERT_FLOAT_EQ(atan2(1.0,2.0), cRes);
 }
 
+TEST(Codegen, mathLibrary) {
+  // HACK: Set kMathAccuracy to use the in-tree math library
+  simit::kMathAccuracy = "high";
+
+  Var a("a", Float);
+  Var b("b", Float);
+  vector<Var> c;
+  for (int i = 0; i < 6; ++i) {
+    c.push_back(Var("c" + to_string(i), Float));
+  }
+
+  Stmt body = Block::make({
+    CallStmt::make({c[0]}, intrinsics::sin(), {a}),
+    CallStmt::make({c[1]}, intrinsics::cos(), {a}),
+    CallStmt::make({c[2]}, intrinsics::exp(), {a}),
+    CallStmt::make({c[3]}, intrinsics::log(), {a}),
+    CallStmt::make({c[4]}, intrinsics::pow(), {a,b}),
+    CallStmt::make({c[5]}, intrinsics::atan2(), {a,b})
+  });
+
+  Func func = Func("testmath", {a,b}, c, body);
+
+  unique_ptr<Backend> backend = getTestBackend();
+  simit::Function function = backend->compile(func);
+
+  simit_float aArg = 1.5;
+  simit_float bArg = -2.5;
+  simit_float cRes[6] = {0.0};
+
+  function.bind("a", &aArg);
+  function.bind("b", &bArg);
+  for (int i = 0; i < 6; ++i) {
+    function.bind(c[i].getName(), &cRes[i]);
+  }
+
+  function.runSafe();
+
+  SIMIT_ASSERT_FLOAT_EQ(sin(1.5), cRes[0]);
+  SIMIT_ASSERT_FLOAT_EQ(cos(1.5), cRes[1]);
+  SIMIT_ASSERT_FLOAT_EQ(exp(1.5), cRes[2]);
+  SIMIT_ASSERT_FLOAT_EQ(log(1.5), cRes[3]);
+  SIMIT_ASSERT_FLOAT_EQ(pow(1.5,-2.5), cRes[4]);
+  SIMIT_ASSERT_FLOAT_EQ(atan2(1.5,-2.5), cRes[5]);
+
+  simit::kMathAccuracy = "libm";
+}
+
+TEST(Codegen, jitSymbols) {
+  // HACK: Set kJITSymbols to list generated functions in the perf map
+  simit::kJITSymbols = true;
+
+  Var a("a", Float);
+  Var b("b", Float);
+  Func func = Func("testperfmap", {a}, {b}, AssignStmt::make(b, a));
+
+  unique_ptr<Backend> backend = getTestBackend();
+  simit::Function function = backend->compile(func);
+  simit_float aArg = 2.0;
+  simit_float bRes = 0.0;
+  function.bind("a", &aArg);
+  function.bind("b", &bRes);
+  function.runSafe();
+  SIMIT_ASSERT_FLOAT_EQ(2.0, bRes);
+
+  // The function and its harness are in the perf map
+  ifstream perfMap("/tmp/perf-" + to_string(getpid()) + ".map");
+  ASSERT_TRUE(perfMap.good());
+  string perfMapString((istreambuf_iterator<char>(perfMap)),
+                       istreambuf_iterator<char>());
+  ASSERT_NE(string::npos, perfMapString.find(" simit:testperfmap\n"));
+  ASSERT_NE(string::npos, perfMapString.find(" simit:testperfmap_harness\n"));
+
+  simit::kJITSymbols = false;
+}
+
 TEST(Codegen, forloop) {
   Var i("i", Int);
   Var out("out", Int);
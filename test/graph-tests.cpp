@@ -287,6 +287,78 @@ TEST(EdgeSet, EdgeIteratorTest) {
   ASSERT_EQ(count, 4);
 }
 
+TEST(EdgeSet, LatticeEndpoints) {
+  Set points;
+  FieldRef<int> x = points.addField<int>("x");
+
+  const int nx = 5;
+  const int ny = 3;
+  Set links(points, {nx, ny});
+  ASSERT_EQ(nx*ny, points.getSize());
+  ASSERT_EQ(nx*ny*2, links.getSize());
+
+  for (int y = 0; y < ny; ++y) {
+    for (int i = 0; i < nx; ++i) {
+      x.set(links.getLatticePoint({i,y}), i + 10*y);
+    }
+  }
+
+  // Link (p,mu) connects p to its periodic successor in direction mu
+  for (int y = 0; y < ny; ++y) {
+    for (int i = 0; i < nx; ++i) {
+      ElementRef e0 = links.getLatticeLink({i,y}, 0);
+      ElementRef e1 = links.getLatticeLink({i,y}, 1);
+      ASSERT_EQ(i + 10*y, x.get(links.getEndpoint(e0,0)));
+      ASSERT_EQ((i+1)%nx + 10*y, x.get(links.getEndpoint(e0,1)));
+      ASSERT_EQ(i + 10*y, x.get(links.getEndpoint(e1,0)));
+      ASSERT_EQ(i + 10*((y+1)%ny), x.get(links.getEndpoint(e1,1)));
+    }
+  }
+
+  // The endpoints array is built on demand and agrees with getEndpoint
+  const int* endpoints = links.getEndpointsData();
+  for (int e = 0; e < links.getSize(); ++e) {
+    ASSERT_EQ(links.getEndpointIndex(e,0), endpoints[2*e]);
+    ASSERT_EQ(links.getEndpointIndex(e,1), endpoints[2*e+1]);
+  }
+}
+
+TEST(EdgeSet, LatticeMortonOrder) {
+  Set points;
+  const int nx = 8;
+  const int ny = 2;
+  const int nz = 4;
+  Set links(points, {nx, ny, nz}, Set::Morton);
+
+  // Morton order is a permutation of the points, and neighbors in every
+  // direction are close
+  vector<bool> seen(nx*ny*nz, false);
+  for (int z = 0; z < nz; ++z) {
+    for (int y = 0; y < ny; ++y) {
+      for (int x = 0; x < nx; ++x) {
+        ElementRef p = links.getLatticePoint({x,y,z});
+        ASSERT_FALSE(seen[p.getIdent()]);
+        seen[p.getIdent()] = true;
+        ASSERT_EQ(vector<int>({x,y,z}), links.getLatticePointCoords(p));
+      }
+    }
+  }
+  ASSERT_EQ(0, links.getLatticePoint({0,0,0}).getIdent());
+  ASSERT_EQ(1, links.getLatticePoint({1,0,0}).getIdent());
+  ASSERT_EQ(2, links.getLatticePoint({0,1,0}).getIdent());
+  ASSERT_EQ(4, links.getLatticePoint({0,0,1}).getIdent());
+  ASSERT_EQ(8, links.getLatticePoint({2,0,0}).getIdent());
+
+  // Links are ordered by their base points and connect them to their
+  // periodic successors
+  ElementRef link = links.getLatticeLink({7,1,2}, 2);
+  ASSERT_EQ(links.getLatticePoint({7,1,2}).getIdent()*3 + 2, link.getIdent());
+  ASSERT_EQ(links.getLatticePoint({7,1,2}), links.getEndpoint(link,0));
+  ASSERT_EQ(links.getLatticePoint({7,1,3}), links.getEndpoint(link,1));
+  link = links.getLatticeLink({7,1,3}, 0);
+  ASSERT_EQ(links.getLatticePoint({0,1,3}), links.getEndpoint(link,1));
+}
+
 TEST(GraphGenerator, createBox) {
   Set points;
   Set edges(points, points);
@@ -322,3 +394,23 @@ TEST(GraphGenerator, createBox) {
 
   ASSERT_EQ(box.getEdges().size(), 54u);
 }
+
+TEST(GraphGenerator, createPowerLawGraph) {
+  Set vertices;
+  Set edges(vertices, vertices);
+  createPowerLawGraph(&vertices, &edges, 1000, 3);
+  ASSERT_EQ(1000, vertices.getSize());
+  ASSERT_EQ(997*3, edges.getSize());
+
+  // Every vertex after the first three links to three distinct vertices
+  // added before it, and early vertices gather most of the links
+  vector<int> degrees(vertices.getSize(), 0);
+  for (ElementRef edge : edges) {
+    int source = edges.getEndpoint(edge, 0).getIdent();
+    int target = edges.getEndpoint(edge, 1).getIdent();
+    ASSERT_LT(target, source);
+    degrees[target]++;
+  }
+  ASSERT_GT(*max_element(degrees.begin(), degrees.begin()+10), 30);
+  ASSERT_EQ(0, degrees.back());
+}
@@ -0,0 +1,63 @@
+#include "gtest/gtest.h"
+
+#include "graph.h"
+#include "locality.h"
+#include "reorder.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(Locality, chain) {
+  Set points;
+  FieldRef<double> a = points.addField<double>("a");
+  Set edges(points, points);
+  vector<ElementRef> refs;
+  for (int i = 0; i < 4; ++i) {
+    refs.push_back(points.add());
+    a.set(refs.back(), i);
+  }
+  for (int i = 0; i < 3; ++i) {
+    edges.add(refs[i], refs[i+1]);
+  }
+
+  LocalityMetrics metrics = computeLocalityMetrics(edges);
+  ASSERT_EQ(3, metrics.numEdges);
+  ASSERT_EQ(2, metrics.cardinality);
+  ASSERT_DOUBLE_EQ(1.0, metrics.averageSpan);
+  ASSERT_EQ(1, metrics.maxSpan);
+  ASSERT_EQ(1, metrics.bandwidth);
+  ASSERT_EQ(3, metrics.profile);
+
+  // Each edge reads its endpoints and two field values
+  ASSERT_EQ(9u, metrics.accesses);
+  ASSERT_GE(metrics.coldAccesses, 2u);
+  uint64_t reuses = 0;
+  for (auto count : metrics.reuseDistances) {
+    reuses += count;
+  }
+  ASSERT_EQ(metrics.accesses, metrics.coldAccesses + reuses);
+  ASSERT_DOUBLE_EQ((double)metrics.coldAccesses / metrics.accesses,
+                   metrics.missRate(512));
+}
+
+TEST(Locality, reorderingImprovesSpan) {
+  Set points;
+  Set edges(points, points);
+  const int n = 100;
+  vector<ElementRef> refs;
+  for (int i = 0; i < n; ++i) {
+    refs.push_back(points.add());
+  }
+  // A path through the points in a scrambled order
+  for (int i = 0; i+1 < n; ++i) {
+    edges.add(refs[(i*37) % n], refs[((i+1)*37) % n]);
+  }
+
+  LocalityMetrics before = computeLocalityMetrics(edges);
+  reorderSet(edges, ReorderPolicy::RCM);
+  LocalityMetrics after = computeLocalityMetrics(edges);
+  ASSERT_GT(before.bandwidth, 1);
+  ASSERT_EQ(1, after.bandwidth);
+  ASSERT_EQ(1, after.maxSpan);
+  ASSERT_LT(after.profile, before.profile);
+}
@@ -0,0 +1,84 @@
+#include "simit-test.h"
+
+#include <sstream>
+
+#include "graph.h"
+#include "function.h"
+#include "memory_report.h"
+
+using namespace std;
+using namespace simit;
+
+/// The bytes of the report's record with the name, or -1 if it has none.
+static int64_t getBytes(const MemoryReport& report, const string& name) {
+  for (auto& record : report.getRecords()) {
+    if (record.name == name) {
+      return record.bytes;
+    }
+  }
+  return -1;
+}
+
+TEST(Memory, report) {
+  MemoryReport report({{SetMemory, "V fields", 4096},
+                       {IndexMemory, "V neighbor index", 0},
+                       {TemporaryMemory, "A", 96},
+                       {TemporaryMemory, "x", 32},
+                       {CodeMemory, "code sections", 2048}}, 64);
+  ASSERT_EQ(6272u, report.getTotal());
+  ASSERT_EQ(128u, report.getTotal(TemporaryMemory));
+  ASSERT_EQ(0u, report.getTotal(SolverMemory));
+  ASSERT_EQ(64u, report.getPeak());
+
+  // Empty categories and records are not printed
+  stringstream table;
+  table << report;
+  ASSERT_NE(string::npos, table.str().find("temporaries"));
+  ASSERT_EQ(string::npos, table.str().find("neighbor index"));
+  ASSERT_EQ(string::npos, table.str().find("solvers"));
+
+  stringstream json;
+  report.writeJSON(json);
+  ASSERT_NE(string::npos, json.str().find("\"total\": 6272"));
+  ASSERT_NE(string::npos,
+            json.str().find("{\"category\": \"temporaries\", \"name\": \"A\", "
+                            "\"bytes\": 96}"));
+}
+
+TEST(Memory, function) {
+  Set V;
+  FieldRef<simit_float> a = V.addField<simit_float>("a");
+  FieldRef<simit_float> b = V.addField<simit_float>("b");
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  ElementRef v2 = V.add();
+  b.set(v0, 1.0);
+  b.set(v1, 2.0);
+  b.set(v2, 3.0);
+
+  Set E(V,V);
+  FieldRef<simit_float> e = E.addField<simit_float>("e");
+  ElementRef e0 = E.add(v0,v1);
+  ElementRef e1 = E.add(v1,v2);
+  e.set(e0, 1.0);
+  e.set(e1, 2.0);
+
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  func.bind("V", &V);
+  func.bind("E", &E);
+  func.runSafe();
+  ASSERT_EQ(3.0, a.get(v0));
+
+  MemoryReport report = func.getMemoryReport();
+  ASSERT_EQ((int64_t)V.getFieldBytes(), getBytes(report, "V fields"));
+  ASSERT_EQ((int64_t)E.getEndpointBytes(), getBytes(report, "E endpoints"));
+  ASSERT_LT(0u, E.getEndpointBytes());
+
+  // The matrix is stored in the neighbors of the vertices: v0 and v2 have
+  // two, and v1 three
+  ASSERT_LE(7 * sizeof(simit_float), report.getTotal(TemporaryMemory));
+  ASSERT_LT(0u, report.getTotal(IndexMemory));
+  ASSERT_LT(0u, report.getTotal(CodeMemory));
+  ASSERT_LE(report.getTotal(SetMemory), report.getTotal());
+}
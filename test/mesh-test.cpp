@@ -309,3 +309,38 @@ const string inputEdge = R"(24  1
   
 }
 
+
+TEST(Mesh, createTetBox) {
+  MeshVol m = createTetBox(3, 2, 2, 0.1, 7);
+  ASSERT_EQ(4u*3u*3u, m.v.size());
+  ASSERT_EQ(6u*3u*2u*2u, m.e.size());
+
+  // Boundary vertices are not moved, and the box spans [0,1] along x
+  ASSERT_DOUBLE_EQ(1.0, m.v[3][0]);
+  ASSERT_DOUBLE_EQ(0.0, m.v[3][1]);
+
+  // Each tet has a negative determinant, and fills a sixth of a cube
+  double volume = 0.0;
+  for (auto& tet : m.e) {
+    double M[3][3];
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        M[j][i] = m.v[tet[i]][j] - m.v[tet[3]][j];
+      }
+    }
+    double det = M[0][0]*(M[1][1]*M[2][2] - M[1][2]*M[2][1])
+               - M[0][1]*(M[1][0]*M[2][2] - M[1][2]*M[2][0])
+               + M[0][2]*(M[1][0]*M[2][1] - M[1][1]*M[2][0]);
+    ASSERT_LT(det, 0.0);
+    volume += -det / 6.0;
+  }
+  ASSERT_NEAR(1.0 * (2.0/3.0) * (2.0/3.0), volume, 1e-12);
+
+  // Cube edges, face diagonals and main diagonals
+  size_t cubeEdges = 3*3*3 + 4*2*3 + 4*3*2;
+  size_t faceDiagonals = 3*2*3 + 3*2*3 + 4*2*2;
+  ASSERT_EQ(cubeEdges + faceDiagonals + 3*2*2, m.edges.size());
+  for (auto& edge : m.edges) {
+    ASSERT_LT(edge[0], edge[1]);
+  }
+}
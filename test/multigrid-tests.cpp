@@ -0,0 +1,159 @@
+#include "simit-test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "graph.h"
+#include "init.h"
+#include "multigrid.h"
+#include "program.h"
+
+using namespace std;
+using namespace simit;
+
+// Build the periodic 2D lattice operator shift*I - Laplacian, with dimension 0
+// innermost, as a CSR matrix
+static void makeHelmholtz(int nx, int ny, double shift, vector<int>& rowptr,
+                          vector<int>& colidx, vector<double>& vals) {
+  rowptr.push_back(0);
+  for (int y = 0; y < ny; ++y) {
+    for (int x = 0; x < nx; ++x) {
+      vector<pair<int,double>> row = {
+        {y*nx + x, 4.0 + shift},
+        {y*nx + (x+1)%nx, -1.0},
+        {y*nx + (x+nx-1)%nx, -1.0},
+        {((y+1)%ny)*nx + x, -1.0},
+        {((y+ny-1)%ny)*nx + x, -1.0}
+      };
+      sort(row.begin(), row.end());
+      for (auto& entry : row) {
+        colidx.push_back(entry.first);
+        vals.push_back(entry.second);
+      }
+      rowptr.push_back(colidx.size());
+    }
+  }
+}
+
+static double residualNorm(const vector<int>& rowptr,
+                           const vector<int>& colidx,
+                           const vector<double>& vals,
+                           const vector<double>& b, const vector<double>& x) {
+  double sum = 0.0;
+  for (size_t i = 0; i < b.size(); ++i) {
+    double r = b[i];
+    for (int ij = rowptr[i]; ij < rowptr[i+1]; ++ij) {
+      r -= vals[ij] * x[colidx[ij]];
+    }
+    sum += r*r;
+  }
+  return sqrt(sum);
+}
+
+TEST(Multigrid, poisson) {
+  const int nx = 64;
+  const int ny = 32;
+  vector<int> rowptr, colidx;
+  vector<double> vals;
+  makeHelmholtz(nx, ny, 1e-3, rowptr, colidx, vals);
+
+  vector<double> b(nx*ny);
+  for (int i = 0; i < nx*ny; ++i) {
+    b[i] = sin(0.1*i) + (i % 7);
+  }
+  double bnorm = 0.0;
+  for (double value : b) {
+    bnorm += value*value;
+  }
+  bnorm = sqrt(bnorm);
+
+  const int dims[] = {nx, ny};
+  for (auto smoother : {MultigridSmoother::Jacobi,
+                        MultigridSmoother::RedBlackGaussSeidel}) {
+    MultigridOptions options;
+    options.smoother = smoother;
+    vector<double> x(nx*ny, 42.0);
+    int cycles = multigridSolve(2, dims, rowptr.data(), colidx.data(),
+                                vals.data(), b.data(), x.data(), options);
+
+    // The convergence rate does not depend on the lattice size
+    ASSERT_GT(cycles, 0);
+    ASSERT_LE(cycles, 25);
+    ASSERT_LE(residualNorm(rowptr, colidx, vals, b, x),
+              options.tolerance * bnorm);
+  }
+}
+
+TEST(Multigrid, stencil) {
+  // Odd dimensions are not coarsened
+  const int nx = 16;
+  const int ny = 5;
+  vector<int> rowptr, colidx;
+  vector<double> vals;
+  makeHelmholtz(nx, ny, 0.5, rowptr, colidx, vals);
+
+  const int offsets[] = {0,0, 1,0, -1,0, 0,1, 0,-1};
+  vector<double> stencil;
+  for (int i = 0; i < nx*ny; ++i) {
+    stencil.insert(stencil.end(), {4.5, -1.0, -1.0, -1.0, -1.0});
+  }
+
+  vector<double> b(nx*ny);
+  for (int i = 0; i < nx*ny; ++i) {
+    b[i] = 1.0 + (i % 3);
+  }
+
+  const int dims[] = {nx, ny};
+  vector<double> x(nx*ny);
+  int cycles = multigridSolve(2, dims, 5, offsets, stencil.data(),
+                              b.data(), x.data());
+  ASSERT_GT(cycles, 0);
+  ASSERT_LE(residualNorm(rowptr, colidx, vals, b, x), 1e-6);
+}
+
+TEST(Multigrid, mgsolve) {
+  // Points
+  Set points;
+  FieldRef<simit_float> b = points.addField<simit_float>("b");
+  FieldRef<simit_float> x = points.addField<simit_float>("x");
+  FieldRef<simit_float> m = points.addField<simit_float>("m");
+
+  // Springs
+  const int nx = 16;
+  const int ny = 16;
+  Set springs(points,{nx,ny});
+  FieldRef<simit_float> a = springs.addField<simit_float>("a");
+
+  for (int y = 0; y < ny; ++y) {
+    for (int xi = 0; xi < nx; ++xi) {
+      ElementRef p = springs.getLatticePoint({xi,y});
+      b.set(p, 1.0 + (xi + 3*y) % 5);
+      m.set(p, 0.1 + 0.05*((xi + y) % 3));
+      a.set(springs.getLatticeLink({xi,y},0), 1.0);
+      a.set(springs.getLatticeLink({xi,y},1), 1.0);
+    }
+  }
+
+  // Compile program and bind arguments
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+
+  func.runSafe();
+
+  // Check that x solves the system
+  auto xAt = [&](int xi, int y) -> double {
+    return x.get(springs.getLatticePoint({(xi+nx)%nx, (y+ny)%ny}));
+  };
+  for (int y = 0; y < ny; ++y) {
+    for (int xi = 0; xi < nx; ++xi) {
+      ElementRef p = springs.getLatticePoint({xi,y});
+      double Ax = (m.get(p) + 4.0) * xAt(xi,y) - xAt(xi+1,y) - xAt(xi-1,y)
+                  - xAt(xi,y+1) - xAt(xi,y-1);
+      ASSERT_NEAR((double)b.get(p), Ax, 1e-4);
+    }
+  }
+}
@@ -0,0 +1,64 @@
+#include "simit-test.h"
+
+#include "ir.h"
+#include "intrinsics.h"
+#include "lower/operation_counts.h"
+
+using namespace std;
+using namespace simit::ir;
+
+TEST(OperationCounts, loops) {
+  // for i in 0:8: for j in 0:4: c[j] = c[j] + a[i]*b[j]
+  Var a("a", TensorType::make(ScalarType::Float, {IndexDomain(8)}));
+  Var b("b", TensorType::make(ScalarType::Float, {IndexDomain(4)}));
+  Var c("c", TensorType::make(ScalarType::Float, {IndexDomain(4)}));
+  Var i("i", Int);
+  Var j("j", Int);
+  Expr product = Mul::make(Load::make(a, i), Load::make(b, j));
+  Stmt loops = ForRange::make(i, 0, 8, ForRange::make(j, 0, 4,
+      Store::make(c, j, product, CompoundOperator::Add)));
+
+  // Per iteration of j: a multiply, a compound add, two loads and a
+  // load and store of c
+  int bytes = ScalarType::floatBytes;
+  OperationCounts counts = countOperations(loops);
+  ASSERT_EQ(8*4*2, counts.flops);
+  ASSERT_EQ(8*4*3*bytes, counts.bytesLoaded);
+  ASSERT_EQ(8*4*bytes, counts.bytesStored);
+  ASSERT_TRUE(counts.exact);
+  ASSERT_DOUBLE_EQ(2.0/(4*bytes), counts.getIntensity());
+
+  // Loops with bounds that are not constant are counted once
+  Var n("n", Int);
+  counts = countOperations(ForRange::make(i, 0, n,
+      Store::make(c, 0, product, CompoundOperator::Add)));
+  ASSERT_EQ(2, counts.flops);
+  ASSERT_FALSE(counts.exact);
+}
+
+TEST(OperationCounts, timed) {
+  // The operations of a timed loop over a set are the set size times those
+  // of an iteration
+  Type vertexType = ElementType::make("Vertex", {});
+  Var V("V", UnstructuredSetType::make(vertexType, {}));
+  Var a("a", TensorType::make(ScalarType::Float, {IndexDomain(8)}));
+  Var i("i", Int);
+  Stmt loop = For::make(i, ForDomain(IndexSet(V)),
+                        Store::make(a, i, Mul::make(Load::make(a, i), 2.0)));
+  Stmt timed = Block::make({CallStmt::make({}, intrinsics::timerStart(), {0}),
+                            loop,
+                            CallStmt::make({}, intrinsics::timerStop(),
+                                           {0, 0, 0})});
+  Func func = countTimedOperations(Func("timed", {a}, {}, timed));
+
+  vector<const CallStmt*> stops;
+  match(func, function<void(const CallStmt*)>([&](const CallStmt* op) {
+    if (op->callee == intrinsics::timerStop()) {
+      stops.push_back(op);
+    }
+  }));
+  ASSERT_EQ(1u, stops.size());
+  ASSERT_EQ("(length(V) * 1)", simit::util::toString(stops[0]->actuals[1]));
+  ASSERT_EQ("(length(V) * " + to_string(2*ScalarType::floatBytes) + ")",
+            simit::util::toString(stops[0]->actuals[2]));
+}
@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+
+#include "graph.h"
+#include "partition.h"
+#include "reorder.h"
+
+using namespace std;
+using namespace simit;
+
+// Build an n x n grid of points connected by horizontal and vertical edges
+static void makeGrid(int n, Set& points, Set& edges, vector<ElementRef>& refs) {
+  for (int i = 0; i < n*n; ++i) {
+    refs.push_back(points.add());
+  }
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      if (x+1 < n) edges.add(refs[y*n+x], refs[y*n+x+1]);
+      if (y+1 < n) edges.add(refs[y*n+x], refs[(y+1)*n+x]);
+    }
+  }
+}
+
+TEST(Partition, grid) {
+  const int n = 32;
+  const int k = 4;
+  vector<int> start(1, 0);
+  vector<int> nbrs;
+  for (int y = 0; y < n; ++y) {
+    for (int x = 0; x < n; ++x) {
+      if (x > 0)   nbrs.push_back(y*n+x-1);
+      if (x+1 < n) nbrs.push_back(y*n+x+1);
+      if (y > 0)   nbrs.push_back((y-1)*n+x);
+      if (y+1 < n) nbrs.push_back((y+1)*n+x);
+      start.push_back(nbrs.size());
+    }
+  }
+
+  vector<int> parts;
+  partitionGraph(n*n, start.data(), nbrs.data(), k, parts);
+  ASSERT_EQ((size_t)(n*n), parts.size());
+
+  vector<int> weights(k, 0);
+  for (int p : parts) {
+    ASSERT_GE(p, 0);
+    ASSERT_LT(p, k);
+    weights[p]++;
+  }
+  for (int w : weights) {
+    ASSERT_LE(w, (n*n/k) * 1.05 + 1);
+  }
+
+  // An optimal 4-way cut of a 32x32 grid cuts 64 edges
+  int cut = 0;
+  for (int v = 0; v < n*n; ++v) {
+    for (int j = start[v]; j < start[v+1]; ++j) {
+      cut += (parts[v] != parts[nbrs[j]]);
+    }
+  }
+  ASSERT_LT(cut/2, 3*n);
+}
+
+TEST(Partition, sets) {
+  Set points;
+  Set edges(points, points);
+  FieldRef<int> id = points.addField<int>("id");
+  vector<ElementRef> refs;
+  const int n = 24;
+  makeGrid(n, points, edges, refs);
+  for (int i = 0; i < n*n; ++i) {
+    id.set(refs[i], i);
+  }
+  vector<pair<ElementRef,ElementRef>> endpoints;
+  for (auto e : edges) {
+    endpoints.push_back({edges.getEndpoint(e, 0), edges.getEndpoint(e, 1)});
+  }
+
+  partitionSets(edges, 3);
+  ASSERT_EQ(3, points.getNumPartitions());
+  ASSERT_EQ(3, edges.getNumPartitions());
+
+  // Element handles are unchanged
+  for (int i = 0; i < n*n; ++i) {
+    ASSERT_EQ(i, (int)id.get(refs[i]));
+  }
+  int i = 0;
+  for (auto e : edges) {
+    ASSERT_EQ(endpoints[i].first, edges.getEndpoint(e, 0));
+    ASSERT_EQ(endpoints[i].second, edges.getEndpoint(e, 1));
+    ++i;
+  }
+
+  // Partition tables are well formed and interior edges only touch vertices
+  // of their own partition
+  const int* vtable = points.getPartitionTable();
+  const int* etable = edges.getPartitionTable();
+  ASSERT_EQ(0, vtable[1]);
+  ASSERT_EQ(n*n, vtable[7]);
+  ASSERT_EQ(0, etable[1]);
+  ASSERT_EQ(edges.getSize(), etable[7]);
+  auto partOf = [&](int v) {
+    int p = 0;
+    while (v >= vtable[3+2*p]) ++p;
+    return p;
+  };
+  for (int p = 0; p < 3; ++p) {
+    ASSERT_LE(vtable[1+2*p], vtable[2+2*p]);
+    ASSERT_LE(vtable[2+2*p], vtable[3+2*p]);
+    for (int e = etable[1+2*p]; e < etable[3+2*p]; ++e) {
+      int v0 = edges.getEndpointIndex(e, 0);
+      int v1 = edges.getEndpointIndex(e, 1);
+      bool interior = (e < etable[2+2*p]);
+      ASSERT_EQ(p, partOf(min(v0, v1)));
+      ASSERT_EQ(interior, partOf(v0) == p && partOf(v1) == p);
+      if (interior) {
+        ASSERT_LT(v0, vtable[3+2*p]);
+        ASSERT_LT(v1, vtable[3+2*p]);
+      }
+    }
+  }
+}
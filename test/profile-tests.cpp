@@ -0,0 +1,209 @@
+#include "simit-test.h"
+
+#include <sstream>
+
+#include "graph.h"
+#include "function.h"
+#include "init.h"
+#include "perf_counters.h"
+#include "profile.h"
+#include "program.h"
+
+using namespace std;
+using namespace simit;
+
+static Profile makeProfile() {
+  return Profile({{0, -1, "main", "func main", 0, 1, 3e-6, 3e-6, 3e-6, 0, 0},
+                  {1, 0, "main", "for i in 0:3", 0, 1, 2e-6, 2e-6, 2e-6, 0, 0},
+                  {2, 1, "main", "map \"double\"", 0, 3, 1.5e-6, 4e-7, 6e-7,
+                   6000, 48000, {3000, 5000, 7, -1, 2}}});
+}
+
+TEST(Profile, writeJSON) {
+  Profile profile = makeProfile();
+  ASSERT_DOUBLE_EQ(3e-6, profile.getTotalTime());
+
+  stringstream json;
+  profile.writeJSON(json);
+  string str = json.str();
+  ASSERT_EQ('[', str.front());
+  ASSERT_NE(string::npos, str.find("\"statement\": \"map \\\"double\\\"\""));
+  ASSERT_NE(string::npos, str.find("\"parent\": 1"));
+  ASSERT_NE(string::npos, str.find("\"count\": 3"));
+  ASSERT_NE(string::npos, str.find("\"min\": 4e-07"));
+  ASSERT_NE(string::npos, str.find("\"instructions\": 5000, "
+                                   "\"llc_misses\": 7, \"dtlb_misses\": -1"));
+}
+
+TEST(Profile, writeChromeTrace) {
+  stringstream trace;
+  makeProfile().writeChromeTrace(trace);
+  string str = trace.str();
+  ASSERT_NE(string::npos, str.find("\"traceEvents\""));
+  ASSERT_NE(string::npos, str.find("\"ph\": \"M\""));
+
+  // Children start with their parent, and last as long as their total time
+  ASSERT_NE(string::npos,
+            str.find("\"name\": \"for i in 0:3\", \"cat\": \"main\", "
+                     "\"ph\": \"X\", \"pid\": 0, \"tid\": 0, "
+                     "\"ts\": 0.000, \"dur\": 2.000"));
+  ASSERT_NE(string::npos, str.find("\"count\": 3, \"min_us\": 0.400, "
+                                   "\"max_us\": 0.600"));
+}
+
+TEST(Profile, function) {
+  Set V;
+  FieldRef<simit_float> val = V.addField<simit_float>("val");
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  val.set(v0, 1.0);
+  val.set(v1, 2.0);
+
+  Function func = loadFunctionWithTimers(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+  ASSERT_TRUE(func.hasProfile());
+  func.bind("V", &V);
+  func.runSafe();
+  ASSERT_EQ(8.0, val.get(v0));
+
+  // The function, its loop and the map each ran on one thread
+  vector<ProfileRecord> records = func.getProfile().getRecords();
+  ASSERT_EQ(3u, records.size());
+  ASSERT_EQ("func main", records[0].statement);
+  ASSERT_EQ(-1, records[0].parent);
+  ASSERT_EQ(1u, records[1].count);
+  ASSERT_EQ(records[1].site, records[2].parent);
+  ASSERT_EQ(3u, records[2].count);
+  ASSERT_EQ("main", records[2].function);
+  ASSERT_LE(records[2].min, records[2].max);
+  ASSERT_LE(records[2].total, records[0].total);
+
+  // Runs of a stopped function are not counted
+  func.resetProfile();
+  func.stopProfile();
+  func.runSafe();
+  ASSERT_EQ(0u, func.getProfile().getRecords().size());
+  func.startProfile();
+  func.runSafe();
+  ASSERT_EQ(3u, func.getProfile().getRecords().size());
+}
+
+TEST(Profile, writeRoofline) {
+  // The map runs at 4 GFLOP/s with an intensity of 1/8 flop/B, so a machine
+  // with a balance of 2 flop/B bounds it by bandwidth to 6.25 GFLOP/s
+  stringstream roofline;
+  makeProfile().writeRoofline(roofline, 100e9, 50e9);
+  string str = roofline.str();
+  ASSERT_NE(string::npos, str.find("balance 2.00 flop/B"));
+  ASSERT_NE(string::npos, str.find("0.12      4.00     32.00    64.00%  memory"
+                                   "  main: map \"double\""));
+  ASSERT_EQ(string::npos, str.find("for i in 0:3"));
+}
+
+TEST(Profile, perfCounters) {
+  // Hosts that do not let the process count events read no events
+  ir::PerfCounterGroup perfCounters;
+  int64_t start[kNumPerfEvents];
+  int64_t stop[kNumPerfEvents];
+  perfCounters.read(start);
+  volatile double sum = 0.0;
+  for (int i = 0; i < 100000; ++i) {
+    sum = sum + i;
+  }
+  perfCounters.read(stop);
+  for (int event = 0; event < kNumPerfEvents; ++event) {
+    if (perfCounters.isAvailable(PerfEvent(event))) {
+      ASSERT_LE(start[event], stop[event]);
+    }
+    else {
+      ASSERT_EQ(0, stop[event]);
+    }
+  }
+  if (perfCounters.isAvailable(Instructions)) {
+    ASSERT_GT(stop[Instructions] - start[Instructions], 100000);
+  }
+}
+
+TEST(Profile, function_events) {
+  Set V;
+  FieldRef<simit_float> val = V.addField<simit_float>("val");
+  V.add();
+  V.add();
+
+  // HACK: Settings are global, so we set and reset them around compilation
+  simit::kPerfCounters = true;
+  Function func = loadFunctionWithTimers(TEST_FILE_NAME, "main");
+  simit::kPerfCounters = false;
+  if (!func.defined()) FAIL();
+  func.bind("V", &V);
+  func.runSafe();
+
+  // Every record counts every event, or reports it as unavailable
+  vector<ProfileRecord> records = func.getProfile().getRecords();
+  ASSERT_EQ(3u, records.size());
+  for (auto& record : records) {
+    ASSERT_EQ((size_t)kNumPerfEvents, record.events.size());
+    for (int64_t count : record.events) {
+      ASSERT_GE(count, -1);
+    }
+  }
+  ASSERT_GE(records[0].events[Instructions], records[2].events[Instructions]);
+}
+
+TEST(Profile, compile_stages) {
+  CompileProfile profile;
+  profile.addStage("Parse", 0.25);
+  profile.addStage("Lower Maps", 0.75, 42);
+  ASSERT_DOUBLE_EQ(1.0, profile.getTotalTime());
+
+  CompileProfile stages;
+  stages.addStage("Emit LLVM IR", 1.0);
+  profile.append(stages);
+  ASSERT_EQ(3u, profile.getStages().size());
+  ASSERT_EQ("Emit LLVM IR", profile.getStages()[2].name);
+  ASSERT_EQ(-1, profile.getStages()[2].nodes);
+
+  stringstream table;
+  table << profile;
+  ASSERT_NE(string::npos, table.str().find("    0.750000   37.50%        42  "
+                                           "Lower Maps"));
+  ASSERT_NE(string::npos, table.str().find("    2.000000  total"));
+
+  stringstream json;
+  profile.writeJSON(json);
+  ASSERT_NE(string::npos, json.str().find("{\"stage\": \"Lower Maps\", "
+                                          "\"time\": 0.75, \"nodes\": 42}"));
+}
+
+TEST(Profile, compile_function) {
+  Program program;
+  ASSERT_EQ(0, program.loadFile(TEST_FILE_NAME));
+  CompileOptions options;
+  options.profileCompile = true;
+  Function func = program.compile("main", options);
+  if (!func.defined()) FAIL();
+
+  // The frontend stages come before the lowering passes, which count nodes
+  vector<CompileStage> stages = func.getCompileProfile().getStages();
+  auto stage = [&stages](const string& name) {
+    return find_if(stages.begin(), stages.end(),
+                   [&name](const CompileStage& s) {return s.name == name;});
+  };
+  ASSERT_NE(stages.end(), stage("Parse"));
+  ASSERT_NE(stages.end(), stage("Lower Maps"));
+  ASSERT_LT(stage("Parse"), stage("Lower Maps"));
+  ASSERT_EQ(-1, stage("Parse")->nodes);
+  ASSERT_GT(stage("Lower Maps")->nodes, 0);
+  for (auto& s : stages) {
+    ASSERT_GE(s.time, 0.0);
+  }
+
+  // Functions compiled without the option only have backend stages
+  Function plain = program.compile("main");
+  vector<CompileStage> backendStages = plain.getCompileProfile().getStages();
+  ASSERT_LT(backendStages.size(), stages.size());
+  for (auto& s : backendStages) {
+    ASSERT_EQ(-1, s.nodes);
+    ASSERT_NE("Parse", s.name);
+  }
+}
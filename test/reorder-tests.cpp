@@ -469,3 +469,182 @@ TEST(Program, reorderFemTest) {
   unsigned int nSteps = 10;
   femTest(filename, prefix, nSteps);
 }
+
+TEST(Program, reorderSpatialKeys) {
+  // Unit square corners map onto a 2x2 lattice
+  double coords[] = {0.0, 0.0,  1.0, 0.0,  0.0, 1.0,  1.0, 1.0};
+  vector<hilbert::curvekey_t> keys;
+
+  hilbert::computeKeys(coords, 4, 2, 1, hilbert::Morton, keys);
+  ASSERT_EQ(4u, keys.size());
+  ASSERT_EQ(0u, keys[0]);
+  ASSERT_EQ(1u, keys[1]);
+  ASSERT_EQ(2u, keys[2]);
+  ASSERT_EQ(3u, keys[3]);
+
+  // The Hilbert curve visits (1,1) before (0,1)
+  hilbert::computeKeys(coords, 4, 2, 1, hilbert::Hilbert, keys);
+  ASSERT_EQ(0u, keys[0]);
+  ASSERT_EQ(1u, keys[1]);
+  ASSERT_EQ(3u, keys[2]);
+  ASSERT_EQ(2u, keys[3]);
+
+  // Lattice scaling is relative to the bounding box, not the origin
+  float shifted[] = {-5.0f, 10.0f, 20.0f,  -3.0f, 12.0f, 22.0f};
+  hilbert::computeKeys(shifted, 2, 3, hilbert::kMaxBitsPerAxis,
+                       hilbert::Morton, keys);
+  ASSERT_EQ(0u, keys[0]);
+  ASSERT_EQ((1ULL << 3*hilbert::kMaxBitsPerAxis) - 1, keys[1]);
+}
+
+TEST(Program, reorderRadixSort) {
+  const int n = 10000;
+  vector<hilbert::curvekey_t> keys(n);
+  vector<int> ids(n);
+  hilbert::curvekey_t state = 12345;
+  for (int i = 0; i < n; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    // Keep some duplicates to exercise stability
+    keys[i] = (i % 5 == 0) ? keys[i/2] : (state >> 1);
+    ids[i] = i;
+  }
+
+  vector<pair<hilbert::curvekey_t,int>> expected;
+  for (int i = 0; i < n; ++i) {
+    expected.push_back(make_pair(keys[i], i));
+  }
+  stable_sort(expected.begin(), expected.end(),
+              [](const pair<hilbert::curvekey_t,int>& a,
+                 const pair<hilbert::curvekey_t,int>& b) {
+                return a.first < b.first;
+              });
+
+  hilbert::radixSortByKey(keys, ids, 63);
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(expected[i].first, keys[i]);
+    ASSERT_EQ(expected[i].second, ids[i]);
+  }
+}
+
+TEST(Program, reorderPermuteSet) {
+  Set verts;
+  Set edges(verts, verts);
+  FieldRef<int,2> a = verts.addField<int,2>("a");
+  FieldRef<double> b = edges.addField<double>("b");
+
+  vector<ElementRef> vertRefs;
+  for (int i = 0; i < 4; ++i) {
+    vertRefs.push_back(verts.add());
+    a.set(vertRefs.back(), {i, 10*i});
+  }
+  int edgeEndpoints[][2] = {{0,1}, {2,1}, {3,2}};
+  vector<ElementRef> edgeRefs;
+  for (int i = 0; i < 3; ++i) {
+    edgeRefs.push_back(edges.add(vertRefs[edgeEndpoints[i][0]],
+                                 vertRefs[edgeEndpoints[i][1]]));
+    b.set(edgeRefs.back(), 0.5 * i);
+  }
+
+  // Neither ordering is its own inverse
+  vector<int> vertexOrdering {1, 2, 3, 0};
+  vector<int> edgeOrdering;
+  edgeVertexSortReordering(edges, edgeOrdering, &vertexOrdering);
+  ASSERT_EQ(1, edgeOrdering[0]);
+  ASSERT_EQ(2, edgeOrdering[1]);
+  ASSERT_EQ(0, edgeOrdering[2]);
+
+  permuteSet(verts, vertexOrdering);
+  permuteSet(edges, edgeOrdering, &vertexOrdering);
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(i,    a.get(vertRefs[vertexOrdering[i]])(0));
+    ASSERT_EQ(10*i, a.get(vertRefs[vertexOrdering[i]])(1));
+  }
+  const int* endpoints = edges.getEndpointsPtr();
+  for (int i = 0; i < 3; ++i) {
+    int e = edgeOrdering[i];
+    SIMIT_ASSERT_FLOAT_EQ(0.5 * i, b.get(edgeRefs[e]));
+    ASSERT_EQ(vertexOrdering[edgeEndpoints[i][0]], endpoints[2*e]);
+    ASSERT_EQ(vertexOrdering[edgeEndpoints[i][1]], endpoints[2*e+1]);
+  }
+}
+
+TEST(Program, reorderSetPolicy) {
+  Set verts;
+  Set edges(verts, verts);
+  FieldRef<double,3> x = verts.addField<double,3>("x");
+  FieldRef<int> id = verts.addField<int>("id");
+  FieldRef<int> eid = edges.addField<int>("eid");
+
+  // Vertices on a line, added in a scrambled order
+  const int n = 64;
+  vector<ElementRef> vertRefs;
+  for (int i = 0; i < n; ++i) {
+    vertRefs.push_back(verts.add());
+    x.set(vertRefs.back(), {(double)((i*37) % n), 0.0, 0.0});
+    id.set(vertRefs.back(), i);
+  }
+  vector<ElementRef> edgeRefs;
+  for (int i = 0; i < n; ++i) {
+    edgeRefs.push_back(edges.add(vertRefs[i], vertRefs[(i*5) % n]));
+    eid.set(edgeRefs.back(), i);
+  }
+  verts.setSpatialField("x");
+
+  reorderSet(edges, ReorderPolicy::Auto);
+  ASSERT_TRUE(verts.isReordered());
+  ASSERT_TRUE(edges.isReordered());
+
+  // Handles still refer to the same elements and endpoints
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(i, (int)id.get(vertRefs[i]));
+    ASSERT_EQ(i, (int)eid.get(edgeRefs[i]));
+    ASSERT_EQ(vertRefs[i], edges.getEndpoint(edgeRefs[i], 0));
+    ASSERT_EQ(vertRefs[(i*5) % n], edges.getEndpoint(edgeRefs[i], 1));
+  }
+
+  // The storage is permuted, and new elements are appended in place
+  const int* idData = static_cast<const int*>(verts.getFieldData("id"));
+  bool moved = false;
+  for (int i = 0; i < n; ++i) {
+    SIMIT_ASSERT_FLOAT_EQ((idData[i]*37) % n, x.get(vertRefs[idData[i]])(0));
+    moved |= (idData[i] != i);
+  }
+  ASSERT_TRUE(moved);
+  ElementRef last = verts.add();
+  id.set(last, n);
+  ASSERT_EQ(n, (int)id.get(last));
+  ASSERT_EQ(n-1, (int)id.get(vertRefs[n-1]));
+}
+
+TEST(Program, reorderRCM) {
+  Set verts;
+  Set edges(verts, verts);
+
+  // A path whose vertices are added in a scrambled order
+  const int n = 50;
+  vector<ElementRef> vertRefs;
+  for (int i = 0; i < n; ++i) {
+    vertRefs.push_back(verts.add());
+  }
+  vector<int> position(n);
+  for (int i = 0; i < n; ++i) {
+    position[i] = (i*7) % n;
+  }
+  for (int i = 0; i+1 < n; ++i) {
+    edges.add(vertRefs[position[i]], vertRefs[position[i+1]]);
+  }
+
+  vector<int> ordering;
+  rcmReorder(verts, ordering);
+  vector<bool> seen(n, false);
+  for (int v = 0; v < n; ++v) {
+    ASSERT_FALSE(seen[ordering[v]]);
+    seen[ordering[v]] = true;
+  }
+
+  // Reverse Cuthill-McKee turns the path into a band of width one
+  for (int i = 0; i+1 < n; ++i) {
+    ASSERT_EQ(1, abs(ordering[position[i]] - ordering[position[i+1]]));
+  }
+}
@@ -0,0 +1,71 @@
+#include "simit-test.h"
+
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include "runtime_math.h"
+
+using namespace std;
+using namespace simit;
+
+// The largest relative error of f against the reference g, at n points evenly
+// spaced in [lo,hi]
+template <typename Float>
+static double maxError(function<Float(Float)> f, function<double(double)> g,
+                       double lo, double hi, int n=10000) {
+  double maxError = 0.0;
+  for (int i = 0; i <= n; ++i) {
+    Float x = Float(lo + (hi-lo)*i/n);
+    double expected = g(x);
+    double error = fabs(f(x) - expected) / max(fabs(expected), 1.0);
+    maxError = max(maxError, error);
+  }
+  return maxError;
+}
+
+template <typename Float, math::Accuracy accuracy>
+static void checkAccuracy(double tolerance) {
+  using namespace math;
+  typedef double (*Reference)(double);
+  EXPECT_LT(maxError<Float>(sin<Float,accuracy>, (Reference)std::sin,
+                            -100.0, 100.0), tolerance);
+  EXPECT_LT(maxError<Float>(cos<Float,accuracy>, (Reference)std::cos,
+                            -100.0, 100.0), tolerance);
+  EXPECT_LT(maxError<Float>(exp<Float,accuracy>, (Reference)std::exp,
+                            -80.0, 80.0), tolerance);
+  EXPECT_LT(maxError<Float>(log<Float,accuracy>, (Reference)std::log,
+                            1e-6, 1e6), tolerance);
+  // pow is accurate relative to |y*log(x)|
+  EXPECT_LT(maxError<Float>([](Float x) {return pow<Float,accuracy>(x, 2.5);},
+                            [](double x) {return std::pow(x, 2.5);},
+                            0.0, 10.0), 10*tolerance);
+  EXPECT_LT(maxError<Float>([](Float y) {return atan2<Float,accuracy>(y, -1);},
+                            [](double y) {return std::atan2(y, -1.0);},
+                            -10.0, 10.0), tolerance);
+}
+
+TEST(RuntimeMath, accuracy) {
+  checkAccuracy<double,math::High>(1e-14);
+  checkAccuracy<double,math::Low>(1e-7);
+  checkAccuracy<float,math::High>(1e-6);
+  checkAccuracy<float,math::Low>(1e-3);
+}
+
+TEST(RuntimeMath, special) {
+  using namespace math;
+  const double infinity = numeric_limits<double>::infinity();
+  ASSERT_EQ(infinity, (exp<double,High>(710.0)));
+  ASSERT_EQ(0.0, (exp<double,High>(-746.0)));
+  ASSERT_NEAR(std::exp(-740.0), (exp<double,High>(-740.0)), 1e-322);
+  ASSERT_EQ(-infinity, (log<double,High>(0.0)));
+  ASSERT_TRUE(std::isnan(log<double,High>(-1.0)));
+  ASSERT_NEAR(std::log(1e-310), (log<double,High>(1e-310)), 1e-12);
+  ASSERT_DOUBLE_EQ(-8.0, (pow<double,High>(-2.0, 3.0)));
+  ASSERT_TRUE(std::isnan(pow<double,High>(-2.0, 0.5)));
+  ASSERT_EQ(1.0, (pow<double,High>(0.0, 0.0)));
+  ASSERT_EQ(infinity, (pow<double,High>(0.0, -1.0)));
+  ASSERT_DOUBLE_EQ(M_PI, (atan2<double,High>(0.0, -1.0)));
+  ASSERT_DOUBLE_EQ(-M_PI_2, (atan2<double,High>(-1.0, 0.0)));
+  ASSERT_DOUBLE_EQ(M_PI_4, (atan2<double,High>(infinity, infinity)));
+}
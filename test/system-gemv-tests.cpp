@@ -58,6 +58,9 @@ TEST(system, gemv) {
 }
 
 TEST(system, gemv_stencil) {
+  // HACK: Set kIndexlessStencils to false to test indexed stencils
+  kIndexlessStencils = false;
+
   // Points
   Set points;
   FieldRef<simit_float> b = points.addField<simit_float>("b");
@@ -108,12 +111,11 @@ TEST(system, gemv_stencil) {
   ASSERT_EQ(3.0, c.get(p0));
   ASSERT_EQ(13.0, c.get(p1));
   ASSERT_EQ(10.0, c.get(p2));
+
+  kIndexlessStencils = true;
 }
 
 TEST(system, gemv_stencil_indexless) {
-  // HACK: Set kIndexlessStencils to true for this type of test
-  kIndexlessStencils = true;
-  
   // Points
   Set points;
   FieldRef<simit_float> b = points.addField<simit_float>("b");
@@ -164,11 +166,12 @@ TEST(system, gemv_stencil_indexless) {
   ASSERT_EQ(3.0, c.get(p0));
   ASSERT_EQ(13.0, c.get(p1));
   ASSERT_EQ(10.0, c.get(p2));
-
-  kIndexlessStencils = false;
 }
 
 TEST(system, gemv_stencil_2d) {
+  // HACK: Set kIndexlessStencils to false to test indexed stencils
+  kIndexlessStencils = false;
+
   // Points
   Set points;
   FieldRef<simit_float> b = points.addField<simit_float>("b");
@@ -249,12 +252,11 @@ TEST(system, gemv_stencil_2d) {
   ASSERT_EQ(181.0, (simit_float)c.get(p10));
   ASSERT_EQ(224.0, (simit_float)c.get(p11));
   ASSERT_EQ(304.0, (simit_float)c.get(p12));
-}
 
-TEST(system, gemv_stencil_2d_indexless) {
-  // HACK: Set kIndexlessStencils to true for this type of test
   kIndexlessStencils = true;
+}
 
+TEST(system, gemv_stencil_2d_indexless) {
   // Points
   Set points;
   FieldRef<simit_float> b = points.addField<simit_float>("b");
@@ -335,8 +337,6 @@ TEST(system, gemv_stencil_2d_indexless) {
   ASSERT_EQ(181.0, (simit_float)c.get(p10));
   ASSERT_EQ(224.0, (simit_float)c.get(p11));
   ASSERT_EQ(304.0, (simit_float)c.get(p12));
-
-  kIndexlessStencils = false;
 }
 
 TEST(system, gemv_add) {
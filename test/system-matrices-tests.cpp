@@ -127,6 +127,9 @@ TEST(system, add_double_blocked) {
 }
 
 TEST(system, add_stencil) {
+  // HACK: Set kIndexlessStencils to false to test indexed stencils
+  kIndexlessStencils = false;
+
   // Points
   Set points;
   FieldRef<simit_float> b = points.addField<simit_float>("b");
@@ -216,12 +219,11 @@ TEST(system, add_stencil) {
   ASSERT_EQ(191.5, (simit_float)c.get(p10));
   ASSERT_EQ(224.0, (simit_float)c.get(p11));
   ASSERT_EQ(307.5, (simit_float)c.get(p12));
-}
 
-TEST(system, DISABLED_add_stencil_indexless) {
-  // HACK: Set kIndexlessStencils to true for this type of test
   kIndexlessStencils = true;
+}
 
+TEST(system, DISABLED_add_stencil_indexless) {
   // Points
   Set points;
   FieldRef<simit_float> b = points.addField<simit_float>("b");
@@ -312,8 +314,6 @@ TEST(system, DISABLED_add_stencil_indexless) {
   ASSERT_EQ(191.5, (simit_float)c.get(p10));
   ASSERT_EQ(224.0, (simit_float)c.get(p11));
   ASSERT_EQ(307.5, (simit_float)c.get(p12));
-
-  kIndexlessStencils = false;
 }
 
 TEST(system, add_generics) {
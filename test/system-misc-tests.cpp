@@ -1,6 +1,9 @@
 #include "simit-test.h"
 
+#include <cmath>
+
 #include "graph.h"
+#include "init.h"
 #include "program.h"
 #include "error.h"
 
@@ -491,6 +494,237 @@ TEST(system, map_edgeset_no_endpoints_results) {
   ASSERT_EQ(4.0, (simit_float)a.get(s1));
 }
 
+static void checkStencilFields(const std::string& fileName, int nx=4, int ny=3,
+                               Set::LatticeOrder order=Set::Lexicographic) {
+  // Points
+  Set points;
+  FieldRef<simit_float> b = points.addField<simit_float>("b");
+  FieldRef<simit_float> c = points.addField<simit_float>("c");
+
+  // Springs
+  Set springs(points,{nx,ny},order);
+  springs.addField<simit_float>("a");
+
+  for (int y = 0; y < ny; ++y) {
+    for (int x = 0; x < nx; ++x) {
+      b.set(springs.getLatticePoint({x,y}), 1.0 + x + nx*y);
+    }
+  }
+
+  // Compile program and bind arguments
+  Function func = loadFunction(fileName, "main");
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+
+  func.runSafe();
+
+  // Check that outputs are correct, with neighbors wrapping around
+  for (int y = 0; y < ny; ++y) {
+    for (int x = 0; x < nx; ++x) {
+      auto bAt = [&](int dx, int dy) -> simit_float {
+        return b.get(springs.getLatticePoint({(x+dx+nx)%nx, (y+dy+ny)%ny}));
+      };
+      simit_float expected = bAt(1,0) + bAt(-1,0) + bAt(2,0) +
+                             bAt(0,1) + bAt(0,-1) - 5.0*bAt(0,0);
+      SIMIT_EXPECT_FLOAT_EQ(expected,
+                            (simit_float)c.get(springs.getLatticePoint({x,y})));
+    }
+  }
+}
+
+TEST(system, map_stencil_fields) {
+  checkStencilFields(TEST_FILE_NAME);
+}
+
+TEST(system, map_stencil_fields_padded) {
+  // HACK: Set kPaddedLattices to true for this type of test
+  kPaddedLattices = true;
+  checkStencilFields(TEST_FILE_NAME);
+  kPaddedLattices = false;
+}
+
+TEST(system, map_stencil_fields_tiled) {
+  // HACK: Set kTileLattices to true for this type of test. The tiles do not
+  // divide the lattice.
+  kTileLattices = true;
+  kLatticeTileSizes = {3,2};
+  checkStencilFields(TEST_FILE_NAME);
+  kTileLattices = false;
+  kLatticeTileSizes.clear();
+}
+
+TEST(system, map_stencil_fields_morton) {
+  // HACK: Set kMortonLattices to true for this type of test
+  kMortonLattices = true;
+  checkStencilFields(TEST_FILE_NAME, 8, 4, Set::Morton);
+  kMortonLattices = false;
+}
+
+TEST(system, map_vectorized) {
+  // HACK: Set kVectorizeMaps to true for this type of test
+  kVectorizeMaps = true;
+
+  // Points on a chain, with 11 springs, so that the last three springs do not
+  // fill a block of kMapVectorWidth elements
+  const int n = 12;
+  Set points;
+  FieldRef<simit_float,3> x = points.addField<simit_float,3>("x");
+  FieldRef<simit_float,3> f = points.addField<simit_float,3>("f");
+  FieldRef<bool> fixed = points.addField<bool>("fixed");
+  FieldRef<simit_float> w = points.addField<simit_float>("w");
+  FieldRef<simit_float> d = points.addField<simit_float>("d");
+  vector<ElementRef> p;
+  for (int i = 0; i < n; ++i) {
+    p.push_back(points.add());
+    x.set(p[i], {0.1*i*i, 1.0*i, 0.0});
+    fixed.set(p[i], i % 5 == 0);
+    w.set(p[i], 1.0 + i);
+  }
+
+  Set springs(points,points);
+  FieldRef<simit_float> k = springs.addField<simit_float>("k");
+  for (int i = 0; i < n-1; ++i) {
+    k.set(springs.add(p[i], p[i+1]), 1.0 + i);
+  }
+
+  // Compile program and bind arguments
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+
+  func.runSafe();
+
+  // Check outputs
+  vector<vector<double>> fExpected(n, vector<double>(3, 0.0));
+  vector<double> dExpected(n, 0.0);
+  for (int i = 0; i < n-1; ++i) {
+    double dx[] = {0.1*((i+1)*(i+1) - i*i), 1.0, 0.0};
+    double ks = (1.0 + i) * sqrt(dx[0]*dx[0] + dx[1]*dx[1]);
+    for (int j = 0; j < 3; ++j) {
+      if (i % 5 == 0) {
+        fExpected[i+1][j] -= 0.5 * ks * dx[j];
+      }
+      else {
+        fExpected[i][j] += ks * dx[j];
+        fExpected[i+1][j] -= ks * dx[j];
+      }
+    }
+    dExpected[i]   += (1.0 + i) * ((1.0 + i) - (2.0 + i));
+    dExpected[i+1] += (1.0 + i) * ((2.0 + i) - (1.0 + i));
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      ASSERT_NEAR(fExpected[i][j], (double)f.get(p[i])(j), 1e-6);
+    }
+    ASSERT_NEAR(dExpected[i], (double)d.get(p[i]), 1e-6);
+  }
+
+  kVectorizeMaps = false;
+}
+
+TEST(system, map_gathered) {
+  // HACK: Set kGatherEndpointFields to true for this type of test
+  kGatherEndpointFields = true;
+
+  // Points on a chain. The second map reads the gathered masses of the first,
+  // but x is written in between and must be gathered again.
+  const int n = 6;
+  Set points;
+  FieldRef<simit_float,3> x = points.addField<simit_float,3>("x");
+  FieldRef<simit_float> m = points.addField<simit_float>("m");
+  FieldRef<simit_float> d = points.addField<simit_float>("d");
+  FieldRef<simit_float> e = points.addField<simit_float>("e");
+  vector<ElementRef> p;
+  for (int i = 0; i < n; ++i) {
+    p.push_back(points.add());
+    x.set(p[i], {0.5*i*i, 0.0, 1.0*i});
+    m.set(p[i], 1.0 + i);
+  }
+
+  Set springs(points,points);
+  FieldRef<simit_float> k = springs.addField<simit_float>("k");
+  for (int i = 0; i < n-1; ++i) {
+    k.set(springs.add(p[i+1], p[i]), 2.0 + i);
+  }
+
+  // Compile program and bind arguments
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+
+  func.runSafe();
+
+  // Check outputs
+  vector<double> dExpected(n, 0.0);
+  for (int i = 0; i < n-1; ++i) {
+    double dx = 0.5*((i+1)*(i+1) - i*i);
+    double l = (2.0 + i) * sqrt(dx*dx + 1.0);
+    dExpected[i+1] += (1.0 + i) * l;
+    dExpected[i]   += (2.0 + i) * l;
+  }
+  for (int i = 0; i < n; ++i) {
+    ASSERT_NEAR(dExpected[i], (double)d.get(p[i]), 1e-6);
+    ASSERT_NEAR(2.0*dExpected[i], (double)e.get(p[i]), 1e-6);
+    ASSERT_NEAR(1.0*i*i, (double)x.get(p[i])(0), 1e-6);
+  }
+
+  kGatherEndpointFields = false;
+}
+
+TEST(system, map_prefetched) {
+  // HACK: Set kPrefetchIndirectAccesses to true for this type of test, with a
+  // distance that reaches past the end of the springs and of the matrix rows
+  kPrefetchIndirectAccesses = true;
+  kPrefetchDistance = 2;
+
+  const int n = 7;
+  Set points;
+  FieldRef<simit_float> b = points.addField<simit_float>("b");
+  FieldRef<simit_float> c = points.addField<simit_float>("c");
+  vector<ElementRef> p;
+  for (int i = 0; i < n; ++i) {
+    p.push_back(points.add());
+    b.set(p[i], 1.0 + i*i);
+  }
+
+  // Springs on a chain, added in shuffled order
+  Set springs(points,points);
+  FieldRef<simit_float> a = springs.addField<simit_float>("a");
+  for (int j = 0; j < n-1; ++j) {
+    int i = (3*j) % (n-1);
+    a.set(springs.add(p[i], p[i+1]), 1.0 + i);
+  }
+
+  // Compile program and bind arguments
+  Function func = loadFunction(TEST_FILE_NAME, "main");
+  if (!func.defined()) FAIL();
+
+  func.bind("points", &points);
+  func.bind("springs", &springs);
+
+  func.runSafe();
+
+  // Check outputs
+  vector<double> cExpected(n, 0.0);
+  for (int i = 0; i < n-1; ++i) {
+    double bSum = (1.0 + i*i) + (1.0 + (i+1)*(i+1));
+    cExpected[i]   += (1.0 + i) * bSum + (1.0 + (i+1)*(i+1));
+    cExpected[i+1] += (1.0 + i) * bSum + (1.0 + i*i);
+  }
+  for (int i = 0; i < n; ++i) {
+    ASSERT_NEAR(cExpected[i], (double)c.get(p[i]), 1e-6);
+  }
+
+  kPrefetchIndirectAccesses = false;
+  kPrefetchDistance = 0;
+}
+
 TEST(system, assembly_vector_copy) {
   Set points;
   auto result = points.addField<simit_float,2>("result");
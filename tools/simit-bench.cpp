@@ -0,0 +1,546 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "error.h"
+#include "graph.h"
+#include "mesh.h"
+#include "program.h"
+#include "util/util.h"
+
+using namespace std;
+using namespace simit;
+
+#ifndef BENCH_DIR
+#define BENCH_DIR "bench"
+#endif
+
+// Inputs are generated from a fixed seed, so that runs are comparable
+static const unsigned kSeed = 0;
+
+// Interior vertices of generated tet meshes are moved by up to a tenth of the
+// side of a cube
+static const double kJitter = 0.1;
+
+static void printUsage() {
+  cerr << "Usage: simit-bench [options]" << endl << endl
+       << "Options:"                   << endl
+       << "-benchmarks=<name,...>"     << endl
+       << "-sizes=<size,...>"          << endl
+       << "-steps=<steps>"             << endl
+       << "-programs=<directory>"      << endl
+       << "-json[=<file>]"             << endl
+       << "-list"                      << endl;
+}
+
+/// The sets of a benchmark input. Edge sets refer to their endpoint sets, so
+/// the sets are destroyed in the reverse of the order they were added in.
+class Input {
+public:
+  ~Input() {
+    while (!sets.empty()) {
+      sets.pop_back();
+    }
+  }
+
+  Set* add(Set* set) {
+    sets.push_back(unique_ptr<Set>(set));
+    return set;
+  }
+
+  /// The sets to bind to the benchmarked function, by name.
+  vector<pair<string,Set*>> bindings;
+
+  /// The set whose elements the throughput is measured in.
+  Set* elements = nullptr;
+
+private:
+  vector<unique_ptr<Set>> sets;
+};
+
+struct Benchmark {
+  string name;
+  string program;     ///< Simit program in the programs directory
+  string precompute;  ///< Function run once before timing, if any
+  string size;        ///< What the size of an input scales
+  vector<unsigned> sizes;
+  function<void(unsigned, Input*)> create;
+};
+
+static double length(const array<double,3>& a, const array<double,3>& b) {
+  return sqrt((b[0]-a[0])*(b[0]-a[0]) + (b[1]-a[1])*(b[1]-a[1]) +
+              (b[2]-a[2])*(b[2]-a[2]));
+}
+
+/// The mass of a spring of the given length, as the springs app computes it.
+static double getSpringMass(double length) {
+  const double density = 1e3;
+  const double radius  = 0.01;
+  const double pi      = 3.14159265358979;
+  return pi*radius*radius*length*density;
+}
+
+/// Add a point for each vertex of the mesh and a spring for each edge.
+static void addSprings(const MeshVol& mesh, Set* points, Set* springs,
+                       vector<ElementRef>* pointRefs,
+                       vector<ElementRef>* springRefs) {
+  for (size_t i = 0; i < mesh.v.size(); ++i) {
+    pointRefs->push_back(points->add());
+  }
+  for (auto& edge : mesh.edges) {
+    springRefs->push_back(springs->add((*pointRefs)[edge[0]],
+                                       (*pointRefs)[edge[1]]));
+  }
+}
+
+static void createSpringsExplicit(unsigned size, Input* input) {
+  MeshVol mesh = createTetBox(size, size, size, kJitter, kSeed);
+  Set* points = input->add(new Set());
+  FieldRef<double,3> x = points->addField<double,3>("x");
+  FieldRef<double,3> v = points->addField<double,3>("v");
+  points->addField<double,3>("fs");
+  points->addField<double,3>("fg");
+  points->addField<double,3>("M");
+  points->addField<double,3>("p");
+  Set* springs = input->add(new Set(*points, *points));
+  FieldRef<double> m  = springs->addField<double>("m");
+  FieldRef<double> l0 = springs->addField<double>("l0");
+
+  vector<ElementRef> pointRefs, springRefs;
+  addSprings(mesh, points, springs, &pointRefs, &springRefs);
+  for (size_t i = 0; i < pointRefs.size(); ++i) {
+    x.set(pointRefs[i], mesh.v[i]);
+    v.set(pointRefs[i], {0.0, 0.0, 0.0});
+  }
+  for (size_t i = 0; i < springRefs.size(); ++i) {
+    auto& edge = mesh.edges[i];
+    double l = length(mesh.v[edge[0]], mesh.v[edge[1]]);
+    l0.set(springRefs[i], l);
+    m.set(springRefs[i], getSpringMass(l));
+  }
+  input->bindings = {{"points", points}, {"springs", springs}};
+  input->elements = springs;
+}
+
+static void createSpringsImplicit(unsigned size, Input* input) {
+  MeshVol mesh = createTetBox(size, size, size, kJitter, kSeed);
+  Set* points = input->add(new Set());
+  FieldRef<double,3> x   = points->addField<double,3>("x");
+  FieldRef<double,3> v   = points->addField<double,3>("v");
+  FieldRef<double>   m   = points->addField<double>("m");
+  FieldRef<bool>   fixed = points->addField<bool>("fixed");
+  Set* springs = input->add(new Set(*points, *points));
+  FieldRef<double> k  = springs->addField<double>("k");
+  FieldRef<double> l0 = springs->addField<double>("l0");
+
+  // Each spring adds half its mass to each endpoint
+  vector<ElementRef> pointRefs, springRefs;
+  addSprings(mesh, points, springs, &pointRefs, &springRefs);
+  vector<double> masses(pointRefs.size(), 0.0);
+  for (size_t i = 0; i < springRefs.size(); ++i) {
+    auto& edge = mesh.edges[i];
+    double l = length(mesh.v[edge[0]], mesh.v[edge[1]]);
+    l0.set(springRefs[i], l);
+    k.set(springRefs[i], 1e4);
+    masses[edge[0]] += 0.5*getSpringMass(l);
+    masses[edge[1]] += 0.5*getSpringMass(l);
+  }
+
+  // Points below the floor are fixed
+  for (size_t i = 0; i < pointRefs.size(); ++i) {
+    x.set(pointRefs[i], mesh.v[i]);
+    v.set(pointRefs[i], {0.0, 0.0, 0.0});
+    m.set(pointRefs[i], masses[i]);
+    fixed.set(pointRefs[i], mesh.v[i][2] < 0.1);
+  }
+  input->bindings = {{"points", points}, {"springs", springs}};
+  input->elements = springs;
+}
+
+static void createFEM(unsigned size, Input* input) {
+  MeshVol mesh = createTetBox(size, size, size, kJitter, kSeed);
+  Set* verts = input->add(new Set());
+  FieldRef<double,3> x  = verts->addField<double,3>("x");
+  FieldRef<double,3> v  = verts->addField<double,3>("v");
+  FieldRef<double,3> fe = verts->addField<double,3>("fe");
+  FieldRef<int>      c  = verts->addField<int>("c");
+  FieldRef<double>   m  = verts->addField<double>("m");
+  Set* tets = input->add(new Set(*verts, *verts, *verts, *verts));
+  FieldRef<double> u = tets->addField<double>("u");
+  FieldRef<double> l = tets->addField<double>("l");
+  tets->addField<double>("W");
+  tets->addField<double,3,3>("B");
+
+  // Young's modulus and Poisson's ratio, as in the fem test
+  const double E  = 5e3;
+  const double nu = 0.45;
+
+  // Vertices at the bottom of the box are constrained
+  vector<ElementRef> vertRefs;
+  for (auto& position : mesh.v) {
+    ElementRef vert = verts->add();
+    vertRefs.push_back(vert);
+    bool constrained = position[1] < 1e-4;
+    x.set(vert, position);
+    v.set(vert, constrained ? array<double,3>{{0.0, 0.0, 0.0}}
+                            : array<double,3>{{0.1, 0.0, 0.1}});
+    fe.set(vert, {0.0, 0.0, 0.0});
+    c.set(vert, constrained ? 1 : 0);
+    m.set(vert, 0.0);
+  }
+  for (auto& e : mesh.e) {
+    ElementRef tet = tets->add(vertRefs[e[0]], vertRefs[e[1]],
+                               vertRefs[e[2]], vertRefs[e[3]]);
+    u.set(tet, 0.5*E/nu);
+    l.set(tet, E*nu/((1+nu)*(1-2*nu)));
+  }
+  input->bindings = {{"verts", verts}, {"tets", tets}};
+  input->elements = tets;
+}
+
+static void createCG(unsigned size, Input* input) {
+  MeshVol mesh = createTetBox(size, size, size, kJitter, kSeed);
+  Set* points = input->add(new Set());
+  FieldRef<double> b = points->addField<double>("b");
+  points->addField<double>("c");
+  points->addField<int>("id");
+  Set* springs = input->add(new Set(*points, *points));
+  FieldRef<double> a = springs->addField<double>("a");
+
+  vector<ElementRef> pointRefs, springRefs;
+  addSprings(mesh, points, springs, &pointRefs, &springRefs);
+  for (size_t i = 0; i < pointRefs.size(); ++i) {
+    b.set(pointRefs[i], 1.0 + (i % 7));
+  }
+  for (ElementRef spring : springRefs) {
+    a.set(spring, 1.0);
+  }
+  input->bindings = {{"points", points}, {"springs", springs}};
+  input->elements = springs;
+}
+
+static void createPageRank(unsigned size, Input* input) {
+  Set* pages = input->add(new Set());
+  pages->addField<double>("outlinks");
+  pages->addField<double>("pr");
+  Set* links = input->add(new Set(*pages, *pages));
+  createPowerLawGraph(pages, links, size, 8, kSeed);
+  input->bindings = {{"pages", pages}, {"links", links}};
+  input->elements = links;
+}
+
+static void createStencil(const vector<int>& dimensions, Input* input) {
+  Set* points = input->add(new Set());
+  FieldRef<double> b = points->addField<double>("b");
+  points->addField<double>("c");
+  Set* links = input->add(new Set(*points, dimensions));
+  FieldRef<double> a = links->addField<double>("a");
+  for (ElementRef point : *points) {
+    b.set(point, 1.0 + (point.getIdent() % 7));
+  }
+  for (ElementRef link : *links) {
+    a.set(link, 1.0);
+  }
+  input->bindings = {{"points", points}, {"springs", links}};
+  input->elements = points;
+}
+
+static vector<Benchmark> getBenchmarks() {
+  return {
+    {"springs_explicit", "springs_explicit.sim", "", "cubes per side",
+     {8, 16, 32}, createSpringsExplicit},
+    {"springs_implicit", "springs_implicit.sim", "", "cubes per side",
+     {8, 16, 32}, createSpringsImplicit},
+    {"fem_linear", "fem_linear.sim", "initializeTet", "cubes per side",
+     {4, 8, 16}, createFEM},
+    {"fem_neohookean", "fem_neohookean.sim", "initializeTet",
+     "cubes per side", {4, 8, 16}, createFEM},
+    {"cg", "cg.sim", "", "cubes per side", {8, 16, 32}, createCG},
+    {"pagerank", "pagerank.sim", "", "pages", {10000, 100000, 1000000},
+     createPageRank},
+    {"stencil_2d", "stencil_2d.sim", "", "points per side", {64, 256, 1024},
+     [](unsigned size, Input* input) {
+       createStencil({(int)size, (int)size}, input);
+     }},
+    {"stencil_3d", "stencil_3d.sim", "", "points per side", {16, 32, 64},
+     [](unsigned size, Input* input) {
+       createStencil({(int)size, (int)size, (int)size}, input);
+     }},
+  };
+}
+
+/// The measurements of a benchmark run on an input of one size.
+struct Result {
+  string benchmark;
+  unsigned size;
+  int elements;
+  double compileTime;
+  double initTime;
+  vector<double> stepTimes;
+
+  /// The bytes of the fields and endpoints of the bound sets. Each step reads
+  /// or writes at least these bytes once.
+  size_t bytes;
+  MemoryReport memory;
+
+  double getMinStepTime() const {
+    return *min_element(stepTimes.begin(), stepTimes.end());
+  }
+  double getMedianStepTime() const {
+    vector<double> times = stepTimes;
+    sort(times.begin(), times.end());
+    return times[times.size()/2];
+  }
+  double getMeanStepTime() const {
+    return accumulate(stepTimes.begin(), stepTimes.end(), 0.0) /
+           stepTimes.size();
+  }
+  double getElementsPerSecond() const {
+    return elements / getMedianStepTime();
+  }
+  double getGBPerSecond() const {
+    return bytes / getMedianStepTime() / 1e9;
+  }
+};
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+  chrono::duration<double> time = chrono::steady_clock::now() - start;
+  return time.count();
+}
+
+static Result run(const Benchmark& benchmark, unsigned size, int steps,
+                  const string& programs) {
+  Result result;
+  result.benchmark = benchmark.name;
+  result.size = size;
+
+  Input input;
+  benchmark.create(size, &input);
+  result.elements = input.elements->getSize();
+  result.bytes = 0;
+  for (auto& binding : input.bindings) {
+    result.bytes += binding.second->getFieldBytes() +
+                    binding.second->getEndpointBytes();
+  }
+
+  Program program;
+  auto start = chrono::steady_clock::now();
+  program.loadFile(programs + "/" + benchmark.program);
+  Function function = program.compile("main");
+  result.compileTime = secondsSince(start);
+
+  if (benchmark.precompute != "") {
+    Function precompute = program.compile(benchmark.precompute);
+    for (auto& binding : input.bindings) {
+      precompute.bind(binding.first, binding.second);
+    }
+    precompute.runSafe();
+  }
+
+  for (auto& binding : input.bindings) {
+    function.bind(binding.first, binding.second);
+  }
+  start = chrono::steady_clock::now();
+  function.init();
+  result.initTime = secondsSince(start);
+
+  // The first step warms the caches and is not measured
+  function.unmapArgs();
+  function.run();
+  for (int i = 0; i < steps; ++i) {
+    start = chrono::steady_clock::now();
+    function.run();
+    result.stepTimes.push_back(secondsSince(start));
+  }
+  function.mapArgs();
+
+  result.memory = function.getMemoryReport();
+  return result;
+}
+
+static void writeJSON(ostream& os, const vector<Result>& results) {
+  auto precision = os.precision(9);
+  os << "{\"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    os << (i == 0 ? "" : ",") << endl
+       << "  {\"name\": " << util::jsonString(result.benchmark)
+       << ", \"size\": " << result.size
+       << ", \"elements\": " << result.elements
+       << ", \"compile_seconds\": " << result.compileTime
+       << ", \"init_seconds\": " << result.initTime
+       << ", \"steps\": " << result.stepTimes.size()
+       << ", \"step_seconds\": {\"min\": " << result.getMinStepTime()
+       << ", \"median\": " << result.getMedianStepTime()
+       << ", \"mean\": " << result.getMeanStepTime() << "}"
+       << ", \"elements_per_second\": " << result.getElementsPerSecond()
+       << ", \"gb_per_second\": " << result.getGBPerSecond()
+       << ", \"memory_bytes\": " << result.memory.getTotal()
+       << ", \"peak_buffer_bytes\": " << result.memory.getPeak() << "}";
+  }
+  os << endl << "]}" << endl;
+  os.precision(precision);
+}
+
+static void printHeader(ostream& os) {
+  os << left << setw(18) << "benchmark" << right << setw(9) << "size"
+     << setw(10) << "elements" << setw(12) << "compile s" << setw(10)
+     << "init s" << setw(12) << "step ms" << setw(10) << "Melem/s"
+     << setw(8) << "GB/s" << setw(12) << "memory MB" << endl;
+}
+
+static void printResult(ostream& os, const Result& result) {
+  auto flags = os.setf(ios::fixed, ios::floatfield);
+  auto precision = os.precision(3);
+  os << left << setw(18) << result.benchmark << right << setw(9)
+     << result.size << setw(10) << result.elements << setw(12)
+     << result.compileTime << setw(10) << result.initTime << setw(12)
+     << 1e3 * result.getMedianStepTime() << setw(10)
+     << result.getElementsPerSecond() / 1e6 << setw(8)
+     << result.getGBPerSecond() << setw(12)
+     << result.memory.getTotal() / 1e6 << endl;
+  os.precision(precision);
+  os.flags(flags);
+}
+
+static bool parseSizes(const string& list, vector<unsigned>* sizes) {
+  for (auto& size : util::split(list, ",")) {
+    int value = atoi(size.c_str());
+    if (value <= 0) {
+      return false;
+    }
+    sizes->push_back(value);
+  }
+  return sizes->size() > 0;
+}
+
+int main(int argc, const char* argv[]) {
+  vector<Benchmark> benchmarks = getBenchmarks();
+  vector<string> selected;
+  vector<unsigned> sizes;
+  int steps = 10;
+  string programs = BENCH_DIR;
+  bool json = false;
+  string jsonFile;
+
+  // Parse Arguments
+  for (int i=1; i < argc; ++i) {
+    string arg = argv[i];
+    std::vector<std::string> keyValPair = simit::util::split(arg, "=");
+    if (keyValPair.size() == 1) {
+      if (arg == "-json") {
+        json = true;
+      }
+      else if (arg == "-list") {
+        for (auto& benchmark : benchmarks) {
+          cout << left << setw(18) << benchmark.name << benchmark.size << ":";
+          for (unsigned size : benchmark.sizes) {
+            cout << " " << size;
+          }
+          cout << endl;
+        }
+        return 0;
+      }
+      else {
+        printUsage();
+        return 3;
+      }
+    }
+    else if (keyValPair.size() == 2) {
+      if (keyValPair[0] == "-benchmarks") {
+        selected = simit::util::split(keyValPair[1], ",");
+      }
+      else if (keyValPair[0] == "-sizes") {
+        if (!parseSizes(keyValPair[1], &sizes)) {
+          printUsage();
+          return 3;
+        }
+      }
+      else if (keyValPair[0] == "-steps") {
+        steps = atoi(keyValPair[1].c_str());
+        if (steps <= 0) {
+          printUsage();
+          return 3;
+        }
+      }
+      else if (keyValPair[0] == "-programs") {
+        programs = keyValPair[1];
+      }
+      else if (keyValPair[0] == "-json") {
+        json = true;
+        jsonFile = keyValPair[1];
+      }
+      else {
+        printUsage();
+        return 3;
+      }
+    }
+    else {
+      printUsage();
+      return 3;
+    }
+  }
+
+  for (auto& name : selected) {
+    if (find_if(benchmarks.begin(), benchmarks.end(),
+                [&name](const Benchmark& b) {return b.name == name;})
+        == benchmarks.end()) {
+      cerr << "Error: Unknown benchmark " << name << endl;
+      return 3;
+    }
+  }
+
+  simit::init("cpu", sizeof(double));
+
+  // The table is written unless the JSON goes to stdout
+  bool table = !json || jsonFile != "";
+  if (table) {
+    printHeader(cout);
+  }
+  vector<Result> results;
+  int status = 0;
+  for (auto& benchmark : benchmarks) {
+    if (selected.size() > 0 &&
+        find(selected.begin(), selected.end(), benchmark.name) ==
+        selected.end()) {
+      continue;
+    }
+    for (unsigned size : (sizes.size() > 0) ? sizes : benchmark.sizes) {
+      try {
+        results.push_back(run(benchmark, size, steps, programs));
+        if (table) {
+          printResult(cout, results.back());
+        }
+      }
+      catch (SimitException&) {
+        // The error has been written to stderr
+        cerr << "Error: " << benchmark.name << " failed at size " << size
+             << endl;
+        status = 1;
+      }
+    }
+  }
+
+  if (json) {
+    if (jsonFile != "") {
+      ofstream file(jsonFile, ios_base::trunc);
+      if (!file.good()) {
+        cerr << "Error: Could not open file " << jsonFile << endl;
+        return 2;
+      }
+      writeJSON(file, results);
+    }
+    else {
+      writeJSON(cout, results);
+    }
+  }
+  return status;
+}
@@ -7,6 +7,7 @@
 #include "ir_printer.h"
 #include "ir_rewriter.h"
 #include "lower/lower.h"
+#include "lower/operation_counts.h"
 #include "temps.h"
 #include "flatten.h"
 #include "frontend/frontend.h"
@@ -14,6 +15,10 @@
 #include "error.h"
 #include "util/util.h"
 #include "storage.h"
+#include "graph.h"
+#include "mesh.h"
+#include "reorder.h"
+#include "locality.h"
 
 #include "backend/backend.h"
 #include "backend/backend_function.h"
@@ -28,9 +33,12 @@ static void printUsage() {
        << "-emit-simit"         << endl
        << "-emit-llvm"          << endl
        << "-emit-asm"           << endl
+       << "-emit-counts"        << endl
+       << "-time-passes"        << endl
        << "-files"              << endl
        << "-compile=<function>" << endl
        << "-section=<section>"  << endl
+       << "-locality=<mesh>"    << endl
        << "-gpu";
 }
 const ios_base::openmode outputMode = ios_base::trunc;
@@ -40,6 +48,102 @@ unique_ptr<ostream> irOutputStream(string sourceFile, string suffix="") {
   return unique_ptr<ostream>(new ofstream(filename, outputMode));
 }
 
+// Print the locality metrics of a mesh's element set under each reordering
+// policy. The mesh is an .obj triangle mesh, a tetgen .node file (with a
+// matching .ele file) or a MeshVol file.
+static int printLocality(const string& meshFile) {
+  vector<array<double,3>> vertices;
+  vector<vector<int>> elements;
+  auto endsWith = [&](const string& suffix) {
+    return meshFile.size() >= suffix.size() &&
+        meshFile.compare(meshFile.size()-suffix.size(), suffix.size(),
+                         suffix) == 0;
+  };
+  int status;
+  if (endsWith(".obj")) {
+    Mesh mesh;
+    status = mesh.load(meshFile);
+    vertices = mesh.v;
+    for (auto& t : mesh.t) {
+      elements.push_back({t[0], t[1], t[2]});
+    }
+  }
+  else {
+    MeshVol mesh;
+    status = endsWith(".node")
+        ? mesh.loadTet(meshFile, meshFile.substr(0, meshFile.size()-5)+".ele")
+        : mesh.load(meshFile);
+    vertices = mesh.v;
+    elements = mesh.e;
+  }
+  if (status != 0 || elements.size() == 0) {
+    cerr << "Error: Could not load mesh " << meshFile << endl;
+    return 2;
+  }
+  const size_t cardinality = elements[0].size();
+  for (auto& element : elements) {
+    if (element.size() != cardinality) {
+      cerr << "Error: Mixed element types in " << meshFile << endl;
+      return 2;
+    }
+  }
+
+  vector<pair<string,ReorderPolicy>> policies = {
+    {"none", ReorderPolicy::None},
+    {"hilbert", ReorderPolicy::Hilbert},
+    {"rcm", ReorderPolicy::RCM}
+  };
+  for (auto& policy : policies) {
+    Set points;
+    FieldRef<double,3> x = points.addField<double,3>("x");
+    vector<ElementRef> refs;
+    for (auto& v : vertices) {
+      refs.push_back(points.add());
+      x.set(refs.back(), {v[0], v[1], v[2]});
+    }
+    points.setSpatialField("x");
+
+    unique_ptr<Set> elementSet;
+    switch (cardinality) {
+      case 2:
+        elementSet.reset(new Set(points, points));
+        for (auto& e : elements) {
+          elementSet->add(refs[e[0]], refs[e[1]]);
+        }
+        break;
+      case 3:
+        elementSet.reset(new Set(points, points, points));
+        for (auto& e : elements) {
+          elementSet->add(refs[e[0]], refs[e[1]], refs[e[2]]);
+        }
+        break;
+      case 4:
+        elementSet.reset(new Set(points, points, points, points));
+        for (auto& e : elements) {
+          elementSet->add(refs[e[0]], refs[e[1]], refs[e[2]], refs[e[3]]);
+        }
+        break;
+      case 8:
+        elementSet.reset(new Set(points, points, points, points,
+                                 points, points, points, points));
+        for (auto& e : elements) {
+          elementSet->add(refs[e[0]], refs[e[1]], refs[e[2]], refs[e[3]],
+                          refs[e[4]], refs[e[5]], refs[e[6]], refs[e[7]]);
+        }
+        break;
+      default:
+        cerr << "Error: Unsupported element cardinality " << cardinality
+             << endl;
+        return 2;
+    }
+
+    reorderSet(*elementSet, policy.second);
+    cout << "--- Locality (" << policy.first << ")" << endl
+         << computeLocalityMetrics(*elementSet) << endl;
+  }
+  return 0;
+}
+
 int main(int argc, const char* argv[]) {
   if (argc < 2) {
     printUsage();
@@ -53,6 +157,8 @@ int main(int argc, const char* argv[]) {
   ostream* simitos = nullptr;
   ostream* llvmos  = nullptr;
   ostream* asmos   = nullptr;
+  ostream* countsos = nullptr;
+  ostream* timeos = nullptr;
 
   std::unique_ptr<ostream> simitosCleanup;
   std::unique_ptr<ostream> llvmosCleanup;
@@ -61,6 +167,7 @@ int main(int argc, const char* argv[]) {
   string section;
   string function;
   string sourceFile;
+  string localityMesh;
 
   // Parse Arguments
   for (int i=1; i < argc; ++i) {
@@ -82,6 +189,12 @@ int main(int argc, const char* argv[]) {
         else if (arg == "-emit-asm") {
           asmos = &cout;
         }
+        else if (arg == "-emit-counts") {
+          countsos = &cout;
+        }
+        else if (arg == "-time-passes") {
+          timeos = &cout;
+        }
         else if (arg == "-compile") {
           compile = true;
         }
@@ -104,6 +217,9 @@ int main(int argc, const char* argv[]) {
           compile = true;
           function = keyValPair[1];
         }
+        else if (keyValPair[0] == "-locality") {
+          localityMesh = keyValPair[1];
+        }
         else {
           printUsage();
           return 3;
@@ -124,6 +240,9 @@ int main(int argc, const char* argv[]) {
       }
     }
   }
+  if (localityMesh != "") {
+    return printLocality(localityMesh);
+  }
   if (sourceFile == "") {
     printUsage();
     return 3;
@@ -185,7 +304,11 @@ int main(int argc, const char* argv[]) {
   std::vector<simit::ParseError> errors;
   simit::internal::ProgramContext ctx;
 
-  status = frontend.parseString(source, &ctx, &errors);
+  // The time of each compilation stage, if passes are timed
+  CompileProfile compileProfile;
+  CompileProfile* profile = timeos ? &compileProfile : nullptr;
+
+  status = frontend.parseString(source, &ctx, &errors, profile);
   if (status != 0) {
     for (auto &error : errors) {
       cerr << error << endl;
@@ -248,13 +371,22 @@ int main(int argc, const char* argv[]) {
       *simitos << "% Compile " << function << endl;
     }
 
-    func = lower(func, simitos);
+    func = lower(func, simitos, false, profile);
+
+    // Print the lowered code with the operation counts of its loops
+    if (countsos) {
+      *countsos << "--- Operation Counts" << endl;
+      simit::ir::IRPrinterCallGraph(*countsos).print(
+          simit::ir::annotateOperationCounts(func));
+      *countsos << endl;
+    }
 
     // Emit and print llvm code
     // NB: The LLVM code gets further optimized at init time (OSR, etc.)
-    if (llvmos || asmos) {
+    if (llvmos || asmos || (timeos && !gpu)) {
       backend::Backend backend("cpu");
       simit::Function  llvmFunc(backend.compile(func));
+      compileProfile.append(llvmFunc.getCompileProfile());
 
       if (llvmos) {
         if (!fileoutput && simitos) {
@@ -281,5 +413,9 @@ int main(int argc, const char* argv[]) {
     }
   }
 
+  if (timeos) {
+    *timeos << "--- Compile Time" << endl << compileProfile << endl;
+  }
+
   return 0;
 }